@@ -18,7 +18,6 @@
 #include <osquery/database/database.h>
 #include <osquery/filesystem/fileops.h>
 #include <osquery/core/flags.h>
-#include <osquery/hashing/hashing.h>
 #include <osquery/logger/logger.h>
 #include <osquery/remote/serializers/json.h>
 #include <osquery/utils/conversions/split.h>
@@ -66,7 +65,6 @@ CLI_FLAG(uint32,
          "Seconds to store successful carve result metadata (in carves table)");
 
 DECLARE_bool(disable_carver);
-DECLARE_uint64(read_max);
 
 std::atomic<bool> CarverRunnable::running_{false};
 
@@ -150,71 +148,28 @@ Carver::Carver(const std::set<std::string>& paths,
   requestId_ = requestId;
 }
 
-Status Carver::createPaths() {
-  // TODO: Adding in a manifest file of all carved files might be nice.
-  carveDir_ =
-      fs::temp_directory_path() / fs::path(kCarvePathPrefix + carveGuid_);
-  auto ret = fs::create_directory(carveDir_);
-  if (!ret) {
-    return Status::failure("Failed to create carve file store");
-  }
-
-  // Store the path to our archive for later exfiltration
-  archivePath_ = carveDir_ / fs::path(kCarveNamePrefix + carveGuid_ + ".tar");
-  compressPath_ =
-      carveDir_ / fs::path(kCarveNamePrefix + carveGuid_ + ".tar.zst");
-
+Status Carver::carve() {
   // Update the DB to reflect that the carve is pending.
   updateCarveValue(carveGuid_, "status", "PENDING");
-  return Status::success();
-};
-
-Carver::~Carver() {
-  fs::remove_all(carveDir_);
-}
-
-Status Carver::carve() {
-  auto s = createPaths();
-  if (!s.ok()) {
-    updateCarveValue(carveGuid_, "status", "CREATE PATHS FAILED");
-    return s;
-  }
-
   const auto carvedFiles = carveAll();
-  s = archive(carvedFiles, archivePath_, FLAGS_carver_block_size);
+
+  // The upload session announces the size of the archive. Without compression
+  // it only depends on the file sizes, so the content does not need to be
+  // read to measure it.
+  CarveCounter counter;
+  auto s = streamCarve(carvedFiles,
+                       FLAGS_carver_compression,
+                       FLAGS_carver_compression,
+                       FLAGS_carver_block_size,
+                       counter);
   if (!s.ok()) {
     VLOG(1) << "Failed to create carve archive: " << s.getMessage();
     updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
     return s;
   }
+  updateCarveValue(carveGuid_, "size", std::to_string(counter.size()));
 
-  fs::path uploadPath;
-  if (FLAGS_carver_compression) {
-    uploadPath = compressPath_;
-    s = compress(archivePath_, compressPath_);
-    if (!s.ok()) {
-      VLOG(1) << "Failed to compress carve archive: " << s.getMessage();
-      updateCarveValue(carveGuid_, "status", "COMPRESS FAILED");
-      return s;
-    }
-  } else {
-    uploadPath = archivePath_;
-  }
-
-  PlatformFile uploadFile(uploadPath, PF_OPEN_EXISTING | PF_READ);
-  updateCarveValue(carveGuid_, "size", std::to_string(uploadFile.size()));
-
-  std::string uploadHash =
-      (uploadFile.size() > FLAGS_read_max)
-          ? "-1"
-          : hashFromFile(HashType::HASH_TYPE_SHA256, uploadPath.string());
-  if (uploadHash == "-1") {
-    VLOG(1)
-        << "Archive file size exceeds read max, skipping integrity computation";
-  }
-  updateCarveValue(carveGuid_, "sha256", uploadHash);
-
-  s = postCarve(uploadPath);
+  s = postCarve(carvedFiles, counter.size());
   if (!s.ok()) {
     VLOG(1) << "Failed to post carve: " << s.getMessage();
     updateCarveValue(carveGuid_, "status", "DATA POST FAILED");
@@ -223,8 +178,8 @@ Status Carver::carve() {
   return Status::success();
 };
 
-std::set<fs::path> Carver::carveAll() {
-  std::set<fs::path> carvedFiles;
+std::vector<CarveFile> Carver::carveAll() {
+  std::vector<CarveFile> carvedFiles;
   for (const auto& srcPath : carvePaths_) {
     // Ensure the file is a flat file on disk before carving
     PlatformFile src(srcPath, PF_OPEN_EXISTING | PF_READ);
@@ -232,57 +187,60 @@ std::set<fs::path> Carver::carveAll() {
       VLOG(1) << "File does not exist on disk or is subdirectory: " << srcPath;
       continue;
     }
-    const auto dstPath = carveDir_ / srcPath.leaf();
-    PlatformFile dst(dstPath, PF_CREATE_NEW | PF_WRITE);
-    if (!dst.isValid()) {
-      VLOG(1) << "Destination temporary file is invalid: " << dstPath;
-      continue;
-    }
-    Status s = blockwiseCopy(src, dst);
-    if (s.ok()) {
-      carvedFiles.insert(dstPath);
-    } else {
-      VLOG(1) << "Failed to copy file from " << srcPath << " to " << dstPath
-              << " " << s.getMessage();
-    }
+    carvedFiles.push_back({srcPath, src.size()});
   }
   return carvedFiles;
 }
 
-Status Carver::blockwiseCopy(PlatformFile& src, PlatformFile& dst) {
-  auto blkCount = ceil(static_cast<double>(src.size()) /
-                       static_cast<double>(FLAGS_carver_block_size));
-
-  std::vector<char> inBuff(FLAGS_carver_block_size, 0);
-  for (size_t i = 0; i < blkCount; i++) {
-    auto bytesRead = src.read(inBuff.data(), FLAGS_carver_block_size);
-    if (bytesRead > 0) {
-      auto bytesWritten = dst.write(inBuff.data(), bytesRead);
-      if (bytesWritten < 0) {
-        return Status(1, "Error writing bytes to tmp fs");
-      }
-    }
+Status Carver::postCarve(const std::vector<CarveFile>& files, uint64_t size) {
+  auto blkCount =
+      static_cast<size_t>(ceil(static_cast<double>(size) /
+                               static_cast<double>(FLAGS_carver_block_size)));
+
+  std::string session_id;
+  auto status = startUpload(blkCount, size, session_id);
+  if (!status.ok()) {
+    return status;
   }
 
+  CarveBlockWriter uploader(
+      FLAGS_carver_block_size,
+      [this, &session_id](size_t block_id, const std::string& block) {
+        return uploadBlock(session_id, block_id, block);
+      });
+  CarveHasher hasher(uploader);
+  status = streamCarve(files,
+                       FLAGS_carver_compression,
+                       true,
+                       FLAGS_carver_block_size,
+                       hasher);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // A compressed archive changes size if a file changed since it was measured.
+  if (hasher.size() != size) {
+    return Status::failure("Carved files changed during the upload");
+  }
+
+  updateCarveValue(carveGuid_, "sha256", hasher.digest());
+  updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
   return Status::success();
 };
 
-Status Carver::postCarve(const boost::filesystem::path& path) {
+Status Carver::startUpload(size_t block_count,
+                           uint64_t size,
+                           std::string& session_id) {
   // Construct the uri we post our data back to:
   auto startUri = TLSRequestHelper::makeURI(FLAGS_carver_start_endpoint);
   Request<TLSTransport, JSONSerializer> startRequest(startUri);
   startRequest.setOption("hostname", FLAGS_tls_hostname);
 
   // Perform the start request to get the session id
-  PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
-  auto blkCount =
-      static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
-                               static_cast<double>(FLAGS_carver_block_size)));
   JSON startParams;
-
-  startParams.add("block_count", blkCount);
+  startParams.add("block_count", block_count);
   startParams.add("block_size", size_t(FLAGS_carver_block_size));
-  startParams.add("carve_size", pFile.size());
+  startParams.add("carve_size", size);
   startParams.add("carve_id", carveGuid_);
   startParams.add("request_id", requestId_);
   startParams.add("node_key", getNodeKey("tls"));
@@ -307,41 +265,34 @@ Status Carver::postCarve(const boost::filesystem::path& path) {
     return Status(1, "Invalid session_id received from remote endpoint");
   }
 
-  std::string session_id = it->value.GetString();
+  session_id = it->value.GetString();
   if (session_id.empty()) {
     return Status(1, "Empty session_id received from remote endpoint");
   }
+  return Status::success();
+}
 
+Status Carver::uploadBlock(const std::string& session_id,
+                           size_t block_id,
+                           const std::string& block) {
   auto contUri = TLSRequestHelper::makeURI(FLAGS_carver_continue_endpoint);
   Request<TLSTransport, JSONSerializer> contRequest(contUri);
   contRequest.setOption("hostname", FLAGS_tls_hostname);
-  for (size_t i = 0; i < blkCount; i++) {
-    std::vector<char> block(FLAGS_carver_block_size, 0);
-    auto r = pFile.read(block.data(), FLAGS_carver_block_size);
 
-    if (r != FLAGS_carver_block_size && r > 0) {
-      // resize the buffer to size we read as last block is likely smaller
-      block.resize(r);
-    }
+  JSON params;
+  params.add("block_id", block_id);
+  params.add("session_id", session_id);
+  params.add("request_id", requestId_);
+  params.add("data", base64::encode(block));
 
-    JSON params;
-    params.add("block_id", i);
-    params.add("session_id", session_id);
-    params.add("request_id", requestId_);
-    params.add("data", base64::encode(std::string(block.begin(), block.end())));
-
-    // TODO: Error sending files.
-    status = contRequest.call(params);
-    if (!status.ok()) {
-      VLOG(1) << "Post of carved block " << i
-              << " failed: " << status.getMessage();
-      continue;
-    }
+  // The stream cannot resend a block, a failed post ends the carve.
+  auto status = contRequest.call(params);
+  if (!status.ok()) {
+    return Status::failure("Post of carved block " + std::to_string(block_id) +
+                           " failed: " + status.getMessage());
   }
-
-  updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
   return Status::success();
-};
+}
 
 void scheduleCarves() {
   if (!FLAGS_disable_carver && kCarverPendingCarves &&
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <osquery/carver/carver_stream.h>
 #include <osquery/dispatcher/dispatcher.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/utils/status/status.h>
@@ -16,6 +17,7 @@
 #include <atomic>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace osquery {
 
@@ -91,7 +93,7 @@ class Carver {
          const std::string& guid,
          const std::string& requestId);
 
-  virtual ~Carver();
+  virtual ~Carver() = default;
 
   /**
    * @brief A helper function to perform a start to finish carve.
@@ -102,50 +104,44 @@ class Carver {
    */
   Status carve();
 
-  /// Create the archive and compression paths.
-  Status createPaths();
-
  protected:
   /**
-   * @brief A helper function that 'carves' all files from disk.
+   * @brief A helper function that selects the files to carve.
    *
-   * This function copies all source files to a temporary directory and returns
-   * a list of all destination files.
+   * This function returns every carve path that is a regular file along with
+   * its current size, which is the size recorded in the archive.
    */
-  std::set<boost::filesystem::path> carveAll();
+  std::vector<CarveFile> carveAll();
 
   /**
-   * @brief A helper function that does a blockwise copy from src to dst.
+   * @brief Helper function to POST a carve to the graph endpoint.
+   *
+   * The archive of the carved files is streamed through the hasher and cut
+   * into blocks that are POSTed as soon as they are complete, no copy of the
+   * carve is stored on disk.
    *
-   * This function copies the source file to the destination file, doing so
-   * by blocks specified with FLAGS_carver_block_size (defaults to 8K).
+   * @param files the files to carve.
+   * @param size the size of the archive announced when starting the upload.
    */
-  Status blockwiseCopy(PlatformFile& src, PlatformFile& dst);
+  Status postCarve(const std::vector<CarveFile>& files, uint64_t size);
 
   /**
-   * @brief Helper function to POST a carve to the graph endpoint.
+   * @brief Start an upload session with the carver_start_endpoint.
    *
-   * Once all of the files have been carved and the tgz has been
-   * created, we POST the carved file to an endpoint specified by the
-   * carver_start_endpoint and carver_continue_endpoint.
+   * @param block_count the number of blocks that will be uploaded.
+   * @param size the size of the uploaded archive.
+   * @param session_id [output] the session receiving the blocks.
    */
-  virtual Status postCarve(const boost::filesystem::path& path);
+  virtual Status startUpload(size_t block_count,
+                             uint64_t size,
+                             std::string& session_id);
 
-  /// Helper function to return the carve directory.
-  boost::filesystem::path getCarveDir() {
-    return carveDir_;
-  }
+  /// POST one block of the archive to the carver_continue_endpoint.
+  virtual Status uploadBlock(const std::string& session_id,
+                             size_t block_id,
+                             const std::string& block);
 
  protected:
-  /**
-   * @brief a variable to keep track of the temp path used in carving.
-   *
-   * This variable represents the location in which we store all of our carved
-   * files. When a carve has completed all of the desired files, as well
-   * as the tar archive should reside in this directory.
-   */
-  boost::filesystem::path carveDir_;
-
   /**
    * @brief a variable tracking all of the paths we attempt to carve.
    *
@@ -154,22 +150,6 @@ class Carver {
    */
   std::set<boost::filesystem::path> carvePaths_;
 
-  /**
-   * @brief a helper variable for keeping track of the posix tar archive.
-   *
-   * This variable is the absolute location of the tar archive created from
-   * tar'ing all of the carved files from the carve temp dir.
-   */
-  boost::filesystem::path archivePath_;
-
-  /**
-   * @brief a helper variable for keeping track of the compressed tar.
-   *
-   * This variable is the absolute location of the tar archive created from
-   * zstd of the archive.
-   */
-  boost::filesystem::path compressPath_;
-
   /**
    * @brief a unique ID identifying the 'carve'.
    *
@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <memory>
+
+// This define is required for Windows static linking of libarchive
+#define LIBARCHIVE_STATIC
+#include <archive.h>
+#include <archive_entry.h>
+#include <zstd.h>
+
+#include <osquery/carver/carver_stream.h>
+#include <osquery/filesystem/fileops.h>
+#include <osquery/logger/logger.h>
+
+namespace osquery {
+
+namespace {
+
+/// Compress a stream with zstd, then pass it on.
+class CarveCompressor : public CarveSink {
+ public:
+  explicit CarveCompressor(CarveSink& next)
+      : next_(next), buffer_(ZSTD_CStreamOutSize()) {}
+
+  ~CarveCompressor() override {
+    if (stream_ != nullptr) {
+      ZSTD_freeCStream(stream_);
+    }
+  }
+
+  Status init() {
+    stream_ = ZSTD_createCStream();
+    if (stream_ == nullptr) {
+      return Status::failure("Couldn't create compression stream");
+    }
+
+    auto ret = ZSTD_initCStream(stream_, 1);
+    if (ZSTD_isError(ret)) {
+      return Status::failure("Couldn't initialize compression stream");
+    }
+    return Status::success();
+  }
+
+  Status write(const char* data, size_t size) override {
+    ZSTD_inBuffer input = {data, size, 0};
+    while (input.pos < input.size) {
+      ZSTD_outBuffer output = {buffer_.data(), buffer_.size(), 0};
+      auto ret = ZSTD_compressStream(stream_, &output, &input);
+      if (ZSTD_isError(ret)) {
+        return Status::failure("ZSTD_compressStream() error : " +
+                               std::string(ZSTD_getErrorName(ret)));
+      }
+
+      auto s = flush(output);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return Status::success();
+  }
+
+  Status finish() override {
+    size_t remaining = 0;
+    do {
+      ZSTD_outBuffer output = {buffer_.data(), buffer_.size(), 0};
+      remaining = ZSTD_endStream(stream_, &output);
+      if (ZSTD_isError(remaining)) {
+        return Status::failure("ZSTD_endStream() error : " +
+                               std::string(ZSTD_getErrorName(remaining)));
+      }
+
+      auto s = flush(output);
+      if (!s.ok()) {
+        return s;
+      }
+    } while (remaining > 0);
+
+    return next_.finish();
+  }
+
+ private:
+  Status flush(const ZSTD_outBuffer& output) {
+    if (output.pos == 0) {
+      return Status::success();
+    }
+    return next_.write(buffer_.data(), output.pos);
+  }
+
+ private:
+  CarveSink& next_;
+  ZSTD_CStream* stream_{nullptr};
+  std::vector<char> buffer_;
+};
+
+/// The state of the archive write callback.
+struct ArchiveContext {
+  CarveSink* sink{nullptr};
+  Status status;
+};
+
+la_ssize_t writeArchive(struct archive* arch,
+                        void* data,
+                        const void* buffer,
+                        size_t length) {
+  auto* context = static_cast<ArchiveContext*>(data);
+  context->status =
+      context->sink->write(static_cast<const char*>(buffer), length);
+  if (!context->status.ok()) {
+    archive_set_error(arch, EIO, "%s", context->status.what().c_str());
+    return -1;
+  }
+  return static_cast<la_ssize_t>(length);
+}
+
+struct ArchiveDeleter {
+  void operator()(struct archive* arch) {
+    archive_write_free(arch);
+  }
+};
+
+struct ArchiveEntryDeleter {
+  void operator()(struct archive_entry* entry) {
+    archive_entry_free(entry);
+  }
+};
+
+/// Return the error of the stream if it failed, otherwise of the archive.
+Status archiveError(struct archive* arch,
+                    const ArchiveContext& context,
+                    const std::string& message) {
+  if (!context.status.ok()) {
+    return context.status;
+  }
+
+  auto error = archive_error_string(arch);
+  return Status::failure(message +
+                         ((error != nullptr) ? ": " + std::string(error) : ""));
+}
+
+} // namespace
+
+Status CarveCounter::write(const char*, size_t size) {
+  size_ += size;
+  return Status::success();
+}
+
+Status CarveCounter::finish() {
+  return Status::success();
+}
+
+CarveHasher::CarveHasher(CarveSink& next)
+    : next_(next), hash_(HashType::HASH_TYPE_SHA256) {}
+
+Status CarveHasher::write(const char* data, size_t size) {
+  hash_.update(data, size);
+  size_ += size;
+  return next_.write(data, size);
+}
+
+Status CarveHasher::finish() {
+  return next_.finish();
+}
+
+std::string CarveHasher::digest() {
+  return hash_.digest();
+}
+
+CarveBlockWriter::CarveBlockWriter(size_t block_size, BlockCallback callback)
+    : block_size_(std::max<size_t>(block_size, 1)),
+      callback_(std::move(callback)) {
+  block_.reserve(block_size_);
+}
+
+Status CarveBlockWriter::write(const char* data, size_t size) {
+  while (size > 0) {
+    auto count = std::min(size, block_size_ - block_.size());
+    block_.append(data, count);
+    data += count;
+    size -= count;
+
+    if (block_.size() == block_size_) {
+      auto s = flush();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  return Status::success();
+}
+
+Status CarveBlockWriter::finish() {
+  if (block_.empty()) {
+    return Status::success();
+  }
+  return flush();
+}
+
+Status CarveBlockWriter::flush() {
+  auto s = callback_(blocks_, block_);
+  blocks_++;
+  block_.clear();
+  return s;
+}
+
+Status streamCarve(const std::vector<CarveFile>& files,
+                   bool compress,
+                   bool read_data,
+                   size_t block_size,
+                   CarveSink& sink) {
+  std::unique_ptr<CarveCompressor> compressor;
+  CarveSink* head = &sink;
+  if (compress) {
+    compressor = std::make_unique<CarveCompressor>(sink);
+    auto s = compressor->init();
+    if (!s.ok()) {
+      return s;
+    }
+    head = compressor.get();
+  }
+
+  std::unique_ptr<struct archive, ArchiveDeleter> arch(archive_write_new());
+  if (arch == nullptr) {
+    return Status::failure("Failed to create tar archive");
+  }
+
+  ArchiveContext context;
+  context.sink = head;
+  archive_write_set_format_pax_restricted(arch.get());
+  auto ret = archive_write_open(
+      arch.get(), &context, nullptr, writeArchive, nullptr);
+  if (ret != ARCHIVE_OK) {
+    return archiveError(arch.get(), context, "Failed to open tar archive");
+  }
+
+  std::vector<char> block(std::max<size_t>(block_size, 1));
+  for (const auto& file : files) {
+    std::unique_ptr<struct archive_entry, ArchiveEntryDeleter> entry(
+        archive_entry_new());
+    archive_entry_set_pathname(entry.get(), file.path.leaf().string().c_str());
+    archive_entry_set_size(entry.get(), static_cast<la_int64_t>(file.size));
+    archive_entry_set_filetype(entry.get(), AE_IFREG);
+    archive_entry_set_perm(entry.get(), 0644);
+    if (archive_write_header(arch.get(), entry.get()) != ARCHIVE_OK) {
+      return archiveError(
+          arch.get(), context, "Failed to archive " + file.path.string());
+    }
+
+    if (read_data) {
+      PlatformFile src(file.path, PF_OPEN_EXISTING | PF_READ);
+      if (!src.isValid()) {
+        VLOG(1) << "Carved file can no longer be read: " << file.path;
+      }
+
+      auto remaining = src.isValid() ? file.size : 0;
+      while (remaining > 0) {
+        auto count =
+            static_cast<size_t>(std::min<uint64_t>(remaining, block.size()));
+        auto r = src.read(block.data(), count);
+        if (r <= 0) {
+          break;
+        }
+
+        if (archive_write_data(arch.get(), block.data(), r) < 0) {
+          return archiveError(
+              arch.get(), context, "Failed to archive " + file.path.string());
+        }
+        remaining -= static_cast<uint64_t>(r);
+      }
+    }
+
+    // Missing content is padded with zeros up to the recorded size.
+    if (archive_write_finish_entry(arch.get()) != ARCHIVE_OK) {
+      return archiveError(
+          arch.get(), context, "Failed to archive " + file.path.string());
+    }
+  }
+
+  if (archive_write_close(arch.get()) != ARCHIVE_OK) {
+    return archiveError(arch.get(), context, "Failed to close tar archive");
+  }
+
+  return head->finish();
+}
+} // namespace osquery
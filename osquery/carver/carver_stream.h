@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <osquery/hashing/hashing.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/// A file to carve, with the size recorded in its archive header.
+struct CarveFile {
+  boost::filesystem::path path;
+  uint64_t size{0};
+};
+
+/**
+ * @brief A stage of the carve stream.
+ *
+ * Every stage passes its output to the next stage before returning, so a slow
+ * stage, such as the uploader, holds back the reads of the carved files and
+ * each stage buffers at most one block of the stream.
+ */
+class CarveSink : private boost::noncopyable {
+ public:
+  virtual ~CarveSink() = default;
+
+  /// Consume the next bytes of the stream.
+  virtual Status write(const char* data, size_t size) = 0;
+
+  /// Flush what is buffered once the stream has ended.
+  virtual Status finish() = 0;
+};
+
+/// Count the bytes of a stream.
+class CarveCounter : public CarveSink {
+ public:
+  Status write(const char* data, size_t size) override;
+  Status finish() override;
+
+  uint64_t size() const {
+    return size_;
+  }
+
+ private:
+  uint64_t size_{0};
+};
+
+/// Compute the SHA256 and the size of a stream, then pass it on.
+class CarveHasher : public CarveSink {
+ public:
+  explicit CarveHasher(CarveSink& next);
+
+  Status write(const char* data, size_t size) override;
+  Status finish() override;
+
+  /// The hex SHA256 of the stream, only call it once the stream has ended.
+  std::string digest();
+
+  uint64_t size() const {
+    return size_;
+  }
+
+ private:
+  CarveSink& next_;
+  Hash hash_;
+  uint64_t size_{0};
+};
+
+/**
+ * @brief Split a stream into fixed-size blocks.
+ *
+ * Each block is given to the callback as soon as it is full, the last block
+ * may be smaller.
+ */
+class CarveBlockWriter : public CarveSink {
+ public:
+  using BlockCallback =
+      std::function<Status(size_t block_id, const std::string& block)>;
+
+  CarveBlockWriter(size_t block_size, BlockCallback callback);
+
+  Status write(const char* data, size_t size) override;
+  Status finish() override;
+
+  /// The number of blocks given to the callback.
+  size_t blocks() const {
+    return blocks_;
+  }
+
+ private:
+  /// Give the buffered block to the callback.
+  Status flush();
+
+ private:
+  size_t block_size_{0};
+  BlockCallback callback_;
+  std::string block_;
+  size_t blocks_{0};
+};
+
+/**
+ * @brief Stream a tar archive of files, optionally compressed with zstd.
+ *
+ * Files are read in blocks of block_size. Each file contributes exactly its
+ * recorded size, a file that grew is truncated and a file that shrank or
+ * can no longer be read is padded with zeros. The archive therefore only
+ * depends on the recorded sizes and the content of the files.
+ *
+ * @param files the files to archive.
+ * @param compress compress the archive with zstd.
+ * @param read_data read the content of the files, otherwise stream zeros.
+ * Without compression, such a stream has the size of the real archive.
+ * @param block_size the size of the reads from the files.
+ * @param sink receives the stream, finish() is called at the end.
+ */
+Status streamCarve(const std::vector<CarveFile>& files,
+                   bool compress,
+                   bool read_data,
+                   size_t block_size,
+                   CarveSink& sink);
+} // namespace osquery
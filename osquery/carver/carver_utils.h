@@ -17,12 +17,6 @@
 
 namespace osquery {
 
-/// Prefix used for the temp FS where carved files are stored.
-const std::string kCarvePathPrefix = "osquery_carve_";
-
-/// Prefix applied to the file carve tar archive.
-const std::string kCarveNamePrefix = "carve_";
-
 /// Database prefix used to directly access and manipulate our carver entries.
 const std::string kCarverDBPrefix = "carves.";
 
@@ -18,14 +18,17 @@
 #include <osquery/filesystem/fileops.h>
 #include <osquery/hashing/hashing.h>
 #include <osquery/registry/registry.h>
+#include <osquery/remote/tests/test_utils.h>
 #include <osquery/utils/json/json.h>
 
 namespace osquery {
 
 namespace fs = boost::filesystem;
 
-/// Prefix used for posix tar archive.
-const std::string kTestCarveNamePrefix = "carve_";
+DECLARE_bool(carver_compression);
+DECLARE_string(carver_start_endpoint);
+DECLARE_string(carver_continue_endpoint);
+DECLARE_uint32(carver_block_size);
 
 class FakeCarver : public Carver {
  public:
@@ -35,11 +38,39 @@ class FakeCarver : public Carver {
       : Carver(paths, guid, requestId) {}
 
  protected:
-  Status postCarve(const boost::filesystem::path&) override {
-    updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
+  Status startUpload(size_t block_count,
+                     uint64_t size,
+                     std::string& session_id) override {
+    block_count_ = block_count;
+    size_ = size;
+    session_id = "session";
     return Status::success();
   }
 
+  Status uploadBlock(const std::string& session_id,
+                     size_t block_id,
+                     const std::string& block) override {
+    EXPECT_EQ(session_id, "session");
+    EXPECT_EQ(block_id, blocks_.size());
+    blocks_.push_back(block);
+    return Status::success();
+  }
+
+ public:
+  /// The uploaded archive.
+  std::string upload() const {
+    std::string data;
+    for (const auto& block : blocks_) {
+      data += block;
+    }
+    return data;
+  }
+
+ public:
+  size_t block_count_{0};
+  uint64_t size_{0};
+  std::vector<std::string> blocks_;
+
  private:
   friend class CarverTests;
   FRIEND_TEST(CarverTests, test_carve_files_locally);
@@ -114,18 +145,19 @@ TEST_F(CarverTests, test_carve_files_locally) {
   std::string requestId = createCarveGuid();
   FakeCarver carve(getCarvePaths(), guid, requestId);
 
-  ASSERT_TRUE(carve.createPaths());
   const auto carves = carve.carveAll();
   EXPECT_EQ(carves.size(), 3U);
 
-  const auto carveFSPath = carve.getCarveDir();
-  const auto tarPath = carveFSPath / (kTestCarveNamePrefix + guid + ".tar");
-  const auto s = archive(carves, tarPath);
-  EXPECT_TRUE(s.ok());
+  // Without compression the content does not change the archive size.
+  CarveCounter zeros;
+  auto s = streamCarve(carves, false, false, 8, zeros);
+  ASSERT_TRUE(s.ok()) << s.what();
 
-  PlatformFile tar(tarPath, PF_OPEN_EXISTING | PF_READ);
-  EXPECT_TRUE(tar.isValid());
-  EXPECT_GT(tar.size(), 0U);
+  CarveCounter counter;
+  s = streamCarve(carves, false, true, 8, counter);
+  ASSERT_TRUE(s.ok()) << s.what();
+  EXPECT_GT(counter.size(), 0U);
+  EXPECT_EQ(counter.size(), zeros.size());
 }
 
 TEST_F(CarverTests, test_carve) {
@@ -134,6 +166,87 @@ TEST_F(CarverTests, test_carve) {
   FakeCarver carve(getCarvePaths(), guid, requestId);
   auto s = carve.carve();
   ASSERT_TRUE(s.ok());
+
+  const auto upload = carve.upload();
+  EXPECT_EQ(upload.size(), carve.size_);
+  EXPECT_EQ(carve.blocks_.size(), carve.block_count_);
+  for (size_t i = 0; i + 1 < carve.blocks_.size(); i++) {
+    EXPECT_EQ(carve.blocks_[i].size(), FLAGS_carver_block_size);
+  }
+
+  std::string value;
+  s = getDatabaseValue(kCarves, kCarverDBPrefix + guid, value);
+  ASSERT_TRUE(s.ok());
+
+  JSON tree;
+  s = tree.fromString(value);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(std::string(tree.doc()["status"].GetString()),
+            kCarverStatusSuccess);
+  EXPECT_EQ(std::string(tree.doc()["size"].GetString()),
+            std::to_string(upload.size()));
+  EXPECT_EQ(std::string(tree.doc()["sha256"].GetString()),
+            hashFromBuffer(
+                HashType::HASH_TYPE_SHA256, upload.data(), upload.size()));
+
+  // The archive contains the content of every file.
+  EXPECT_NE(upload.find("This is a hidden file"), std::string::npos);
+}
+
+TEST_F(CarverTests, test_carve_compressed) {
+  auto compression = FLAGS_carver_compression;
+  auto block_size = FLAGS_carver_block_size;
+  FLAGS_carver_block_size = 64;
+
+  FLAGS_carver_compression = false;
+  FakeCarver tar_carve(getCarvePaths(), createCarveGuid(), "");
+  auto s = tar_carve.carve();
+  ASSERT_TRUE(s.ok());
+
+  FLAGS_carver_compression = true;
+  FakeCarver zst_carve(getCarvePaths(), createCarveGuid(), "");
+  s = zst_carve.carve();
+  FLAGS_carver_compression = compression;
+  FLAGS_carver_block_size = block_size;
+  ASSERT_TRUE(s.ok());
+
+  auto upload = zst_carve.upload();
+  EXPECT_EQ(upload.size(), zst_carve.size_);
+  EXPECT_EQ(zst_carve.blocks_.size(), zst_carve.block_count_);
+  ASSERT_GT(upload.size(), 4U);
+  EXPECT_EQ(upload.substr(0, 4), "\x28\xB5\x2F\xFD");
+
+  // The compressed carve decompresses to the uncompressed carve.
+  auto zst_path = getWorkingDir() / "carve.tar.zst";
+  auto tar_path = getWorkingDir() / "carve.tar";
+  ASSERT_TRUE(writeTextFile(zst_path, upload).ok());
+  s = osquery::decompress(zst_path, tar_path);
+  ASSERT_TRUE(s.ok()) << s.what();
+
+  std::string tar;
+  ASSERT_TRUE(readFile(tar_path, tar).ok());
+  EXPECT_EQ(tar, tar_carve.upload());
+}
+
+TEST_F(CarverTests, test_carve_changed_file) {
+  const auto path = getFilesToCarveDir() / "growing.log";
+  ASSERT_TRUE(writeTextFile(path, "short").ok());
+
+  FakeCarver carve({path.string()}, createCarveGuid(), "");
+  const auto carves = carve.carveAll();
+  ASSERT_EQ(carves.size(), 1U);
+  EXPECT_EQ(carves[0].size, 5U);
+
+  // Content past the recorded size is not archived.
+  ASSERT_TRUE(writeTextFile(path, "short and then much longer").ok());
+  CarveCounter counter;
+  auto s = streamCarve(carves, false, true, 8, counter);
+  ASSERT_TRUE(s.ok()) << s.what();
+
+  CarveCounter zeros;
+  s = streamCarve(carves, false, false, 8, zeros);
+  ASSERT_TRUE(s.ok()) << s.what();
+  EXPECT_EQ(counter.size(), zeros.size());
 }
 
 TEST_F(CarverTests, test_schedule_carves) {
@@ -263,6 +376,54 @@ TEST_F(CarverTests, test_carve_files_not_exists) {
   EXPECT_TRUE(carves.empty());
 }
 
+TEST_F(CarverTests, test_carve_upload) {
+  ASSERT_TRUE(TLSServerRunner::start());
+  TLSServerRunner::setClientConfig();
+
+  auto start_endpoint = FLAGS_carver_start_endpoint;
+  auto continue_endpoint = FLAGS_carver_continue_endpoint;
+  auto block_size = FLAGS_carver_block_size;
+  FLAGS_carver_start_endpoint = "/carve_init";
+  FLAGS_carver_continue_endpoint = "/carve_block";
+  FLAGS_carver_block_size = 128;
+
+  std::string guid;
+  auto s = osquery::carvePaths(getCarvePaths(), "request-id", guid);
+  ASSERT_TRUE(s.ok());
+
+  Carver carve(getCarvePaths(), guid, "request-id");
+  s = carve.carve();
+
+  FLAGS_carver_start_endpoint = start_endpoint;
+  FLAGS_carver_continue_endpoint = continue_endpoint;
+  FLAGS_carver_block_size = block_size;
+  TLSServerRunner::unsetClientConfig();
+  TLSServerRunner::stop();
+  ASSERT_TRUE(s.ok()) << s.what();
+
+  std::string value;
+  s = getDatabaseValue(kCarves, kCarverDBPrefix + guid, value);
+  ASSERT_TRUE(s.ok());
+
+  JSON tree;
+  s = tree.fromString(value);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(std::string(tree.doc()["status"].GetString()),
+            kCarverStatusSuccess);
+
+  // The test server reassembles the blocks of the carve.
+  auto upload_path = fs::path("/tmp") / (guid + ".tar");
+  std::string upload;
+  ASSERT_TRUE(readFile(upload_path, upload).ok());
+  fs::remove(upload_path);
+
+  EXPECT_EQ(std::string(tree.doc()["size"].GetString()),
+            std::to_string(upload.size()));
+  EXPECT_EQ(std::string(tree.doc()["sha256"].GetString()),
+            hashFromBuffer(
+                HashType::HASH_TYPE_SHA256, upload.data(), upload.size()));
+}
+
 TEST_F(CarverTests, test_compression_decompression) {
   auto const test_data_file = getWorkingDir() / "test.data";
   writeTextFile(test_data_file, R"raw_text(
@@ -119,6 +119,9 @@ DECLARE_string(pack_delimiter);
 const std::string kExecutingQuery{"executing_query"};
 const std::string kFailedQueries{"failed_queries"};
 
+/// The executing query key of a scheduler worker thread, empty otherwise.
+static thread_local std::string kWorkerExecutingQuery;
+
 // The config may be accessed and updated asynchronously; use mutexes.
 Mutex config_hash_mutex_;
 Mutex config_refresh_mutex_;
@@ -186,14 +189,6 @@ class Schedule : private boost::noncopyable {
   /// Underlying storage for the packs
   container packs_;
 
-  /**
-   * @brief The schedule will check and record previously executing queries.
-   *
-   * If a query is found on initialization, the name will be recorded, it is
-   * possible to skip previously failed queries.
-   */
-  std::string failed_query_;
-
   /**
    * @brief List of denylisted queries.
    *
@@ -320,17 +315,43 @@ Schedule::Schedule() {
   // Parse the schedule's query denylist from backing storage.
   restoreScheduleDenylist(denylist_);
 
-  // Check if any queries were executing when the tool last stopped.
-  getDatabaseValue(kPersistentSettings, kExecutingQuery, failed_query_);
-  if (!failed_query_.empty()) {
-    LOG(WARNING) << "Scheduled query may have failed: " << failed_query_;
-    setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
-    // Add this query name to the denylist and save the denylist.
-    denylist_[failed_query_] = getUnixTime() + 86400;
+  // Check if any queries were executing when the tool last stopped, each
+  // scheduler worker records its executing query under its own key.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kPersistentSettings, keys, kExecutingQuery);
+  bool failed = false;
+  for (const auto& key : keys) {
+    if (key != kExecutingQuery && key.find(kExecutingQuery + ".") != 0) {
+      continue;
+    }
+
+    std::string failed_query;
+    getDatabaseValue(kPersistentSettings, key, failed_query);
+    if (failed_query.empty()) {
+      continue;
+    }
+
+    LOG(WARNING) << "Scheduled query may have failed: " << failed_query;
+    setDatabaseValue(kPersistentSettings, key, "");
+    // Add this query name to the denylist.
+    denylist_[failed_query] = getUnixTime() + 86400;
+    failed = true;
+  }
+
+  if (failed) {
     saveScheduleDenylist(denylist_);
   }
 }
 
+const std::string& executingQueryKey() {
+  return kWorkerExecutingQuery.empty() ? kExecutingQuery
+                                       : kWorkerExecutingQuery;
+}
+
+void setExecutingQueryWorker(size_t id) {
+  kWorkerExecutingQuery = kExecutingQuery + "." + std::to_string(id);
+}
+
 Config::Config()
     : schedule_(std::make_unique<Schedule>()),
       valid_(false),
@@ -1042,12 +1063,12 @@ void Config::recordQueryPerformance(const std::string& name,
   query.last_executed = getUnixTime();
 
   // Clear the executing query (remove the dirty bit).
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
+  setDatabaseValue(kPersistentSettings, executingQueryKey(), "");
 }
 
 void Config::recordQueryStart(const std::string& name) {
-  // There should only ever be a single executing query in the schedule.
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, name);
+  // There is a single executing query per scheduler thread.
+  setDatabaseValue(kPersistentSettings, executingQueryKey(), name);
   // Store the time this query name last executed for later results eviction.
   // When configuration updates occur the previous schedule is searched for
   // 'stale' query names, aka those that have week-old or longer last execute
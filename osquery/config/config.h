@@ -34,6 +34,17 @@ class ConfigRefreshRunner;
 /// The name of the executing query within the single-threaded schedule.
 extern const std::string kExecutingQuery;
 
+/**
+ * @brief The backing store key of the query executing on the calling thread.
+ *
+ * Each scheduler worker records its executing query under its own key, see
+ * setExecutingQueryWorker, every other thread uses kExecutingQuery.
+ */
+const std::string& executingQueryKey();
+
+/// Record the executing queries of the calling thread for a scheduler worker.
+void setExecutingQueryWorker(size_t id);
+
 /**
  * @brief The programmatic representation of osquery's configuration
  *
@@ -100,6 +100,10 @@ class ConfigTests : public testing::Test {
     return Config::get();
   }
 
+  void reset() {
+    Config::get().reset();
+  }
+
  private:
   uint64_t refresh_{0};
 };
@@ -356,6 +360,32 @@ TEST_F(ConfigTests, test_schedule_denylist) {
   EXPECT_EQ(denylist.size(), 1U);
 }
 
+TEST_F(ConfigTests, test_schedule_denylist_workers) {
+  saveScheduleDenylist({});
+
+  // Queries that did not complete on the schedule and on a worker.
+  get().recordQueryStart("serial_query");
+  std::thread worker([this]() {
+    setExecutingQueryWorker(3);
+    EXPECT_EQ(executingQueryKey(), kExecutingQuery + ".3");
+    get().recordQueryStart("worker_query");
+  });
+  worker.join();
+  EXPECT_EQ(executingQueryKey(), kExecutingQuery);
+
+  // Each executing query is denylisted when the schedule is restored.
+  reset();
+  std::map<std::string, uint64_t> denylist;
+  restoreScheduleDenylist(denylist);
+  EXPECT_EQ(denylist.count("serial_query"), 1U);
+  EXPECT_EQ(denylist.count("worker_query"), 1U);
+
+  std::string executing;
+  getDatabaseValue(kPersistentSettings, kExecutingQuery + ".3", executing);
+  EXPECT_TRUE(executing.empty());
+  saveScheduleDenylist({});
+}
+
 TEST_F(ConfigTests, test_pack_noninline) {
   auto& rf = RegistryFactory::get();
   rf.registry("config")->add("test", std::make_shared<TestConfigPlugin>());
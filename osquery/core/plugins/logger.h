@@ -161,6 +161,27 @@ class LoggerPlugin : public Plugin {
    */
   virtual Status logString(const std::string& s) = 0;
 
+  /**
+   * @brief Log the result strings of one scheduled query.
+   *
+   * Plugins that write or send logs in batches should override this method
+   * to handle the strings in a single write. By default each string is
+   * forwarded to logString.
+   *
+   * @param strings the strings to log, in order.
+   * @return the last failed status, every string is attempted.
+   */
+  virtual Status logStringBatch(const std::vector<std::string>& strings) {
+    Status status;
+    for (const auto& s : strings) {
+      auto s_status = logString(s);
+      if (!s_status.ok()) {
+        status = std::move(s_status);
+      }
+    }
+    return status;
+  }
+
   /**
    * @brief See the usesLogStatus method, log a Glog status.
    *
@@ -11,11 +11,14 @@
 #include <string>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
 #include <osquery/core/query.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
+#include <osquery/utils/conversions/castvariant.h>
 
 #include <osquery/utils/json/json.h>
 
@@ -56,6 +59,164 @@ uint64_t Query::getQueryCounter(bool new_query) const {
   return counter;
 }
 
+/**
+ * @brief Prefix of stored fingerprints, used when removed rows are not
+ * reported.
+ *
+ * Results stored before fingerprinting are JSON arrays, which begin with '['.
+ */
+const std::string kFingerprintsPrefix{"fp1:"};
+
+/**
+ * @brief Prefix of stored fingerprints that are each followed by their row.
+ *
+ * Each fingerprint is followed by the decimal size of its JSON row, a ':' and
+ * the row. The rows are only parsed to report removed rows.
+ */
+const std::string kFingerprintRowsPrefix{"fpr1:"};
+
+namespace {
+
+/// The previous results of a scheduled query, as stored in the database.
+struct StoredResults {
+  /// The sorted fingerprints, duplicate rows are repeated.
+  RowFingerprints fingerprints;
+
+  /// The offset and size of the JSON row of each fingerprint, if stored.
+  std::vector<std::pair<size_t, size_t>> rows;
+
+  /// True if the rows are stored alongside the fingerprints.
+  bool has_rows{false};
+};
+
+} // namespace
+
+/// Fingerprints are hex encoded, database plugins may store values as text.
+static void appendRowFingerprint(const RowFingerprint& fingerprint,
+                                 std::string& raw) {
+  static const char kHex[] = "0123456789abcdef";
+
+  for (auto word : {fingerprint.high, fingerprint.low}) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      raw.push_back(kHex[(word >> shift) & 0xf]);
+    }
+  }
+}
+
+static bool readRowFingerprint(const std::string& raw,
+                               size_t& offset,
+                               RowFingerprint& fingerprint) {
+  if (raw.size() - offset < 32) {
+    return false;
+  }
+
+  for (auto* word : {&fingerprint.high, &fingerprint.low}) {
+    *word = 0;
+    for (size_t i = 0; i < 16; i++) {
+      auto c = raw[offset++];
+      uint64_t nibble = 0;
+      if (c >= '0' && c <= '9') {
+        nibble = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        nibble = c - 'a' + 10;
+      } else {
+        return false;
+      }
+      *word = (*word << 4) | nibble;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Parse stored fingerprints, and the location of their rows.
+ *
+ * Returns false if the value is not a well-formed, sorted, list of
+ * fingerprints, such as results stored as JSON rows by an older version.
+ */
+static bool deserializeStoredResults(const std::string& raw,
+                                     StoredResults& results) {
+  size_t offset = 0;
+  if (raw.compare(0, kFingerprintRowsPrefix.size(), kFingerprintRowsPrefix) ==
+      0) {
+    results.has_rows = true;
+    offset = kFingerprintRowsPrefix.size();
+  } else if (raw.compare(0, kFingerprintsPrefix.size(), kFingerprintsPrefix) ==
+             0) {
+    offset = kFingerprintsPrefix.size();
+  } else {
+    return false;
+  }
+
+  while (offset < raw.size()) {
+    RowFingerprint fingerprint;
+    if (!readRowFingerprint(raw, offset, fingerprint)) {
+      return false;
+    }
+    if (!results.fingerprints.empty() &&
+        fingerprint < results.fingerprints.back()) {
+      return false;
+    }
+    results.fingerprints.push_back(fingerprint);
+
+    if (results.has_rows) {
+      size_t size = 0;
+      size_t digits = 0;
+      while (offset < raw.size() && digits < 10 && raw[offset] >= '0' &&
+             raw[offset] <= '9') {
+        size = size * 10 + static_cast<size_t>(raw[offset++] - '0');
+        digits++;
+      }
+      if (digits == 0 || offset >= raw.size() || raw[offset] != ':') {
+        return false;
+      }
+      offset++;
+      if (size > raw.size() - offset) {
+        return false;
+      }
+      results.rows.emplace_back(offset, size);
+      offset += size;
+    }
+  }
+  return true;
+}
+
+static void serializeRowFingerprints(const RowFingerprints& fingerprints,
+                                     std::string& raw) {
+  raw = kFingerprintsPrefix;
+  raw.reserve(raw.size() + fingerprints.size() * 32);
+  for (const auto& fingerprint : fingerprints) {
+    appendRowFingerprint(fingerprint, raw);
+  }
+}
+
+/// Store the sorted fingerprints each followed by its row.
+template <typename QueryDataType>
+static Status serializeRowsWithFingerprints(const QueryDataType& qd,
+                                            std::string& raw) {
+  std::vector<std::pair<RowFingerprint, size_t>> order;
+  order.reserve(qd.size());
+  for (size_t i = 0; i < qd.size(); i++) {
+    order.emplace_back(getRowFingerprint(qd[i]), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  raw = kFingerprintRowsPrefix;
+  std::string json;
+  for (const auto& entry : order) {
+    json.clear();
+    auto status = serializeRowJSON(qd[entry.second], json, true);
+    if (!status.ok()) {
+      return status;
+    }
+    appendRowFingerprint(entry.first, raw);
+    raw += std::to_string(json.size());
+    raw.push_back(':');
+    raw += json;
+  }
+  return Status::success();
+}
+
 Status Query::getPreviousQueryResults(QueryDataSet& results) const {
   std::string raw;
   auto status = getDatabaseValue(kQueries, name_, raw);
@@ -63,13 +224,62 @@ Status Query::getPreviousQueryResults(QueryDataSet& results) const {
     return status;
   }
 
-  status = deserializeQueryDataJSON(raw, results);
-  if (!status.ok()) {
-    return status;
+  StoredResults stored;
+  if (!deserializeStoredResults(raw, stored)) {
+    // Results stored before fingerprinting are JSON rows.
+    return deserializeQueryDataJSON(raw, results);
+  }
+
+  if (!stored.has_rows) {
+    return Status::failure("Rows are not stored for scheduled query " + name_);
+  }
+
+  for (const auto& row : stored.rows) {
+    RowTyped r;
+    status = deserializeRowJSON(raw.substr(row.first, row.second), r);
+    if (!status.ok()) {
+      return status;
+    }
+    results.insert(std::move(r));
   }
   return Status::success();
 }
 
+/**
+ * @brief Lookup the stored rows matching a set of removed fingerprints.
+ *
+ * The rows are reported in the order a full-row differential reports them.
+ */
+static Status getRemovedRows(const std::string& raw,
+                             const StoredResults& previous,
+                             const RowFingerprints& removed,
+                             QueryDataTyped& results) {
+  size_t i = 0;
+  for (const auto& fingerprint : removed) {
+    // Both lists are sorted, duplicate rows match in turn.
+    while (i < previous.fingerprints.size() &&
+           previous.fingerprints[i] < fingerprint) {
+      i++;
+    }
+    if (i == previous.fingerprints.size()) {
+      break;
+    }
+    if (previous.fingerprints[i] != fingerprint) {
+      continue;
+    }
+
+    const auto& row = previous.rows[i++];
+    RowTyped r;
+    auto status = deserializeRowJSON(raw.substr(row.first, row.second), r);
+    if (!status.ok()) {
+      return status;
+    }
+    results.push_back(std::move(r));
+  }
+  std::sort(results.begin(), results.end());
+  return Status::success();
+}
+
 std::vector<std::string> Query::getStoredQueryNames() {
   std::vector<std::string> results;
   scanDatabaseKeys(kQueries, results);
@@ -104,6 +314,31 @@ Status Query::addNewResults(QueryDataTyped current_qd,
                             uint64_t& counter,
                             DiffResults& dr,
                             bool calculate_diff) const {
+  return addResults(current_qd, current_epoch, counter, dr, calculate_diff);
+}
+
+Status Query::addNewResults(QueryDataColumnar current_qd,
+                            const uint64_t current_epoch,
+                            uint64_t& counter,
+                            DiffResults& dr,
+                            bool calculate_diff) const {
+  return addResults(current_qd, current_epoch, counter, dr, calculate_diff);
+}
+
+static inline QueryDataTyped takeRows(QueryDataTyped& qd) {
+  return std::move(qd);
+}
+
+static inline QueryDataTyped takeRows(const QueryDataColumnar& qd) {
+  return qd.toQueryDataTyped();
+}
+
+template <typename QueryDataType>
+Status Query::addResults(QueryDataType& current_qd,
+                         const uint64_t current_epoch,
+                         uint64_t& counter,
+                         DiffResults& dr,
+                         bool calculate_diff) const {
   // The current results are 'fresh' when not calculating a differential.
   bool fresh_results = !calculate_diff;
   bool new_query = false;
@@ -123,46 +358,87 @@ Status Query::addNewResults(QueryDataTyped current_qd,
     saveQuery(name_, query_);
   }
 
-  // Use a 'target' avoid copying the query data when serializing and saving.
-  // If a differential is requested and needed the target remains the original
-  // query data, otherwise the content is moved to the differential's added set.
-  const auto* target_gd = &current_qd;
+  // The current results are serialized and saved before they are moved to
+  // the differential's added set, this avoids copying them.
   bool update_db = true;
+  RowFingerprints current_fingerprints;
+  bool fingerprinted = false;
   if (!fresh_results && calculate_diff) {
-    // Get the rows from the last run of this query name.
-    QueryDataSet previous_qd;
-    auto status = getPreviousQueryResults(previous_qd);
+    // Get the fingerprints, or legacy rows, from the last run of this query.
+    std::string raw;
+    auto status = getDatabaseValue(kQueries, name_, raw);
     if (!status.ok()) {
       return status;
     }
 
-    // Calculate the differential between previous and current query results.
-    dr = diff(previous_qd, current_qd);
-
-    update_db = (!dr.added.empty() || !dr.removed.empty());
-  } else {
-    dr.added = std::move(current_qd);
-    target_gd = &dr.added;
+    StoredResults previous;
+    if (!deserializeStoredResults(raw, previous)) {
+      // Results stored before fingerprinting are JSON rows.
+      QueryDataSet previous_qd;
+      status = getPreviousQueryResults(previous_qd);
+      if (status.ok()) {
+        dr = diff(previous_qd, current_qd);
+      } else {
+        LOG(WARNING) << "Cannot read previous results for scheduled query "
+                     << name_ << ": " << status.getMessage();
+        fresh_results = true;
+      }
+    } else if (report_removed_ && !previous.has_rows) {
+      // Removed rows cannot be reported, treat the results like a new epoch.
+      LOG(INFO) << "Storing rows to report removals for scheduled query "
+                << name_;
+      fresh_results = true;
+    } else {
+      // Diff by fingerprint, the previous rows are only read when rows were
+      // removed and the query reports them.
+      RowFingerprints removed;
+      dr.added = diffFingerprints(
+          previous.fingerprints, current_qd, current_fingerprints, removed);
+      fingerprinted = true;
+
+      if (!removed.empty() && report_removed_) {
+        status = getRemovedRows(raw, previous, removed, dr.removed);
+        if (!status.ok()) {
+          // The removals cannot be reported, report the current results like
+          // a new epoch rather than silently dropping them.
+          LOG(WARNING) << "Cannot read removed rows for scheduled query "
+                       << name_ << ": " << status.getMessage();
+          dr.removed.clear();
+          fresh_results = true;
+        }
+      }
+      update_db = (!dr.added.empty() || !removed.empty() ||
+                   previous.has_rows != report_removed_);
+    }
   }
 
   if (update_db) {
-    // Replace the "previous" query data with the current.
-    std::string json;
-    auto status = serializeQueryDataJSON(*target_gd, json, true);
-    if (!status.ok()) {
-      return status;
+    // Store only what the next differential reads: the fingerprints, each
+    // followed by its row if removed rows are reported.
+    DatabaseStringValueList data;
+    data.emplace_back(name_, std::string());
+    if (report_removed_) {
+      auto status =
+          serializeRowsWithFingerprints(current_qd, data.back().second);
+      if (!status.ok()) {
+        return status;
+      }
+    } else {
+      if (!fingerprinted) {
+        current_fingerprints = getRowFingerprints(current_qd);
+      }
+      serializeRowFingerprints(current_fingerprints, data.back().second);
     }
+    data.emplace_back(name_ + "epoch", std::to_string(current_epoch));
 
-    status = setDatabaseValue(kQueries, name_, json);
+    auto status = setDatabaseBatch(kQueries, data);
     if (!status.ok()) {
       return status;
     }
+  }
 
-    status = setDatabaseValue(
-        kQueries, name_ + "epoch", std::to_string(current_epoch));
-    if (!status.ok()) {
-      return status;
-    }
+  if (fresh_results) {
+    dr.added = takeRows(current_qd);
   }
 
   if (update_db || fresh_results || new_query) {
@@ -314,6 +590,234 @@ Status serializeQueryLogItemAsEvents(const QueryLogItem& item, JSON& doc) {
   return Status::success();
 }
 
+namespace {
+
+/// A rapidjson output stream appending to a std::string.
+class JSONStringStream {
+ public:
+  using Ch = char;
+
+  void Put(char c) {
+    out_->push_back(c);
+  }
+
+  void Flush() {}
+
+  void setOutput(std::string& out) {
+    out_ = &out;
+  }
+
+ private:
+  std::string* out_{nullptr};
+};
+
+/**
+ * @brief Writes the events of a QueryLogItem without building a document.
+ *
+ * The fields shared by every event are rendered once per item, each event
+ * then writes its columns straight from the RowTyped into a reused line.
+ * Fields are ordered as serializeQueryLogItemAsEvents orders the members of
+ * its documents, so both produce the same lines.
+ */
+class EventLineWriter {
+ public:
+  explicit EventLineWriter(const QueryLogItem& item);
+
+  /// Render the event of a row, the line is overwritten by the next event.
+  template <typename RowType>
+  const std::string& write(const RowType& row, const std::string& action);
+
+ private:
+  enum class EventSlot { COLUMNS, ACTION };
+
+  struct Member {
+    std::string name;
+
+    /// The rendered JSON value, unused for the per-event slots.
+    std::string value;
+
+    boost::optional<EventSlot> slot;
+  };
+
+  /// Replace or append a member, like JSON::add.
+  static void setMember(std::vector<Member>& members, Member member);
+
+  /// Reset the writer to append a single JSON value to the output.
+  rj::Writer<JSONStringStream>& writerFor(std::string& out);
+
+  /// Render a JSON string value.
+  std::string renderString(const std::string& value);
+
+  void writeColumns(const RowTyped& row);
+
+  void writeColumns(const QueryDataColumnar::RowRef& row);
+
+  void writeColumn(rj::Writer<JSONStringStream>& writer,
+                   const std::string& name,
+                   const RowDataTyped& value);
+
+ private:
+  bool numerics_{false};
+
+  /// Rendered text before each per-event slot.
+  std::vector<std::pair<std::string, EventSlot>> segments_;
+
+  /// Rendered text after the last per-event slot.
+  std::string tail_;
+
+  std::string line_;
+
+  JSONStringStream stream_;
+  rj::Writer<JSONStringStream> writer_;
+};
+
+EventLineWriter::EventLineWriter(const QueryLogItem& item)
+    : numerics_(FLAGS_logger_numerics) {
+  std::vector<Member> members;
+  setMember(members, {"name", renderString(item.name), boost::none});
+  setMember(members,
+            {"hostIdentifier", renderString(item.identifier), boost::none});
+  setMember(members,
+            {"calendarTime", renderString(item.calendar_time), boost::none});
+
+  std::string value;
+  writerFor(value).Uint64(item.time);
+  setMember(members, {"unixTime", std::move(value), boost::none});
+  value.clear();
+  writerFor(value).Uint64(item.epoch);
+  setMember(members, {"epoch", std::move(value), boost::none});
+  value.clear();
+  writerFor(value).Uint64(item.counter);
+  setMember(members, {"counter", std::move(value), boost::none});
+  value.clear();
+  writerFor(value).Bool(numerics_);
+  setMember(members, {"numerics", std::move(value), boost::none});
+
+  if (!item.decorations.empty()) {
+    if (FLAGS_decorations_top_level) {
+      for (const auto& decoration : item.decorations) {
+        setMember(
+            members,
+            {decoration.first, renderString(decoration.second), boost::none});
+      }
+    } else {
+      value.clear();
+      auto& writer = writerFor(value);
+      writer.StartObject();
+      for (const auto& decoration : item.decorations) {
+        writer.Key(decoration.first.data(),
+                   static_cast<rj::SizeType>(decoration.first.size()));
+        writer.String(decoration.second.data(),
+                      static_cast<rj::SizeType>(decoration.second.size()));
+      }
+      writer.EndObject();
+      setMember(members, {"decorations", std::move(value), boost::none});
+    }
+  }
+
+  setMember(members, {"columns", "", EventSlot::COLUMNS});
+  setMember(members, {"action", "", EventSlot::ACTION});
+
+  std::string literal = "{";
+  for (size_t i = 0; i < members.size(); i++) {
+    if (i > 0) {
+      literal += ',';
+    }
+    literal += renderString(members[i].name);
+    literal += ':';
+    if (members[i].slot) {
+      segments_.emplace_back(std::move(literal), *members[i].slot);
+      literal.clear();
+    } else {
+      literal += members[i].value;
+    }
+  }
+  tail_ = std::move(literal) + "}";
+}
+
+void EventLineWriter::setMember(std::vector<Member>& members, Member member) {
+  auto it = std::find_if(
+      members.begin(), members.end(), [&member](const Member& existing) {
+        return existing.name == member.name;
+      });
+  if (it != members.end()) {
+    // A removed member is replaced by the last one, as rapidjson does.
+    if (std::next(it) != members.end()) {
+      *it = std::move(members.back());
+    }
+    members.pop_back();
+  }
+  members.push_back(std::move(member));
+}
+
+rj::Writer<JSONStringStream>& EventLineWriter::writerFor(std::string& out) {
+  stream_.setOutput(out);
+  writer_.Reset(stream_);
+  return writer_;
+}
+
+std::string EventLineWriter::renderString(const std::string& value) {
+  std::string out;
+  writerFor(out).String(value.data(), static_cast<rj::SizeType>(value.size()));
+  return out;
+}
+
+void EventLineWriter::writeColumn(rj::Writer<JSONStringStream>& writer,
+                                  const std::string& name,
+                                  const RowDataTyped& value) {
+  writer.Key(name.data(), static_cast<rj::SizeType>(name.size()));
+
+  const auto* text = boost::get<std::string>(&value);
+  if (text != nullptr) {
+    writer.String(text->data(), static_cast<rj::SizeType>(text->size()));
+  } else if (!numerics_) {
+    auto cast = castVariant(value);
+    writer.String(cast.data(), static_cast<rj::SizeType>(cast.size()));
+  } else if (const auto* integer = boost::get<long long>(&value)) {
+    writer.Int64(*integer);
+  } else {
+    writer.Double(boost::get<double>(value));
+  }
+}
+
+void EventLineWriter::writeColumns(const RowTyped& row) {
+  auto& writer = writerFor(line_);
+  writer.StartObject();
+  for (const auto& column : row) {
+    writeColumn(writer, column.first, column.second);
+  }
+  writer.EndObject();
+}
+
+void EventLineWriter::writeColumns(const QueryDataColumnar::RowRef& row) {
+  auto& writer = writerFor(line_);
+  writer.StartObject();
+  // The schema orders columns by name, as a RowTyped is ordered.
+  for (auto index : row.schema().ordered()) {
+    writeColumn(writer, row.name(index), row[index]);
+  }
+  writer.EndObject();
+}
+
+template <typename RowType>
+const std::string& EventLineWriter::write(const RowType& row,
+                                          const std::string& action) {
+  line_.clear();
+  for (const auto& segment : segments_) {
+    line_ += segment.first;
+    if (segment.second == EventSlot::COLUMNS) {
+      writeColumns(row);
+    } else {
+      writerFor(line_).String(action.data(),
+                              static_cast<rj::SizeType>(action.size()));
+    }
+  }
+  line_ += tail_;
+  return line_;
+}
+
+} // namespace
+
 Status serializeQueryLogItemJSON(const QueryLogItem& item, std::string& json) {
   auto doc = JSON::newObject();
   auto status = serializeQueryLogItem(item, doc);
@@ -324,22 +828,42 @@ Status serializeQueryLogItemJSON(const QueryLogItem& item, std::string& json) {
   return doc.toString(json);
 }
 
-Status serializeQueryLogItemAsEventsJSON(const QueryLogItem& item,
-                                         std::vector<std::string>& items) {
-  auto doc = JSON::newArray();
-  auto status = serializeQueryLogItemAsEvents(item, doc);
-  if (!status.ok()) {
-    return status;
+Status serializeQueryLogItemAsEventsJSON(
+    const QueryLogItem& item,
+    const std::function<Status(const std::string&)>& event_callback) {
+  if (item.results.added.empty() && item.results.removed.empty() &&
+      item.snapshot_results.empty()) {
+    return Status(1, "No differential or snapshot results");
   }
 
-  // return doc.toString()
-  for (auto& event : doc.doc().GetArray()) {
-    rj::StringBuffer sb;
-    rj::Writer<rj::StringBuffer> writer(sb);
-    event.Accept(writer);
-    items.push_back(sb.GetString());
+  static const std::string kRemoved{"removed"};
+  static const std::string kAdded{"added"};
+  static const std::string kSnapshot{"snapshot"};
+
+  EventLineWriter writer(item);
+  Status status;
+  auto write_events = [&](const auto& rows, const std::string& action) {
+    for (const auto& row : rows) {
+      status = event_callback(writer.write(row, action));
+    }
+  };
+
+  if (!item.results.added.empty() || !item.results.removed.empty()) {
+    write_events(item.results.removed, kRemoved);
+    write_events(item.results.added, kAdded);
+  } else {
+    write_events(item.snapshot_results, kSnapshot);
   }
-  return Status::success();
+  return status;
+}
+
+Status serializeQueryLogItemAsEventsJSON(const QueryLogItem& item,
+                                         std::vector<std::string>& items) {
+  return serializeQueryLogItemAsEventsJSON(
+      item, [&items](const std::string& event) {
+        items.push_back(event);
+        return Status::success();
+      });
 }
 
 }
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -39,7 +40,7 @@ struct QueryLogItem {
   DiffResults results;
 
   /// Optional snapshot results, no differential applied.
-  QueryDataTyped snapshot_results;
+  QueryDataColumnar snapshot_results;
 
   /// The name of the scheduled query.
   std::string name;
@@ -116,6 +117,23 @@ Status serializeQueryLogItemAsEvents(const QueryLogItem& item, JSON& json);
 Status serializeQueryLogItemAsEventsJSON(const QueryLogItem& i,
                                          std::vector<std::string>& items);
 
+/**
+ * @brief Serialize a QueryLogItem into JSON event lines, one per row.
+ *
+ * Each line is written directly from the rows, without an intermediate JSON
+ * document, into a buffer reused for the next line. The lines are identical
+ * to the ones serializeQueryLogItemAsEventsJSON returns.
+ *
+ * @param item the QueryLogItem to serialize
+ * @param event_callback called with each line, it must copy the line to keep
+ * it. Every line is passed even if a call fails.
+ *
+ * @return the Status of the last callback, or an error if there are no rows
+ */
+Status serializeQueryLogItemAsEventsJSON(
+    const QueryLogItem& item,
+    const std::function<Status(const std::string&)>& event_callback);
+
 /**
  * @brief Interact with the historical on-disk storage for a given query.
  */
@@ -131,7 +149,9 @@ class Query {
    * @param q a ScheduledQuery struct.
    */
   explicit Query(std::string name, const ScheduledQuery& q)
-      : query_(q.query), name_(std::move(name)) {}
+      : query_(q.query),
+        name_(std::move(name)),
+        report_removed_(q.reportRemovedRows()) {}
 
   /**
    * @brief Serialize the data in RocksDB into a useful data structure
@@ -139,6 +159,10 @@ class Query {
    * This method retrieves the data from RocksDB and returns the data in a
    * std::multiset, in-order to apply binary search in diff function.
    *
+   * Results are stored as row fingerprints, each followed by its row only when
+   * the query reports removed rows. Results stored by an older version as
+   * JSON rows are also accepted, and used to diff them.
+   *
    * @param results the output QueryDataSet struct.
    *
    * @return the success or failure of the operation.
@@ -206,6 +230,9 @@ class Query {
    * to the database using addNewResults and get back a data structure
    * indicating what rows in the query's results have changed.
    *
+   * The differential is calculated against the fingerprints of the previous
+   * results. When the results are unchanged nothing is parsed or written.
+   *
    * @param qd the QueryDataTyped object containing query results to store.
    * @param epoch the epoch associated with QueryData
    * @param counter the output that holds the query execution counter.
@@ -220,6 +247,21 @@ class Query {
                        DiffResults& dr,
                        bool calculate_diff = true) const;
 
+  /**
+   * @brief Add a new set of columnar results to the persistent storage and get
+   * back the differential results.
+   *
+   * The results are fingerprinted, diffed, and stored without building a
+   * RowTyped for each row. Only rows reported as added are copied.
+   *
+   * @see addNewResults
+   */
+  Status addNewResults(QueryDataColumnar qd,
+                       uint64_t epoch,
+                       uint64_t& counter,
+                       DiffResults& dr,
+                       bool calculate_diff = true) const;
+
   /**
    * @brief The most recent result set for a scheduled query.
    *
@@ -241,6 +283,15 @@ class Query {
    */
   static std::vector<std::string> getStoredQueryNames();
 
+ private:
+  /// Store and diff results of either row representation.
+  template <typename QueryDataType>
+  Status addResults(QueryDataType& qd,
+                    uint64_t epoch,
+                    uint64_t& counter,
+                    DiffResults& dr,
+                    bool calculate_diff) const;
+
  private:
   /// The scheduled query's query string.
   std::string query_;
@@ -248,6 +299,9 @@ class Query {
   /// The scheduled query name.
   std::string name_;
 
+  /// True if removed rows are reported, and full rows must be stored.
+  bool report_removed_{true};
+
  private:
   FRIEND_TEST(QueryTests, test_private_members);
   FRIEND_TEST(QueryTests, test_add_and_get_current_results);
@@ -7,6 +7,10 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
 #include "diff_results.h"
 
 namespace rj = rapidjson;
@@ -69,4 +73,211 @@ DiffResults diff(QueryDataSet& old, QueryDataTyped& current) {
   return r;
 }
 
+DiffResults diff(QueryDataSet& old, const QueryDataColumnar& current) {
+  DiffResults r;
+
+  // Order the current rows the same way the old set is ordered.
+  std::vector<size_t> order(current.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&current](size_t a, size_t b) {
+    return current[a].compare(current[b]) < 0;
+  });
+
+  // Walk both ordered sequences once, marking the current rows with a match.
+  std::vector<bool> matched(current.size(), false);
+  auto item = old.begin();
+  for (auto index : order) {
+    auto row = current[index];
+    int c = 0;
+    while (item != old.end() && (c = row.compare(*item)) > 0) {
+      ++item;
+    }
+    if (item != old.end() && c == 0) {
+      matched[index] = true;
+      item = old.erase(item);
+    }
+  }
+
+  // Added rows are reported in the order of the current results.
+  for (size_t i = 0; i < current.size(); i++) {
+    if (!matched[i]) {
+      r.added.push_back(current[i].toRowTyped());
+    }
+  }
+
+  for (auto& i : old) {
+    r.removed.push_back(std::move(i));
+  }
+
+  return r;
+}
+
+namespace {
+
+/**
+ * @brief Accumulates two independent 64-bit lanes over a row's bytes.
+ *
+ * The lanes are FNV-1a style with different bases and primes, each is then
+ * passed through the splitmix64 finalizer to spread the low-entropy bits.
+ */
+class RowHasher {
+ public:
+  void update(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+      high_ = (high_ ^ bytes[i]) * 0x100000001b3ULL;
+      low_ = (low_ ^ bytes[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+    length_ += size;
+  }
+
+  void update(uint64_t value) {
+    update(&value, sizeof(value));
+  }
+
+  void update(const std::string& value) {
+    update(static_cast<uint64_t>(value.size()));
+    update(value.data(), value.size());
+  }
+
+  RowFingerprint finish() const {
+    return {mix(high_ ^ length_), mix(low_ + length_)};
+  }
+
+ private:
+  static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+ private:
+  uint64_t high_{0xcbf29ce484222325ULL};
+  uint64_t low_{0x84222325cbf29ce4ULL};
+  uint64_t length_{0};
+};
+
+} // namespace
+
+/// Hash a column name and typed value, equal values hash the same.
+static void hashColumn(RowHasher& hasher,
+                       const std::string& name,
+                       const RowDataTyped& data) {
+  hasher.update(name);
+
+  auto type = static_cast<unsigned char>(data.which());
+  hasher.update(&type, sizeof(type));
+  if (const auto* value = boost::get<long long>(&data)) {
+    hasher.update(static_cast<uint64_t>(*value));
+  } else if (const auto* value = boost::get<double>(&data)) {
+    // Both signed zeros compare equal, so they must hash the same.
+    double d = (*value == 0.0) ? 0.0 : *value;
+    uint64_t bits = 0;
+    std::memcpy(&bits, &d, sizeof(bits));
+    hasher.update(bits);
+  } else {
+    hasher.update(boost::get<std::string>(data));
+  }
+}
+
+RowFingerprint getRowFingerprint(const RowTyped& row) {
+  RowHasher hasher;
+  // A RowTyped is ordered by column name, equal rows hash in the same order.
+  for (const auto& column : row) {
+    hashColumn(hasher, column.first, column.second);
+  }
+  return hasher.finish();
+}
+
+RowFingerprint getRowFingerprint(const QueryDataColumnar::RowRef& row) {
+  RowHasher hasher;
+  // The schema orders columns as a RowTyped would, so both hash the same.
+  for (auto index : row.schema().ordered()) {
+    hashColumn(hasher, row.name(index), row[index]);
+  }
+  return hasher.finish();
+}
+
+template <typename QueryDataType>
+static RowFingerprints getSortedFingerprints(const QueryDataType& qd) {
+  RowFingerprints fingerprints;
+  fingerprints.reserve(qd.size());
+  for (const auto& row : qd) {
+    fingerprints.push_back(getRowFingerprint(row));
+  }
+  std::sort(fingerprints.begin(), fingerprints.end());
+  return fingerprints;
+}
+
+RowFingerprints getRowFingerprints(const QueryDataTyped& qd) {
+  return getSortedFingerprints(qd);
+}
+
+RowFingerprints getRowFingerprints(const QueryDataColumnar& qd) {
+  return getSortedFingerprints(qd);
+}
+
+static inline const RowTyped& toRowTyped(const RowTyped& row) {
+  return row;
+}
+
+static inline RowTyped toRowTyped(const QueryDataColumnar::RowRef& row) {
+  return row.toRowTyped();
+}
+
+template <typename QueryDataType>
+static QueryDataTyped diffSortedFingerprints(
+    const RowFingerprints& old,
+    const QueryDataType& current,
+    RowFingerprints& current_fingerprints,
+    RowFingerprints& removed) {
+  std::vector<std::pair<RowFingerprint, size_t>> order;
+  order.reserve(current.size());
+  for (size_t i = 0; i < current.size(); i++) {
+    order.emplace_back(getRowFingerprint(current[i]), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  // Walk both sorted sequences once, marking the current rows with a match.
+  current_fingerprints.clear();
+  current_fingerprints.reserve(order.size());
+  removed.clear();
+  std::vector<bool> matched(current.size(), false);
+  auto item = old.begin();
+  for (const auto& entry : order) {
+    current_fingerprints.push_back(entry.first);
+    while (item != old.end() && *item < entry.first) {
+      removed.push_back(*item++);
+    }
+    if (item != old.end() && *item == entry.first) {
+      matched[entry.second] = true;
+      ++item;
+    }
+  }
+  removed.insert(removed.end(), item, old.end());
+
+  // Added rows are reported in the order of the current results.
+  QueryDataTyped added;
+  for (size_t i = 0; i < current.size(); i++) {
+    if (!matched[i]) {
+      added.push_back(toRowTyped(current[i]));
+    }
+  }
+  return added;
+}
+
+QueryDataTyped diffFingerprints(const RowFingerprints& old,
+                                const QueryDataTyped& current,
+                                RowFingerprints& current_fingerprints,
+                                RowFingerprints& removed) {
+  return diffSortedFingerprints(old, current, current_fingerprints, removed);
+}
+
+QueryDataTyped diffFingerprints(const RowFingerprints& old,
+                                const QueryDataColumnar& current,
+                                RowFingerprints& current_fingerprints,
+                                RowFingerprints& removed) {
+  return diffSortedFingerprints(old, current, current_fingerprints, removed);
+}
+
 } // namespace osquery
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <osquery/core/sql/query_data.h>
+#include <osquery/core/sql/query_data_columnar.h>
 
 namespace osquery {
 
@@ -96,4 +97,83 @@ Status serializeDiffResultsJSON(const DiffResults& d,
  */
 DiffResults diff(QueryDataSet& old_, QueryDataTyped& new_);
 
+/**
+ * @brief Diff QueryDataSet object and QueryDataColumnar object
+ *        and create a DiffResults object
+ *
+ * The current rows are compared in place, only rows that were added are
+ * copied into RowTyped containers. The result is identical to diffing the
+ * equivalent QueryDataTyped.
+ *
+ * @param old_ the "old" set of results, removed rows are moved out.
+ * @param new_ the "new" set of results.
+ *
+ * @return a DiffResults object which indicates the change from old_ to new_
+ */
+DiffResults diff(QueryDataSet& old_, const QueryDataColumnar& new_);
+
+/**
+ * @brief A 128-bit fingerprint of a single RowTyped.
+ *
+ * Fingerprints let a scheduled query be diffed against its previous results
+ * without storing or parsing the previous rows. Rows that compare equal
+ * always produce equal fingerprints. The hash is not cryptographic.
+ */
+struct RowFingerprint {
+  uint64_t high{0};
+  uint64_t low{0};
+
+  bool operator<(const RowFingerprint& comp) const {
+    return (high < comp.high) || (high == comp.high && low < comp.low);
+  }
+
+  bool operator==(const RowFingerprint& comp) const {
+    return high == comp.high && low == comp.low;
+  }
+
+  bool operator!=(const RowFingerprint& comp) const {
+    return !(*this == comp);
+  }
+};
+
+/// A sorted list of row fingerprints, duplicate rows are repeated.
+using RowFingerprints = std::vector<RowFingerprint>;
+
+/// Compute the fingerprint of a row from its column names and typed values.
+RowFingerprint getRowFingerprint(const RowTyped& row);
+
+/// Compute the fingerprint of a columnar row, equal to its RowTyped's.
+RowFingerprint getRowFingerprint(const QueryDataColumnar::RowRef& row);
+
+/// Compute the sorted fingerprints of every row in a result set.
+RowFingerprints getRowFingerprints(const QueryDataTyped& qd);
+
+/// Compute the sorted fingerprints of every row in a columnar result set.
+RowFingerprints getRowFingerprints(const QueryDataColumnar& qd);
+
+/**
+ * @brief Diff the fingerprints of the "old" results against new results.
+ *
+ * This has the same multiset semantics as diff, but only the old fingerprints
+ * are required. Rows that were removed are reported by fingerprint, the caller
+ * decides if the full removed rows are needed.
+ *
+ * @param old_ the sorted fingerprints of the "old" set of results.
+ * @param new_ the "new" set of results.
+ * @param current [output] the sorted fingerprints of new_.
+ * @param removed [output] the sorted fingerprints no longer in new_.
+ *
+ * @return the rows in new_ that were added, in the order of new_.
+ */
+QueryDataTyped diffFingerprints(const RowFingerprints& old_,
+                                const QueryDataTyped& new_,
+                                RowFingerprints& current,
+                                RowFingerprints& removed);
+
+/// Diff fingerprints against columnar results, only added rows are copied.
+QueryDataTyped diffFingerprints(const RowFingerprints& old_,
+                                const QueryDataColumnar& new_,
+                                RowFingerprints& current,
+                                RowFingerprints& removed);
+
 } // namespace osquery
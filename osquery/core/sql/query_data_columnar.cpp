@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+
+#include "query_data_columnar.h"
+
+#include <osquery/utils/conversions/castvariant.h>
+
+namespace rj = rapidjson;
+
+namespace osquery {
+
+/// Three-way comparison matching boost::variant's operator<.
+static inline int compareValue(const RowDataTyped& a, const RowDataTyped& b) {
+  if (a.which() != b.which()) {
+    return (a.which() < b.which()) ? -1 : 1;
+  }
+  if (a < b) {
+    return -1;
+  }
+  if (b < a) {
+    return 1;
+  }
+  return 0;
+}
+
+static inline int compareName(const std::string& a, const std::string& b) {
+  auto c = a.compare(b);
+  return (c < 0) ? -1 : ((c > 0) ? 1 : 0);
+}
+
+ColumnSchema::ColumnSchema(ColumnNames names) : names_(std::move(names)) {
+  // A RowTyped keeps the last value assigned to a duplicate column name.
+  std::map<std::string, size_t> unique;
+  for (size_t i = 0; i < names_.size(); i++) {
+    unique[names_[i]] = i;
+  }
+
+  ordered_.reserve(unique.size());
+  for (const auto& column : unique) {
+    ordered_.push_back(column.second);
+  }
+}
+
+size_t ColumnSchema::find(const std::string& name) const {
+  auto it = std::lower_bound(
+      ordered_.begin(),
+      ordered_.end(),
+      name,
+      [this](size_t index, const std::string& n) { return names_[index] < n; });
+  if (it == ordered_.end() || names_[*it] != name) {
+    return npos;
+  }
+  return *it;
+}
+
+const RowDataTyped* QueryDataColumnar::RowRef::find(
+    const std::string& name) const {
+  auto index = schema_->find(name);
+  if (index == ColumnSchema::npos) {
+    return nullptr;
+  }
+  return &values_[index];
+}
+
+RowTyped QueryDataColumnar::RowRef::toRowTyped() const {
+  RowTyped row;
+  for (auto index : schema_->ordered()) {
+    row.emplace_hint(row.end(), name(index), values_[index]);
+  }
+  return row;
+}
+
+Row QueryDataColumnar::RowRef::toRow() const {
+  Row row;
+  for (auto index : schema_->ordered()) {
+    row.emplace_hint(row.end(), name(index), castVariant(values_[index]));
+  }
+  return row;
+}
+
+int QueryDataColumnar::RowRef::compare(const RowTyped& other) const {
+  auto it = other.begin();
+  for (auto index : schema_->ordered()) {
+    if (it == other.end()) {
+      return 1;
+    }
+
+    auto c = compareName(name(index), it->first);
+    if (c == 0) {
+      c = compareValue(values_[index], it->second);
+    }
+    if (c != 0) {
+      return c;
+    }
+    ++it;
+  }
+  return (it == other.end()) ? 0 : -1;
+}
+
+int QueryDataColumnar::RowRef::compare(const RowRef& other) const {
+  const auto& lhs = schema_->ordered();
+  const auto& rhs = other.schema_->ordered();
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (i >= rhs.size()) {
+      return 1;
+    }
+
+    int c = 0;
+    if (schema_ != other.schema_) {
+      c = compareName(name(lhs[i]), other.name(rhs[i]));
+    }
+    if (c == 0) {
+      c = compareValue(values_[lhs[i]], other.values_[rhs[i]]);
+    }
+    if (c != 0) {
+      return c;
+    }
+  }
+  return (lhs.size() == rhs.size()) ? 0 : -1;
+}
+
+const QueryDataColumnar::Segment& QueryDataColumnar::segment(
+    size_t row) const {
+  if (segments_.size() == 1) {
+    return segments_.front();
+  }
+
+  auto it = std::upper_bound(
+      segments_.begin(),
+      segments_.end(),
+      row,
+      [](size_t r, const Segment& segment) { return r < segment.first_row; });
+  return *std::prev(it);
+}
+
+RowDataTyped* QueryDataColumnar::addRow() {
+  auto offset = values_.size();
+  if (segments_.empty() || segments_.back().schema != schema_) {
+    segments_.push_back({rows_, offset, schema_});
+  }
+  values_.resize(offset + columns());
+  rows_++;
+  return values_.data() + offset;
+}
+
+void QueryDataColumnar::addRow(const RowTyped& row) {
+  auto* values = addRow();
+  for (size_t i = 0; i < columns(); i++) {
+    auto it = row.find(schema_->names()[i]);
+    if (it != row.end()) {
+      values[i] = it->second;
+    }
+  }
+}
+
+QueryDataTyped QueryDataColumnar::toQueryDataTyped() const {
+  QueryDataTyped results;
+  results.reserve(rows_);
+  for (const auto& row : *this) {
+    results.push_back(row.toRowTyped());
+  }
+  return results;
+}
+
+QueryData QueryDataColumnar::toQueryData() const {
+  QueryData results;
+  results.reserve(rows_);
+  for (const auto& row : *this) {
+    results.push_back(row.toRow());
+  }
+  return results;
+}
+
+static void serializeRow(const QueryDataColumnar::RowRef& r,
+                         JSON& doc,
+                         rj::Value& obj,
+                         bool asNumeric) {
+  for (auto index : r.schema().ordered()) {
+    const auto& key = r.name(index);
+    if (asNumeric) {
+      boost::apply_visitor(
+          [&doc, &obj, &key](auto value) { doc.add(key, value, obj); },
+          r[index]);
+    } else {
+      doc.addCopy(key, castVariant(r[index]), obj);
+    }
+  }
+}
+
+Status serializeQueryData(const QueryDataColumnar& q,
+                          JSON& doc,
+                          rj::Document& arr,
+                          bool asNumeric) {
+  if (q.schema() == nullptr) {
+    return Status::success();
+  }
+
+  for (const auto& r : q) {
+    auto row_obj = doc.getObject();
+    serializeRow(r, doc, row_obj, asNumeric);
+    doc.push(row_obj, arr);
+  }
+  return Status::success();
+}
+
+Status serializeQueryDataJSON(const QueryDataColumnar& q,
+                              std::string& json,
+                              bool asNumeric) {
+  auto doc = JSON::newArray();
+
+  auto status = serializeQueryData(q, doc, doc.doc(), asNumeric);
+  if (!status.ok()) {
+    return status;
+  }
+  return doc.toString(json);
+}
+
+Status serializeRowJSON(const QueryDataColumnar::RowRef& r,
+                        std::string& json,
+                        bool asNumeric) {
+  auto doc = JSON::newObject();
+  serializeRow(r, doc, doc.doc(), asNumeric);
+  return doc.toString(json);
+}
+
+} // namespace osquery
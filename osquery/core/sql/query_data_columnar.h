@@ -0,0 +1,312 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <osquery/core/sql/query_data.h>
+
+namespace osquery {
+
+/**
+ * @brief The interned set of column names for a result set.
+ *
+ * A schema is resolved once per prepared statement and shared by every row
+ * produced by that statement. Column values are addressed by index.
+ *
+ * The schema also keeps the columns in name order, with duplicate names
+ * resolved to the last column, which matches how a RowTyped map is built and
+ * compared. This lets columnar rows be serialized and diffed with the same
+ * semantics as RowTyped.
+ */
+class ColumnSchema {
+ public:
+  explicit ColumnSchema(ColumnNames names);
+
+  /// Column names in result order.
+  const ColumnNames& names() const {
+    return names_;
+  }
+
+  /// Number of columns in result order.
+  size_t size() const {
+    return names_.size();
+  }
+
+  /// Indexes of unique columns, sorted by column name.
+  const std::vector<size_t>& ordered() const {
+    return ordered_;
+  }
+
+  /// Return the index of a column name, or `npos` if the name is unknown.
+  size_t find(const std::string& name) const;
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+ private:
+  ColumnNames names_;
+  std::vector<size_t> ordered_;
+};
+
+using ColumnSchemaRef = std::shared_ptr<const ColumnSchema>;
+
+/**
+ * @brief A typed result set stored column-indexed in a contiguous buffer.
+ *
+ * QueryDataColumnar is an alternative to QueryDataTyped for large results.
+ * Column names are stored once in a shared ColumnSchema and row values are
+ * stored back-to-back in a single vector. This avoids a map allocation per
+ * row and a copy of every column name per cell.
+ *
+ * Rows are accessed through RowRef views. Consumers that still require
+ * RowTyped or Row containers may convert with the `to*` adapters.
+ *
+ * Each statement of a query may select different columns, rows keep the
+ * schema that was set when they were added.
+ */
+class QueryDataColumnar {
+ public:
+  /// A non-owning view of a single row.
+  class RowRef {
+   public:
+    RowRef(const QueryDataColumnar& data, size_t row) {
+      const auto& segment = data.segment(row);
+      schema_ = segment.schema.get();
+      values_ = data.values_.data() + segment.offset +
+                (row - segment.first_row) * schema_->size();
+    }
+
+    /// Number of columns.
+    size_t size() const {
+      return schema_->size();
+    }
+
+    /// The schema shared by every row of the result set.
+    const ColumnSchema& schema() const {
+      return *schema_;
+    }
+
+    /// Column name at an index.
+    const std::string& name(size_t column) const {
+      return schema_->names()[column];
+    }
+
+    /// Column value at an index.
+    const RowDataTyped& operator[](size_t column) const {
+      return values_[column];
+    }
+
+    /// Lookup a column value by name, nullptr if the column does not exist.
+    const RowDataTyped* find(const std::string& name) const;
+
+    /// Copy the row into a RowTyped.
+    RowTyped toRowTyped() const;
+
+    /// Copy the row into a Row, casting values to strings.
+    Row toRow() const;
+
+    /// Compare with the same ordering as RowTyped's operator<.
+    int compare(const RowTyped& other) const;
+
+    /// Compare with the same ordering as RowTyped's operator<.
+    int compare(const RowRef& other) const;
+
+    bool operator==(const RowTyped& other) const {
+      return compare(other) == 0;
+    }
+
+   private:
+    const ColumnSchema* schema_{nullptr};
+    const RowDataTyped* values_{nullptr};
+
+   private:
+    friend class QueryDataColumnar;
+  };
+
+  /// A forward iterator yielding RowRef views.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = RowRef;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = RowRef;
+
+    const_iterator(const QueryDataColumnar& data, size_t row)
+        : data_(&data), row_(row) {}
+
+    RowRef operator*() const {
+      return RowRef(*data_, row_);
+    }
+
+    const_iterator& operator++() {
+      ++row_;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return row_ == other.row_ && data_ == other.data_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    const QueryDataColumnar* data_{nullptr};
+    size_t row_{0};
+  };
+
+ public:
+  QueryDataColumnar() = default;
+  explicit QueryDataColumnar(ColumnSchemaRef schema)
+      : schema_(std::move(schema)) {}
+
+  /// Set the schema of the rows added next, earlier rows keep their schema.
+  void setSchema(ColumnSchemaRef schema) {
+    schema_ = std::move(schema);
+  }
+
+  /// The schema of the rows added next, nullptr if no statement had columns.
+  const ColumnSchemaRef& schema() const {
+    return schema_;
+  }
+
+  /// Number of columns of the rows added next.
+  size_t columns() const {
+    return (schema_ == nullptr) ? 0 : schema_->size();
+  }
+
+  /// Number of rows.
+  size_t size() const {
+    return rows_;
+  }
+
+  bool empty() const {
+    return rows_ == 0;
+  }
+
+  void reserve(size_t rows) {
+    values_.reserve(rows * columns());
+  }
+
+  void clear() {
+    values_.clear();
+    segments_.clear();
+    rows_ = 0;
+  }
+
+  /**
+   * @brief Append an empty row and return its column slots.
+   *
+   * The returned pointer references `columns()` values and is invalidated by
+   * the next call to addRow.
+   */
+  RowDataTyped* addRow();
+
+  /// Append a RowTyped, columns not present in the schema are ignored.
+  void addRow(const RowTyped& row);
+
+  RowRef operator[](size_t row) const {
+    return RowRef(*this, row);
+  }
+
+  const_iterator begin() const {
+    return const_iterator(*this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(*this, rows_);
+  }
+
+  /// Copy the rows into a QueryDataTyped.
+  QueryDataTyped toQueryDataTyped() const;
+
+  /// Copy the rows into a QueryData, casting values to strings.
+  QueryData toQueryData() const;
+
+  /// Apply a callable to every value, used for in-place escaping.
+  template <typename Function>
+  void forEachValue(Function func) {
+    for (auto& value : values_) {
+      func(value);
+    }
+  }
+
+ private:
+  /// Consecutive rows added with the same schema.
+  struct Segment {
+    /// Index of the first row.
+    size_t first_row{0};
+
+    /// Index of the first value of the first row.
+    size_t offset{0};
+
+    ColumnSchemaRef schema{nullptr};
+  };
+
+  /// Return the segment holding a row.
+  const Segment& segment(size_t row) const;
+
+ private:
+  ColumnSchemaRef schema_{nullptr};
+  std::vector<Segment> segments_;
+  std::vector<RowDataTyped> values_;
+  size_t rows_{0};
+};
+
+/**
+ * @brief Serialize a QueryDataColumnar object into a JSON array.
+ *
+ * The output is identical to serializing the equivalent QueryDataTyped.
+ *
+ * @param q the QueryDataColumnar to serialize.
+ * @param doc the managed JSON document.
+ * @param arr [output] the output JSON array.
+ * @param asNumeric true iff numeric values are serialized as such
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeQueryData(const QueryDataColumnar& q,
+                          JSON& doc,
+                          rapidjson::Document& arr,
+                          bool asNumeric);
+
+/**
+ * @brief Serialize a QueryDataColumnar object into a JSON string.
+ *
+ * @param q the QueryDataColumnar to serialize.
+ * @param json [output] the output JSON string.
+ * @param asNumeric true iff numeric values are serialized as such
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeQueryDataJSON(const QueryDataColumnar& q,
+                              std::string& json,
+                              bool asNumeric);
+
+/**
+ * @brief Serialize a columnar row into a JSON string.
+ *
+ * The output is identical to serializing the equivalent RowTyped.
+ *
+ * @param r the row to serialize.
+ * @param json [output] the output JSON string.
+ * @param asNumeric true iff numeric values are serialized as such
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeRowJSON(const QueryDataColumnar::RowRef& r,
+                        std::string& json,
+                        bool asNumeric);
+
+} // namespace osquery
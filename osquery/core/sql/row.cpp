@@ -65,7 +65,7 @@ Status serializeRow(const RowTyped& r,
                                auto value) { doc.add(key, value, obj); },
                            i.second);
     } else {
-      doc.addRef(i.first, castVariant(i.second), obj);
+      doc.addCopy(i.first, castVariant(i.second), obj);
     }
   }
   return Status::success();
@@ -0,0 +1,340 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "row_binary.h"
+
+namespace osquery {
+
+namespace {
+
+/// Leading byte of a binary row, a JSON row starts with '{'.
+const char kRowBinaryVersion{'\x01'};
+
+/// Leading byte of a serialized column dictionary.
+const char kColumnDictionaryVersion{'\x01'};
+
+/// Leading byte of a column-oriented chunk of rows.
+const char kColumnChunkVersion{'\x01'};
+
+/// Column tag bit set when the value is stored as an integer.
+const std::uint64_t kIntegerColumnTag{1U};
+
+void putString(std::string& out, const std::string& value) {
+  putVarint(out, value.size());
+  out.append(value);
+}
+
+bool getString(const std::string& in, std::size_t& offset, std::string& value) {
+  std::uint64_t size{0U};
+  if (!getVarint(in, offset, size) || size > in.size() - offset) {
+    return false;
+  }
+
+  value.assign(in, offset, static_cast<std::size_t>(size));
+  offset += static_cast<std::size_t>(size);
+  return true;
+}
+
+/**
+ * @brief Parse a decimal integer that std::to_string reproduces exactly.
+ *
+ * Values with a sign other than '-', leading zeros, or "-0" are not canonical
+ * and are stored as strings so that every row round-trips unchanged.
+ */
+bool getCanonicalInteger(const std::string& value, long long& integer) {
+  auto negative = !value.empty() && value[0] == '-';
+  std::size_t start = negative ? 1U : 0U;
+
+  auto digits = value.size() - start;
+  if (digits == 0U || digits > 19U) {
+    return false;
+  }
+
+  if (value[start] == '0' && (digits > 1U || negative)) {
+    return false;
+  }
+
+  std::uint64_t magnitude{0U};
+  for (auto i = start; i < value.size(); ++i) {
+    auto c = value[i];
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    magnitude = magnitude * 10U + static_cast<std::uint64_t>(c - '0');
+  }
+
+  if (negative) {
+    if (magnitude > 9223372036854775808ULL) {
+      return false;
+    }
+    integer = -static_cast<long long>(magnitude - 1U) - 1;
+
+  } else {
+    if (magnitude > 9223372036854775807ULL) {
+      return false;
+    }
+    integer = static_cast<long long>(magnitude);
+  }
+
+  return true;
+}
+
+std::uint64_t zigzagEncode(long long value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+long long zigzagDecode(std::uint64_t value) {
+  return static_cast<long long>((value >> 1) ^ (~(value & 1U) + 1U));
+}
+
+} // namespace
+
+void putVarint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80U) {
+    out.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(const std::string& in,
+               std::size_t& offset,
+               std::uint64_t& value) {
+  value = 0U;
+  for (unsigned shift = 0U; shift < 64U; shift += 7U) {
+    if (offset >= in.size()) {
+      return false;
+    }
+
+    auto byte = static_cast<std::uint8_t>(in[offset++]);
+    value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0U) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t ColumnDictionary::add(const std::string& name) {
+  auto it = index_.find(name);
+  if (it != index_.end()) {
+    return it->second;
+  }
+
+  auto index = names_.size();
+  names_.push_back(name);
+  index_.insert({name, index});
+  return index;
+}
+
+const std::string* ColumnDictionary::name(std::size_t index) const {
+  return (index < names_.size()) ? &names_[index] : nullptr;
+}
+
+void ColumnDictionary::serialize(std::string& out) const {
+  out.clear();
+  out.push_back(kColumnDictionaryVersion);
+  putVarint(out, names_.size());
+  for (const auto& name : names_) {
+    putString(out, name);
+  }
+}
+
+Status ColumnDictionary::deserialize(const std::string& in) {
+  if (in.empty() || in[0] != kColumnDictionaryVersion) {
+    return Status::failure("Unsupported column dictionary version");
+  }
+
+  std::size_t offset{1U};
+  std::uint64_t count{0U};
+  if (!getVarint(in, offset, count)) {
+    return Status::failure("Truncated column dictionary");
+  }
+
+  ColumnDictionary dictionary;
+  for (std::uint64_t i = 0U; i < count; ++i) {
+    std::string name;
+    if (!getString(in, offset, name)) {
+      return Status::failure("Truncated column dictionary");
+    }
+
+    if (dictionary.add(name) != i) {
+      return Status::failure("Duplicate column in dictionary: " + name);
+    }
+  }
+
+  *this = std::move(dictionary);
+  return Status::success();
+}
+
+void serializeRowBinary(const Row& r,
+                        ColumnDictionary& dictionary,
+                        std::string& out) {
+  out.clear();
+  out.push_back(kRowBinaryVersion);
+  putVarint(out, r.size());
+
+  for (const auto& column : r) {
+    std::uint64_t tag = dictionary.add(column.first) << 1;
+
+    long long integer{0};
+    if (getCanonicalInteger(column.second, integer)) {
+      putVarint(out, tag | kIntegerColumnTag);
+      putVarint(out, zigzagEncode(integer));
+
+    } else {
+      putVarint(out, tag);
+      putString(out, column.second);
+    }
+  }
+}
+
+Status deserializeRowBinary(const std::string& in,
+                            const ColumnDictionary& dictionary,
+                            Row& r) {
+  if (!isRowBinary(in)) {
+    return Status::failure("Unsupported binary row version");
+  }
+
+  std::size_t offset{1U};
+  std::uint64_t count{0U};
+  if (!getVarint(in, offset, count)) {
+    return Status::failure("Truncated binary row");
+  }
+
+  for (std::uint64_t i = 0U; i < count; ++i) {
+    std::uint64_t tag{0U};
+    if (!getVarint(in, offset, tag)) {
+      return Status::failure("Truncated binary row");
+    }
+
+    const auto* name = dictionary.name(static_cast<std::size_t>(tag >> 1));
+    if (name == nullptr) {
+      return Status::failure("Unknown column in binary row");
+    }
+
+    std::string value;
+    if ((tag & kIntegerColumnTag) != 0U) {
+      std::uint64_t integer{0U};
+      if (!getVarint(in, offset, integer)) {
+        return Status::failure("Truncated binary row");
+      }
+      value = std::to_string(zigzagDecode(integer));
+
+    } else if (!getString(in, offset, value)) {
+      return Status::failure("Truncated binary row");
+    }
+
+    r[*name] = std::move(value);
+  }
+
+  return Status::success();
+}
+
+void serializeColumnChunk(const QueryData& rows,
+                          ColumnDictionary& dictionary,
+                          std::string& out) {
+  std::vector<bool> used;
+  for (const auto& row : rows) {
+    for (const auto& column : row) {
+      auto index = dictionary.add(column.first);
+      if (index >= used.size()) {
+        used.resize(index + 1, false);
+      }
+      used[index] = true;
+    }
+  }
+
+  out.clear();
+  out.push_back(kColumnChunkVersion);
+  putVarint(out, rows.size());
+  putVarint(out, std::count(used.begin(), used.end(), true));
+
+  for (std::size_t index = 0U; index < used.size(); ++index) {
+    if (!used[index]) {
+      continue;
+    }
+
+    putVarint(out, index);
+    const auto& name = *dictionary.name(index);
+    for (const auto& row : rows) {
+      auto value = row.find(name);
+      if (value == row.end()) {
+        putVarint(out, 0U);
+      } else {
+        putVarint(out, value->second.size() + 1U);
+        out.append(value->second);
+      }
+    }
+  }
+}
+
+Status deserializeColumnChunk(const std::string& in,
+                              const ColumnDictionary& dictionary,
+                              QueryData& rows) {
+  if (in.empty() || in[0] != kColumnChunkVersion) {
+    return Status::failure("Unsupported column chunk version");
+  }
+
+  std::size_t offset{1U};
+  std::uint64_t row_count{0U};
+  std::uint64_t column_count{0U};
+  if (!getVarint(in, offset, row_count) ||
+      !getVarint(in, offset, column_count)) {
+    return Status::failure("Truncated column chunk");
+  }
+
+  // Every value takes at least one byte, this bounds the allocation below.
+  if (row_count > in.size() - offset) {
+    return Status::failure("Truncated column chunk");
+  }
+
+  rows.clear();
+  rows.resize(static_cast<std::size_t>(row_count));
+  for (std::uint64_t i = 0U; i < column_count; ++i) {
+    std::uint64_t index{0U};
+    if (!getVarint(in, offset, index)) {
+      return Status::failure("Truncated column chunk");
+    }
+
+    const auto* name = dictionary.name(static_cast<std::size_t>(index));
+    if (name == nullptr) {
+      return Status::failure("Unknown column in column chunk");
+    }
+
+    for (auto& row : rows) {
+      std::uint64_t size{0U};
+      if (!getVarint(in, offset, size)) {
+        return Status::failure("Truncated column chunk");
+      }
+
+      if (size == 0U) {
+        continue;
+      }
+
+      if (size - 1U > in.size() - offset) {
+        return Status::failure("Truncated column chunk");
+      }
+      row[*name].assign(in, offset, static_cast<std::size_t>(size - 1U));
+      offset += static_cast<std::size_t>(size - 1U);
+    }
+  }
+
+  return Status::success();
+}
+
+bool isRowBinary(const std::string& in) {
+  return !in.empty() && in[0] == kRowBinaryVersion;
+}
+
+} // namespace osquery
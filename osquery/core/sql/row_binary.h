@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <osquery/core/sql/query_data.h>
+#include <osquery/core/sql/row.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/// Append an unsigned LEB128 varint.
+void putVarint(std::string& out, std::uint64_t value);
+
+/**
+ * @brief Read an unsigned LEB128 varint.
+ *
+ * @param in the serialized bytes.
+ * @param offset [in/out] the position of the varint, moved past it.
+ * @param value [output] the varint value.
+ *
+ * @return false if the varint is truncated or longer than 64 bits.
+ */
+bool getVarint(const std::string& in,
+               std::size_t& offset,
+               std::uint64_t& value);
+
+/**
+ * @brief An append-only dictionary of column names.
+ *
+ * Binary rows reference their columns by index into a dictionary, so the
+ * column names are stored once per dictionary instead of once per row.
+ * Indexes are never reused or reordered, a dictionary may only grow.
+ */
+class ColumnDictionary final {
+ public:
+  /// Return the index of a column name, adding it if it is unknown.
+  std::size_t add(const std::string& name);
+
+  /// Return the column name at an index, nullptr if the index is unknown.
+  const std::string* name(std::size_t index) const;
+
+  /// Number of column names.
+  std::size_t size() const {
+    return names_.size();
+  }
+
+  /// Serialize the column names, in index order.
+  void serialize(std::string& out) const;
+
+  /// Replace the dictionary with serialized column names.
+  Status deserialize(const std::string& in);
+
+ private:
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, std::size_t> index_;
+};
+
+/**
+ * @brief Serialize a Row into the compact binary row format.
+ *
+ * The format starts with a version byte that can never begin a JSON document.
+ * Each column is stored as a varint dictionary index followed by either a
+ * zigzag varint, for values that are canonical decimal integers, or a varint
+ * length and the raw string bytes.
+ *
+ * @param r the Row to serialize.
+ * @param dictionary the column dictionary, unknown columns are added.
+ * @param out [output] the serialized row.
+ */
+void serializeRowBinary(const Row& r,
+                        ColumnDictionary& dictionary,
+                        std::string& out);
+
+/**
+ * @brief Deserialize a Row from the compact binary row format.
+ *
+ * @param in the serialized row.
+ * @param dictionary the column dictionary used to serialize the row.
+ * @param r [output] the output Row structure.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status deserializeRowBinary(const std::string& in,
+                            const ColumnDictionary& dictionary,
+                            Row& r);
+
+/**
+ * @brief Serialize rows into a column-oriented chunk.
+ *
+ * A chunk starts with a version byte and the row count, followed by each
+ * column used by the rows once: its dictionary index, then its value in every
+ * row as a varint length plus one and the raw bytes. A length of 0 marks a
+ * row without the column, so sparse rows round-trip unchanged.
+ *
+ * @param rows the rows to serialize.
+ * @param dictionary the column dictionary, unknown columns are added.
+ * @param out [output] the serialized chunk.
+ */
+void serializeColumnChunk(const QueryData& rows,
+                          ColumnDictionary& dictionary,
+                          std::string& out);
+
+/**
+ * @brief Deserialize rows from a column-oriented chunk.
+ *
+ * @param in the serialized chunk.
+ * @param dictionary the column dictionary used to serialize the chunk.
+ * @param rows [output] the rows, replacing any existing content.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status deserializeColumnChunk(const std::string& in,
+                              const ColumnDictionary& dictionary,
+                              QueryData& rows);
+
+/// Check if a serialized row uses the binary row format.
+bool isRowBinary(const std::string& in);
+
+} // namespace osquery
@@ -16,17 +16,58 @@
 #include <osquery/registry/registry_factory.h>
 #include <osquery/utils/conversions/tryto.h>
 
+#include <osquery/core/sql/row_binary.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
 
 namespace osquery {
 
 FLAG(bool, disable_caching, false, "Disable scheduled query caching");
 
+namespace {
+
+/// Rows of a chunked generate call that have not been returned yet.
+struct GenerateChunkSession {
+  TableRows rows;
+
+  /// Index of the first row of the next chunk.
+  size_t offset{0};
+
+  /// Columns of the chunks, sent again whenever a chunk adds a column.
+  ColumnDictionary columns;
+
+  std::chrono::steady_clock::time_point last_used;
+};
+
+/// Rows returned per chunk if the request does not ask for a size.
+const size_t kGenerateChunkRows{1024};
+
+/// Sessions the core has not finished or cancelled are dropped when idle.
+const std::chrono::seconds kGenerateSessionExpiry{60};
+
+/// Maximum number of unfinished sessions, the least recently used is dropped.
+const size_t kGenerateSessionsMax{16};
+
+std::atomic<size_t> kGenerateSessionID{0};
+
+std::map<std::string, std::shared_ptr<GenerateChunkSession>> kGenerateSessions;
+Mutex kGenerateSessionsMutex;
+
+} // namespace
+
 CREATE_LAZY_REGISTRY(TablePlugin, "table");
 
 uint64_t TablePlugin::kCacheInterval = 0;
 uint64_t TablePlugin::kCacheStep = 0;
 
+/// Set when the calling thread executes scheduled queries of a worker pool.
+static thread_local bool kThreadCache{false};
+static thread_local uint64_t kThreadCacheInterval{0};
+static thread_local uint64_t kThreadCacheStep{0};
+
 #define kDisableRowId "WITHOUT ROWID"
 
 // Columns used bitmask
@@ -91,6 +132,9 @@ void TablePlugin::setRequestFromContext(const QueryContext& context,
 QueryContext TablePlugin::getContextFromRequest(
     const PluginRequest& request) const {
   QueryContext context;
+  // Rows filled by column index, such as SlotTableRow, name their columns
+  // from the table content.
+  context.table_->columns = columns();
   if (request.count("context") == 0) {
     return context;
   }
@@ -151,6 +195,8 @@ Status TablePlugin::call(const PluginRequest& request,
   } else if (action == "update") {
     auto context = getContextFromRequest(request);
     response = update(context, request);
+  } else if (action == "generate_chunk") {
+    return generateChunk(request, response);
   } else if (action == "columns") {
     response = routeInfo();
   } else {
@@ -160,6 +206,106 @@ Status TablePlugin::call(const PluginRequest& request,
   return Status::success();
 }
 
+Status TablePlugin::generateChunk(const PluginRequest& request,
+                                  PluginResponse& response) {
+  auto chunk_rows = kGenerateChunkRows;
+  auto requested_rows = request.find("chunk_rows");
+  if (requested_rows != request.end()) {
+    auto rows = tryTo<unsigned long>(requested_rows->second);
+    if (rows && rows.get() > 0) {
+      chunk_rows = static_cast<size_t>(rows.take());
+    }
+  }
+
+  std::shared_ptr<GenerateChunkSession> session;
+  std::string cursor;
+  auto request_cursor = request.find("cursor");
+  if (request_cursor == request.end() || request_cursor->second.empty()) {
+    session = std::make_shared<GenerateChunkSession>();
+    auto context = getContextFromRequest(request);
+    if (usesGenerator()) {
+      RowGenerator::pull_type generator(std::bind(&TablePlugin::generator,
+                                                  this,
+                                                  std::placeholders::_1,
+                                                  std::ref(context)));
+      for (; generator; generator()) {
+        session->rows.push_back(generator.get());
+      }
+    } else {
+      session->rows = generate(context);
+    }
+
+    for (const auto& column : columns()) {
+      session->columns.add(std::get<0>(column));
+    }
+    cursor = getName() + "." + std::to_string(++kGenerateSessionID);
+  } else {
+    // The session is owned by this request until it is stored again.
+    cursor = request_cursor->second;
+    WriteLock lock(kGenerateSessionsMutex);
+    auto it = kGenerateSessions.find(cursor);
+    if (it == kGenerateSessions.end()) {
+      return Status::failure("Unknown or expired generate cursor: " + cursor);
+    }
+    session = std::move(it->second);
+    kGenerateSessions.erase(it);
+  }
+
+  if (request.count("cancel") > 0) {
+    return Status::success();
+  }
+
+  auto first_chunk = session->offset == 0;
+  auto known_columns = session->columns.size();
+  auto end = std::min(session->offset + chunk_rows, session->rows.size());
+
+  QueryData chunk;
+  chunk.reserve(end - session->offset);
+  for (; session->offset < end; ++session->offset) {
+    // Rows are released as they are sent.
+    auto& row = session->rows[session->offset];
+    chunk.push_back(static_cast<Row>(*row));
+    row.reset();
+  }
+
+  Row item;
+  serializeColumnChunk(chunk, session->columns, item["data"]);
+  if (first_chunk || session->columns.size() != known_columns) {
+    session->columns.serialize(item["columns"]);
+  }
+  item["rows"] = INTEGER(chunk.size());
+  item["cursor"] = (end < session->rows.size()) ? cursor : "";
+  response.push_back(std::move(item));
+
+  if (end == session->rows.size()) {
+    return Status::success();
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  session->last_used = now;
+
+  WriteLock lock(kGenerateSessionsMutex);
+  for (auto it = kGenerateSessions.begin(); it != kGenerateSessions.end();) {
+    if (now - it->second->last_used > kGenerateSessionExpiry) {
+      it = kGenerateSessions.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (kGenerateSessions.size() >= kGenerateSessionsMax) {
+    auto oldest = std::min_element(
+        kGenerateSessions.begin(),
+        kGenerateSessions.end(),
+        [](const auto& left, const auto& right) {
+          return left.second->last_used < right.second->last_used;
+        });
+    kGenerateSessions.erase(oldest);
+  }
+  kGenerateSessions[cursor] = std::move(session);
+  return Status::success();
+}
+
 std::string TablePlugin::columnDefinition(bool is_extension) const {
   return osquery::columnDefinition(columns(), is_extension);
 }
@@ -192,6 +338,15 @@ PluginResponse TablePlugin::routeInfo() const {
   response.push_back(
       {{"id", "attributes"},
        {"attributes", INTEGER(static_cast<size_t>(attributes()))}});
+
+  for (const auto& column : columnSelectivity()) {
+    response.push_back({{"id", "selectivity"},
+                        {"name", column.first},
+                        {"selectivity", std::to_string(column.second)}});
+  }
+
+  // Advertise the generate_chunk action, older cores ignore unknown ids.
+  response.push_back({{"id", "generateChunk"}, {"version", "1"}});
   return response;
 }
 
@@ -212,13 +367,33 @@ static bool cacheAllowed(const TableColumns& cols, const QueryContext& ctx) {
   return true;
 }
 
+void TablePlugin::setThreadCache(uint64_t interval, uint64_t step) {
+  kThreadCache = true;
+  kThreadCacheInterval = interval;
+  kThreadCacheStep = step;
+}
+
+uint64_t TablePlugin::cacheInterval() {
+  return kThreadCache ? kThreadCacheInterval : kCacheInterval;
+}
+
+uint64_t TablePlugin::cacheStep() {
+  return kThreadCache ? kThreadCacheStep : kCacheStep;
+}
+
 bool TablePlugin::isCached(uint64_t step, const QueryContext& ctx) const {
   if (FLAGS_disable_caching) {
     return false;
   }
 
   // Perform the step comparison first, because it's easy.
-  return (step < last_cached_ + last_interval_ && cacheAllowed(columns(), ctx));
+  {
+    ReadLock lock(cache_mutex_);
+    if (step >= last_cached_ + last_interval_) {
+      return false;
+    }
+  }
+  return cacheAllowed(columns(), ctx);
 }
 
 TableRows TablePlugin::getCache() const {
@@ -242,8 +417,11 @@ void TablePlugin::setCache(uint64_t step,
   // Serialize QueryData and save to database.
   std::string content;
   if (serializeTableRowsJSON(results, content)) {
-    last_cached_ = step;
-    last_interval_ = interval;
+    {
+      WriteLock lock(cache_mutex_);
+      last_cached_ = step;
+      last_interval_ = interval;
+    }
     setDatabaseValue(kQueries, "cache." + getName(), content);
   }
 }
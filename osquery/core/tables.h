@@ -26,6 +26,7 @@
 #include <osquery/core/plugins/plugin.h>
 #include <osquery/core/query.h>
 #include <osquery/core/sql/column.h>
+#include <osquery/utils/mutex.h>
 
 #include <gtest/gtest_prod.h>
 
@@ -194,6 +195,9 @@ enum class TableAttributes {
 
   /// (Deprecated) This table's data requires an osquery kernel module.
   KERNEL_REQUIRED = 16,
+
+  /// The rows only depend on the constraints, a statement may reuse a scan.
+  MEMOIZABLE = 32,
 };
 
 /// Treat table attributes as a set of flags.
@@ -217,6 +221,9 @@ using ColumnAliasSet = std::map<std::string, std::set<std::string>>;
 /// Alias for a map of alias to canonical column names
 using AliasColumnMap = std::unordered_map<std::string, std::string>;
 
+/// Alias for a map of column names to the fraction of rows an equality keeps.
+using ColumnSelectivity = std::map<std::string, double>;
+
 /// Forward declaration of QueryContext for ConstraintList relationships.
 struct QueryContext;
 
@@ -423,6 +430,12 @@ struct VirtualTableContent {
   /// Transient set of virtual table used columns (as bitmasks)
   std::unordered_map<size_t, UsedColumnsBitset> colsUsedBitsets;
 
+  /// The extension table can return rows in chunks, see TablePlugin::call.
+  bool chunked_generate{false};
+
+  /// Selectivity hints of the columns, see TablePlugin::columnSelectivity.
+  ColumnSelectivity selectivity;
+
   /*
    * @brief A table implementation specific query result cache.
    *
@@ -471,6 +484,7 @@ struct QueryContext {
   QueryContext(QueryContext&& other)
       : constraints(std::move(other.constraints)),
         colsUsed(std::move(other.colsUsed)),
+        row_recycler(std::move(other.row_recycler)),
         enable_cache_(other.enable_cache_),
         use_cache_(other.use_cache_),
         table_(other.table_) {
@@ -482,6 +496,7 @@ struct QueryContext {
   QueryContext& operator=(QueryContext&& other) {
     std::swap(constraints, other.constraints);
     std::swap(colsUsed, other.colsUsed);
+    std::swap(row_recycler, other.row_recycler);
     std::swap(enable_cache_, other.enable_cache_);
     std::swap(use_cache_, other.use_cache_);
     std::swap(table_, other.table_);
@@ -640,6 +655,15 @@ struct QueryContext {
   boost::optional<UsedColumns> colsUsed;
   boost::optional<UsedColumnsBitset> colsUsedBitset;
 
+  /**
+   * @brief The row most recently consumed by SQLite, shared with the cursor.
+   *
+   * For generator tables the cursor returns each yielded row here before
+   * resuming the generator, such that the generator may reuse the row.
+   * This is nullptr if the context is not bound to a generator.
+   */
+  std::shared_ptr<TableRowHolder> row_recycler{nullptr};
+
  private:
   /// If false then the context is maintaining an ephemeral cache.
   bool enable_cache_{false};
@@ -652,6 +676,7 @@ struct QueryContext {
 
  private:
   friend class TablePlugin;
+  friend class SlotTableRow;
 };
 
 /**
@@ -707,6 +732,18 @@ class TablePlugin : public Plugin {
     return TableAttributes::NONE;
   }
 
+  /**
+   * @brief Hint the planner about the rows an equality constraint keeps.
+   *
+   * Each value is the fraction, between 0 and 1, of the table rows returned
+   * when the column is constrained with '='. The planner scales the observed
+   * row count of a full scan with it until the constrained scan itself has
+   * been observed.
+   */
+  virtual ColumnSelectivity columnSelectivity() const {
+    return ColumnSelectivity();
+  }
+
   /**
    * @brief Generate a complete table representation.
    *
@@ -842,6 +879,9 @@ class TablePlugin : public Plugin {
                 const TableRows& results);
 
  private:
+  /// Protects the last cached step and interval, they are updated together.
+  mutable Mutex cache_mutex_;
+
   /// The last time in seconds the table data results were saved to cache.
   uint64_t last_cached_{0};
 
@@ -861,6 +901,20 @@ class TablePlugin : public Plugin {
   /// The schedule step, this is the current position of the schedule.
   static uint64_t kCacheStep;
 
+  /**
+   * @brief Apply the interval and step of a scheduled query to this thread.
+   *
+   * Scheduler workers execute queries concurrently, each applies the values
+   * of its own query instead of kCacheInterval and kCacheStep.
+   */
+  static void setThreadCache(uint64_t interval, uint64_t step);
+
+  /// The scheduled interval of the calling thread, see setThreadCache.
+  static uint64_t cacheInterval();
+
+  /// The schedule step of the calling thread, see setThreadCache.
+  static uint64_t cacheStep();
+
  public:
   /**
    * @brief The registry call "router".
@@ -869,6 +923,8 @@ class TablePlugin : public Plugin {
    * handle requests and responses from extensions. The TablePlugin uses an
    * "action" key, which can be:
    *   - generate: call the plugin's row generate method (defined in spec).
+   *   - generate_chunk: return the next chunk of rows of a generate call as
+   *     a column-oriented batch, see generateChunk.
    *   - columns: return a list of column name and SQLite types.
    *   - definition: return an SQL statement for table creation.
    *
@@ -902,6 +958,18 @@ class TablePlugin : public Plugin {
   /// Helper data structure transformation methods.
   QueryContext getContextFromRequest(const PluginRequest& request) const;
 
+  /**
+   * @brief Return the rows of a generate call in chunks.
+   *
+   * The first request generates the rows and keeps them in a session, each
+   * request then returns up to "chunk_rows" rows serialized with
+   * serializeColumnChunk. The response has a single item with the chunk in
+   * "data", the serialized column dictionary in "columns" when it changed,
+   * and the "cursor" to pass in the next request, empty once every row was
+   * returned. A request with "cancel" drops the session.
+   */
+  Status generateChunk(const PluginRequest& request, PluginResponse& response);
+
   UsedColumnsBitset usedColumnsToBitset(const UsedColumns usedColumns) const;
   friend class RegistryFactory;
   FRIEND_TEST(VirtualTableTests, test_tableplugin_columndefinition);
@@ -85,6 +85,130 @@ TEST_F(QueryTests, test_add_and_get_current_results) {
   }
 }
 
+TEST_F(QueryTests, test_fingerprint_results) {
+  auto query = getOsqueryScheduledQuery();
+  auto cf = Query("fingerprints", query);
+  auto results = getTestDBExpectedResults();
+
+  // Results stored as JSON rows are diffed and replaced with fingerprints.
+  std::string json;
+  ASSERT_TRUE(serializeQueryDataJSON(results, json, true).ok());
+  ASSERT_TRUE(setDatabaseValue(kQueries, "fingerprints", json).ok());
+  ASSERT_TRUE(setDatabaseValue(kQueries, "fingerprintsepoch", "0").ok());
+  setDatabaseValue(kQueries, "query.fingerprints", query.query);
+
+  DiffResults dr;
+  uint64_t counter = 0;
+  auto current = results;
+  current.pop_back();
+  ASSERT_TRUE(cf.addNewResults(current, 0, counter, dr).ok());
+  EXPECT_TRUE(dr.added.empty());
+  ASSERT_EQ(dr.removed.size(), 1U);
+  EXPECT_EQ(dr.removed[0], results.back());
+
+  std::string raw;
+  getDatabaseValue(kQueries, "fingerprints", raw);
+  EXPECT_NE(raw, json);
+  ASSERT_FALSE(raw.empty());
+  EXPECT_NE(raw[0], '[');
+
+  // Unchanged results do not update the stored rows.
+  std::string stored = raw;
+  DiffResults unchanged;
+  ASSERT_TRUE(cf.addNewResults(current, 0, counter, unchanged).ok());
+  EXPECT_TRUE(unchanged.hasNoResults());
+  getDatabaseValue(kQueries, "fingerprints", raw);
+  EXPECT_EQ(raw, stored);
+
+  // Removed rows are detected without stored rows when they are not reported.
+  query.options["removed"] = false;
+  auto cf2 = Query("fingerprints", query);
+  DiffResults removed;
+  current.pop_back();
+  ASSERT_TRUE(cf2.addNewResults(current, 0, counter, removed).ok());
+  EXPECT_TRUE(removed.hasNoResults());
+  getDatabaseValue(kQueries, "fingerprints", raw);
+  EXPECT_LT(raw.size(), stored.size());
+  EXPECT_EQ(raw.find('{'), std::string::npos);
+
+  DiffResults added;
+  ASSERT_TRUE(cf2.addNewResults(results, 0, counter, added).ok());
+  EXPECT_EQ(added.added.size(), 2U);
+  EXPECT_TRUE(added.removed.empty());
+
+  // Reporting removed rows again starts over, the rows were not stored.
+  query.options["removed"] = true;
+  auto cf3 = Query("fingerprints", query);
+  DiffResults restarted;
+  counter = 5;
+  ASSERT_TRUE(cf3.addNewResults(current, 0, counter, restarted).ok());
+  EXPECT_EQ(restarted.added, current);
+  EXPECT_TRUE(restarted.removed.empty());
+  EXPECT_EQ(counter, 0U);
+
+  // Malformed fingerprints are not trusted, the results start over.
+  setDatabaseValue(kQueries, "fingerprints", "fp1:0123");
+  DiffResults malformed;
+  ASSERT_TRUE(cf3.addNewResults(current, 0, counter, malformed).ok());
+  EXPECT_EQ(malformed.added, current);
+  EXPECT_TRUE(malformed.removed.empty());
+
+  QueryDataSet previous;
+  ASSERT_TRUE(cf3.getPreviousQueryResults(previous).ok());
+  EXPECT_EQ(previous.size(), current.size());
+
+  // Removed rows that cannot be read are not dropped, the results start over.
+  getDatabaseValue(kQueries, "fingerprints", raw);
+  auto row = raw.find('{');
+  ASSERT_NE(row, std::string::npos);
+  raw[row] = '!';
+  setDatabaseValue(kQueries, "fingerprints", raw);
+
+  DiffResults unreadable;
+  counter = 5;
+  QueryDataTyped replaced = {results.back()};
+  ASSERT_TRUE(cf3.addNewResults(replaced, 0, counter, unreadable).ok());
+  EXPECT_EQ(unreadable.added, replaced);
+  EXPECT_TRUE(unreadable.removed.empty());
+  EXPECT_EQ(counter, 0U);
+}
+
+TEST_F(QueryTests, test_columnar_results) {
+  auto query = getOsqueryScheduledQuery();
+  auto typed = Query("typed_results", query);
+  auto columnar = Query("columnar_results", query);
+
+  auto toColumnar = [](const QueryDataTyped& rows) {
+    QueryDataColumnar results(
+        std::make_shared<const ColumnSchema>(ColumnNames{"age", "username"}));
+    for (const auto& row : rows) {
+      results.addRow(row);
+    }
+    return results;
+  };
+
+  // Columnar results are stored and diffed the same as typed results.
+  uint64_t counter = 0;
+  DiffResults typed_dr;
+  DiffResults columnar_dr;
+  auto results = getTestDBExpectedResults();
+  ASSERT_TRUE(typed.addNewResults(results, 0, counter, typed_dr).ok());
+  ASSERT_TRUE(
+      columnar.addNewResults(toColumnar(results), 0, counter, columnar_dr)
+          .ok());
+  EXPECT_EQ(columnar_dr, typed_dr);
+
+  for (const auto& result : getTestDBResultStream()) {
+    DiffResults expected;
+    DiffResults actual;
+    ASSERT_TRUE(typed.addNewResults(result.second, 0, counter, expected).ok());
+    ASSERT_TRUE(
+        columnar.addNewResults(toColumnar(result.second), 0, counter, actual)
+            .ok());
+    EXPECT_EQ(actual, expected);
+  }
+}
+
 TEST_F(QueryTests, test_get_query_results) {
   // Grab an expected set of query data and add it as the previous result.
   auto encoded_qd = getSerializedQueryDataJSON();
@@ -7,6 +7,8 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <thread>
+
 #include <gtest/gtest.h>
 #include <gflags/gflags.h>
 
@@ -189,4 +191,25 @@ TEST_F(TablesTests, test_caching) {
   EXPECT_TRUE(test.testIsCached(6));
   EXPECT_FALSE(test.testIsCached(7));
 }
+
+TEST_F(TablesTests, test_thread_caching) {
+  auto backup_step = TablePlugin::kCacheStep;
+  auto backup_interval = TablePlugin::kCacheInterval;
+  TablePlugin::kCacheInterval = 10;
+  TablePlugin::kCacheStep = 20;
+
+  // A scheduler worker applies the settings of its query to itself only.
+  std::thread worker([]() {
+    TablePlugin::setThreadCache(5, 3);
+    EXPECT_EQ(TablePlugin::cacheInterval(), 5U);
+    EXPECT_EQ(TablePlugin::cacheStep(), 3U);
+  });
+  worker.join();
+
+  EXPECT_EQ(TablePlugin::cacheInterval(), 10U);
+  EXPECT_EQ(TablePlugin::cacheStep(), 20U);
+
+  TablePlugin::kCacheStep = backup_step;
+  TablePlugin::kCacheInterval = backup_interval;
+}
 }
@@ -10,6 +10,7 @@
 #include <benchmark/benchmark.h>
 
 #include <osquery/core/query.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/database/database.h>
 #include <osquery/filesystem/filesystem.h>
 
@@ -48,6 +49,20 @@ QueryDataSet getExampleQueryDataSet(size_t x, size_t y) {
   return qds;
 }
 
+QueryDataTyped getExampleQueryDataTyped(size_t x, size_t y) {
+  QueryDataTyped qd;
+  qd.reserve(y);
+  for (size_t i = 0; i < y; i++) {
+    RowTyped r;
+    r["id"] = static_cast<long long>(i);
+    for (size_t j = 0; j < x; j++) {
+      r["key" + std::to_string(j)] = std::to_string(j) + "content";
+    }
+    qd.push_back(std::move(r));
+  }
+  return qd;
+}
+
 ColumnNames getExampleColumnNames(size_t x) {
   ColumnNames cn;
   for (size_t i = 0; i < x; i++) {
@@ -94,6 +109,37 @@ BENCHMARK(DATABASE_serialize_json)
     ->ArgPair(10, 10)
     ->ArgPair(10, 100);
 
+static void DATABASE_row_json(benchmark::State& state) {
+  auto qd = getExampleQueryData(state.range(0), state.range(1));
+  while (state.KeepRunning()) {
+    for (const auto& r : qd) {
+      std::string content;
+      serializeRowJSON(r, content);
+
+      Row row;
+      deserializeRowJSON(content, row);
+    }
+  }
+}
+
+BENCHMARK(DATABASE_row_json)->ArgPair(10, 100)->ArgPair(30, 100);
+
+static void DATABASE_row_binary(benchmark::State& state) {
+  auto qd = getExampleQueryData(state.range(0), state.range(1));
+  ColumnDictionary dictionary;
+  while (state.KeepRunning()) {
+    for (const auto& r : qd) {
+      std::string content;
+      serializeRowBinary(r, dictionary, content);
+
+      Row row;
+      deserializeRowBinary(content, dictionary, row);
+    }
+  }
+}
+
+BENCHMARK(DATABASE_row_binary)->ArgPair(10, 100)->ArgPair(30, 100);
+
 static void DATABASE_diff(benchmark::State& state) {
   QueryData qd = getExampleQueryData(state.range(0), state.range(1));
   QueryDataSet qds = getExampleQueryDataSet(state.range(0), state.range(1));
@@ -104,6 +150,35 @@ static void DATABASE_diff(benchmark::State& state) {
 
 BENCHMARK(DATABASE_diff)->ArgPair(1, 1)->ArgPair(10, 10)->ArgPair(10, 100);
 
+static void DATABASE_diff_typed(benchmark::State& state) {
+  auto qd = getExampleQueryDataTyped(state.range(0), state.range(1));
+  // One row changes between the previous and current results.
+  auto previous = qd;
+  previous.back()["id"] = -1LL;
+  while (state.KeepRunning()) {
+    QueryDataSet qds(previous.begin(), previous.end());
+    auto d = diff(qds, qd);
+  }
+}
+
+BENCHMARK(DATABASE_diff_typed)->ArgPair(10, 1000)->ArgPair(10, 100000);
+
+static void DATABASE_diff_fingerprints(benchmark::State& state) {
+  auto qd = getExampleQueryDataTyped(state.range(0), state.range(1));
+  auto previous = qd;
+  previous.back()["id"] = -1LL;
+  auto fingerprints = getRowFingerprints(previous);
+  while (state.KeepRunning()) {
+    RowFingerprints current;
+    RowFingerprints removed;
+    auto added = diffFingerprints(fingerprints, qd, current, removed);
+  }
+}
+
+BENCHMARK(DATABASE_diff_fingerprints)
+    ->ArgPair(10, 1000)
+    ->ArgPair(10, 100000);
+
 static void DATABASE_query_results(benchmark::State& state) {
   auto qd = getExampleQueryData(state.range(0), state.range(1));
   auto query = getOsqueryScheduledQuery();
@@ -120,6 +195,22 @@ BENCHMARK(DATABASE_query_results)
     ->ArgPair(10, 10)
     ->ArgPair(10, 100);
 
+static void DATABASE_query_results_unchanged(benchmark::State& state) {
+  auto qd = getExampleQueryDataTyped(state.range(0), state.range(1));
+  auto query = getOsqueryScheduledQuery();
+  auto dbq = Query("benchmark_unchanged", query);
+  uint64_t counter = 0;
+  dbq.addNewResults(qd, 0, counter);
+  while (state.KeepRunning()) {
+    DiffResults diff_results;
+    dbq.addNewResults(qd, 0, counter, diff_results);
+  }
+}
+
+BENCHMARK(DATABASE_query_results_unchanged)
+    ->ArgPair(10, 1000)
+    ->ArgPair(10, 100000);
+
 static void DATABASE_get(benchmark::State& state) {
   setDatabaseValue(kPersistentSettings, "benchmark", "1");
   while (state.KeepRunning()) {
@@ -7,12 +7,15 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/io/detail/quoted_manip.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/process/process.h>
@@ -45,6 +48,7 @@ const std::string kQueries = "queries";
 const std::string kEvents = "events";
 const std::string kCarves = "carves";
 const std::string kLogs = "logs";
+const std::string kHashes = "hashes";
 
 const std::string kDbEpochSuffix = "epoch";
 const std::string kDbCounterSuffix = "counter";
@@ -52,7 +56,7 @@ const std::string kDbCounterSuffix = "counter";
 const std::string kDbVersionKey = "results_version";
 
 const std::vector<std::string> kDomains = {
-    kPersistentSettings, kQueries, kEvents, kLogs, kCarves};
+    kPersistentSettings, kQueries, kEvents, kLogs, kCarves, kHashes};
 
 std::atomic<bool> kDBAllowOpen(false);
 std::atomic<bool> kDBInitialized(false);
@@ -113,6 +117,40 @@ Status DatabasePlugin::scan(const std::string& domain,
   return Status::success();
 }
 
+Status DatabasePlugin::getRange(const std::string& domain,
+                                const std::string& low,
+                                const std::string& high,
+                                DatabaseStringValueList& results,
+                                uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  // Only keys sharing the common prefix of both bounds can be in the range.
+  auto common = std::mismatch(low.begin(), low.end(), high.begin(), high.end());
+  std::vector<std::string> keys;
+  auto status = scan(domain, keys, std::string(low.begin(), common.first), 0);
+  if (!status.ok()) {
+    return status;
+  }
+
+  std::sort(keys.begin(), keys.end());
+  auto it = std::lower_bound(keys.begin(), keys.end(), low);
+  size_t count = 0;
+  for (; it != keys.end() && *it <= high; ++it) {
+    std::string value;
+    if (!get(domain, *it, value).ok()) {
+      continue;
+    }
+
+    results.emplace_back(*it, std::move(value));
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status::success();
+}
+
 Status DatabasePlugin::call(const PluginRequest& request,
                             PluginResponse& response) {
   if (request.count("action") == 0) {
@@ -204,6 +242,21 @@ Status DatabasePlugin::call(const PluginRequest& request,
       response.push_back({{"k", k}});
     }
     return status;
+  } else if (request.at("action") == "get_range") {
+    auto key_high =
+        (request.count("key_high") > 0) ? request.at("key_high") : "";
+    size_t max = 0;
+    if (request.count("max") > 0) {
+      max = std::stoul(request.at("max"));
+    }
+
+    DatabaseStringValueList results;
+    auto status = this->getRange(domain, key, key_high, results, max);
+    for (auto& pair : results) {
+      response.push_back(
+          {{"k", std::move(pair.first)}, {"v", std::move(pair.second)}});
+    }
+    return status;
   }
 
   return Status(1, "Unknown database plugin action");
@@ -437,6 +490,43 @@ Status scanDatabaseKeys(const std::string& domain,
   }
 }
 
+Status getDatabaseRange(const std::string& domain,
+                        const std::string& low,
+                        const std::string& high,
+                        DatabaseStringValueList& results,
+                        uint64_t max) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "get_range"},
+                             {"domain", domain},
+                             {"key", low},
+                             {"key_high", high},
+                             {"max", std::to_string(max)}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+
+    for (auto& item : response) {
+      if (item.count("k") > 0 && item.count("v") > 0) {
+        results.emplace_back(std::move(item["k"]), std::move(item["v"]));
+      }
+    }
+    return status;
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot read database range: " + low);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->getRange(domain, low, high, results, max);
+  }
+}
+
 void resetDatabase() {
   PluginRequest request = {{"action", "reset"}};
   Registry::call("database", request);
@@ -617,6 +707,111 @@ static Status migrateV1V2(void) {
   return Status::success();
 }
 
+static Status migrateV2V3(void) {
+  const std::string data_prefix("data.");
+  const std::string columns_prefix("columns.");
+  const std::size_t batch_size{1024U};
+
+  std::vector<std::string> keys;
+  Status s = scanDatabaseKeys(kEvents, keys, data_prefix);
+  if (!s.ok()) {
+    return Status::failure(
+        1, "Failed to scan event keys from database: " + s.what());
+  }
+
+  struct SubscriberColumns final {
+    ColumnDictionary dictionary;
+    std::size_t stored_column_count{0U};
+  };
+
+  // Event data keys are "data.<publisher>.<subscriber>.<eid>", every
+  // namespace has its own column dictionary.
+  std::map<std::string, SubscriberColumns> subscriber_columns;
+  DatabaseStringValueList batch;
+
+  // A dictionary is written before any converted row that references it.
+  auto write_batch = [&subscriber_columns, &batch, &columns_prefix]() {
+    for (auto& p : subscriber_columns) {
+      auto& columns = p.second;
+      if (columns.dictionary.size() == columns.stored_column_count) {
+        continue;
+      }
+
+      std::string value;
+      columns.dictionary.serialize(value);
+      auto status = setDatabaseValue(kEvents, columns_prefix + p.first, value);
+      if (!status.ok()) {
+        return status;
+      }
+      columns.stored_column_count = columns.dictionary.size();
+    }
+
+    if (batch.empty()) {
+      return Status::success();
+    }
+
+    auto status = setDatabaseBatch(kEvents, batch);
+    batch.clear();
+    return status;
+  };
+
+  for (const auto& key : keys) {
+    auto separator = key.rfind('.');
+    if (separator == std::string::npos || separator <= data_prefix.size()) {
+      continue;
+    }
+
+    std::string value;
+    s = getDatabaseValue(kEvents, key, value);
+    if (!s.ok() || isRowBinary(value)) {
+      continue;
+    }
+
+    // Invalid events are removed when the subscriber indexes its events.
+    Row row;
+    if (!deserializeRowJSON(value, row).ok()) {
+      continue;
+    }
+
+    auto event_namespace =
+        key.substr(data_prefix.size(), separator - data_prefix.size());
+
+    auto it = subscriber_columns.find(event_namespace);
+    if (it == subscriber_columns.end()) {
+      it = subscriber_columns.emplace(event_namespace, SubscriberColumns())
+               .first;
+
+      // Continue a previously interrupted migration.
+      std::string dictionary;
+      s = getDatabaseValue(
+          kEvents, columns_prefix + event_namespace, dictionary);
+      if (s.ok() && !it->second.dictionary.deserialize(dictionary).ok()) {
+        LOG(WARNING) << "Replacing the invalid column dictionary for "
+                     << event_namespace;
+      }
+      it->second.stored_column_count = it->second.dictionary.size();
+    }
+
+    std::string binary_row;
+    serializeRowBinary(row, it->second.dictionary, binary_row);
+    batch.push_back(std::make_pair(key, std::move(binary_row)));
+
+    if (batch.size() >= batch_size) {
+      s = write_batch();
+      if (!s.ok()) {
+        return Status::failure("Failed to write converted events: " + s.what());
+      }
+    }
+  }
+
+  s = write_batch();
+  if (!s.ok()) {
+    return Status::failure("Failed to write converted events: " + s.what());
+  }
+
+  return Status::success();
+}
+
 Status upgradeDatabase(int to_version) {
   std::string value;
   Status st = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
@@ -648,6 +843,10 @@ Status upgradeDatabase(int to_version) {
       migrate_status = migrateV1V2();
       break;
 
+    case 2:
+      migrate_status = migrateV2V3();
+      break;
+
     default:
       LOG(ERROR) << "Logic error: the migration code is broken!";
       migrate_status = Status::failure("Migration code broken.");
@@ -734,6 +933,14 @@ class OsqueryDatabase final : public IDatabaseInterface {
                                   size_t max) const override {
     return osquery::scanDatabaseKeys(domain, keys, prefix, max);
   }
+
+  virtual Status getDatabaseRange(const std::string& domain,
+                                  const std::string& low,
+                                  const std::string& high,
+                                  DatabaseStringValueList& results,
+                                  size_t max) const override {
+    return osquery::getDatabaseRange(domain, low, high, results, max);
+  }
 };
 
 IDatabaseInterface& getOsqueryDatabase() {
@@ -49,11 +49,14 @@ extern const std::string kEvents;
 /// The "domain" where the results of carve queries are stored.
 extern const std::string kCarves;
 
+/// The "domain" where file hashes are persisted by the hash table cache.
+extern const std::string kHashes;
+
 /// The key for the DB version
 extern const std::string kDbVersionKey;
 
 /// The running version of our database schema
-const int kDbCurrentVersion = 2;
+const int kDbCurrentVersion = 3;
 
 /**
  * @brief The "domain" where buffered log results are stored.
@@ -139,6 +142,26 @@ class DatabasePlugin : public Plugin {
                       const std::string& prefix,
                       uint64_t max) const;
 
+  /**
+   * @brief Read the keys and values within an inclusive range of keys.
+   *
+   * Pairs are appended to the results in key order. Plugins backed by an
+   * ordered store should override this with a single iteration, the default
+   * implementation scans keys and then performs point lookups.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param low The inclusive lower bound key.
+   * @param high The inclusive upper bound key.
+   * @param results The output key and value pairs.
+   * @param max The maximum number of pairs to read, 0 means no limit.
+   * @return Failure if the range could not be read.
+   */
+  virtual Status getRange(const std::string& domain,
+                          const std::string& low,
+                          const std::string& high,
+                          DatabaseStringValueList& results,
+                          uint64_t max) const;
+
   /**
    * @brief Shutdown the database and release initialization resources.
    *
@@ -239,6 +262,13 @@ Status scanDatabaseKeys(const std::string& domain,
                         const std::string& prefix,
                         uint64_t max = 0);
 
+/// Get the ordered keys and values within an inclusive range in domain.
+Status getDatabaseRange(const std::string& domain,
+                        const std::string& low,
+                        const std::string& high,
+                        DatabaseStringValueList& results,
+                        uint64_t max = 0);
+
 /// Allow callers to reload or reset the database plugin.
 void resetDatabase();
 
@@ -65,6 +65,13 @@ class EphemeralDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Ordered key and value range lookup method.
+  Status getRange(const std::string& domain,
+                  const std::string& low,
+                  const std::string& high,
+                  DatabaseStringValueList& results,
+                  uint64_t max) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override {
@@ -199,4 +206,36 @@ Status EphemeralDatabasePlugin::scan(const std::string& domain,
   }
   return Status(0);
 }
+
+Status EphemeralDatabasePlugin::getRange(const std::string& domain,
+                                         const std::string& low,
+                                         const std::string& high,
+                                         DatabaseStringValueList& results,
+                                         uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  auto domainIterator = db_.find(domain);
+  if (domainIterator == db_.end()) {
+    return Status(0);
+  }
+
+  const auto& keys = domainIterator->second;
+  size_t count = 0;
+  for (auto it = keys.lower_bound(low); it != keys.end() && it->first <= high;
+       ++it) {
+    // Integer values are not part of the string-keyed value ranges.
+    const auto* value = boost::get<std::string>(&it->second);
+    if (value == nullptr) {
+      continue;
+    }
+
+    results.emplace_back(it->first, *value);
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(0);
+}
 } // namespace osquery
@@ -60,6 +60,12 @@ class IDatabaseInterface {
                                   const std::string& prefix,
                                   size_t max) const = 0;
 
+  virtual Status getDatabaseRange(const std::string& domain,
+                                  const std::string& low,
+                                  const std::string& high,
+                                  DatabaseStringValueList& results,
+                                  size_t max) const = 0;
+
   IDatabaseInterface(const IDatabaseInterface&) = delete;
   IDatabaseInterface& operator=(const IDatabaseInterface&) = delete;
 };
@@ -8,6 +8,7 @@
  */
 
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry.h>
@@ -294,4 +295,46 @@ TEST_F(DatabaseTests, test_migration_v1v2) {
   EXPECT_EQ(value, "event_data");
 }
 
+TEST_F(DatabaseTests, test_migration_v2v3) {
+  /* Testing migration from 2 to 3 */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  const std::string kEventKey{
+      "data.auditeventpublisher.process_events.0000000001"};
+  Row row = {{"path", "/bin/ls"}, {"pid", "100"}, {"time", "1600000000"}};
+
+  std::string json_row;
+  ASSERT_TRUE(serializeRowJSON(row, json_row).ok());
+
+  status = setDatabaseValue(kEvents, kEventKey, json_row);
+  ASSERT_TRUE(status.ok());
+
+  status = upgradeDatabase(3);
+  ASSERT_TRUE(status.ok());
+
+  std::string value;
+  status = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
+  EXPECT_EQ(value, "3");
+
+  std::string binary_row;
+  status = getDatabaseValue(kEvents, kEventKey, binary_row);
+  ASSERT_TRUE(status.ok());
+  ASSERT_TRUE(isRowBinary(binary_row));
+
+  std::string serialized_dictionary;
+  status = getDatabaseValue(kEvents,
+                            "columns.auditeventpublisher.process_events",
+                            serialized_dictionary);
+  ASSERT_TRUE(status.ok());
+
+  ColumnDictionary dictionary;
+  ASSERT_TRUE(dictionary.deserialize(serialized_dictionary).ok());
+
+  Row result;
+  status = deserializeRowBinary(binary_row, dictionary, result);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(result, row);
+}
+
 } // namespace osquery
@@ -9,9 +9,12 @@
 
 #include <osquery/database/database.h>
 
+#include <osquery/core/flags.h>
 #include <osquery/core/query.h>
 #include <osquery/core/sql/diff_results.h>
 #include <osquery/core/sql/query_data.h>
+#include <osquery/core/sql/query_data_columnar.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/sql/tests/sql_test_utils.h>
 
 #include <gtest/gtest.h>
@@ -20,6 +23,9 @@
 
 namespace osquery {
 
+DECLARE_bool(decorations_top_level);
+DECLARE_bool(logger_numerics);
+
 class ResultsTests : public testing::Test {};
 
 TEST_F(ResultsTests, test_simple_diff) {
@@ -36,6 +42,123 @@ TEST_F(ResultsTests, test_simple_diff) {
   EXPECT_EQ(results.removed, o);
 }
 
+TEST_F(ResultsTests, test_columnar_diff) {
+  auto schema = std::make_shared<const ColumnSchema>(ColumnNames{"foo", "id"});
+  QueryDataColumnar current(schema);
+  QueryDataTyped current_typed;
+  for (long long i = 0; i < 4; i++) {
+    auto* row = current.addRow();
+    row[0] = std::string("bar");
+    row[1] = i;
+    current_typed.push_back(current[i].toRowTyped());
+  }
+
+  // The old results share two rows and include one removed row.
+  QueryDataSet old;
+  old.insert(current_typed[1]);
+  old.insert(current_typed[3]);
+  RowTyped removed;
+  removed["foo"] = "baz";
+  removed["id"] = 9LL;
+  old.insert(removed);
+  QueryDataSet old_typed = old;
+
+  auto expected = diff(old_typed, current_typed);
+  auto results = diff(old, current);
+  EXPECT_EQ(results, expected);
+  ASSERT_EQ(results.added.size(), 2U);
+  EXPECT_EQ(results.added[0], current_typed[0]);
+  EXPECT_EQ(results.added[1], current_typed[2]);
+  ASSERT_EQ(results.removed.size(), 1U);
+  EXPECT_EQ(results.removed[0], removed);
+}
+
+TEST_F(ResultsTests, test_fingerprint_diff) {
+  QueryDataTyped current;
+  for (long long i = 0; i < 4; i++) {
+    RowTyped row;
+    row["foo"] = "bar";
+    row["id"] = i;
+    current.push_back(row);
+  }
+  // A duplicate row is only matched once.
+  current.push_back(current[1]);
+
+  RowTyped removed;
+  removed["foo"] = "baz";
+  removed["id"] = 9LL;
+  QueryDataTyped old{current[1], current[3], removed, removed};
+  auto old_fingerprints = getRowFingerprints(old);
+
+  RowFingerprints current_fingerprints;
+  RowFingerprints removed_fingerprints;
+  auto added = diffFingerprints(old_fingerprints,
+                                current,
+                                current_fingerprints,
+                                removed_fingerprints);
+  EXPECT_EQ(current_fingerprints, getRowFingerprints(current));
+
+  QueryDataSet old_set(old.begin(), old.end());
+  auto expected = diff(old_set, current);
+  EXPECT_EQ(added, expected.added);
+  ASSERT_EQ(removed_fingerprints.size(), 2U);
+  EXPECT_EQ(removed_fingerprints[0], getRowFingerprint(removed));
+  EXPECT_EQ(removed_fingerprints[1], getRowFingerprint(removed));
+
+  // Types and signed zeros follow RowTyped equality.
+  RowTyped zero;
+  zero["value"] = 0.0;
+  RowTyped negative_zero;
+  negative_zero["value"] = -0.0;
+  EXPECT_EQ(getRowFingerprint(zero), getRowFingerprint(negative_zero));
+  RowTyped text;
+  text["value"] = "0";
+  EXPECT_NE(getRowFingerprint(zero), getRowFingerprint(text));
+}
+
+TEST_F(ResultsTests, test_serialize_query_data_columnar) {
+  auto results = getSerializedQueryData();
+
+  // Build the columnar equivalent of the typed test data.
+  ColumnNames columns;
+  for (const auto& column : results.second.front()) {
+    columns.push_back(column.first);
+  }
+  QueryDataColumnar columnar(
+      std::make_shared<const ColumnSchema>(std::move(columns)));
+  for (const auto& row : results.second) {
+    columnar.addRow(row);
+  }
+  EXPECT_EQ(columnar.toQueryDataTyped(), results.second);
+
+  auto doc = JSON::newArray();
+  auto s = serializeQueryData(columnar, doc, doc.doc(), true);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(results.first.doc(), doc.doc());
+}
+
+TEST_F(ResultsTests, test_columnar_schema_change) {
+  QueryDataColumnar columnar(
+      std::make_shared<const ColumnSchema>(ColumnNames{"a", "b"}));
+  columnar.addRow({{"a", "1"}, {"b", "2"}});
+
+  // Rows added after a schema change keep their own columns.
+  columnar.setSchema(std::make_shared<const ColumnSchema>(ColumnNames{"c"}));
+  columnar.addRow({{"c", "3"}});
+  columnar.addRow({{"c", "4"}});
+
+  QueryDataTyped expected = {
+      {{"a", "1"}, {"b", "2"}},
+      {{"c", "3"}},
+      {{"c", "4"}},
+  };
+  EXPECT_EQ(columnar.toQueryDataTyped(), expected);
+
+  std::string json;
+  EXPECT_TRUE(serializeQueryDataJSON(columnar, json, false).ok());
+  EXPECT_EQ(json, R"([{"a":"1","b":"2"},{"c":"3"},{"c":"4"}])");
+}
+
 TEST_F(ResultsTests, test_serialize_row) {
   auto results = getSerializedRow();
   auto doc = JSON::newObject();
@@ -59,6 +182,81 @@ TEST_F(ResultsTests, test_deserialize_row_json) {
   EXPECT_EQ(output, results.second);
 }
 
+TEST_F(ResultsTests, test_serialize_row_binary) {
+  Row row = {
+      {"path", "/usr/bin/true"},
+      {"pid", "1234"},
+      {"uid", "-1"},
+      {"eid", "0000000042"},
+      {"cmdline", std::string("a\0b", 3)},
+      {"empty", ""},
+  };
+
+  ColumnDictionary dictionary;
+  std::string output;
+  serializeRowBinary(row, dictionary, output);
+  EXPECT_TRUE(isRowBinary(output));
+  EXPECT_EQ(dictionary.size(), row.size());
+
+  // Rows reuse the columns already present in the dictionary.
+  std::string second_output;
+  serializeRowBinary({{"pid", "7"}}, dictionary, second_output);
+  EXPECT_EQ(dictionary.size(), row.size());
+
+  std::string serialized_dictionary;
+  dictionary.serialize(serialized_dictionary);
+
+  ColumnDictionary loaded_dictionary;
+  ASSERT_TRUE(loaded_dictionary.deserialize(serialized_dictionary).ok());
+
+  Row result;
+  auto s = deserializeRowBinary(output, loaded_dictionary, result);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(result, row);
+
+  // Truncated rows and unknown columns are errors.
+  Row truncated;
+  s = deserializeRowBinary(
+      output.substr(0, output.size() - 1), loaded_dictionary, truncated);
+  EXPECT_FALSE(s.ok());
+
+  Row unknown;
+  s = deserializeRowBinary(output, ColumnDictionary(), unknown);
+  EXPECT_FALSE(s.ok());
+
+  std::string json;
+  serializeRowJSON(row, json);
+  EXPECT_FALSE(isRowBinary(json));
+}
+
+TEST_F(ResultsTests, test_serialize_column_chunk) {
+  QueryData rows = {
+      {{"path", "/bin/true"}, {"pid", "1"}},
+      {{"pid", "2"}, {"cmdline", std::string("a\0b", 3)}},
+      {{"path", ""}},
+  };
+
+  ColumnDictionary dictionary;
+  std::string output;
+  serializeColumnChunk(rows, dictionary, output);
+  EXPECT_EQ(dictionary.size(), 3U);
+
+  QueryData result;
+  auto s = deserializeColumnChunk(output, dictionary, result);
+  ASSERT_TRUE(s.ok());
+  EXPECT_EQ(result, rows);
+
+  // Truncated chunks and unknown columns are errors.
+  QueryData truncated;
+  s = deserializeColumnChunk(
+      output.substr(0, output.size() - 1), dictionary, truncated);
+  EXPECT_FALSE(s.ok());
+
+  QueryData unknown;
+  s = deserializeColumnChunk(output, ColumnDictionary(), unknown);
+  EXPECT_FALSE(s.ok());
+}
+
 TEST_F(ResultsTests, test_serialize_query_data) {
   auto results = getSerializedQueryData();
   auto doc = JSON::newArray();
@@ -126,6 +324,54 @@ TEST_F(ResultsTests, test_serialize_query_log_item_json) {
   EXPECT_EQ(results.first, json);
 }
 
+TEST_F(ResultsTests, test_serialize_query_log_item_as_events_json) {
+  auto item = getSerializedQueryLogItem().second;
+  item.results.added.push_back(
+      {{"int", 1LL}, {"double", 0.5}, {"text", std::string("a\"\n\0b", 5)}});
+  item.decorations = {{"host_uuid", "uuid"}, {"name", "decorated"}};
+
+  // Snapshot results are columnar and written in column name order.
+  QueryLogItem snapshot;
+  snapshot.name = "snapshot";
+  snapshot.snapshot_results = QueryDataColumnar(
+      std::make_shared<const ColumnSchema>(ColumnNames{"text", "int"}));
+  auto* values = snapshot.snapshot_results.addRow();
+  values[0] = std::string("a\"b");
+  values[1] = 1LL;
+
+  auto top_level = FLAGS_decorations_top_level;
+  auto numerics = FLAGS_logger_numerics;
+  for (auto decorations_top_level : {false, true}) {
+    for (auto logger_numerics : {false, true}) {
+      FLAGS_decorations_top_level = decorations_top_level;
+      FLAGS_logger_numerics = logger_numerics;
+
+      for (const auto* target : {&item, &snapshot}) {
+        // The streamed lines match the events of the JSON document.
+        auto doc = JSON::newArray();
+        ASSERT_TRUE(serializeQueryLogItemAsEvents(*target, doc).ok());
+        std::vector<std::string> expected;
+        for (const auto& event : doc.doc().GetArray()) {
+          rapidjson::StringBuffer sb;
+          rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+          event.Accept(writer);
+          expected.push_back(sb.GetString());
+        }
+
+        std::vector<std::string> events;
+        ASSERT_TRUE(serializeQueryLogItemAsEventsJSON(*target, events).ok());
+        EXPECT_EQ(events, expected);
+      }
+    }
+  }
+  FLAGS_decorations_top_level = top_level;
+  FLAGS_logger_numerics = numerics;
+
+  QueryLogItem empty;
+  std::vector<std::string> events;
+  EXPECT_FALSE(serializeQueryLogItemAsEventsJSON(empty, events).ok());
+}
+
 TEST_F(ResultsTests, test_adding_duplicate_rows_to_query_data) {
   RowTyped r1, r2, r3;
   r1["foo"] = "bar";
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <ctime>
+#include <thread>
 
 #include <boost/format.hpp>
 #include <boost/io/detail/quoted_manip.hpp>
@@ -52,6 +53,12 @@ FLAG(bool,
      false,
      "Log the running scheduled query name at INFO level");
 
+FLAG(uint64,
+     schedule_workers,
+     0,
+     "Number of threads executing scheduled queries concurrently (0 for "
+     "serial execution, limited to the number of CPUs)");
+
 HIDDEN_FLAG(bool,
             schedule_reload_sql,
             false,
@@ -62,7 +69,39 @@ DECLARE_bool(events_optimize);
 DECLARE_bool(enable_numeric_monitoring);
 DECLARE_bool(verbose);
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
+/// Snapshot the worker's own performance counters from the processes table.
+static QueryData selectPerformance(const std::string& pid,
+                                   const SQLiteDBInstanceRef& instance) {
+  if (instance == nullptr) {
+    return SQL::selectFrom({"resident_size", "user_time", "system_time"},
+                           "processes",
+                           "pid",
+                           EQUALS,
+                           pid);
+  }
+
+  QueryData results;
+  queryInternal(
+      "SELECT resident_size, user_time, system_time FROM processes WHERE "
+      "pid = " +
+          pid,
+      results,
+      instance);
+  instance->clearAffectedTables();
+  return results;
+}
+
+static SQLInternal runScheduledSQL(const ScheduledQuery& query,
+                                   const SQLiteDBInstanceRef& instance) {
+  if (instance == nullptr) {
+    return SQLInternal(query.query, true);
+  }
+  return SQLInternal(query.query, instance, true);
+}
+
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    const SQLiteDBInstanceRef& instance) {
   if (FLAGS_enable_numeric_monitoring) {
     CodeProfiler profiler(
         {(boost::format("scheduler.pack.%s") % query.pack_name).str(),
@@ -77,25 +116,17 @@ SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
           monitoring::hostIdentifierKeys().scheme % query.pack_name %
           query.name)
              .str()});
-    return SQLInternal(query.query, true);
+    return runScheduledSQL(query, instance);
   } else {
     // Snapshot the performance and times for the worker before running.
     auto pid = std::to_string(PlatformProcess::getCurrentPid());
-    auto r0 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
+    auto r0 = selectPerformance(pid, instance);
     auto t0 = getUnixTime();
     Config::get().recordQueryStart(name);
-    SQLInternal sql(query.query, true);
+    auto sql = runScheduledSQL(query, instance);
     // Snapshot the performance after, and compare.
     auto t1 = getUnixTime();
-    auto r1 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
+    auto r1 = selectPerformance(pid, instance);
     if (r0.size() > 0 && r1.size() > 0) {
       // Always called while processes table is working.
       Config::get().recordQueryPerformance(name, t1 - t0, r0[0], r1[0]);
@@ -104,16 +135,18 @@ SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
   }
 }
 
-Status launchQuery(const std::string& name, const ScheduledQuery& query) {
+/// Execute a scheduled query and log its results, without running decorators.
+static Status executeQuery(const std::string& name,
+                           const ScheduledQuery& query,
+                           const SQLiteDBInstanceRef& instance) {
   // Execute the scheduled query and create a named query object.
   if (FLAGS_verbose) {
     VLOG(1) << "Executing scheduled query " << name << ": " << query.query;
   } else if (FLAGS_schedule_lognames) {
     LOG(INFO) << "Executing scheduled query " << name;
   }
-  runDecorators(DECORATE_ALWAYS);
 
-  auto sql = monitor(name, query);
+  auto sql = monitor(name, query, instance);
   if (!sql.getStatus().ok()) {
     LOG(ERROR) << "Error executing scheduled query " << name << ": "
                << sql.getStatus().toString();
@@ -135,7 +168,7 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
 
   if (query.isSnapshotQuery()) {
     // This is a snapshot query, emit results with a differential or state.
-    item.snapshot_results = std::move(sql.rowsTyped());
+    item.snapshot_results = std::move(sql.rows());
     logSnapshotQuery(item);
     return Status::success();
   }
@@ -151,7 +184,7 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   // was executed by exact matching each row.
   if (!FLAGS_events_optimize || !sql.eventBased()) {
     status = dbQuery.addNewResults(
-        std::move(sql.rowsTyped()), item.epoch, item.counter, diff_results);
+        std::move(sql.rows()), item.epoch, item.counter, diff_results);
     if (!status.ok()) {
       std::string message = "Error adding new results to database for query " +
                             name + ": " + status.what();
@@ -159,7 +192,7 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
       requestShutdown(EXIT_CATASTROPHIC, message);
     }
   } else {
-    diff_results.added = std::move(sql.rowsTyped());
+    diff_results.added = sql.rows().toQueryDataTyped();
   }
 
   if (!query.reportRemovedRows()) {
@@ -183,6 +216,121 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   return status;
 }
 
+Status launchQuery(const std::string& name,
+                   const ScheduledQuery& query,
+                   const SQLiteDBInstanceRef& instance) {
+  runDecorators(DECORATE_ALWAYS);
+  return executeQuery(name, query, instance);
+}
+
+/// ScheduledQuery is only movable, the pool keeps its own copy.
+static ScheduledQuery copyScheduledQuery(const ScheduledQuery& query) {
+  ScheduledQuery copy(query.pack_name, query.name, query.query);
+  copy.oncall = query.oncall;
+  copy.interval = query.interval;
+  copy.splayed_interval = query.splayed_interval;
+  copy.denylisted = query.denylisted;
+  copy.options = query.options;
+  return copy;
+}
+
+static void recordQueryStatus(const ScheduledQuery& query,
+                              const Status& status) {
+  monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
+                      query.pack_name % query.name %
+                      (status.ok() ? "success" : "failure"))
+                         .str(),
+                     1,
+                     monitoring::PreAggregationType::Sum,
+                     true);
+}
+
+SchedulerWorkerPool::SchedulerWorkerPool(size_t workers) {
+  connections_.reserve(workers);
+  threads_.reserve(workers);
+  for (size_t id = 0; id < workers; ++id) {
+    connections_.push_back(SQLiteDBManager::getUnique());
+  }
+  for (size_t id = 0; id < workers; ++id) {
+    threads_.emplace_back(&SchedulerWorkerPool::work, this, id);
+  }
+}
+
+SchedulerWorkerPool::~SchedulerWorkerPool() {
+  {
+    WriteLock lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void SchedulerWorkerPool::add(const std::string& name,
+                              const ScheduledQuery& query,
+                              uint64_t step) {
+  {
+    WriteLock lock(mutex_);
+    queue_.push_back({name, copyScheduledQuery(query), step});
+    pending_++;
+  }
+  work_cv_.notify_one();
+}
+
+void SchedulerWorkerPool::wait() {
+  WriteLock lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void SchedulerWorkerPool::resetConnections() {
+  WriteLock lock(mutex_);
+  for (auto& connection : connections_) {
+    connection = SQLiteDBManager::getUnique();
+  }
+}
+
+void SchedulerWorkerPool::work(size_t id) {
+  // A query that does not complete is denylisted by the key of its worker.
+  setExecutingQueryWorker(id);
+
+  WriteLock lock(mutex_);
+  while (true) {
+    // Select the oldest task whose query name is not already executing.
+    auto task = queue_.end();
+    work_cv_.wait(lock, [this, &task]() {
+      task = std::find_if(queue_.begin(), queue_.end(), [this](const Task& t) {
+        return running_.count(t.name) == 0;
+      });
+      return stopping_ || task != queue_.end();
+    });
+    if (stopping_) {
+      break;
+    }
+
+    auto name = std::move(task->name);
+    auto query = std::move(task->query);
+    auto step = task->step;
+    queue_.erase(task);
+    running_.insert(name);
+    auto connection = connections_[id];
+    lock.unlock();
+
+    // Apply the cache settings of this task to the worker thread only.
+    TablePlugin::setThreadCache(query.splayed_interval, step);
+    recordQueryStatus(query, executeQuery(name, query, connection));
+
+    lock.lock();
+    running_.erase(name);
+    pending_--;
+    if (pending_ == 0) {
+      done_cv_.notify_all();
+    }
+    // Another task with the same name may now be eligible.
+    work_cv_.notify_all();
+  }
+}
+
 void SchedulerRunner::calculateTimeDriftAndMaybePause(
     std::chrono::milliseconds loop_step_duration) {
   if (loop_step_duration + time_drift_ < interval_) {
@@ -214,6 +362,9 @@ void SchedulerRunner::maybeReloadSchedule(uint64_t time_step) {
   if (FLAGS_schedule_reload > 0 && (time_step % FLAGS_schedule_reload) == 0) {
     if (FLAGS_schedule_reload_sql) {
       SQLiteDBManager::resetPrimary();
+      if (pool_ != nullptr) {
+        pool_->resetConnections();
+      }
     }
     resetDatabase();
   }
@@ -226,30 +377,51 @@ void SchedulerRunner::maybeFlushLogs(uint64_t time_step) {
   }
 }
 
+void SchedulerRunner::maybeCreateWorkerPool() {
+  size_t workers = static_cast<size_t>(FLAGS_schedule_workers);
+  size_t cpus = std::max(std::thread::hardware_concurrency(), 1U);
+  workers = std::min(workers, cpus);
+  if (workers > 1) {
+    VLOG(1) << "Executing scheduled queries with " << workers << " workers";
+    pool_ = std::make_unique<SchedulerWorkerPool>(workers);
+  }
+}
+
 void SchedulerRunner::start() {
   // Start the counter at the second.
   auto i = osquery::getUnixTime();
   // Timeout is the number of seconds from starting.
   timeout_ += (timeout_ == 0) ? 0 : i;
 
+  maybeCreateWorkerPool();
+
   for (; (timeout_ == 0) || (i <= timeout_); ++i) {
     auto start_time_point = std::chrono::steady_clock::now();
-    Config::get().scheduledQueries(([&i](const std::string& name,
-                                         const ScheduledQuery& query) {
+    bool decorated = false;
+    Config::get().scheduledQueries(([this, &i, &decorated](
+                                        const std::string& name,
+                                        const ScheduledQuery& query) {
       if (query.splayed_interval > 0 && i % query.splayed_interval == 0) {
         TablePlugin::kCacheInterval = query.splayed_interval;
         TablePlugin::kCacheStep = i;
-        const auto status = launchQuery(name, query);
-        monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
-                            query.pack_name % query.name %
-                            (status.ok() ? "success" : "failure"))
-                               .str(),
-                           1,
-                           monitoring::PreAggregationType::Sum,
-                           true);
+        if (pool_ != nullptr) {
+          // Pooled queries share the decorations collected once per step.
+          if (!decorated) {
+            runDecorators(DECORATE_ALWAYS);
+            decorated = true;
+          }
+          pool_->add(name, query, i);
+          return;
+        }
+        recordQueryStatus(query, launchQuery(name, query));
       }
     }));
 
+    if (pool_ != nullptr) {
+      // Housekeeping below may reset the databases, wait for this step.
+      pool_->wait();
+    }
+
     maybeRunDecorators(i);
     maybeReloadSchedule(i);
     maybeFlushLogs(i);
@@ -264,6 +436,8 @@ void SchedulerRunner::start() {
     }
   }
 
+  pool_.reset();
+
   // Scheduler ended.
   if (!interrupted()) {
     LOG(INFO) << "The scheduler ended after " << timeout_ << " seconds";
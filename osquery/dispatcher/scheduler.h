@@ -10,14 +10,97 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 
+#include <osquery/core/sql/scheduled_query.h>
 #include <osquery/dispatcher/dispatcher.h>
+#include <osquery/utils/mutex.h>
 
 #include "osquery/sql/sqlite_util.h"
 
 namespace osquery {
 
+/**
+ * @brief A bounded pool of workers that execute scheduled queries.
+ *
+ * Each worker owns a dedicated SQLite connection with all virtual tables
+ * attached, so concurrent queries do not contend on the primary database.
+ *
+ * Queries sharing the same name are never executed concurrently and run in
+ * the order they were added. This keeps the differential results, stored per
+ * query name, serialized.
+ *
+ * The DECORATE_ALWAYS decorators are not run by the workers, the scheduler
+ * runs them once per step before queueing that step's queries.
+ *
+ * Each worker records its executing query under its own key, so a query that
+ * does not complete is denylisted even while other workers run queries.
+ */
+class SchedulerWorkerPool : private boost::noncopyable {
+ public:
+  explicit SchedulerWorkerPool(size_t workers);
+  ~SchedulerWorkerPool();
+
+  /// Queue a scheduled query for execution at the given schedule step.
+  void add(const std::string& name,
+           const ScheduledQuery& query,
+           uint64_t step);
+
+  /// Block until every queued query has finished executing.
+  void wait();
+
+  /// Replace each worker's connection, only call while the pool is idle.
+  void resetConnections();
+
+  /// The number of workers.
+  size_t size() const {
+    return threads_.size();
+  }
+
+ private:
+  /// Worker thread entry point.
+  void work(size_t id);
+
+ private:
+  struct Task {
+    std::string name;
+    ScheduledQuery query;
+    uint64_t step;
+  };
+
+  /// Worker threads.
+  std::vector<std::thread> threads_;
+
+  /// One SQLite connection for each worker.
+  std::vector<SQLiteDBInstanceRef> connections_;
+
+  /// Queries waiting for a worker.
+  std::deque<Task> queue_;
+
+  /// Names of queries currently executing.
+  std::set<std::string> running_;
+
+  /// Number of queued and executing queries.
+  size_t pending_{0};
+
+  /// Set when the pool is destroyed.
+  bool stopping_{false};
+
+  /// Protects the queue, running set, and counters.
+  Mutex mutex_;
+
+  /// Signaled when work is queued or a query name is released.
+  ConditionVariable work_cv_;
+
+  /// Signaled when the pool drains.
+  ConditionVariable done_cv_;
+};
+
 /// A Dispatcher service thread that watches an ExtensionManagerHandler.
 class SchedulerRunner : public InternalRunnable {
  public:
@@ -57,6 +140,9 @@ class SchedulerRunner : public InternalRunnable {
   /// Check if carve requests should be scheduled.
   void maybeScheduleCarves(uint64_t time_step);
 
+  /// Create the optional worker pool based on the schedule_workers flag.
+  void maybeCreateWorkerPool();
+
  private:
   /// Interval in seconds between schedule steps.
   const std::chrono::milliseconds interval_;
@@ -70,9 +156,26 @@ class SchedulerRunner : public InternalRunnable {
   std::chrono::milliseconds time_drift_;
 
   const std::chrono::milliseconds max_time_drift_;
+
+  /// Optional pool for concurrent scheduled query execution.
+  std::unique_ptr<SchedulerWorkerPool> pool_;
 };
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query);
+/**
+ * @brief Execute a scheduled query and record its performance.
+ *
+ * @param name The scheduled query name.
+ * @param query The scheduled query.
+ * @param instance [optional] A connection to use instead of the primary.
+ */
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    const SQLiteDBInstanceRef& instance = nullptr);
+
+/// Execute a scheduled query and log its results.
+Status launchQuery(const std::string& name,
+                   const ScheduledQuery& query,
+                   const SQLiteDBInstanceRef& instance = nullptr);
 
 /// Start querying according to the config's schedule
 void startScheduler();
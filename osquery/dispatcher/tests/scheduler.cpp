@@ -23,6 +23,7 @@ namespace osquery {
 
 DECLARE_bool(disable_logging);
 DECLARE_uint64(schedule_reload);
+DECLARE_uint64(schedule_workers);
 
 class SchedulerTests : public testing::Test {
   void SetUp() override {
@@ -58,7 +59,7 @@ TEST_F(SchedulerTests, test_monitor) {
   query.splayed_interval = 11;
 
   auto results = monitor(name, query);
-  EXPECT_EQ(results.rowsTyped().size(), 1U);
+  EXPECT_EQ(results.rows().size(), 1U);
 
   // Ask the config instance for the monitored performance.
   QueryPerformance perf;
@@ -251,6 +252,64 @@ TEST_F(SchedulerTests, test_scheduler_drift_accumulation) {
   TablePlugin::kCacheInterval = backup_interval;
 }
 
+TEST_F(SchedulerTests, test_scheduler_workers) {
+  const auto backup_step = TablePlugin::kCacheStep;
+  const auto backup_interval = TablePlugin::kCacheInterval;
+  const auto backup_workers = FLAGS_schedule_workers;
+
+  const auto now = osquery::getUnixTime();
+  TablePlugin::kCacheStep = now;
+
+  std::string config = R"config(
+  {
+    "packs": {
+      "workers": {
+        "queries": {
+          "1": {"query": "select 1 as number", "interval": 1},
+          "2": {"query": "select 2 as number", "interval": 1},
+          "3": {"query": "select * from time", "interval": 1}
+        }
+      }
+    }
+  })config";
+  Config::get().update({{"data", config}});
+
+  // The pool is only created when more than one worker is available.
+  FLAGS_schedule_workers = 2;
+  SchedulerRunner runner(static_cast<unsigned long int>(1), size_t{1});
+  runner.start();
+  FLAGS_schedule_workers = backup_workers;
+
+  EXPECT_GT(TablePlugin::kCacheStep, now);
+
+  // Differential results are stored by each worker.
+  std::string content;
+  getDatabaseValue(kQueries, "pack_workers_1", content);
+  EXPECT_FALSE(content.empty());
+
+  TablePlugin::kCacheStep = backup_step;
+  TablePlugin::kCacheInterval = backup_interval;
+}
+
+TEST_F(SchedulerTests, test_scheduler_worker_pool_ordering) {
+  ScheduledQuery query("pool_pack", "pool", "select 1 as number");
+  query.interval = 1;
+
+  SchedulerWorkerPool pool(2);
+  EXPECT_EQ(pool.size(), 2U);
+
+  // Queries with the same name are serialized, both must complete.
+  pool.add("pack_pool_pack_pool", query, 1);
+  pool.add("pack_pool_pack_pool", query, 1);
+  pool.wait();
+
+  QueryPerformance perf;
+  Config::get().getPerformanceStats(
+      "pack_pool_pack_pool",
+      ([&perf](const QueryPerformance& r) { perf = r; }));
+  EXPECT_EQ(perf.executions, 2U);
+}
+
 TEST_F(SchedulerTests, test_scheduler_reload) {
   std::string config =
       "{\"schedule\":{\"1\":{"
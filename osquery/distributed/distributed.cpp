@@ -7,7 +7,10 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <atomic>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include <osquery/core/plugins/logger.h>
@@ -33,9 +36,32 @@ FLAG(bool,
      true,
      "Disable distributed queries (default true)");
 
+FLAG(uint64,
+     distributed_workers,
+     0,
+     "Number of threads executing distributed queries concurrently (0 for "
+     "serial execution, limited to the number of CPUs)");
+
+FLAG(uint64,
+     distributed_write_size,
+     0,
+     "Approximate bytes of distributed query results to buffer before "
+     "writing them (0 to write once all queries ran)");
+
 const std::string kDistributedQueryPrefix{"distributed."};
 
-std::string Distributed::currentRequestId_{""};
+thread_local std::string Distributed::currentRequestId_{""};
+
+/// Estimate the serialized size of a result, used for incremental writes.
+static size_t getResultSize(const DistributedQueryResult& result) {
+  size_t size = result.request.id.size() + result.message.size();
+  for (const auto& row : result.results) {
+    for (const auto& column : row) {
+      size += column.first.size() + column.second.size();
+    }
+  }
+  return size;
+}
 
 Status DistributedPlugin::call(const PluginRequest& request,
                                PluginResponse& response) {
@@ -86,15 +112,22 @@ size_t Distributed::getPendingQueryCount() {
 }
 
 size_t Distributed::getCompletedCount() {
+  ReadLock lock(results_mutex_);
   return results_.size();
 }
 
 Status Distributed::serializeResults(std::string& json) {
+  ReadLock lock(results_mutex_);
+  return serializeResults(results_, json);
+}
+
+Status Distributed::serializeResults(
+    const std::vector<DistributedQueryResult>& results, std::string& json) {
   auto doc = JSON::newObject();
   auto queries_obj = doc.getObject();
   auto statuses_obj = doc.getObject();
   auto messages_obj = doc.getObject();
-  for (const auto& result : results_) {
+  for (const auto& result : results) {
     auto arr = doc.getArray();
     auto s = serializeQueryData(result.results, result.columns, doc, arr);
     if (!s.ok()) {
@@ -112,33 +145,83 @@ Status Distributed::serializeResults(std::string& json) {
 }
 
 void Distributed::addResult(const DistributedQueryResult& result) {
+  WriteLock lock(results_mutex_);
+  results_size_ += getResultSize(result);
   results_.push_back(result);
 }
 
+void Distributed::runRequest(const DistributedQueryRequest& request) {
+  LOG(INFO) << "Executing distributed query: " << request.id << ": "
+            << request.query;
+
+  // Keep track of the request executing on this worker thread.
+  Distributed::setCurrentRequestId(request.id);
+
+  SQL sql(request.query);
+  const auto ok = sql.getStatus().ok();
+  const auto& msg = ok ? "" : sql.getMessageString();
+  if (!ok) {
+    LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
+               << msg;
+  }
+  DistributedQueryResult result(
+      request, sql.rows(), sql.columns(), sql.getStatus(), msg);
+  addResult(result);
+  Distributed::setCurrentRequestId("");
+
+  if (FLAGS_distributed_write_size > 0) {
+    bool flush = false;
+    {
+      ReadLock lock(results_mutex_);
+      flush = results_size_ >= FLAGS_distributed_write_size;
+    }
+
+    if (flush) {
+      auto s = flushCompleted();
+      if (!s.ok()) {
+        LOG(ERROR) << "Error writing distributed query results: "
+                   << s.getMessage();
+      }
+    }
+  }
+}
+
 Status Distributed::runQueries() {
-  while (getPendingQueryCount() > 0) {
-    auto request = popRequest();
-    LOG(INFO) << "Executing distributed query: " << request.id << ": "
-              << request.query;
-
-    // Keep track of the currently executing request
-    Distributed::setCurrentRequestId(request.id);
-
-    SQL sql(request.query);
-    const auto ok = sql.getStatus().ok();
-    const auto& msg = ok ? "" : sql.getMessageString();
-    if (!ok) {
-      LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
-                 << msg;
+  // Read the queued queries once. Each query is removed from the database
+  // right before it executes, so a query that crashes is not run again.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kQueries, keys, kDistributedQueryPrefix);
+
+  size_t workers = std::max<size_t>(1, FLAGS_distributed_workers);
+  workers = std::min<size_t>(
+      workers, std::max<size_t>(1, std::thread::hardware_concurrency()));
+  workers = std::min<size_t>(workers, keys.size());
+
+  std::atomic<size_t> next{0};
+  auto work = [this, &keys, &next]() {
+    for (auto index = next++; index < keys.size(); index = next++) {
+      DistributedQueryRequest request;
+      if (popRequest(keys[index], request).ok()) {
+        runRequest(request);
+      }
     }
-    DistributedQueryResult result(
-        request, sql.rows(), sql.columns(), sql.getStatus(), msg);
-    addResult(result);
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back(work);
   }
+
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
   return flushCompleted();
 }
 
 Status Distributed::flushCompleted() {
+  WriteLock flush_lock(flush_mutex_);
   if (getCompletedCount() == 0) {
     return Status::success();
   }
@@ -148,18 +231,33 @@ Status Distributed::flushCompleted() {
     return Status(1, "Missing distributed plugin " + distributed_plugin);
   }
 
-  std::string results;
-  auto s = serializeResults(results);
-  if (!s.ok()) {
-    return s;
+  // Results completed while writing are queued for the next write.
+  std::vector<DistributedQueryResult> completed;
+  {
+    WriteLock lock(results_mutex_);
+    completed.swap(results_);
+    results_size_ = 0;
   }
 
-  PluginResponse response;
-  s = Registry::call("distributed",
-                     {{"action", "writeResults"}, {"results", results}},
-                     response);
+  std::string results;
+  auto s = serializeResults(completed, results);
+
   if (s.ok()) {
-    results_.clear();
+    PluginResponse response;
+    s = Registry::call("distributed",
+                       {{"action", "writeResults"}, {"results", results}},
+                       response);
+  }
+
+  if (!s.ok()) {
+    // Keep the results for the next write.
+    WriteLock lock(results_mutex_);
+    for (const auto& result : completed) {
+      results_size_ += getResultSize(result);
+    }
+    results_.insert(results_.begin(),
+                    std::make_move_iterator(completed.begin()),
+                    std::make_move_iterator(completed.end()));
   }
   return s;
 }
@@ -244,13 +342,22 @@ DistributedQueryRequest Distributed::popRequest() {
 
   // Set the last-most-recent query as the request, and delete it.
   DistributedQueryRequest request;
-  const auto& next = queries.front();
-  request.id = next.substr(kDistributedQueryPrefix.size());
-  getDatabaseValue(kQueries, next, request.query);
-  deleteDatabaseValue(kQueries, next);
+  popRequest(queries.front(), request);
   return request;
 }
 
+Status Distributed::popRequest(const std::string& key,
+                               DistributedQueryRequest& request) {
+  request.id = key.substr(kDistributedQueryPrefix.size());
+  auto s = getDatabaseValue(kQueries, key, request.query);
+  if (!s.ok()) {
+    return s;
+  }
+
+  deleteDatabaseValue(kQueries, key);
+  return Status::success();
+}
+
 std::string Distributed::getCurrentRequestId() {
   return currentRequestId_;
 }
@@ -14,6 +14,7 @@
 
 #include <osquery/core/plugins/plugin.h>
 #include <osquery/core/query.h>
+#include <osquery/utils/mutex.h>
 #include <osquery/utils/status/status.h>
 
 namespace osquery {
@@ -231,10 +232,22 @@ class Distributed {
   /// Serialize result data into a JSON string and clear the results
   Status serializeResults(std::string& json);
 
-  /// Process and execute queued queries
+  /**
+   * @brief Process and execute queued queries
+   *
+   * The queued queries are read once and executed by up to
+   * distributed_workers threads. Results are written once all queries ran,
+   * or earlier once they exceed distributed_write_size bytes.
+   */
   Status runQueries();
 
-  // Getter for ID of currently executing request
+  /**
+   * @brief Get the ID of the request executing on the calling thread
+   *
+   * With distributed_workers several requests execute at once, each worker
+   * thread sees the ID of its own request. Threads not executing a request,
+   * such as extension table generators, see an empty ID.
+   */
   static std::string getCurrentRequestId();
 
  protected:
@@ -256,6 +269,18 @@ class Distributed {
    */
   DistributedQueryRequest popRequest();
 
+  /**
+   * @brief Read and remove a queued request from the database
+   *
+   * @param key the database key of the queued query
+   * @param request [output] the request which needs to be executed
+   * @return a Status indicating if the request was still queued
+   */
+  Status popRequest(const std::string& key, DistributedQueryRequest& request);
+
+  /// Execute a single request, and queue its result.
+  void runRequest(const DistributedQueryRequest& request);
+
   /**
    * @brief Queue a result to be batch sent to the server
    *
@@ -263,18 +288,31 @@ class Distributed {
    */
   void addResult(const DistributedQueryResult& result);
 
+  /// Serialize a set of results into a JSON string
+  static Status serializeResults(
+      const std::vector<DistributedQueryResult>& results, std::string& json);
+
   /**
    * @brief Flush all of the collected results to the server
    */
   Status flushCompleted();
 
-  // Setter for ID of currently executing request
+  // Setter for ID of the request executing on the calling thread
   static void setCurrentRequestId(const std::string& cReqId);
 
   std::vector<DistributedQueryResult> results_;
 
-  // ID of the currently executing query
-  static std::string currentRequestId_;
+  /// Approximate serialized size of the queued results.
+  size_t results_size_{0};
+
+  /// Protects results_ and results_size_.
+  Mutex results_mutex_;
+
+  /// Serializes writes of completed results.
+  Mutex flush_mutex_;
+
+  /// ID of the request executing on this thread.
+  static thread_local std::string currentRequestId_;
 
  private:
   friend class DistributedTests;
@@ -8,6 +8,7 @@
  */
 
 #include <iostream>
+#include <set>
 
 #include <gtest/gtest.h>
 
@@ -27,6 +28,8 @@ namespace osquery {
 
 DECLARE_string(distributed_tls_read_endpoint);
 DECLARE_string(distributed_tls_write_endpoint);
+DECLARE_uint64(distributed_workers);
+DECLARE_uint64(distributed_write_size);
 
 class DistributedTests : public testing::Test {
  protected:
@@ -206,4 +209,63 @@ TEST_F(DistributedTests, test_workflow) {
   EXPECT_EQ(dist.getPendingQueryCount(), 0U);
   EXPECT_EQ(dist.results_.size(), 0U);
 }
+
+class MockDistributedPlugin : public DistributedPlugin {
+ public:
+  Status getQueries(std::string& json) override {
+    json =
+        "{\"queries\": {\"a\": \"select 1 as one\", \"b\": \"select 2 as "
+        "two\", \"c\": \"select 3 as three\"}}";
+    return Status::success();
+  }
+
+  Status writeResults(const std::string& json) override {
+    writes.push_back(json);
+    return Status::success();
+  }
+
+  std::vector<std::string> writes;
+};
+
+TEST_F(DistributedTests, test_concurrent_incremental_writes) {
+  auto plugin = std::make_shared<MockDistributedPlugin>();
+
+  auto& rf = RegistryFactory::get();
+  rf.registry("distributed")->add("mock_distributed", plugin);
+  ASSERT_TRUE(rf.setActive("distributed", "mock_distributed").ok());
+
+  auto workers = FLAGS_distributed_workers;
+  auto write_size = FLAGS_distributed_write_size;
+  FLAGS_distributed_workers = 4;
+  FLAGS_distributed_write_size = 1;
+
+  Distributed dist;
+  ASSERT_TRUE(dist.pullUpdates().ok());
+  EXPECT_EQ(dist.getPendingQueryCount(), 3U);
+
+  auto s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+  EXPECT_EQ(dist.getPendingQueryCount(), 0U);
+  EXPECT_EQ(dist.getCompletedCount(), 0U);
+  EXPECT_TRUE(Distributed::getCurrentRequestId().empty());
+
+  // Results are written as soon as they exceed the write size.
+  EXPECT_GE(plugin->writes.size(), 1U);
+
+  std::set<std::string> ids;
+  for (const auto& json : plugin->writes) {
+    auto doc = JSON::newObject();
+    ASSERT_TRUE(doc.fromString(json));
+    ASSERT_TRUE(doc.doc()["queries"].IsObject());
+    for (const auto& query : doc.doc()["queries"].GetObject()) {
+      ids.insert(query.name.GetString());
+    }
+  }
+
+  std::set<std::string> expected = {"a", "b", "c"};
+  EXPECT_EQ(ids, expected);
+
+  FLAGS_distributed_workers = workers;
+  FLAGS_distributed_write_size = write_size;
+}
 } // namespace osquery
@@ -151,7 +151,9 @@ static void EVENTS_retrieve_events(benchmark::State& state) {
 BENCHMARK(EVENTS_retrieve_events)
     ->ArgPair(0, 100)
     ->ArgPair(0, 1000)
-    ->ArgPair(0, 10000);
+    ->ArgPair(0, 10000)
+    ->ArgPair(0, 100000)
+    ->ArgPair(0, 250000);
 
 static void EVENTS_gentable(benchmark::State& state) {
   auto sub = std::make_shared<BenchmarkEventSubscriber>();
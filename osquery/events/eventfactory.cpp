@@ -303,6 +303,10 @@ void EventFactory::forwardEvent(const std::string& event) {
   }
 }
 
+bool EventFactory::hasForwarders() {
+  return !getInstance().loggers_.empty();
+}
+
 void EventFactory::configUpdate() {
   // Scan the schedule for queries that touch "_events" tables.
   // We will count the queries
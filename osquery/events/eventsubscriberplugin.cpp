@@ -7,6 +7,9 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <cstdlib>
+
 #include <osquery/config/config.h>
 #include <osquery/core/flags.h>
 #include <osquery/database/database.h>
@@ -26,6 +29,9 @@ namespace {
 /// Checkpoint interval to inspect max event buffering.
 const EventContextID kEventsCheckpoint{256U};
 
+/// Number of events read with each database range lookup.
+const std::size_t kEventsRetrieveBatch{1024U};
+
 void removeDeprecatedEventKeysOnceHelper() {
   std::vector<std::string> key_list;
   auto status = scanDatabaseKeys(kEvents, key_list);
@@ -125,32 +131,42 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
     auto event_identifier = getEventID();
     event_id_list.push_back(event_identifier);
 
-    auto string_event_identifier = toIndex(event_identifier);
-
     row["time"] = string_event_time;
-    row["eid"] = string_event_identifier;
+    row["eid"] = toIndex(event_identifier);
+  }
 
-    // Serialize and store the row data, for query-time retrieval.
-    std::string serialized_row;
-    auto status = serializeRowJSON(row, serialized_row);
-    if (!status.ok()) {
-      VLOG(1) << status.getMessage();
-      continue;
-    }
+  // Logger plugins may request events to be forwarded directly as JSON.
+  if (EventFactory::hasForwarders()) {
+    for (const auto& row : row_list) {
+      std::string json_row;
+      auto status = serializeRowJSON(row, json_row);
+      if (!status.ok()) {
+        VLOG(1) << status.getMessage();
+        continue;
+      }
 
-    // Then remove the newline.
-    if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
-      serialized_row.pop_back();
+      // Then remove the newline.
+      if (json_row.size() > 0 && json_row.back() == '\n') {
+        json_row.pop_back();
+      }
+
+      EventFactory::forwardEvent(json_row);
     }
+  }
+
+  // Serialize and store the row data, for query-time retrieval.
+  std::vector<std::string> serialized_rows;
+  auto serialize_status = serializeEventRows(
+      context, getOsqueryDatabase(), row_list, serialized_rows);
 
-    // Logger plugins may request events to be forwarded directly.
-    // If no active logger is marked 'usesLogEvent' then this is a no-op.
-    EventFactory::forwardEvent(serialized_row);
+  if (!serialize_status.ok()) {
+    return serialize_status;
+  }
 
-    // Store the event data in the batch
+  for (std::size_t i = 0U; i < serialized_rows.size(); ++i) {
     database_data.push_back(
-        std::make_pair("data." + dbNamespace() + "." + string_event_identifier,
-                       serialized_row));
+        std::make_pair("data." + dbNamespace() + "." + row_list[i].at("eid"),
+                       std::move(serialized_rows[i])));
   }
 
   if (database_data.empty()) {
@@ -168,6 +184,7 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
       return status;
     }
 
+    WriteLock index_lock(context.event_index_mutex);
     auto it = context.event_index.find(event_time);
     if (it == context.event_index.end()) {
       context.event_index.insert({event_time, event_id_list});
@@ -294,7 +311,7 @@ void EventSubscriberPlugin::setOptimizeData(IDatabaseInterface& db_interface,
   // Store the optimization time and eid.
   std::string query_name;
   db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
+      kPersistentSettings, executingQueryKey(), query_name);
   if (query_name.empty()) {
     return;
   }
@@ -317,7 +334,7 @@ void EventSubscriberPlugin::getOptimizeData(IDatabaseInterface& db_interface,
                                             std::string& query_name) {
   // Read the optimization time for the current executing query.
   db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
+      kPersistentSettings, executingQueryKey(), query_name);
 
   if (query_name.empty()) {
     o_time = 0;
@@ -360,6 +377,26 @@ Status EventSubscriberPlugin::generateEventDataIndex(
     return status;
   }
 
+  {
+    auto dictionary_key = databaseKeyForColumnDictionary(context);
+
+    std::string serialized_dictionary;
+    status = db_interface.getDatabaseValue(
+        kEvents, dictionary_key, serialized_dictionary);
+
+    WriteLock lock(context.column_dictionary_mutex);
+    if (status.ok()) {
+      status = context.column_dictionary.deserialize(serialized_dictionary);
+      if (!status.ok()) {
+        LOG(ERROR) << "Invalid column dictionary for subscriber "
+                   << context.database_namespace << ": "
+                   << status.getMessage();
+      }
+    }
+
+    context.stored_column_count = context.column_dictionary.size();
+  }
+
   std::vector<std::string> invalid_data_key_list;
   std::size_t event_count{0U};
 
@@ -396,7 +433,7 @@ Status EventSubscriberPlugin::generateEventDataIndex(
       }
 
       Row row;
-      if (!deserializeRowJSON(serialized_row, row)) {
+      if (!deserializeEventRow(context, serialized_row, row).ok()) {
         invalid_data_key_list.push_back(key);
         continue;
       }
@@ -453,6 +490,57 @@ std::string EventSubscriberPlugin::databaseKeyForEventId(Context& context,
          string_event_id;
 }
 
+std::string EventSubscriberPlugin::databaseKeyForColumnDictionary(
+    Context& context) {
+  return std::string("columns.") + context.database_namespace;
+}
+
+Status EventSubscriberPlugin::serializeEventRows(
+    Context& context,
+    IDatabaseInterface& db_interface,
+    const std::vector<Row>& row_list,
+    std::vector<std::string>& serialized_rows) {
+  serialized_rows.clear();
+  serialized_rows.reserve(row_list.size());
+
+  WriteLock lock(context.column_dictionary_mutex);
+
+  for (const auto& row : row_list) {
+    std::string serialized_row;
+    serializeRowBinary(row, context.column_dictionary, serialized_row);
+    serialized_rows.push_back(std::move(serialized_row));
+  }
+
+  // The dictionary is written while holding the lock, before any row that
+  // references a new column can be stored.
+  if (context.column_dictionary.size() == context.stored_column_count) {
+    return Status::success();
+  }
+
+  std::string serialized_dictionary;
+  context.column_dictionary.serialize(serialized_dictionary);
+
+  auto status = db_interface.setDatabaseValue(
+      kEvents, databaseKeyForColumnDictionary(context), serialized_dictionary);
+  if (!status.ok()) {
+    return status;
+  }
+
+  context.stored_column_count = context.column_dictionary.size();
+  return Status::success();
+}
+
+Status EventSubscriberPlugin::deserializeEventRow(
+    Context& context, const std::string& serialized_row, Row& row) {
+  // Events stored before the binary row format was introduced are JSON.
+  if (!isRowBinary(serialized_row)) {
+    return deserializeRowJSON(serialized_row, row);
+  }
+
+  ReadLock lock(context.column_dictionary_mutex);
+  return deserializeRowBinary(serialized_row, context.column_dictionary, row);
+}
+
 void EventSubscriberPlugin::removeOverflowingEventBatches(
     Context& context,
     IDatabaseInterface& db_interface,
@@ -590,45 +678,125 @@ void EventSubscriberPlugin::generateRows(Context& context,
     return;
   }
 
-  EventIndex::iterator lower_bound_it;
-  if (start_time == 0U) {
-    lower_bound_it = context.event_index.begin();
+  EventIDList event_id_list;
 
-  } else {
-    lower_bound_it = context.event_index.lower_bound(start_time);
-    if (lower_bound_it == context.event_index.end()) {
-      return;
+  {
+    ReadLock lock(context.event_index_mutex);
+
+    auto lower_bound_it = (start_time == 0U)
+                              ? context.event_index.begin()
+                              : context.event_index.lower_bound(start_time);
+
+    auto upper_bound_it = (end_time == 0U)
+                              ? context.event_index.end()
+                              : context.event_index.upper_bound(end_time);
+
+    for (auto it = lower_bound_it; it != upper_bound_it; ++it) {
+      const auto& index_entry = it->second;
+      event_id_list.insert(
+          event_id_list.end(), index_entry.begin(), index_entry.end());
     }
   }
 
-  auto upper_bound_it = (end_time == 0U)
-                            ? context.event_index.end()
-                            : context.event_index.upper_bound(end_time);
+  if (event_id_list.empty()) {
+    return;
+  }
+
+  // Event identifiers are zero-padded within the keys, so the events can be
+  // read in identifier order with range lookups instead of a point lookup per
+  // event. Events stored within the key range, but outside of the requested
+  // time range, are skipped.
+  std::sort(event_id_list.begin(), event_id_list.end());
+
+  auto prefix = "data." + context.database_namespace + ".";
+  auto high_key = databaseKeyForEventId(context, event_id_list.back());
 
   std::vector<std::string> invalid_key_list;
+  std::size_t missing_event_count{0U};
 
-  for (auto it = lower_bound_it; it != upper_bound_it; ++it) {
-    const auto& event_id_list = it->second;
+  DatabaseStringValueList event_batch;
+  auto event_id_it = event_id_list.begin();
+  auto low_key = databaseKeyForEventId(context, *event_id_it);
 
-    for (const auto& event_identifier : event_id_list) {
-      auto key = databaseKeyForEventId(context, event_identifier);
+  while (event_id_it != event_id_list.end()) {
+    event_batch.clear();
 
-      std::string serialized_row;
-      auto status = db_interface.getDatabaseValue(kEvents, key, serialized_row);
-      if (serialized_row.empty()) {
-        invalid_key_list.push_back(key);
+    auto batch_event_id_it = event_id_it;
+    auto status = db_interface.getDatabaseRange(
+        kEvents, low_key, high_key, event_batch, kEventsRetrieveBatch);
+
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to read the events for subscriber "
+                 << context.database_namespace << ": " << status.getMessage();
+      break;
+    }
+
+    for (auto& p : event_batch) {
+      auto& key = p.first;
+      auto& serialized_row = p.second;
+
+      char* null_terminator = nullptr;
+      auto event_identifier = static_cast<EventID>(
+          std::strtoull(&key[prefix.size()], &null_terminator, 10));
+
+      if (null_terminator == nullptr || *null_terminator != '\0') {
         continue;
       }
 
+      while (event_id_it != event_id_list.end() &&
+             *event_id_it < event_identifier) {
+        ++missing_event_count;
+        ++event_id_it;
+      }
+
+      if (event_id_it == event_id_list.end()) {
+        break;
+      }
+
+      if (*event_id_it != event_identifier) {
+        continue;
+      }
+
+      ++event_id_it;
+
       Row row = {};
-      status = deserializeRowJSON(serialized_row, row);
-      if (!status.ok()) {
-        invalid_key_list.push_back(key);
+      if (serialized_row.empty() ||
+          !deserializeEventRow(context, serialized_row, row).ok()) {
+        invalid_key_list.push_back(std::move(key));
         continue;
       }
 
       callback(std::move(row));
     }
+
+    if (event_batch.size() < kEventsRetrieveBatch) {
+      // The key range is exhausted, the remaining events are missing.
+      missing_event_count += static_cast<std::size_t>(
+          std::distance(event_id_it, event_id_list.end()));
+      break;
+    }
+
+    if (event_id_it == event_id_list.end()) {
+      break;
+    }
+
+    if (event_id_it != batch_event_id_it) {
+      low_key = databaseKeyForEventId(context, *event_id_it);
+    } else {
+      // None of the keys in this batch matched an indexed event (they were
+      // all malformed), continue right after the last key that was returned.
+      low_key = event_batch.back().first + '\0';
+      if (low_key > high_key) {
+        missing_event_count += static_cast<std::size_t>(
+            std::distance(event_id_it, event_id_list.end()));
+        break;
+      }
+    }
+  }
+
+  if (missing_event_count != 0U) {
+    VLOG(1) << "Failed to find " << missing_event_count
+            << " indexed events for subscriber " << context.database_namespace;
   }
 
   if (!invalid_key_list.empty()) {
@@ -12,6 +12,7 @@
 #include <gtest/gtest_prod.h>
 
 #include <osquery/core/plugins/plugin.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/events/eventer.h>
@@ -153,6 +154,11 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
 
     std::size_t last_query_time{0U};
     std::atomic<EventID> last_event_id{0U};
+
+    /// Column names referenced by the stored binary event rows.
+    ColumnDictionary column_dictionary;
+    std::size_t stored_column_count{0U};
+    Mutex column_dictionary_mutex;
   };
 
   static std::string toIndex(std::uint64_t i);
@@ -179,6 +185,24 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
 
   static std::string databaseKeyForEventId(Context& context, EventID event_id);
 
+  static std::string databaseKeyForColumnDictionary(Context& context);
+
+  /**
+   * @brief Serialize event rows into the binary row format.
+   *
+   * New column names are added to the context's column dictionary, which is
+   * persisted before returning so that it is never older than the rows.
+   */
+  static Status serializeEventRows(Context& context,
+                                   IDatabaseInterface& db_interface,
+                                   const std::vector<Row>& row_list,
+                                   std::vector<std::string>& serialized_rows);
+
+  /// Deserialize a stored event row, either in the binary or JSON format.
+  static Status deserializeEventRow(Context& context,
+                                    const std::string& serialized_row,
+                                    Row& row);
+
   static void removeOverflowingEventBatches(Context& context,
                                             IDatabaseInterface& db_interface,
                                             std::size_t max_event_batches);
@@ -126,6 +126,56 @@ TEST_F(EventSubscriberPluginTests, databaseKeyForEventId) {
   EXPECT_EQ(key, expected_key.str());
 }
 
+TEST_F(EventSubscriberPluginTests, serializeEventRows) {
+  MockedOsqueryDatabase mocked_database;
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  std::vector<Row> row_list = {
+      {{"time", "1"}, {"path", "/bin/ls"}},
+      {{"time", "2"}, {"path", "/bin/sh"}, {"pid", "-10"}},
+  };
+
+  std::vector<std::string> serialized_rows;
+  auto status = EventSubscriberPlugin::serializeEventRows(
+      context, mocked_database, row_list, serialized_rows);
+
+  ASSERT_TRUE(status.ok());
+  ASSERT_EQ(serialized_rows.size(), row_list.size());
+
+  auto dictionary_key =
+      EventSubscriberPlugin::databaseKeyForColumnDictionary(context);
+  EXPECT_EQ(mocked_database.key_map.count(dictionary_key), 1U);
+
+  // The column dictionary is loaded along with the event index.
+  EventSubscriberPlugin::Context new_context;
+  EventSubscriberPlugin::setDatabaseNamespace(new_context, "type", "name");
+
+  status = EventSubscriberPlugin::generateEventDataIndex(new_context,
+                                                        mocked_database);
+  ASSERT_TRUE(status.ok());
+
+  for (std::size_t i = 0U; i < row_list.size(); ++i) {
+    Row row;
+    status = EventSubscriberPlugin::deserializeEventRow(
+        new_context, serialized_rows[i], row);
+
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(row, row_list[i]);
+  }
+
+  // Events stored as JSON are still readable.
+  std::string json_row;
+  ASSERT_TRUE(serializeRowJSON(row_list[0], json_row).ok());
+
+  Row row;
+  status =
+      EventSubscriberPlugin::deserializeEventRow(new_context, json_row, row);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(row, row_list[0]);
+}
+
 TEST_F(EventSubscriberPluginTests, removeOverflowingEventBatches) {
   MockedOsqueryDatabase mocked_database;
   EXPECT_EQ(mocked_database.key_map.size(), 20U);
@@ -219,4 +269,66 @@ TEST_F(EventSubscriberPluginTests, generateRows) {
   EXPECT_EQ(callback_count, 20U);
 }
 
+TEST_F(EventSubscriberPluginTests, generateRowsMissingEvents) {
+  MockedOsqueryDatabase mocked_database;
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+
+  ASSERT_TRUE(status.ok());
+  ASSERT_EQ(context.event_index.size(), 10U);
+
+  // Remove the data of an indexed event, the rest should still be returned.
+  const auto& missing_event_list = context.event_index.at(3);
+  ASSERT_EQ(missing_event_list.size(), 1U);
+  mocked_database.key_map.erase(EventSubscriberPlugin::databaseKeyForEventId(
+      context, missing_event_list.front()));
+
+  std::vector<std::string> time_list;
+  auto callback = [&time_list](Row row) { time_list.push_back(row["time"]); };
+
+  EventSubscriberPlugin::generateRows(context, mocked_database, callback, 0, 0);
+
+  std::vector<std::string> expected_time_list = {
+      "0", "1", "2", "4", "5", "6", "7", "8", "9"};
+  EXPECT_EQ(time_list, expected_time_list);
+}
+
+TEST_F(EventSubscriberPluginTests, generateRowsMalformedKeys) {
+  MockedOsqueryDatabase mocked_database;
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+
+  ASSERT_TRUE(status.ok());
+  ASSERT_EQ(context.event_index.size(), 10U);
+
+  // Replace the data of an indexed event with more malformed keys than a
+  // single range lookup returns; the scan must move past them.
+  const auto& missing_event_list = context.event_index.at(3);
+  ASSERT_EQ(missing_event_list.size(), 1U);
+  auto missing_key = EventSubscriberPlugin::databaseKeyForEventId(
+      context, missing_event_list.front());
+  mocked_database.key_map.erase(missing_key);
+
+  for (std::size_t i = 0U; i < 3000U; ++i) {
+    mocked_database.key_map[missing_key + "x" + std::to_string(i)] = "";
+  }
+
+  std::vector<std::string> time_list;
+  auto callback = [&time_list](Row row) { time_list.push_back(row["time"]); };
+
+  EventSubscriberPlugin::generateRows(context, mocked_database, callback, 0, 0);
+
+  std::vector<std::string> expected_time_list = {
+      "0", "1", "2", "4", "5", "6", "7", "8", "9"};
+  EXPECT_EQ(time_list, expected_time_list);
+}
+
 } // namespace osquery
@@ -65,7 +65,10 @@ Status MockedOsqueryDatabase::getDatabaseValue(const std::string& domain,
 
   if (domain == kEvents) {
     auto key_it = key_map.find(key);
-    if (key_it == key_map.end()) {
+    if (key_it == key_map.end() && key.find("columns.") == 0U) {
+      return Status::failure("MockedOsqueryDatabase: Key not found: " + key);
+
+    } else if (key_it == key_map.end()) {
       throw std::logic_error(
           "MockedOsqueryDatabase: Invalid key passed to getDatabaseValue: " +
           key);
@@ -107,13 +110,14 @@ Status MockedOsqueryDatabase::setDatabaseValue(const std::string& domain,
         domain);
   }
 
-  if (key != "optimize.test_query" && key != "optimize_eid.test_query") {
+  if (key != "optimize.test_query" && key != "optimize_eid.test_query" &&
+      key.find("columns.") != 0U) {
     throw std::logic_error(
         "MockedOsqueryDatabase: Invalid key passed to setDatabaseValue: " +
         key);
   }
 
-  key_map.insert({key, value});
+  key_map[key] = value;
   return Status::success();
 }
 
@@ -189,4 +193,30 @@ Status MockedOsqueryDatabase::scanDatabaseKeys(const std::string& domain,
   return Status::success();
 }
 
+Status MockedOsqueryDatabase::getDatabaseRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high,
+    DatabaseStringValueList& results,
+    size_t max) const {
+  if (domain != kEvents || low > high) {
+    throw std::logic_error(
+        "MockedOsqueryDatabase: Invalid parameter passed to getDatabaseRange. "
+        "domain:" +
+        domain);
+  }
+
+  size_t count = 0;
+  for (auto it = key_map.lower_bound(low);
+       it != key_map.end() && it->first <= high;
+       ++it) {
+    results.push_back(*it);
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+
+  return Status::success();
+}
+
 } // namespace osquery
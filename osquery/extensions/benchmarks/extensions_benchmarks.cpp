@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+
+#include <osquery/core/core.h>
+#include <osquery/core/flags.h>
+#include <osquery/extensions/extensions.h>
+#include <osquery/extensions/interface.h>
+#include <osquery/filesystem/fileops.h>
+#include <osquery/process/process.h>
+#include <osquery/registry/registry_factory.h>
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+DECLARE_uint32(extensions_pool_size);
+
+class BenchmarkExtensionPlugin : public Plugin {
+ public:
+  Status call(const PluginRequest& request, PluginResponse& response) override {
+    response.push_back(request);
+    return Status::success();
+  }
+};
+
+CREATE_REGISTRY(BenchmarkExtensionPlugin, "benchmark_extension");
+
+/// Serve the local registry as a stand-in extension, return its socket.
+static std::string startBenchmarkExtension() {
+  static const auto path = []() {
+    auto& rf = RegistryFactory::get();
+    rf.registry("benchmark_extension")
+        ->add("echo", std::make_shared<BenchmarkExtensionPlugin>());
+    rf.addAlias("benchmark_extension", "echo", "benchmark_echo");
+
+    auto manager_path =
+        (fs::temp_directory_path() /
+         fs::unique_path("osquery.extensions_benchmark.%%%%.%%%%"))
+            .string();
+    Dispatcher::addService(std::make_shared<ExtensionRunner>(manager_path, 1));
+
+    auto extension_path = getExtensionSocket(1, manager_path);
+    for (size_t i = 0; i < 100 && !socketExists(extension_path).ok(); ++i) {
+      sleepFor(20);
+    }
+    return extension_path;
+  }();
+
+  return path;
+}
+
+static void EXTENSIONS_call(benchmark::State& state) {
+  auto path = startBenchmarkExtension();
+
+  auto pool_size = FLAGS_extensions_pool_size;
+  FLAGS_extensions_pool_size = static_cast<uint32_t>(state.range(0));
+  ExtensionClientPool::get().clear(path);
+
+  PluginRequest request = {{"action", "echo"}, {"value", "benchmark"}};
+  for (auto _ : state) {
+    PluginResponse response;
+    auto status = callExtension(
+        path, "benchmark_extension", "benchmark_echo", request, response);
+    if (!status.ok()) {
+      state.SkipWithError(status.what().c_str());
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  ExtensionClientPool::get().clear(path);
+  FLAGS_extensions_pool_size = pool_size;
+}
+
+// A pool size of 0 opens and checks a new connection for every call.
+BENCHMARK(EXTENSIONS_call)->Arg(0)->Arg(4);
+} // namespace osquery
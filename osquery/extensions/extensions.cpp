@@ -234,6 +234,7 @@ void ExtensionManagerWatcher::start() {
   }
 
   // When interrupted, request each extension tear down.
+  ExtensionClientPool::get().clear();
   const auto uuids = RegistryFactory::get().routeUUIDs();
   for (const auto& uuid : uuids) {
     try {
@@ -347,6 +348,7 @@ void ExtensionManagerWatcher::watch() {
     if (uuid.second > 1) {
       LOG(INFO) << "Extension UUID " << uuid.first << " has gone away";
       RegistryFactory::get().removeBroadcast(uuid.first);
+      ExtensionClientPool::get().clear(getExtensionSocket(uuid.first));
       failures_[uuid.first] = 1;
     }
   }
@@ -687,6 +689,31 @@ Status callExtension(const std::string& extension_path,
                      const std::string& item,
                      const PluginRequest& request,
                      PluginResponse& response) {
+  auto& pool = ExtensionClientPool::get();
+  auto client = pool.acquire(extension_path);
+
+  // A pooled connection may still fail if the extension restarted while it
+  // was idle. If the request could not be written the call is attempted once
+  // more on a new connection. Once written, the extension may have acted on
+  // the request, such as an insert, and it is not repeated.
+  if (client != nullptr) {
+    try {
+      auto status = client->call(registry, item, request, response);
+      pool.release(extension_path, std::move(client));
+      return status;
+    } catch (const std::exception& e) {
+      VLOG(1) << "Pooled call to extension " << extension_path
+              << " failed: " << e.what();
+      auto sent = client->requestSent();
+      client.reset();
+      pool.clear(extension_path);
+      if (sent) {
+        return Status(1, "Extension call failed: " + std::string(e.what()));
+      }
+      response.clear();
+    }
+  }
+
   // Make sure the extension manager path exists, and is writable.
   auto status = extensionPathActive(extension_path);
   if (!status.ok()) {
@@ -694,12 +721,13 @@ Status callExtension(const std::string& extension_path,
   }
 
   try {
-    ExtensionClient client(extension_path);
-    status = client.call(registry, item, request, response);
+    client = std::make_unique<ExtensionClient>(extension_path);
+    status = client->call(registry, item, request, response);
   } catch (const std::exception& e) {
     return Status(1, "Extension call failed: " + std::string(e.what()));
   }
 
+  pool.release(extension_path, std::move(client));
   return status;
 }
 
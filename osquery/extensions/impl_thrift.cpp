@@ -23,6 +23,8 @@
 #include <thrift/transport/TPipe.h>
 #include <thrift/transport/TPipeServer.h>
 #else
+#include <poll.h>
+
 #include <thrift/transport/TServerSocket.h>
 #include <thrift/transport/TSocket.h>
 #endif
@@ -436,6 +438,24 @@ bool ExtensionClientCore::manager() {
   return manager_;
 }
 
+bool ExtensionClientCore::isConnected() {
+  if (client_ == nullptr || !client_->transport->isOpen()) {
+    return false;
+  }
+
+#if !defined(WIN32)
+  // An idle connection has nothing to read, unless the server closed it.
+  struct pollfd descriptor;
+  descriptor.fd = client_->socket->getSocketFD();
+  descriptor.events = POLLIN;
+  descriptor.revents = 0;
+  if (::poll(&descriptor, 1, 0) != 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
 ExtensionClient::ExtensionClient(const std::string& path, size_t timeout) {
   init(path, false);
   setTimeouts(timeout);
@@ -463,7 +483,10 @@ Status ExtensionClient::call(const std::string& registry,
                              PluginResponse& response) {
   extensions::ExtensionResponse er;
   auto client = manager() ? client_->em : client_->e;
-  client->call(er, registry, item, request);
+  request_sent_ = false;
+  client->send_call(registry, item, request);
+  request_sent_ = true;
+  client->recv_call(er);
   for (const auto& r : er.response) {
     response.push_back(r);
   }
@@ -476,6 +499,10 @@ void ExtensionClient::shutdown() {
   client->shutdown();
 }
 
+bool ExtensionClient::requestSent() const {
+  return request_sent_;
+}
+
 ExtensionList ExtensionManagerClient::extensions() {
   ExtensionList el;
   extensions::InternalExtensionList iel;
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include <osquery/core/core.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/shutdown.h>
 #include <osquery/core/system.h>
 #include <osquery/filesystem/filesystem.h>
@@ -30,6 +31,11 @@ using chrono_clock = std::chrono::high_resolution_clock;
 
 namespace osquery {
 
+FLAG(uint32,
+     extensions_pool_size,
+     4,
+     "Idle connections kept open to each extension (0 disables pooling)");
+
 const std::vector<std::string> kSDKVersionChanges = {
     {"1.7.7"},
 };
@@ -138,6 +144,7 @@ Status ExtensionManagerInterface::deregisterExtension(RouteUUID uuid) {
 
   // On success return the uuid of the now de-registered extension.
   RegistryFactory::get().removeBroadcast(uuid);
+  ExtensionClientPool::get().clear(getExtensionSocket(uuid));
 
   WriteLock lock(extensions_mutex_);
   extensions_.erase(uuid);
@@ -187,6 +194,76 @@ bool ExtensionManagerInterface::exists(const std::string& name) {
   return false;
 }
 
+ExtensionClientPool& ExtensionClientPool::get() {
+  static ExtensionClientPool pool;
+  return pool;
+}
+
+std::unique_ptr<ExtensionClient> ExtensionClientPool::acquire(
+    const std::string& path) {
+  while (true) {
+    std::unique_ptr<ExtensionClient> client;
+    {
+      WriteLock lock(mutex_);
+      auto it = idle_.find(path);
+      if (it == idle_.end() || it->second.empty()) {
+        return nullptr;
+      }
+
+      client = std::move(it->second.back());
+      it->second.pop_back();
+    }
+
+    if (client->isConnected()) {
+      return client;
+    }
+    VLOG(1) << "Closing stale connection to extension " << path;
+  }
+}
+
+void ExtensionClientPool::release(const std::string& path,
+                                  std::unique_ptr<ExtensionClient> client) {
+  {
+    WriteLock lock(mutex_);
+    auto& clients = idle_[path];
+    if (clients.size() < FLAGS_extensions_pool_size) {
+      clients.push_back(std::move(client));
+      return;
+    }
+  }
+
+  // The pool is full, the connection is closed without holding the lock.
+  client.reset();
+}
+
+void ExtensionClientPool::clear(const std::string& path) {
+  std::vector<std::unique_ptr<ExtensionClient>> clients;
+  {
+    WriteLock lock(mutex_);
+    auto it = idle_.find(path);
+    if (it == idle_.end()) {
+      return;
+    }
+
+    clients = std::move(it->second);
+    idle_.erase(it);
+  }
+}
+
+void ExtensionClientPool::clear() {
+  std::map<std::string, std::vector<std::unique_ptr<ExtensionClient>>> idle;
+  {
+    WriteLock lock(mutex_);
+    idle.swap(idle_);
+  }
+}
+
+size_t ExtensionClientPool::idle(const std::string& path) {
+  ReadLock lock(mutex_);
+  auto it = idle_.find(path);
+  return (it == idle_.end()) ? 0 : it->second.size();
+}
+
 void removeStalePaths(const std::string& manager) {
   std::vector<std::string> paths;
   // Attempt to remove all stale extension sockets.
@@ -328,6 +328,14 @@ class ExtensionClientCore : private boost::noncopyable {
   /// Check if the client is an extension manager.
   bool manager();
 
+  /**
+   * @brief Check if the connection is open and the server has not closed it.
+   *
+   * This does not send a request, a pending end-of-file or unexpected data
+   * on an idle connection means it cannot be reused.
+   */
+  bool isConnected();
+
  protected:
   /// Path to extension server socket.
   std::string path_;
@@ -368,6 +376,18 @@ class ExtensionClient : public ExtensionClientCore, public ExtensionAPI {
 
   /// Request that the extension stop.
   void shutdown() override;
+
+  /**
+   * @brief Check if the last call wrote its request to the extension.
+   *
+   * A call that failed before the request was written may be retried on
+   * another connection, the extension did not receive it.
+   */
+  bool requestSent() const;
+
+ private:
+  /// True once the request of the last call was written.
+  bool request_sent_{false};
 };
 
 /// Internal accessor for a client to an extension manager (from an extension).
@@ -406,6 +426,49 @@ class ExtensionManagerClient : public ExtensionClient,
   Status getQueryColumns(const std::string& sql, QueryData& qd) override;
 };
 
+/**
+ * @brief Long-lived client connections to extensions, by socket path.
+ *
+ * A call borrows an idle connection to the extension, or opens a new one,
+ * and returns it to the pool once the call succeeds. Each extension keeps at
+ * most extensions_pool_size idle connections.
+ */
+class ExtensionClientPool : private boost::noncopyable {
+ public:
+  static ExtensionClientPool& get();
+
+  /**
+   * @brief Take an idle connection to an extension.
+   *
+   * Connections that fail the health check are closed.
+   *
+   * @return a connected client, or nullptr if none is idle.
+   */
+  std::unique_ptr<ExtensionClient> acquire(const std::string& path);
+
+  /// Return a connection after a successful call.
+  void release(const std::string& path,
+               std::unique_ptr<ExtensionClient> client);
+
+  /// Close the idle connections to an extension.
+  void clear(const std::string& path);
+
+  /// Close every idle connection.
+  void clear();
+
+  /// Number of idle connections to an extension.
+  size_t idle(const std::string& path);
+
+ private:
+  ExtensionClientPool() = default;
+
+ private:
+  std::map<std::string, std::vector<std::unique_ptr<ExtensionClient>>> idle_;
+
+  /// Protects the idle connections.
+  Mutex mutex_;
+};
+
 /// Attempt to remove all stale extension sockets.
 void removeStalePaths(const std::string& manager);
 } // namespace osquery
@@ -283,6 +283,31 @@ TEST_F(ExtensionsTest, test_extension_broadcast) {
   EXPECT_EQ(response.size(), 1U);
   EXPECT_EQ(response[0]["test_key"], "test_value");
 
+  // The connection is kept and reused by the next call.
+  auto& pool = ExtensionClientPool::get();
+  EXPECT_EQ(pool.idle(ext_socket), 1U);
+  response.clear();
+  status = callExtension(ext_socket,
+                         "extension_test",
+                         "test_alias",
+                         {{"test_key", "test_value"}},
+                         response);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(response.size(), 1U);
+  EXPECT_EQ(pool.idle(ext_socket), 1U);
+
+  // A call records once its request is written, after which it is not retried.
+  ExtensionClient client(ext_socket);
+  EXPECT_FALSE(client.requestSent());
+  response.clear();
+  status = client.call(
+      "extension_test", "test_alias", {{"test_key", "test_value"}}, response);
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(client.requestSent());
+
+  pool.clear(ext_socket);
+  EXPECT_EQ(pool.idle(ext_socket), 0U);
+
   rf.removeBroadcast(uuid);
   rf.allowDuplicates(false);
 }
@@ -360,6 +360,29 @@ bool platformSetSafeDbPerms(const std::string& path);
  */
 std::vector<std::string> platformGlob(const std::string& find_path);
 
+#ifndef WIN32
+/**
+ * @brief List the entries below directories, one depth level at a time.
+ *
+ * This is equivalent to globbing "directory/**" with one more "/**" per level,
+ * but every directory is read exactly once. Each level is appended to results
+ * in glob order with directories marked by a trailing '/'. Hidden entries are
+ * not matched. A directory that is its own ancestor, by device and inode, is
+ * not listed, which stops symlink loops.
+ *
+ * @param directories directories to list, each with a trailing '/'.
+ * @param root the parent of the directories, used for loop detection.
+ * @param depth the maximum number of levels to list.
+ * @param workers the maximum number of threads listing a level.
+ * @param results [output] the entries found.
+ */
+void platformWalkDirectories(std::vector<std::string> directories,
+                             const std::string& root,
+                             size_t depth,
+                             size_t workers,
+                             std::vector<std::string>& results);
+#endif
+
 /**
  * @brief Checks to see if the current user has the permissions to perform a
  *        specified operation on a file.
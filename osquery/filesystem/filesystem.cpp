@@ -49,6 +49,11 @@ HIDDEN_FLAG(bool, allow_unsafe, false, "Allow unsafe executable permissions");
 /// Disable forensics (atime/mtime preserving) file reads.
 HIDDEN_FLAG(bool, disable_forensic, true, "Disable atime/mtime preservation");
 
+FLAG(uint32,
+     glob_workers,
+     1,
+     "Number of threads listing directories for recursive globs");
+
 static const size_t kMaxRecursiveGlobs = 64;
 
 Status writeTextFile(const fs::path& path,
@@ -316,11 +321,50 @@ static bool checkForLoops(std::set<int>& dsym_inos, std::string path) {
   return false;
 }
 
+/// Prune results based on settings/requested glob limitations.
+static void pruneGlobs(std::vector<std::string>& results, GlobLimits limits) {
+  auto end = std::remove_if(
+      results.begin(), results.end(), [limits](const std::string& found) {
+        return !(((found[found.length() - 1] == '/' ||
+                   found[found.length() - 1] == '\\') &&
+                  limits & GLOB_FOLDERS) ||
+                 ((found[found.length() - 1] != '/' &&
+                   found[found.length() - 1] != '\\') &&
+                  limits & GLOB_FILES));
+      });
+  results.erase(end, results.end());
+}
+
 static void genGlobs(std::string path,
                      std::vector<std::string>& results,
                      GlobLimits limits) {
   // Use our helped escape/replace for wildcards.
   replaceGlobWildcards(path, limits);
+
+#ifndef WIN32
+  size_t wild = path.rfind("**");
+  if (wild != std::string::npos && wild + 2 == path.size()) {
+    // Glob the first level of a trailing double star, then read each
+    // directory below it once instead of globbing every depth again.
+    auto glob_results = platformGlob(path);
+    std::vector<std::string> directories;
+    for (const auto& result_path : glob_results) {
+      if (!result_path.empty() && result_path.back() == '/') {
+        directories.push_back(result_path);
+      }
+    }
+
+    results.insert(results.end(), glob_results.begin(), glob_results.end());
+    platformWalkDirectories(std::move(directories),
+                            path.substr(0, wild),
+                            kMaxRecursiveGlobs - 2,
+                            FLAGS_glob_workers,
+                            results);
+    pruneGlobs(results, limits);
+    return;
+  }
+#endif
+
   // inodes of directory symlinks for loop detection
   std::set<int> dsym_inos;
 
@@ -347,17 +391,7 @@ static void genGlobs(std::string path,
     path += "/**";
   }
 
-  // Prune results based on settings/requested glob limitations.
-  auto end = std::remove_if(
-      results.begin(), results.end(), [limits](const std::string& found) {
-        return !(((found[found.length() - 1] == '/' ||
-                   found[found.length() - 1] == '\\') &&
-                  limits & GLOB_FOLDERS) ||
-                 ((found[found.length() - 1] != '/' &&
-                   found[found.length() - 1] != '\\') &&
-                  limits & GLOB_FILES));
-      });
-  results.erase(end, results.end());
+  pruneGlobs(results, limits);
 }
 
 Status resolveFilePattern(const fs::path& fs_path,
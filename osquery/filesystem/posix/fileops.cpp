@@ -10,6 +10,8 @@
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/fileops.h>
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <glob.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -20,9 +22,16 @@
 #include <sys/time.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
+#include <osquery/logger/logger.h>
+
 namespace fs = boost::filesystem;
 namespace errc = boost::system::errc;
 
@@ -303,6 +312,153 @@ std::vector<std::string> platformGlob(const std::string& find_path) {
   return results;
 }
 
+namespace {
+
+/// The entries of a single directory read by platformWalkDirectories.
+struct WalkedDirectory {
+  /// Set if the directory could be opened and read.
+  bool listed{false};
+
+  /// Identity of the directory, used to detect loops.
+  dev_t device{0};
+  ino_t inode{0};
+
+  std::vector<std::string> entries;
+};
+
+void walkDirectory(const std::string& path, WalkedDirectory& walked) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat dir_stat;
+  if (::fstat(fd, &dir_stat) != 0) {
+    ::close(fd);
+    return;
+  }
+
+  auto* dir = ::fdopendir(fd);
+  if (dir == nullptr) {
+    ::close(fd);
+    return;
+  }
+
+  walked.listed = true;
+  walked.device = dir_stat.st_dev;
+  walked.inode = dir_stat.st_ino;
+
+  struct dirent* entry = nullptr;
+  while ((entry = ::readdir(dir)) != nullptr) {
+    // Like glob, a wildcard does not match hidden entries.
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+
+    // Only links and file systems without entry types need a stat, the
+    // target of a link decides if it is marked as a directory.
+    bool is_directory = (entry->d_type == DT_DIR);
+    if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) {
+      struct stat target;
+      is_directory = ::fstatat(::dirfd(dir), entry->d_name, &target, 0) == 0 &&
+                     S_ISDIR(target.st_mode);
+    }
+
+    walked.entries.push_back(path + entry->d_name);
+    if (is_directory) {
+      walked.entries.back().push_back('/');
+    }
+  }
+
+  ::closedir(dir);
+}
+
+} // namespace
+
+void platformWalkDirectories(std::vector<std::string> directories,
+                             const std::string& root,
+                             size_t depth,
+                             size_t workers,
+                             std::vector<std::string>& results) {
+  // A directory is a loop if it is one of its own ancestors.
+  struct Ancestor {
+    dev_t device;
+    ino_t inode;
+    std::shared_ptr<const Ancestor> parent;
+  };
+  using AncestorRef = std::shared_ptr<const Ancestor>;
+
+  AncestorRef root_ancestor{nullptr};
+  struct stat root_stat;
+  if (!root.empty() && ::stat(root.c_str(), &root_stat) == 0) {
+    root_ancestor = std::make_shared<const Ancestor>(
+        Ancestor{root_stat.st_dev, root_stat.st_ino, nullptr});
+  }
+  std::vector<AncestorRef> parents(directories.size(), root_ancestor);
+
+  for (; depth > 0 && !directories.empty(); depth--) {
+    std::vector<WalkedDirectory> walked(directories.size());
+
+    auto threads = std::min(workers, directories.size());
+    if (threads > 1) {
+      std::atomic<size_t> next{0};
+      std::vector<std::thread> pool;
+      for (size_t i = 0; i < threads; i++) {
+        pool.emplace_back([&directories, &walked, &next]() {
+          for (auto index = next++; index < directories.size();
+               index = next++) {
+            walkDirectory(directories[index], walked[index]);
+          }
+        });
+      }
+
+      for (auto& thread : pool) {
+        thread.join();
+      }
+    } else {
+      for (size_t i = 0; i < directories.size(); i++) {
+        walkDirectory(directories[i], walked[i]);
+      }
+    }
+
+    std::vector<std::pair<std::string, AncestorRef>> level;
+    for (size_t i = 0; i < directories.size(); i++) {
+      if (!walked[i].listed) {
+        continue;
+      }
+
+      bool loop = false;
+      for (auto a = parents[i]; a != nullptr && !loop; a = a->parent) {
+        loop = (a->device == walked[i].device && a->inode == walked[i].inode);
+      }
+      if (loop) {
+        VLOG(1) << "Symlink loop detected. Ignoring: " << directories[i];
+        continue;
+      }
+
+      auto ancestor = std::make_shared<const Ancestor>(
+          Ancestor{walked[i].device, walked[i].inode, parents[i]});
+      for (auto& entry : walked[i].entries) {
+        level.emplace_back(std::move(entry), ancestor);
+      }
+    }
+
+    std::sort(level.begin(),
+              level.end(),
+              [](const auto& l, const auto& r) { return l.first < r.first; });
+
+    directories.clear();
+    parents.clear();
+    for (auto& entry : level) {
+      if (entry.first.back() == '/') {
+        directories.push_back(entry.first);
+        parents.push_back(std::move(entry.second));
+      }
+      results.push_back(std::move(entry.first));
+    }
+  }
+}
+
 int platformAccess(const std::string& path, mode_t mode) {
   return ::access(path.c_str(), mode);
 }
@@ -37,6 +37,7 @@ namespace fs = boost::filesystem;
 namespace osquery {
 
 DECLARE_uint64(read_max);
+DECLARE_uint32(glob_workers);
 
 class FilesystemTests : public testing::Test {
  protected:
@@ -386,6 +387,47 @@ TEST_F(FilesystemTests, test_wildcard_all_types) {
                    .string()));
 }
 
+TEST_F(FilesystemTests, test_wildcard_double_workers) {
+  std::vector<std::string> serial;
+  resolveFilePattern(fake_directory_ / "%%", serial);
+
+  auto workers = FLAGS_glob_workers;
+  FLAGS_glob_workers = 4;
+  std::vector<std::string> parallel;
+  resolveFilePattern(fake_directory_ / "%%", parallel);
+  FLAGS_glob_workers = workers;
+
+  EXPECT_EQ(serial.size(), 20U);
+  EXPECT_EQ(serial, parallel);
+}
+
+TEST_F(FilesystemTests, test_wildcard_double_loop) {
+  if (isPlatform(PlatformType::TYPE_WINDOWS)) {
+    return;
+  }
+
+  auto root = fs::temp_directory_path() /
+              fs::unique_path("osquery.tests.loop.%%%%.%%%%");
+  fs::create_directories(root / "a/b");
+  fs::create_directories(root / "c");
+  boost::system::error_code ec;
+  fs::create_directory_symlink(root, root / "a/b/up", ec);
+  ASSERT_FALSE(ec);
+  // A second path to the same directory is not a loop.
+  fs::create_directory_symlink(root / "c", root / "a/c", ec);
+  ASSERT_FALSE(ec);
+
+  std::vector<std::string> results;
+  resolveFilePattern(root / "%%", results, GLOB_FOLDERS);
+  fs::remove_all(root);
+
+  auto canonical_root = fs::canonical(root.parent_path()) / root.filename();
+  EXPECT_TRUE(contains(results, (canonical_root / "a/b/up/").string()));
+  EXPECT_TRUE(contains(results, (canonical_root / "a/c/").string()));
+  EXPECT_FALSE(contains(results, (canonical_root / "a/b/up/a/").string()));
+  EXPECT_EQ(results.size(), 5U);
+}
+
 TEST_F(FilesystemTests, test_wildcard_invalid_path) {
   std::vector<std::string> results;
   auto status = resolveFilePattern("/not_there_abcdefz/%%", results);
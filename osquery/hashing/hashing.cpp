@@ -7,29 +7,50 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
-#include <algorithm>
-#include <iomanip>
-#include <sstream>
-#include <unordered_map>
+#include <array>
+#include <memory>
 #include <vector>
 
-#include <openssl/md5.h>
-#include <openssl/sha.h>
+#ifdef __linux__
+#include <fcntl.h>
+#endif
 
+#include <openssl/evp.h>
+
+#include <osquery/core/flags.h>
+#include <osquery/filesystem/fileops.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/hashing/hashing.h>
+#include <osquery/logger/logger.h>
 #include <osquery/utils/base64.h>
 #include <osquery/utils/info/platform_type.h>
 #include <osquery/utils/status/status.h>
 
 namespace osquery {
 
+DECLARE_uint64(read_max);
+DECLARE_bool(disable_forensic);
+
 /// The buffer read size from file IO to hashing structures.
-const size_t kHashChunkSize{4096};
+const size_t kHashChunkSize{256 * 1024};
+
+/// Return the OpenSSL digest implementing an osquery hash type.
+static const EVP_MD* getDigest(HashType algorithm) {
+  switch (algorithm) {
+  case HASH_TYPE_MD5:
+    return EVP_md5();
+  case HASH_TYPE_SHA1:
+    return EVP_sha1();
+  case HASH_TYPE_SHA256:
+    return EVP_sha256();
+  default:
+    return nullptr;
+  }
+}
 
 Hash::~Hash() {
   if (ctx_ != nullptr) {
-    free(ctx_);
+    EVP_MD_CTX_free(static_cast<EVP_MD_CTX*>(ctx_));
   }
 }
 
@@ -38,57 +59,45 @@ Hash::Hash(HashType algorithm)
 
 Hash::Hash(HashType algorithm, HashEncodingType encoding)
     : algorithm_(algorithm), encoding_(encoding) {
-  if (algorithm_ == HASH_TYPE_MD5) {
-    length_ = MD5_DIGEST_LENGTH;
-    ctx_ = static_cast<MD5_CTX*>(malloc(sizeof(MD5_CTX)));
-    MD5_Init(static_cast<MD5_CTX*>(ctx_));
-  } else if (algorithm_ == HASH_TYPE_SHA1) {
-    length_ = SHA_DIGEST_LENGTH;
-    ctx_ = static_cast<SHA_CTX*>(malloc(sizeof(SHA_CTX)));
-    SHA1_Init(static_cast<SHA_CTX*>(ctx_));
-  } else if (algorithm_ == HASH_TYPE_SHA256) {
-    length_ = SHA256_DIGEST_LENGTH;
-    ctx_ = static_cast<SHA256_CTX*>(malloc(sizeof(SHA256_CTX)));
-    SHA256_Init(static_cast<SHA256_CTX*>(ctx_));
-  } else {
+  // The EVP interface selects the CPU accelerated implementations.
+  const auto* md = getDigest(algorithm_);
+  if (md == nullptr) {
     throw std::domain_error("Unknown hash function");
   }
+
+  auto* ctx = EVP_MD_CTX_new();
+  if (ctx == nullptr || EVP_DigestInit_ex(ctx, md, nullptr) != 1) {
+    EVP_MD_CTX_free(ctx);
+    throw std::runtime_error("Cannot initialize hash function");
+  }
+
+  ctx_ = ctx;
+  length_ = static_cast<size_t>(EVP_MD_size(md));
 }
 
 void Hash::update(const void* buffer, size_t size) {
-  if (algorithm_ == HASH_TYPE_MD5) {
-    MD5_Update(static_cast<MD5_CTX*>(ctx_), buffer, size);
-  } else if (algorithm_ == HASH_TYPE_SHA1) {
-    SHA1_Update(static_cast<SHA_CTX*>(ctx_), buffer, size);
-  } else if (algorithm_ == HASH_TYPE_SHA256) {
-    SHA256_Update(static_cast<SHA256_CTX*>(ctx_), buffer, size);
-  }
+  EVP_DigestUpdate(static_cast<EVP_MD_CTX*>(ctx_), buffer, size);
 }
 
 std::string Hash::digest() {
-  std::vector<unsigned char> hash;
-  hash.assign(length_, '\0');
-
-  if (algorithm_ == HASH_TYPE_MD5) {
-    MD5_Final(hash.data(), static_cast<MD5_CTX*>(ctx_));
-  } else if (algorithm_ == HASH_TYPE_SHA1) {
-    SHA1_Final(hash.data(), static_cast<SHA_CTX*>(ctx_));
-  } else if (algorithm_ == HASH_TYPE_SHA256) {
-    SHA256_Final(hash.data(), static_cast<SHA256_CTX*>(ctx_));
+  std::array<unsigned char, EVP_MAX_MD_SIZE> hash;
+  unsigned int length = 0;
+  auto* ctx = static_cast<EVP_MD_CTX*>(ctx_);
+  if (EVP_DigestFinal_ex(ctx, hash.data(), &length) != 1) {
+    return "";
   }
 
   if (encoding_ == HASH_ENCODING_TYPE_HEX) {
-    std::stringstream digest;
-    for (size_t i = 0; i < length_; i++) {
-      digest << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+    static const char kHexDigits[] = "0123456789abcdef";
+    std::string digest(length * 2, '\0');
+    for (size_t i = 0; i < length; i++) {
+      digest[i * 2] = kHexDigits[hash[i] >> 4];
+      digest[i * 2 + 1] = kHexDigits[hash[i] & 0x0F];
     }
-    return digest.str();
+    return digest;
   } else if (encoding_ == HASH_ENCODING_TYPE_BASE64) {
-    std::stringstream digest;
-    for (size_t i = 0; i < length_; i++) {
-      digest << hash[i];
-    }
-    return base64::encode(digest.str());
+    return base64::encode(
+        std::string(reinterpret_cast<const char*>(hash.data()), length));
   }
 
   return "";
@@ -102,42 +111,102 @@ std::string hashFromBuffer(HashType hash_type,
   return hash.digest();
 }
 
-MultiHashes hashMultiFromFile(int mask, const std::string& path) {
-  std::map<HashType, std::shared_ptr<Hash>> hashes = {
-      {HASH_TYPE_MD5, std::make_shared<Hash>(HASH_TYPE_MD5)},
-      {HASH_TYPE_SHA1, std::make_shared<Hash>(HASH_TYPE_SHA1)},
-      {HASH_TYPE_SHA256, std::make_shared<Hash>(HASH_TYPE_SHA256)},
-  };
-
+/**
+ * @brief Stream a file through a set of hashes in a single pass.
+ *
+ * The file is read through a reusable per-thread buffer, so the memory used
+ * does not depend on the file size. Regular files are hashed completely,
+ * special files without a known size are limited to read_max bytes.
+ */
+static Status hashFileContent(const std::string& path,
+                              std::vector<std::unique_ptr<Hash>>& hashes) {
   auto blocking = isPlatform(PlatformType::TYPE_WINDOWS);
-  auto s = readFile(path,
-                    0,
-                    kHashChunkSize,
-                    false,
-                    true,
-                    ([&hashes, &mask](std::string& buffer, size_t size) {
-                      for (auto& hash : hashes) {
-                        if (mask & hash.first) {
-                          hash.second->update(&buffer[0], size);
-                        }
-                      }
-                    }),
-                    blocking);
+  int mode = PF_OPEN_EXISTING | PF_READ;
+  if (!blocking) {
+    mode |= PF_NONBLOCK;
+  }
+
+  auto fd = std::make_unique<PlatformFile>(path, mode);
+  if (!blocking && fd->isValid() && fd->isSpecialFile()) {
+    // A special file cannot be read in non-blocking mode, reopen it.
+    fd = std::make_unique<PlatformFile>(path, mode & ~PF_NONBLOCK);
+  }
+
+  if (!fd->isValid()) {
+    return Status::failure("Cannot open file for reading: " + path);
+  }
+
+  auto limit = fd->isSpecialFile() ? static_cast<size_t>(FLAGS_read_max) : 0;
+
+#ifdef __linux__
+  // Hint a sequential scan, doubling the kernel read-ahead.
+  ::posix_fadvise(fd->nativeHandle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  PlatformTime times;
+  fd->getFileTimes(times);
+
+  static thread_local std::vector<char> buffer(kHashChunkSize);
+
+  size_t total_bytes = 0;
+  while (true) {
+    auto part_bytes = fd->read(buffer.data(), buffer.size());
+    if (part_bytes < 0 && fd->hasPendingIo()) {
+      continue;
+    }
+    if (part_bytes < 0) {
+      return Status::failure("Cannot read file: " + path);
+    }
+    if (part_bytes == 0) {
+      break;
+    }
+
+    total_bytes += static_cast<size_t>(part_bytes);
+    if (limit > 0 && total_bytes >= limit) {
+      return Status::failure("File exceeds read limits");
+    }
+
+    for (auto& hash : hashes) {
+      hash->update(buffer.data(), static_cast<size_t>(part_bytes));
+    }
+  }
+
+  // Attempt to restore the atime and mtime before the file read.
+  if (!FLAGS_disable_forensic) {
+    fd->setFileTimes(times);
+  }
+  return Status::success();
+}
+
+MultiHashes hashMultiFromFile(int mask, const std::string& path) {
+  // Only the requested hashes are updated, in the order of MultiHashes.
+  static const std::array<HashType, 3> kHashTypes = {
+      HASH_TYPE_MD5, HASH_TYPE_SHA1, HASH_TYPE_SHA256};
+
+  std::vector<std::unique_ptr<Hash>> hashes;
+  for (auto type : kHashTypes) {
+    if (mask & type) {
+      hashes.push_back(std::make_unique<Hash>(type));
+    }
+  }
 
   MultiHashes mh = {};
+  auto s = hashFileContent(path, hashes);
   if (!s.ok()) {
+    VLOG(1) << "Cannot hash " << path << ": " << s.getMessage();
     return mh;
   }
 
   mh.mask = mask;
+  auto hash = hashes.begin();
   if (mask & HASH_TYPE_MD5) {
-    mh.md5 = hashes.at(HASH_TYPE_MD5)->digest();
+    mh.md5 = (*hash++)->digest();
   }
   if (mask & HASH_TYPE_SHA1) {
-    mh.sha1 = hashes.at(HASH_TYPE_SHA1)->digest();
+    mh.sha1 = (*hash++)->digest();
   }
   if (mask & HASH_TYPE_SHA256) {
-    mh.sha256 = hashes.at(HASH_TYPE_SHA256)->digest();
+    mh.sha256 = (*hash++)->digest();
   }
   return mh;
 }
@@ -116,9 +116,9 @@ class Hash : private boost::noncopyable {
   /// The encoding type used to encode the digest.
   HashEncodingType encoding_;
 
-  /// The buffer used to maintain the context and state of the hashing
+  /// The OpenSSL digest context maintaining the state of the hashing
   /// operations
-  void* ctx_;
+  void* ctx_{nullptr};
 
   /// The length of the hash to be returned
   size_t length_;
@@ -136,6 +136,9 @@ std::string hashFromFile(HashType hash_type, const std::string& path);
 /**
  * @brief Compute multiple hashes from a files contents simultaneously.
  *
+ * The file is streamed through a fixed size buffer in a single pass, so
+ * regular files of any size may be hashed with constant memory.
+ *
  * @param mask Bitmask specifying target osquery-supported algorithms.
  * @param path Filesystem path (the hash target).
  * @return A struct containing string (hex) representations
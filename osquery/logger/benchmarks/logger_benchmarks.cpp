@@ -11,6 +11,7 @@
 
 #include <osquery/core/core.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/query.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry_factory.h>
 
@@ -83,4 +84,73 @@ static void LOGGER_logstring_plugin(benchmark::State& state) {
 }
 
 BENCHMARK(LOGGER_logstring_plugin);
+
+static QueryLogItem getBenchmarkQueryLogItem(size_t rows) {
+  QueryLogItem item;
+  item.name = "benchmark";
+  item.identifier = "localhost";
+  item.calendar_time = "Mon Aug 25 12:10:57 2014";
+  item.time = 1408993857;
+  item.decorations = {{"host_uuid", "00000000-0000-0000-0000-000000000000"},
+                      {"username", "osquery"}};
+
+  for (size_t i = 0; i < rows; i++) {
+    item.results.added.push_back({{"pid", static_cast<long long>(i)},
+                                  {"name", "process_" + std::to_string(i)},
+                                  {"path", std::string("/usr/bin/process")},
+                                  {"resident_size", 4096.0}});
+  }
+  return item;
+}
+
+static void LOGGER_query_log_item_events_document(benchmark::State& state) {
+  auto item = getBenchmarkQueryLogItem(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    // The previous serializer: a document of events, then one line per event.
+    auto doc = JSON::newArray();
+    serializeQueryLogItemAsEvents(item, doc);
+    for (const auto& event : doc.doc().GetArray()) {
+      rapidjson::StringBuffer sb;
+      rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+      event.Accept(writer);
+      benchmark::DoNotOptimize(std::string(sb.GetString()));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(LOGGER_query_log_item_events_document)->Arg(10000);
+
+static void LOGGER_query_log_item_events_stream(benchmark::State& state) {
+  auto item = getBenchmarkQueryLogItem(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    serializeQueryLogItemAsEventsJSON(item, [](const std::string& event) {
+      benchmark::DoNotOptimize(event.data());
+      return Status::success();
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(LOGGER_query_log_item_events_stream)->Arg(10000);
+
+static void LOGGER_query_log_item_plugin(benchmark::State& state) {
+  FLAGS_disable_logging = false;
+  auto& rf = RegistryFactory::get();
+  rf.registry("logger")->add("dummy", std::make_shared<DummyLoggerPlugin>());
+
+  auto active = rf.getActive("logger");
+  rf.setActive("logger", "dummy");
+
+  auto item = getBenchmarkQueryLogItem(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    logQueryLogItem(item);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+
+  rf.setActive("logger", active);
+  FLAGS_disable_logging = true;
+}
+
+BENCHMARK(LOGGER_query_log_item_plugin)->Arg(10000);
 }
@@ -79,6 +79,22 @@ Status logString(const std::string& message,
                  const std::string& category,
                  const std::string& receiver);
 
+/**
+ * @brief Log several strings using a specific logger receiver.
+ *
+ * Each logger plugin receives the strings in one logStringBatch call.
+ * Loggers implemented in extensions receive one call per string.
+ *
+ * @param messages the strings to log
+ * @param category a category/metadata key
+ * @param receiver a string representing the log receiver to use
+ *
+ * @return Status indicating the success or failure of the operation
+ */
+Status logStringBatch(const std::vector<std::string>& messages,
+                      const std::string& category,
+                      const std::string& receiver);
+
 /**
  * @brief Log results of scheduled queries to the default receiver
  *
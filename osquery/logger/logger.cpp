@@ -401,6 +401,30 @@ Status logString(const std::string& message,
   return status;
 }
 
+Status logStringBatch(const std::vector<std::string>& messages,
+                      const std::string& category,
+                      const std::string& receiver) {
+  if (FLAGS_disable_logging || messages.empty()) {
+    return Status::success();
+  }
+
+  Status status;
+  for (const auto& logger : osquery::split(receiver, ",")) {
+    if (Registry::get().exists("logger", logger, true)) {
+      auto plugin = Registry::get().plugin("logger", logger);
+      auto logger_plugin = std::dynamic_pointer_cast<LoggerPlugin>(plugin);
+      status = logger_plugin->logStringBatch(messages);
+    } else {
+      // The extension API logs a single string per call.
+      for (const auto& message : messages) {
+        status = Registry::call(
+            "logger", logger, {{"string", message}, {"category", category}});
+      }
+    }
+  }
+  return status;
+}
+
 namespace {
 const std::string kTotalQueryCounterMonitorPath("query.total.count");
 }
@@ -420,23 +444,22 @@ Status logQueryLogItem(const QueryLogItem& results,
         kTotalQueryCounterMonitorPath, 1, monitoring::PreAggregationType::Sum);
   }
 
-  std::vector<std::string> json_items;
-  Status status;
   if (FLAGS_logger_event_type) {
-    status = serializeQueryLogItemAsEventsJSON(results, json_items);
-  } else {
-    std::string json;
-    status = serializeQueryLogItemJSON(results, json);
-    json_items.emplace_back(json);
+    // The events of the query are handed to each logger at once.
+    std::vector<std::string> json_items;
+    auto status = serializeQueryLogItemAsEventsJSON(results, json_items);
+    if (!status.ok()) {
+      return status;
+    }
+    return logStringBatch(json_items, "event", receiver);
   }
+
+  std::string json;
+  auto status = serializeQueryLogItemJSON(results, json);
   if (!status.ok()) {
     return status;
   }
-
-  for (const auto& json : json_items) {
-    status = logString(json, "event", receiver);
-  }
-  return status;
+  return logString(json, "event", receiver);
 }
 
 Status logSnapshotQuery(const QueryLogItem& item) {
@@ -449,20 +472,8 @@ Status logSnapshotQuery(const QueryLogItem& item) {
         kTotalQueryCounterMonitorPath, 1, monitoring::PreAggregationType::Sum);
   }
 
-  std::vector<std::string> json_items;
-  Status status;
-  if (FLAGS_logger_snapshot_event_type) {
-    status = serializeQueryLogItemAsEventsJSON(item, json_items);
-  } else {
-    std::string json;
-    status = serializeQueryLogItemJSON(item, json);
-    json_items.emplace_back(json);
-  }
-  if (!status.ok()) {
-    return status;
-  }
-
-  for (const auto& json : json_items) {
+  auto log_snapshot = [](const std::string& json) {
+    Status status;
     auto receiver = RegistryFactory::get().getActive("logger");
     for (const auto& logger : osquery::split(receiver, ",")) {
       if (Registry::get().exists("logger", logger, true)) {
@@ -473,9 +484,19 @@ Status logSnapshotQuery(const QueryLogItem& item) {
         status = Registry::call("logger", logger, {{"snapshot", json}});
       }
     }
+    return status;
+  };
+
+  if (FLAGS_logger_snapshot_event_type) {
+    return serializeQueryLogItemAsEventsJSON(item, log_snapshot);
   }
 
-  return status;
+  std::string json;
+  auto status = serializeQueryLogItemJSON(item, json);
+  if (!status.ok()) {
+    return status;
+  }
+  return log_snapshot(json);
 }
 
 size_t queuedStatuses() {
@@ -14,6 +14,8 @@
 #include <osquery/registry/registry.h>
 #include <osquery/sql/sql.h>
 
+#include "osquery/sql/slot_table_row.h"
+#include "osquery/sql/table_statistics.h"
 #include "osquery/sql/virtual_table.h"
 
 namespace osquery {
@@ -155,6 +157,31 @@ static void SQL_virtual_table_internal_unique(benchmark::State& state) {
 
 BENCHMARK(SQL_virtual_table_internal_unique);
 
+static void SQL_virtual_table_internal_pool(benchmark::State& state) {
+  // Every benchmark thread waits for the one-time registration, so no thread
+  // queries the pool before the table is attached.
+  static const bool registered = []() {
+    auto tables = RegistryFactory::get().registry("table");
+    tables->add("benchmark", std::make_shared<BenchmarkTablePlugin>());
+    // Attach to the primary and replay the attach to the connection pool.
+    Registry::call("sql", "sql", {{"action", "attach"}, {"table", "benchmark"}});
+    return true;
+  }();
+  static_cast<void>(registered);
+
+  while (state.KeepRunning()) {
+    // Concurrent callers receive the primary, a pooled, or a transient
+    // connection depending on contention.
+    auto dbc = SQLiteDBManager::get();
+    QueryData results;
+    queryInternal("select * from benchmark", results, dbc);
+    dbc->clearAffectedTables();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(SQL_virtual_table_internal_pool)->ThreadRange(1, 8)->UseRealTime();
+
 class BenchmarkLongTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const {
@@ -229,9 +256,10 @@ class BenchmarkWideTableYieldPlugin : public BenchmarkWideTablePlugin {
 
   void generator(RowYield& yield, QueryContext& ctx) override {
     for (size_t k = 0; k < kWideCount; k++) {
-      auto r = make_table_row();
+      // Fill the reused slot row by column index.
+      auto r = SlotTableRow::acquire(ctx);
       for (size_t i = 0; i < 20; i++) {
-        r["test_" + std::to_string(i)] = "0";
+        r->setInteger(i, 0);
       }
       yield(std::move(r));
     }
@@ -310,4 +338,78 @@ static void SQL_select_basic(benchmark::State& state) {
 }
 
 BENCHMARK(SQL_select_basic);
+
+static void SQL_regex_match_rows(benchmark::State& state) {
+  // A constant pattern matched against many rows, compiled once per query.
+  auto query =
+      "with recursive rows(i) as (select 0 union all select i + 1 from rows "
+      "where i < " +
+      std::to_string(state.range(0)) +
+      ") select count(regex_match('/usr/bin/proc' || i || "
+      "' --config_path=/etc/osquery.conf --verbose', "
+      "'--config_path=([^ ]+)', 1)) from rows;";
+  auto dbc = SQLiteDBManager::getUnique();
+  while (state.KeepRunning()) {
+    QueryData results;
+    queryInternal(query, results, dbc);
+  }
+}
+
+BENCHMARK(SQL_regex_match_rows)->Arg(20000);
+
+class BenchmarkSizedTablePlugin : public TablePlugin {
+ public:
+  explicit BenchmarkSizedTablePlugin(size_t rows) : rows_(rows) {}
+
+ protected:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("test_int", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  TableRows generate(QueryContext& ctx) override {
+    TableRows results;
+    for (size_t i = 0; i < rows_; i++) {
+      results.push_back(make_table_row({{"test_int", INTEGER(i)}}));
+    }
+    return results;
+  }
+
+ private:
+  size_t rows_{0};
+};
+
+static void SQL_virtual_table_join_statistics(benchmark::State& state) {
+  auto tables = RegistryFactory::get().registry("table");
+  tables->add("benchmark_large",
+              std::make_shared<BenchmarkSizedTablePlugin>(1000));
+  tables->add("benchmark_single",
+              std::make_shared<BenchmarkSizedTablePlugin>(1));
+
+  auto dbc = SQLiteDBManager::getUnique();
+  for (const auto& name : {"benchmark_large", "benchmark_single"}) {
+    PluginResponse res;
+    Registry::call("table", name, {{"action", "columns"}}, res);
+    attachTableInternal(name, columnDefinition(res, false, false), dbc, false);
+  }
+
+  // Without statistics the single row table is generated for every row of
+  // the large one, as the tables are joined in the order of the query.
+  bool use_statistics = state.range(0) != 0;
+  while (state.KeepRunning()) {
+    if (!use_statistics) {
+      TableStatistics::get().clear();
+    }
+
+    QueryData results;
+    queryInternal(
+        "select * from benchmark_large join benchmark_single using (test_int)",
+        results,
+        dbc);
+    dbc->clearAffectedTables();
+  }
+}
+
+BENCHMARK(SQL_virtual_table_join_statistics)->Arg(0)->Arg(1);
 } // namespace osquery
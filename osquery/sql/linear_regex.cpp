@@ -0,0 +1,905 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "linear_regex.h"
+
+#include <algorithm>
+
+namespace osquery {
+
+namespace {
+
+/// Patterns compiling to more instructions use std::regex.
+const size_t kMaxProgramSize{4096};
+
+/// Largest bound accepted in a {n,m} quantifier.
+const int kMaxRepeat{1000};
+
+bool isWordByte(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isDigitByte(unsigned char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool isSpaceByte(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+} // namespace
+
+struct LinearRegex::Node {
+  enum class Type {
+    BYTE,
+    ANY,
+    CLASS,
+    CONCAT,
+    ALTERNATE,
+    REPEAT,
+    GROUP,
+    ASSERT,
+  };
+
+  explicit Node(Type t) : type(t) {}
+
+  Type type;
+
+  /// The byte, class index or assertion of a leaf.
+  uint32_t arg{0};
+
+  std::vector<std::unique_ptr<Node>> children;
+
+  /// The capture index of a group, 0 for a non-capturing group.
+  size_t group{0};
+
+  /// Bounds of a repeat, max is -1 if unbounded.
+  int min{0};
+  int max{0};
+  bool greedy{true};
+
+  /// Capture indexes [first_group, end_group) within a repeated node.
+  size_t first_group{0};
+  size_t end_group{0};
+};
+
+/**
+ * @brief Recursive descent parser for the supported ECMAScript subset.
+ *
+ * Any syntax outside of the subset, including invalid patterns, fails the
+ * parse so that std::regex decides how to handle the pattern.
+ */
+class LinearRegex::Parser {
+ public:
+  Parser(const std::string& pattern, std::vector<ByteClass>& classes)
+      : pattern_(pattern), classes_(classes) {}
+
+  std::unique_ptr<Node> parse() {
+    auto node = parseDisjunction();
+    if (node == nullptr || position_ != pattern_.size()) {
+      return nullptr;
+    }
+    return node;
+  }
+
+  size_t groups() const {
+    return groups_;
+  }
+
+ private:
+  bool done() const {
+    return position_ >= pattern_.size();
+  }
+
+  char peek() const {
+    return pattern_[position_];
+  }
+
+  std::unique_ptr<Node> parseDisjunction() {
+    auto first = parseAlternative();
+    if (first == nullptr || done() || peek() != '|') {
+      return first;
+    }
+
+    auto node = std::make_unique<Node>(Node::Type::ALTERNATE);
+    node->children.push_back(std::move(first));
+    while (!done() && peek() == '|') {
+      position_++;
+      auto alternative = parseAlternative();
+      if (alternative == nullptr) {
+        return nullptr;
+      }
+      node->children.push_back(std::move(alternative));
+    }
+    return node;
+  }
+
+  std::unique_ptr<Node> parseAlternative() {
+    auto node = std::make_unique<Node>(Node::Type::CONCAT);
+    while (!done() && peek() != '|' && peek() != ')') {
+      auto term = parseTerm();
+      if (term == nullptr) {
+        return nullptr;
+      }
+      node->children.push_back(std::move(term));
+    }
+    return node;
+  }
+
+  std::unique_ptr<Node> parseTerm() {
+    auto first_group = groups_ + 1;
+    bool assertion = false;
+    auto atom = parseAtom(assertion);
+    if (atom == nullptr) {
+      return nullptr;
+    }
+
+    if (done()) {
+      return atom;
+    }
+
+    int min = 0;
+    int max = 0;
+    switch (peek()) {
+    case '*':
+      min = 0;
+      max = -1;
+      position_++;
+      break;
+    case '+':
+      min = 1;
+      max = -1;
+      position_++;
+      break;
+    case '?':
+      min = 0;
+      max = 1;
+      position_++;
+      break;
+    case '{':
+      if (!parseBraces(min, max)) {
+        return nullptr;
+      }
+      break;
+    default:
+      return atom;
+    }
+
+    if (assertion) {
+      // Quantified assertions are left to std::regex.
+      return nullptr;
+    }
+
+    auto node = std::make_unique<Node>(Node::Type::REPEAT);
+    node->min = min;
+    node->max = max;
+    if (!done() && peek() == '?') {
+      node->greedy = false;
+      position_++;
+    }
+    node->first_group = first_group;
+    node->end_group = groups_ + 1;
+    node->children.push_back(std::move(atom));
+    return node;
+  }
+
+  bool parseNumber(int& value) {
+    size_t start = position_;
+    value = 0;
+    while (!done() && isDigitByte(peek())) {
+      value = value * 10 + (peek() - '0');
+      if (value > kMaxRepeat) {
+        return false;
+      }
+      position_++;
+    }
+    return position_ > start;
+  }
+
+  bool parseBraces(int& min, int& max) {
+    position_++;
+    if (!parseNumber(min)) {
+      return false;
+    }
+
+    max = min;
+    if (!done() && peek() == ',') {
+      position_++;
+      if (!done() && peek() == '}') {
+        max = -1;
+      } else if (!parseNumber(max)) {
+        return false;
+      }
+    }
+
+    if (done() || peek() != '}' || (max != -1 && max < min)) {
+      return false;
+    }
+    position_++;
+    return true;
+  }
+
+  std::unique_ptr<Node> makeByte(unsigned char c) {
+    auto node = std::make_unique<Node>(Node::Type::BYTE);
+    node->arg = c;
+    return node;
+  }
+
+  std::unique_ptr<Node> makeClass(const ByteClass& byte_class) {
+    auto node = std::make_unique<Node>(Node::Type::CLASS);
+    node->arg = static_cast<uint32_t>(classes_.size());
+    classes_.push_back(byte_class);
+    return node;
+  }
+
+  std::unique_ptr<Node> makeAssertion(Assertion assertion) {
+    auto node = std::make_unique<Node>(Node::Type::ASSERT);
+    node->arg = static_cast<uint32_t>(assertion);
+    return node;
+  }
+
+  std::unique_ptr<Node> parseAtom(bool& assertion) {
+    char c = peek();
+    position_++;
+    switch (c) {
+    case '^':
+      assertion = true;
+      return makeAssertion(Assertion::BEGIN);
+    case '$':
+      assertion = true;
+      return makeAssertion(Assertion::END);
+    case '.':
+      return std::make_unique<Node>(Node::Type::ANY);
+    case '(':
+      return parseGroup();
+    case '[':
+      return parseClass();
+    case '\\':
+      return parseEscape(assertion);
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+    case '}':
+    case ']':
+    case ')':
+      return nullptr;
+    default:
+      return makeByte(static_cast<unsigned char>(c));
+    }
+  }
+
+  std::unique_ptr<Node> parseGroup() {
+    auto node = std::make_unique<Node>(Node::Type::GROUP);
+    if (!done() && peek() == '?') {
+      // Only non-capturing groups, lookaheads are left to std::regex.
+      if (position_ + 1 >= pattern_.size() || pattern_[position_ + 1] != ':') {
+        return nullptr;
+      }
+      position_ += 2;
+    } else {
+      node->group = ++groups_;
+    }
+
+    auto body = parseDisjunction();
+    if (body == nullptr || done() || peek() != ')') {
+      return nullptr;
+    }
+    position_++;
+    node->children.push_back(std::move(body));
+    return node;
+  }
+
+  /// Add the bytes of a \d \w \s class escape, or their negation.
+  static bool addClassEscape(char c, ByteClass& byte_class) {
+    bool (*predicate)(unsigned char) = nullptr;
+    switch (c) {
+    case 'd':
+    case 'D':
+      predicate = isDigitByte;
+      break;
+    case 'w':
+    case 'W':
+      predicate = isWordByte;
+      break;
+    case 's':
+    case 'S':
+      predicate = isSpaceByte;
+      break;
+    default:
+      return false;
+    }
+
+    bool negate = (c >= 'A' && c <= 'Z');
+    for (size_t i = 0; i < byte_class.size(); i++) {
+      if (predicate(static_cast<unsigned char>(i)) != negate) {
+        byte_class[i] = true;
+      }
+    }
+    return true;
+  }
+
+  /// Parse a character escape, shared by atoms and classes.
+  bool parseCharacterEscape(char c, unsigned char& value) {
+    switch (c) {
+    case 'n':
+      value = '\n';
+      return true;
+    case 'r':
+      value = '\r';
+      return true;
+    case 't':
+      value = '\t';
+      return true;
+    case 'f':
+      value = '\f';
+      return true;
+    case 'v':
+      value = '\v';
+      return true;
+    case '0':
+      if (!done() && isDigitByte(peek())) {
+        return false;
+      }
+      value = '\0';
+      return true;
+    case 'x': {
+      if (position_ + 1 >= pattern_.size()) {
+        return false;
+      }
+      auto high = hexValue(pattern_[position_]);
+      auto low = hexValue(pattern_[position_ + 1]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      position_ += 2;
+      value = static_cast<unsigned char>(high * 16 + low);
+      return true;
+    }
+    default:
+      // Other letters and digits are backreferences or unsupported escapes.
+      if (isWordByte(static_cast<unsigned char>(c))) {
+        return false;
+      }
+      value = static_cast<unsigned char>(c);
+      return true;
+    }
+  }
+
+  std::unique_ptr<Node> parseEscape(bool& assertion) {
+    if (done()) {
+      return nullptr;
+    }
+
+    char c = peek();
+    position_++;
+    if (c == 'b' || c == 'B') {
+      assertion = true;
+      return makeAssertion((c == 'b') ? Assertion::WORD_BOUNDARY
+                                      : Assertion::NOT_WORD_BOUNDARY);
+    }
+
+    ByteClass byte_class{};
+    if (addClassEscape(c, byte_class)) {
+      return makeClass(byte_class);
+    }
+
+    unsigned char value = 0;
+    if (!parseCharacterEscape(c, value)) {
+      return nullptr;
+    }
+    return makeByte(value);
+  }
+
+  /// Parse a class member that may be a range bound, false on class escapes.
+  bool parseClassAtom(unsigned char& value, ByteClass& byte_class, bool& set) {
+    char c = peek();
+    position_++;
+    set = false;
+    if (c == '[') {
+      // POSIX classes and collating elements are left to std::regex.
+      if (!done() && (peek() == ':' || peek() == '.' || peek() == '=')) {
+        return false;
+      }
+    } else if (c == '\\') {
+      if (done()) {
+        return false;
+      }
+      c = peek();
+      position_++;
+      if (addClassEscape(c, byte_class)) {
+        set = true;
+        return true;
+      }
+      if (c == 'b') {
+        value = '\b';
+        return true;
+      }
+      return parseCharacterEscape(c, value);
+    }
+
+    value = static_cast<unsigned char>(c);
+    return true;
+  }
+
+  std::unique_ptr<Node> parseClass() {
+    bool negate = false;
+    if (!done() && peek() == '^') {
+      negate = true;
+      position_++;
+    }
+
+    // Empty classes are left to std::regex.
+    if (done() || peek() == ']') {
+      return nullptr;
+    }
+
+    ByteClass byte_class{};
+    while (!done() && peek() != ']') {
+      unsigned char low = 0;
+      bool set = false;
+      if (!parseClassAtom(low, byte_class, set)) {
+        return nullptr;
+      }
+
+      bool range = position_ + 1 < pattern_.size() && peek() == '-' &&
+                   pattern_[position_ + 1] != ']';
+      if (!range) {
+        if (!set) {
+          byte_class[low] = true;
+        }
+        continue;
+      }
+
+      position_++;
+      unsigned char high = 0;
+      bool high_set = false;
+      if (!parseClassAtom(high, byte_class, high_set)) {
+        return nullptr;
+      }
+
+      // Ranges of class escapes, of non-ASCII bytes, or reversed ranges are
+      // left to std::regex.
+      if (set || high_set || low > high || high >= 0x80) {
+        return nullptr;
+      }
+      for (size_t i = low; i <= high; i++) {
+        byte_class[i] = true;
+      }
+    }
+
+    if (done()) {
+      return nullptr;
+    }
+    position_++;
+
+    if (negate) {
+      for (auto& member : byte_class) {
+        member = !member;
+      }
+    }
+    return makeClass(byte_class);
+  }
+
+ private:
+  const std::string& pattern_;
+  std::vector<ByteClass>& classes_;
+  size_t position_{0};
+  size_t groups_{0};
+};
+
+/// Emit the Pike VM program of a parsed pattern.
+class LinearRegex::Compiler {
+ public:
+  explicit Compiler(std::vector<Instruction>& program) : program_(program) {}
+
+  bool emit(const Node& node) {
+    if (program_.size() > kMaxProgramSize) {
+      return false;
+    }
+
+    switch (node.type) {
+    case Node::Type::BYTE:
+      add(Op::BYTE, node.arg);
+      return true;
+    case Node::Type::ANY:
+      add(Op::ANY);
+      return true;
+    case Node::Type::CLASS:
+      add(Op::CLASS, node.arg);
+      return true;
+    case Node::Type::ASSERT:
+      add(Op::ASSERT, node.arg);
+      return true;
+    case Node::Type::CONCAT:
+      for (const auto& child : node.children) {
+        if (!emit(*child)) {
+          return false;
+        }
+      }
+      return true;
+    case Node::Type::GROUP:
+      if (node.group == 0) {
+        return emit(*node.children[0]);
+      }
+      add(Op::SAVE, static_cast<uint32_t>(node.group * 2));
+      if (!emit(*node.children[0])) {
+        return false;
+      }
+      add(Op::SAVE, static_cast<uint32_t>(node.group * 2 + 1));
+      return true;
+    case Node::Type::ALTERNATE:
+      return emitAlternate(node);
+    case Node::Type::REPEAT:
+      return emitRepeat(node);
+    }
+    return false;
+  }
+
+ private:
+  uint32_t add(Op op, uint32_t arg = 0, uint32_t x = 0, uint32_t y = 0) {
+    program_.push_back({op, arg, x, y});
+    return static_cast<uint32_t>(program_.size() - 1);
+  }
+
+  uint32_t next() const {
+    return static_cast<uint32_t>(program_.size());
+  }
+
+  /// Set the branches of a split, the preferred branch first.
+  void setSplit(uint32_t split, uint32_t preferred, uint32_t other) {
+    program_[split].x = preferred;
+    program_[split].y = other;
+  }
+
+  bool emitAlternate(const Node& node) {
+    std::vector<uint32_t> jumps;
+    for (size_t i = 0; i < node.children.size(); i++) {
+      bool last = (i + 1 == node.children.size());
+      uint32_t split = 0;
+      if (!last) {
+        split = add(Op::SPLIT);
+      }
+      auto start = next();
+      if (!emit(*node.children[i])) {
+        return false;
+      }
+      if (!last) {
+        jumps.push_back(add(Op::JUMP));
+        setSplit(split, start, next());
+      }
+    }
+
+    for (auto jump : jumps) {
+      program_[jump].x = next();
+    }
+    return true;
+  }
+
+  /// Emit one iteration of a repeat, clearing the captures of the body.
+  bool emitIteration(const Node& node) {
+    if (node.end_group > node.first_group) {
+      add(Op::RESET,
+          static_cast<uint32_t>(node.first_group * 2),
+          0,
+          static_cast<uint32_t>(node.end_group * 2));
+    }
+    return emit(*node.children[0]);
+  }
+
+  bool emitRepeat(const Node& node) {
+    for (int i = 0; i < node.min; i++) {
+      if (!emitIteration(node)) {
+        return false;
+      }
+    }
+
+    if (node.max == -1) {
+      auto split = add(Op::SPLIT);
+      auto body = next();
+      if (!emitIteration(node)) {
+        return false;
+      }
+      add(Op::JUMP, 0, split);
+      node.greedy ? setSplit(split, body, next())
+                  : setSplit(split, next(), body);
+      return true;
+    }
+
+    std::vector<uint32_t> splits;
+    for (int i = node.min; i < node.max; i++) {
+      splits.push_back(add(Op::SPLIT));
+      if (!emitIteration(node)) {
+        return false;
+      }
+    }
+
+    for (auto split : splits) {
+      node.greedy ? setSplit(split, split + 1, next())
+                  : setSplit(split, next(), split + 1);
+    }
+    return true;
+  }
+
+ private:
+  std::vector<Instruction>& program_;
+};
+
+/// The threads of a Pike VM step, at most one per instruction.
+struct LinearRegex::ThreadList {
+  /// Prepare the list for a search, keeping the allocated storage.
+  void reset(size_t program_size, size_t slot_count) {
+    slots = slot_count;
+    pcs.clear();
+    pcs.reserve(program_size);
+    seen.assign(program_size, 0);
+    generation = 1;
+    captures.resize(program_size * slots);
+  }
+
+  void clear() {
+    pcs.clear();
+    generation++;
+  }
+
+  size_t slots{0};
+
+  /// Instructions of the threads, in priority order.
+  std::vector<uint32_t> pcs;
+
+  /// The generation an instruction was last visited in.
+  std::vector<uint32_t> seen;
+  uint32_t generation{1};
+
+  /// Capture slots of each thread, indexed by instruction.
+  std::vector<std::ptrdiff_t> captures;
+};
+
+std::unique_ptr<LinearRegex> LinearRegex::compile(const std::string& pattern) {
+  std::unique_ptr<LinearRegex> regex(new LinearRegex());
+  Parser parser(pattern, regex->classes_);
+  auto node = parser.parse();
+  if (node == nullptr) {
+    return nullptr;
+  }
+  regex->groups_ = parser.groups();
+
+  auto& program = regex->program_;
+  Compiler compiler(program);
+  program.push_back({Op::SAVE, 0, 0, 0});
+  if (!compiler.emit(*node) || program.size() > kMaxProgramSize) {
+    return nullptr;
+  }
+  program.push_back({Op::SAVE, 1, 0, 0});
+  program.push_back({Op::MATCH, 0, 0, 0});
+  regex->computeFirstBytes();
+  return regex;
+}
+
+void LinearRegex::computeFirstBytes() {
+  // Follow the empty transitions from the start, assertions only narrow the
+  // positions where a match starts so they are followed too.
+  std::vector<bool> seen(program_.size(), false);
+  std::vector<uint32_t> pending = {0};
+  ByteClass first_bytes{};
+  while (!pending.empty()) {
+    auto pc = pending.back();
+    pending.pop_back();
+    if (seen[pc]) {
+      continue;
+    }
+    seen[pc] = true;
+
+    const auto& instruction = program_[pc];
+    switch (instruction.op) {
+    case Op::MATCH:
+      // The pattern matches the empty string anywhere.
+      return;
+    case Op::BYTE:
+      first_bytes[instruction.arg] = true;
+      break;
+    case Op::ANY:
+      for (size_t i = 0; i < first_bytes.size(); i++) {
+        first_bytes[i] = first_bytes[i] || (i != '\n' && i != '\r');
+      }
+      break;
+    case Op::CLASS:
+      for (size_t i = 0; i < first_bytes.size(); i++) {
+        first_bytes[i] = first_bytes[i] || classes_[instruction.arg][i];
+      }
+      break;
+    case Op::JUMP:
+      pending.push_back(instruction.x);
+      break;
+    case Op::SPLIT:
+      pending.push_back(instruction.x);
+      pending.push_back(instruction.y);
+      break;
+    default:
+      pending.push_back(pc + 1);
+      break;
+    }
+  }
+
+  first_bytes_ = first_bytes;
+  has_first_bytes_ = true;
+}
+
+void LinearRegex::addThread(ThreadList& list,
+                            uint32_t pc,
+                            const char* data,
+                            size_t size,
+                            size_t position,
+                            std::ptrdiff_t* captures) const {
+  if (list.seen[pc] == list.generation) {
+    return;
+  }
+  list.seen[pc] = list.generation;
+
+  const auto& instruction = program_[pc];
+  switch (instruction.op) {
+  case Op::JUMP:
+    addThread(list, instruction.x, data, size, position, captures);
+    return;
+  case Op::SPLIT:
+    addThread(list, instruction.x, data, size, position, captures);
+    addThread(list, instruction.y, data, size, position, captures);
+    return;
+  case Op::SAVE: {
+    auto saved = captures[instruction.arg];
+    captures[instruction.arg] = static_cast<std::ptrdiff_t>(position);
+    addThread(list, pc + 1, data, size, position, captures);
+    captures[instruction.arg] = saved;
+    return;
+  }
+  case Op::RESET: {
+    std::vector<std::ptrdiff_t> saved(captures + instruction.arg,
+                                      captures + instruction.y);
+    std::fill(captures + instruction.arg, captures + instruction.y, -1);
+    addThread(list, pc + 1, data, size, position, captures);
+    std::copy(saved.begin(), saved.end(), captures + instruction.arg);
+    return;
+  }
+  case Op::ASSERT: {
+    bool before = position > 0 &&
+                  isWordByte(static_cast<unsigned char>(data[position - 1]));
+    bool after = position < size &&
+                 isWordByte(static_cast<unsigned char>(data[position]));
+    bool passed = false;
+    switch (static_cast<Assertion>(instruction.arg)) {
+    case Assertion::BEGIN:
+      passed = (position == 0);
+      break;
+    case Assertion::END:
+      passed = (position == size);
+      break;
+    case Assertion::WORD_BOUNDARY:
+      passed = (before != after);
+      break;
+    case Assertion::NOT_WORD_BOUNDARY:
+      passed = (before == after);
+      break;
+    }
+    if (passed) {
+      addThread(list, pc + 1, data, size, position, captures);
+    }
+    return;
+  }
+  default:
+    list.pcs.push_back(pc);
+    std::copy(captures,
+              captures + list.slots,
+              list.captures.begin() + pc * list.slots);
+    return;
+  }
+}
+
+bool LinearRegex::search(const char* data,
+                         size_t size,
+                         size_t offset,
+                         bool anchored,
+                         bool not_null,
+                         std::vector<std::ptrdiff_t>& captures) const {
+  auto slots = (groups_ + 1) * 2;
+  // Searches on a thread reuse the storage of its previous search.
+  thread_local ThreadList current;
+  thread_local ThreadList following;
+  thread_local std::vector<std::ptrdiff_t> working;
+  current.reset(program_.size(), slots);
+  following.reset(program_.size(), slots);
+  working.assign(slots, -1);
+  bool matched = false;
+
+  for (auto position = offset; position <= size; position++) {
+    if (!matched && (position == offset || !anchored)) {
+      if (current.pcs.empty() && has_first_bytes_ && !anchored) {
+        // Without running threads, skip to the next byte that may start a
+        // match.
+        auto start = position;
+        while (position < size &&
+               !first_bytes_[static_cast<unsigned char>(data[position])]) {
+          position++;
+        }
+        if (position == size) {
+          break;
+        }
+        if (position != start) {
+          current.clear();
+        }
+      }
+
+      // A thread starting here has a lower priority than the running threads.
+      std::fill(working.begin(), working.end(), -1);
+      addThread(current, 0, data, size, position, working.data());
+    }
+
+    if (current.pcs.empty() && (matched || anchored)) {
+      break;
+    }
+
+    following.clear();
+    unsigned char c =
+        (position < size) ? static_cast<unsigned char>(data[position]) : 0;
+    for (auto pc : current.pcs) {
+      const auto& instruction = program_[pc];
+      const auto* thread = current.captures.data() + pc * slots;
+      bool step = false;
+      switch (instruction.op) {
+      case Op::MATCH:
+        if (not_null && thread[0] == static_cast<std::ptrdiff_t>(position)) {
+          continue;
+        }
+        matched = true;
+        captures.assign(thread, thread + slots);
+        break;
+      case Op::BYTE:
+        step = position < size && c == instruction.arg;
+        break;
+      case Op::ANY:
+        step = position < size && c != '\n' && c != '\r';
+        break;
+      case Op::CLASS:
+        step = position < size && classes_[instruction.arg][c];
+        break;
+      default:
+        break;
+      }
+
+      if (instruction.op == Op::MATCH) {
+        // Threads after a match have a lower priority.
+        break;
+      }
+
+      if (step) {
+        std::copy(thread, thread + slots, working.begin());
+        addThread(following, pc + 1, data, size, position + 1, working.data());
+      }
+    }
+
+    std::swap(current, following);
+  }
+
+  return matched;
+}
+
+} // namespace osquery
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace osquery {
+
+/**
+ * @brief A regular expression matched in time linear to the input size.
+ *
+ * Patterns are compiled to a program for a Pike VM, which simulates every
+ * alternative of the pattern in lockstep over the input instead of
+ * backtracking. A search costs O(input size * program size), pathological
+ * patterns such as "(a*)*b" cannot take exponential time.
+ *
+ * The syntax is the ECMAScript subset without backtracking-only features:
+ * literals, '.', character classes with ranges and the \d \w \s escapes,
+ * capturing and (?:) groups, alternation, greedy and lazy quantifiers, and
+ * the ^ $ \b \B assertions. Matches are leftmost-first, like std::regex,
+ * but a group repeated by a quantifier only reports a capture from an
+ * iteration that consumed input.
+ * Patterns using other features, such as backreferences or lookaheads, are
+ * not compiled and callers should use std::regex instead.
+ */
+class LinearRegex {
+ public:
+  /**
+   * @brief Compile a pattern.
+   *
+   * @return nullptr if the pattern is invalid or uses unsupported syntax.
+   */
+  static std::unique_ptr<LinearRegex> compile(const std::string& pattern);
+
+  /// The number of capturing groups, not counting the whole match.
+  size_t groups() const {
+    return groups_;
+  }
+
+  /**
+   * @brief Search for the leftmost match within an input.
+   *
+   * @param data the input, searched from offset to size.
+   * @param size the input size.
+   * @param offset the position to start searching from.
+   * @param anchored only match at the offset.
+   * @param not_null do not accept an empty match.
+   * @param captures [output] begin and end positions of the match and of each
+   * group, -1 for a group that did not participate.
+   * @return true if a match was found.
+   */
+  bool search(const char* data,
+              size_t size,
+              size_t offset,
+              bool anchored,
+              bool not_null,
+              std::vector<std::ptrdiff_t>& captures) const;
+
+ private:
+  enum class Op : uint8_t {
+    BYTE,
+    ANY,
+    CLASS,
+    MATCH,
+    JUMP,
+    SPLIT,
+    SAVE,
+    RESET,
+    ASSERT,
+  };
+
+  enum class Assertion : uint8_t {
+    BEGIN,
+    END,
+    WORD_BOUNDARY,
+    NOT_WORD_BOUNDARY,
+  };
+
+  struct Instruction {
+    Op op;
+
+    /// The byte, class index, capture slot or assertion of the instruction.
+    uint32_t arg{0};
+
+    /// Jump target, or the preferred branch of a split.
+    uint32_t x{0};
+
+    /// The other branch of a split, or the end slot of a reset.
+    uint32_t y{0};
+  };
+
+  using ByteClass = std::array<bool, 256>;
+
+  struct Node;
+  class Parser;
+  class Compiler;
+  struct ThreadList;
+
+  LinearRegex() = default;
+
+  /// Compute the bytes that may start a match.
+  void computeFirstBytes();
+
+  /// Follow the empty transitions from pc and add the reached threads.
+  void addThread(ThreadList& list,
+                 uint32_t pc,
+                 const char* data,
+                 size_t size,
+                 size_t position,
+                 std::ptrdiff_t* captures) const;
+
+ private:
+  std::vector<Instruction> program_;
+  std::vector<ByteClass> classes_;
+  size_t groups_{0};
+
+  /// Bytes that may start a match, unset if the pattern matches empty.
+  ByteClass first_bytes_{};
+  bool has_first_bytes_{false};
+};
+
+} // namespace osquery
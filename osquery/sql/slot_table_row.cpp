@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <cstring>
+
+#include "slot_table_row.h"
+#include "virtual_table.h"
+
+#include <osquery/logger/logger.h>
+#include <osquery/utils/conversions/castvariant.h>
+#include <osquery/utils/conversions/tryto.h>
+
+namespace rj = rapidjson;
+
+namespace osquery {
+
+SlotTableRow::SlotTableRow(std::shared_ptr<VirtualTableContent> content)
+    : content_(std::move(content)) {
+  if (content_ != nullptr) {
+    slots_.resize(content_->columns.size());
+  }
+}
+
+std::unique_ptr<SlotTableRow> SlotTableRow::acquire(QueryContext& context) {
+  if (context.row_recycler != nullptr) {
+    auto* row = dynamic_cast<SlotTableRow*>(context.row_recycler->get());
+    if (row != nullptr && row->content_ == context.table_) {
+      context.row_recycler->release();
+      row->clear();
+      return std::unique_ptr<SlotTableRow>(row);
+    }
+  }
+
+  return std::make_unique<SlotTableRow>(context.table_);
+}
+
+void SlotTableRow::clear() {
+  for (auto& slot : slots_) {
+    slot.type = SlotType::NONE;
+  }
+}
+
+SlotTableRow::Slot& SlotTableRow::slot(size_t column) {
+  if (column >= slots_.size()) {
+    slots_.resize(column + 1);
+  }
+  return slots_[column];
+}
+
+void SlotTableRow::setInteger(size_t column, long long value) {
+  auto& s = slot(column);
+  s.type = SlotType::INTEGER;
+  s.integer = value;
+}
+
+void SlotTableRow::setDouble(size_t column, double value) {
+  auto& s = slot(column);
+  s.type = SlotType::DOUBLE;
+  s.real = value;
+}
+
+void SlotTableRow::setText(size_t column, const std::string& value) {
+  setText(column, value.data(), value.size());
+}
+
+void SlotTableRow::setText(size_t column, const char* value) {
+  setText(column, value, std::strlen(value));
+}
+
+void SlotTableRow::setText(size_t column, const char* value, size_t size) {
+  auto& s = slot(column);
+  s.type = SlotType::TEXT;
+  // Assigning keeps the string capacity of the reused slot.
+  s.text.assign(value, size);
+}
+
+void SlotTableRow::setNull(size_t column) {
+  slot(column).type = SlotType::NONE;
+}
+
+const std::string* SlotTableRow::columnName(size_t column) const {
+  if (content_ == nullptr || column >= content_->columns.size()) {
+    return nullptr;
+  }
+  return &std::get<0>(content_->columns[column]);
+}
+
+std::string SlotTableRow::slotString(const Slot& slot) {
+  // Format values as the typed rows are formatted when cast to Row.
+  static const CastVisitor visitor;
+  switch (slot.type) {
+  case SlotType::INTEGER:
+    return visitor(slot.integer);
+  case SlotType::DOUBLE:
+    return visitor(slot.real);
+  case SlotType::TEXT:
+    return slot.text;
+  default:
+    return "";
+  }
+}
+
+SlotTableRow::operator Row() const {
+  Row row;
+  for (size_t i = 0; i < slots_.size(); i++) {
+    const auto* name = columnName(i);
+    if (name != nullptr && slots_[i].type != SlotType::NONE) {
+      row[*name] = slotString(slots_[i]);
+    }
+  }
+  return row;
+}
+
+int SlotTableRow::get_rowid(sqlite_int64 default_value,
+                            sqlite_int64* pRowid) const {
+  *pRowid = default_value;
+  for (size_t i = 0; i < slots_.size(); i++) {
+    const auto* name = columnName(i);
+    if (name == nullptr || *name != "rowid") {
+      continue;
+    }
+
+    const auto& slot = slots_[i];
+    if (slot.type == SlotType::INTEGER) {
+      *pRowid = slot.integer;
+    } else if (slot.type == SlotType::TEXT) {
+      auto exp = tryTo<long long>(slot.text, 10);
+      if (exp.isError()) {
+        VLOG(1) << "Invalid rowid value returned " << exp.getError();
+        return SQLITE_ERROR;
+      }
+      *pRowid = exp.take();
+    }
+    break;
+  }
+  return SQLITE_OK;
+}
+
+int SlotTableRow::get_column(sqlite3_context* ctx,
+                             sqlite3_vtab* vtab,
+                             int col) {
+  const auto* pVtab = (VirtualTable*)vtab;
+  auto index = static_cast<size_t>(col);
+  if (!pVtab->content->aliases.empty()) {
+    // Aliased columns read the slot of the column they alias.
+    const auto& column_name = std::get<0>(pVtab->content->columns[index]);
+    auto alias = pVtab->content->aliases.find(column_name);
+    if (alias != pVtab->content->aliases.end()) {
+      index = alias->second;
+    }
+  }
+
+  if (index >= slots_.size()) {
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
+
+  const auto& slot = slots_[index];
+  switch (slot.type) {
+  case SlotType::INTEGER:
+    sqlite3_result_int64(ctx, slot.integer);
+    break;
+  case SlotType::DOUBLE:
+    sqlite3_result_double(ctx, slot.real);
+    break;
+  case SlotType::TEXT:
+    sqlite3_result_text(ctx,
+                        slot.text.c_str(),
+                        static_cast<int>(slot.text.size()),
+                        SQLITE_TRANSIENT);
+    break;
+  default:
+    sqlite3_result_null(ctx);
+    break;
+  }
+  return SQLITE_OK;
+}
+
+Status SlotTableRow::serialize(JSON& doc, rj::Value& obj) const {
+  for (size_t i = 0; i < slots_.size(); i++) {
+    const auto* name = columnName(i);
+    if (name != nullptr && slots_[i].type != SlotType::NONE) {
+      doc.addCopy(*name, slotString(slots_[i]), obj);
+    }
+  }
+
+  return Status::success();
+}
+
+TableRowHolder SlotTableRow::clone() const {
+  auto row = std::make_unique<SlotTableRow>(content_);
+  row->slots_ = slots_;
+  return TableRowHolder(row.release());
+}
+
+} // namespace osquery
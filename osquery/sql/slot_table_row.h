@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osquery/core/sql/table_row.h>
+#include <osquery/core/tables.h>
+#include <osquery/utils/json/json.h>
+
+namespace osquery {
+
+/**
+ * @brief A TableRow backed by a typed, column-indexed slot array.
+ *
+ * Slots are addressed by the position of the column in the table's columns()
+ * definition, which is the same index SQLite passes to xColumn. Generator
+ * tables should obtain rows with SlotTableRow::acquire, which hands back the
+ * row consumed by the previous xNext. Reusing the row keeps the slot array
+ * and the capacity of each text slot, so a steady-state scan yields rows
+ * without allocating.
+ *
+ * The value is returned to SQLite with the slot's type, a table must use the
+ * setter matching the declared column type.
+ */
+class SlotTableRow : public TableRow {
+ public:
+  explicit SlotTableRow(std::shared_ptr<VirtualTableContent> content);
+  SlotTableRow(const SlotTableRow&) = delete;
+  SlotTableRow& operator=(const SlotTableRow&) = delete;
+
+  /**
+   * @brief Return an empty row for a generator to fill and yield.
+   *
+   * If the cursor has released the previously yielded row it is cleared and
+   * reused, otherwise a new row is allocated.
+   */
+  static std::unique_ptr<SlotTableRow> acquire(QueryContext& context);
+
+  /// Mark every slot as NULL while keeping the slot storage.
+  void clear();
+
+  void setInteger(size_t column, long long value);
+  void setDouble(size_t column, double value);
+  void setText(size_t column, const std::string& value);
+  void setText(size_t column, const char* value);
+  void setText(size_t column, const char* value, size_t size);
+
+  /// Mark a single slot as NULL.
+  void setNull(size_t column);
+
+  explicit operator Row() const override;
+  int get_rowid(sqlite_int64 default_value,
+                sqlite_int64* pRowid) const override;
+  int get_column(sqlite3_context* ctx, sqlite3_vtab* pVtab, int col) override;
+  Status serialize(JSON& doc, rapidjson::Value& obj) const override;
+  TableRowHolder clone() const override;
+
+ private:
+  enum class SlotType { NONE, INTEGER, DOUBLE, TEXT };
+
+  struct Slot {
+    SlotType type{SlotType::NONE};
+    long long integer{0};
+    double real{0};
+    std::string text;
+  };
+
+  /// Return the slot for a column, growing the slot array if needed.
+  Slot& slot(size_t column);
+
+  /// Return the name of a column, or nullptr if the column is unknown.
+  const std::string* columnName(size_t column) const;
+
+  /// Convert a slot into the string representation used by Row.
+  static std::string slotString(const Slot& slot);
+
+ private:
+  /// Table content, provides column names for the Row conversions.
+  std::shared_ptr<VirtualTableContent> content_;
+
+  std::vector<Slot> slots_;
+};
+
+} // namespace osquery
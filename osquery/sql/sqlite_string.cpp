@@ -16,13 +16,18 @@
 #endif
 
 #include <functional>
+#include <list>
+#include <memory>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <osquery/core/flags.h>
 #include <osquery/logger/logger.h>
+#include <osquery/sql/linear_regex.h>
 #include <osquery/utils/conversions/split.h>
+#include <osquery/utils/mutex.h>
 
 #include <sqlite3.h>
 
@@ -35,6 +40,162 @@ HIDDEN_FLAG(
     "Defines the maximum size in bytes of a regex that can be used with the "
     "regex_match and regex_split functions");
 
+HIDDEN_FLAG(bool,
+            regex_linear_engine,
+            true,
+            "Match regex_match and regex_split patterns in linear time, "
+            "patterns using other syntax fall back to std::regex");
+
+namespace {
+
+/// Number of compiled patterns kept by the process-wide cache.
+const size_t kRegexCacheSize{64};
+
+/**
+ * @brief A pattern compiled for the regex_match and regex_split functions.
+ *
+ * The linear-time engine is used when enabled and the pattern is within its
+ * supported syntax, otherwise the pattern is compiled with std::regex.
+ */
+class CompiledRegex {
+ public:
+  /// Compile a pattern, throws std::regex_error if the pattern is invalid.
+  CompiledRegex(const std::string& pattern, bool linear) {
+    if (linear) {
+      linear_ = LinearRegex::compile(pattern);
+    }
+    if (linear_ == nullptr) {
+      regex_ = std::regex(pattern);
+    }
+  }
+
+  /**
+   * @brief Search for the leftmost match from an offset within the input.
+   *
+   * Captures are the absolute begin and end positions of the match and each
+   * group, -1 for a group that did not participate.
+   */
+  bool search(const char* data,
+              size_t size,
+              size_t offset,
+              bool anchored,
+              bool not_null,
+              std::vector<std::ptrdiff_t>& captures) const {
+    if (linear_ != nullptr) {
+      return linear_->search(data, size, offset, anchored, not_null, captures);
+    }
+
+    auto flags = std::regex_constants::match_default;
+    if (offset > 0) {
+      flags |= std::regex_constants::match_prev_avail;
+    }
+    if (anchored) {
+      flags |= std::regex_constants::match_continuous;
+    }
+    if (not_null) {
+      flags |= std::regex_constants::match_not_null;
+    }
+
+    std::cmatch results;
+    if (!std::regex_search(
+            data + offset, data + size, results, regex_, flags)) {
+      return false;
+    }
+
+    captures.assign(results.size() * 2, -1);
+    for (size_t i = 0; i < results.size(); i++) {
+      if (results[i].matched) {
+        captures[i * 2] = results[i].first - data;
+        captures[i * 2 + 1] = results[i].second - data;
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::unique_ptr<LinearRegex> linear_;
+  std::regex regex_;
+};
+
+using CompiledRegexRef = std::shared_ptr<const CompiledRegex>;
+
+/// A bounded least-recently-used cache of compiled patterns.
+class RegexCache {
+ public:
+  static RegexCache& get() {
+    static RegexCache instance;
+    return instance;
+  }
+
+  /// Return the compiled pattern, throws std::regex_error if it is invalid.
+  CompiledRegexRef compile(const std::string& pattern) {
+    // The engine is part of the key, the flag may change at runtime.
+    auto key = (FLAGS_regex_linear_engine ? 'l' : 's') + pattern;
+    {
+      WriteLock lock(mutex_);
+      auto it = index_.find(key);
+      if (it != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+      }
+    }
+
+    // Compile without holding the lock, a concurrent miss compiles twice.
+    auto regex = std::make_shared<const CompiledRegex>(
+        pattern, FLAGS_regex_linear_engine);
+
+    WriteLock lock(mutex_);
+    if (index_.count(key) == 0) {
+      entries_.emplace_front(key, regex);
+      index_[key] = entries_.begin();
+      if (entries_.size() > kRegexCacheSize) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+      }
+    }
+    return regex;
+  }
+
+ private:
+  using Entry = std::pair<std::string, CompiledRegexRef>;
+
+  /// Compiled patterns, most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  Mutex mutex_;
+};
+
+} // namespace
+
+/**
+ * @brief Return the compiled pattern of a function argument.
+ *
+ * The pattern is kept as SQLite auxiliary data, a statement evaluating the
+ * function over many rows with a constant pattern compiles it once. Other
+ * statements share the compiled patterns of the process-wide cache.
+ *
+ * Throws std::regex_error if the pattern is invalid.
+ */
+static CompiledRegexRef getCompiledRegex(sqlite3_context* context,
+                                         int argument,
+                                         const char* pattern,
+                                         size_t size) {
+  auto* cached =
+      static_cast<CompiledRegexRef*>(sqlite3_get_auxdata(context, argument));
+  if (cached != nullptr) {
+    return *cached;
+  }
+
+  auto regex = RegexCache::get().compile(std::string(pattern, size));
+  sqlite3_set_auxdata(context,
+                      argument,
+                      new CompiledRegexRef(regex),
+                      [](void* data) {
+                        delete static_cast<CompiledRegexRef*>(data);
+                      });
+  return regex;
+}
+
 using SplitResult = std::vector<std::string>;
 using StringSplitFunction = std::function<SplitResult(
     const std::string& input, const std::string& tokens)>;
@@ -59,39 +220,6 @@ static SplitResult tokenSplit(const std::string& input,
   return osquery::split(input, tokens);
 }
 
-/**
- * @brief A regex SQLite column string split implementation.
- *
- * Split a column value using a single or multi-character token and select an
- * expected index. The token input is considered a regex.
- *
- * Example:
- *   1. SELECT ip_address from addresses;
- *      192.168.0.1
- *   2. SELECT SPLIT(ip_address, "\.", 1) from addresses;
- *      168
- *   3. SELECT SPLIT(ip_address, "\.0", 0) from addresses;
- *      192.168
- */
-static SplitResult regexSplit(const std::string& input,
-                              const std::string& token) {
-  // Split using the token as a regex to support multi-character tokens.
-  // Exceptions are caught by the caller, as that's where the sql context is
-  std::vector<std::string> result;
-
-  if (token.size() > FLAGS_regex_max_size) {
-    throw std::regex_error(std::regex_constants::error_complexity);
-  }
-
-  std::regex pattern = std::regex(token);
-  std::sregex_token_iterator iter_begin(
-      input.begin(), input.end(), pattern, -1);
-  std::sregex_token_iterator iter_end;
-  std::copy(iter_begin, iter_end, std::back_inserter(result));
-
-  return result;
-}
-
 static void callStringSplitFunc(sqlite3_context* context,
                                 int argc,
                                 sqlite3_value** argv,
@@ -136,15 +264,101 @@ static void tokenStringSplitFunc(sqlite3_context* context,
   callStringSplitFunc(context, argc, argv, tokenSplit);
 }
 
+/**
+ * @brief A regex SQLite column string split implementation.
+ *
+ * Split a column value using a single or multi-character token and select an
+ * expected index. The token input is considered a regex.
+ *
+ * Example:
+ *   1. SELECT ip_address from addresses;
+ *      192.168.0.1
+ *   2. SELECT SPLIT(ip_address, "\.", 1) from addresses;
+ *      168
+ *   3. SELECT SPLIT(ip_address, "\.0", 0) from addresses;
+ *      192.168
+ */
 static void regexStringSplitFunc(sqlite3_context* context,
                                  int argc,
                                  sqlite3_value** argv) {
+  assert(argc == 3);
+  if (SQLITE_NULL == sqlite3_value_type(argv[0]) ||
+      SQLITE_NULL == sqlite3_value_type(argv[1]) ||
+      SQLITE_NULL == sqlite3_value_type(argv[2])) {
+    sqlite3_result_null(context);
+    return;
+  }
+
+  // Parse and verify the split input parameters.
+  const auto* input =
+      reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+  auto input_size = static_cast<size_t>(sqlite3_value_bytes(argv[0]));
+  const auto* token =
+      reinterpret_cast<const char*>(sqlite3_value_text(argv[1]));
+  auto token_size = static_cast<size_t>(sqlite3_value_bytes(argv[1]));
+  auto index = static_cast<size_t>(sqlite3_value_int(argv[2]));
+
+  if (token_size == 0) {
+    // Empty input string is an error
+    sqlite3_result_error(context, "Invalid input to split function", -1);
+    return;
+  }
+
+  CompiledRegexRef regex;
   try {
-    callStringSplitFunc(context, argc, argv, regexSplit);
+    if (token_size > FLAGS_regex_max_size) {
+      throw std::regex_error(std::regex_constants::error_complexity);
+    }
+    regex = getCompiledRegex(context, 1, token, token_size);
   } catch (const std::regex_error& e) {
     LOG(INFO) << "Invalid regex: " << e.what();
     sqlite3_result_error(context, "Invalid regex", -1);
+    return;
   }
+
+  // Walk the tokens between matches like std::sregex_token_iterator, until
+  // the selected index. An empty match is followed by a non-empty match at
+  // the same position, or by a search from the next position.
+  std::vector<std::ptrdiff_t> captures;
+  size_t count = 0;
+  size_t token_begin = 0;
+  auto found = regex->search(input, input_size, 0, false, false, captures);
+  while (found) {
+    auto match_begin = static_cast<size_t>(captures[0]);
+    auto match_end = static_cast<size_t>(captures[1]);
+    if (count++ == index) {
+      sqlite3_result_text(context,
+                          input + token_begin,
+                          static_cast<int>(match_begin - token_begin),
+                          SQLITE_TRANSIENT);
+      return;
+    }
+
+    token_begin = match_end;
+    auto start = match_end;
+    if (match_begin == match_end) {
+      if (start == input_size) {
+        break;
+      }
+      if (regex->search(input, input_size, start, true, true, captures)) {
+        continue;
+      }
+      start++;
+    }
+    found = regex->search(input, input_size, start, false, false, captures);
+  }
+
+  // The remaining input is the last token, unless it is empty after a match.
+  if (count == index && (count == 0 || token_begin < input_size)) {
+    sqlite3_result_text(context,
+                        input + token_begin,
+                        static_cast<int>(input_size - token_begin),
+                        SQLITE_TRANSIENT);
+    return;
+  }
+
+  // Could emit a warning about a selected index that is out of bounds.
+  sqlite3_result_null(context);
 }
 
 /**
@@ -169,16 +383,15 @@ static void regexStringMatchFunc(sqlite3_context* context,
     sqlite3_result_null(context);
     return;
   }
+  auto regex_size = static_cast<size_t>(sqlite3_value_bytes(argv[1]));
 
   // parse and verify input parameters
-  const std::string input(
-      reinterpret_cast<const char*>(sqlite3_value_text(argv[0])));
-  std::smatch results;
+  const auto* input =
+      reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+  auto input_size = static_cast<size_t>(sqlite3_value_bytes(argv[0]));
   auto index = static_cast<size_t>(sqlite3_value_int(argv[2]));
-  bool isMatchFound = false;
 
-  if (strnlen(regex, FLAGS_regex_max_size) == FLAGS_regex_max_size &&
-      regex[FLAGS_regex_max_size] != '\0') {
+  if (regex_size > FLAGS_regex_max_size) {
     std::string error = "Invalid regex: too big, max size is " +
                         std::to_string(FLAGS_regex_max_size) + " bytes";
     LOG(INFO) << error;
@@ -186,8 +399,12 @@ static void regexStringMatchFunc(sqlite3_context* context,
     return;
   }
 
+  std::vector<std::ptrdiff_t> captures;
+  bool isMatchFound = false;
   try {
-    isMatchFound = std::regex_search(input, results, std::regex(regex));
+    auto compiled = getCompiledRegex(context, 1, regex, regex_size);
+    isMatchFound =
+        compiled->search(input, input_size, 0, false, false, captures);
   } catch (const std::regex_error& e) {
     LOG(INFO) << "Invalid regex: " << e.what();
     sqlite3_result_error(context, "Invalid regex", -1);
@@ -199,14 +416,20 @@ static void regexStringMatchFunc(sqlite3_context* context,
     return;
   }
 
-  if (index >= results.size()) {
+  if (index * 2 >= captures.size()) {
     sqlite3_result_null(context);
     return;
   }
 
+  // A group that did not participate in the match is an empty string.
+  auto begin = captures[index * 2];
+  auto end = captures[index * 2 + 1];
+  if (begin < 0) {
+    begin = end = 0;
+  }
   sqlite3_result_text(context,
-                      results[index].str().c_str(),
-                      static_cast<int>(results[index].str().size()),
+                      input + begin,
+                      static_cast<int>(end - begin),
                       SQLITE_TRANSIENT);
 }
 
@@ -39,6 +39,11 @@ FLAG(string,
 
 FLAG(string, nullvalue, "", "Set string for NULL values, default ''");
 
+FLAG(uint64,
+     sqlite_pool_size,
+     4,
+     "Number of pre-attached SQLite connections for concurrent callers");
+
 using OpReg = QueryPlanner::Opcode::Register;
 
 using SQLiteDBInstanceRef = std::shared_ptr<SQLiteDBInstance>;
@@ -181,10 +186,14 @@ Status SQLiteSQLPlugin::getQueryTables(const std::string& query,
   return Status(0);
 }
 
-SQLInternal::SQLInternal(const std::string& query, bool use_cache) {
-  auto dbc = SQLiteDBManager::get();
+SQLInternal::SQLInternal(const std::string& query, bool use_cache)
+    : SQLInternal(query, SQLiteDBManager::get(), use_cache) {}
+
+SQLInternal::SQLInternal(const std::string& query,
+                         const SQLiteDBInstanceRef& dbc,
+                         bool use_cache) {
   dbc->useCache(use_cache);
-  status_ = queryInternal(query, resultsTyped_, dbc);
+  status_ = queryInternal(query, results_, dbc);
 
   // One of the advantages of using SQLInternal (aside from the Registry-bypass)
   // is the ability to "deep-inspect" the table attributes and actions.
@@ -193,8 +202,8 @@ SQLInternal::SQLInternal(const std::string& query, bool use_cache) {
   dbc->clearAffectedTables();
 }
 
-QueryDataTyped& SQLInternal::rowsTyped() {
-  return resultsTyped_;
+QueryDataColumnar& SQLInternal::rows() {
+  return results_;
 }
 
 const Status& SQLInternal::getStatus() const {
@@ -225,11 +234,9 @@ class StringEscaperVisitor : public boost::static_visitor<> {
 
 void SQLInternal::escapeResults() {
   StringEscaperVisitor visitor;
-  for (auto& rowTyped : resultsTyped_) {
-    for (auto& column : rowTyped) {
-      boost::apply_visitor(visitor, column.second);
-    }
-  }
+  results_.forEachValue([&visitor](RowDataTyped& value) {
+    boost::apply_visitor(visitor, value);
+  });
 }
 
 Status SQLiteSQLPlugin::attach(const std::string& name) {
@@ -249,7 +256,11 @@ Status SQLiteSQLPlugin::attach(const std::string& name) {
   auto dbc = SQLiteDBManager::getConnection(true);
 
   // Attach as an extension, allowing read/write tables
-  return attachTableInternal(name, statement, dbc, is_extension);
+  status = attachTableInternal(name, statement, dbc, is_extension);
+  if (status.ok()) {
+    SQLiteDBManager::instance().attachPooled(name, statement, is_extension);
+  }
+  return status;
 }
 
 Status SQLiteSQLPlugin::detach(const std::string& name) {
@@ -257,6 +268,7 @@ Status SQLiteSQLPlugin::detach(const std::string& name) {
   // primary database. To allow this, getConnection can explicitly request the
   // primary instance and avoid the contention decisions.
   auto dbc = SQLiteDBManager::getConnection(true);
+  SQLiteDBManager::instance().detachPooled(name);
   return detachTableInternal(name, dbc);
 }
 
@@ -356,6 +368,17 @@ bool SQLiteDBInstance::tableCalled(VirtualTableContent const& table) {
   return (affected_tables_.count(table.name) > 0);
 }
 
+std::shared_ptr<const TableRows> SQLiteDBInstance::getMemoizedScan(
+    const std::string& key) const {
+  auto it = memoized_scans_.find(key);
+  return (it != memoized_scans_.end()) ? it->second : nullptr;
+}
+
+void SQLiteDBInstance::memoizeScan(const std::string& key,
+                                   std::shared_ptr<const TableRows> rows) {
+  memoized_scans_[key] = std::move(rows);
+}
+
 TableAttributes SQLiteDBInstance::getAttributes() const {
   const SQLiteDBInstance* rdbc = this;
   if (isPrimary() && !managed_) {
@@ -387,6 +410,7 @@ void SQLiteDBInstance::clearAffectedTables() {
   // Since the affected tables are cleared, there are no more affected tables.
   // There is no concept of compounding tables between queries.
   affected_tables_.clear();
+  memoized_scans_.clear();
   use_cache_ = false;
 }
 
@@ -443,14 +467,16 @@ bool SQLiteDBManager::isDisabled(const std::string& table_name) {
 void SQLiteDBManager::resetPrimary() {
   auto& self = instance();
 
-  WriteLock connection_lock(self.mutex_);
-  self.connection_.reset();
-
   {
+    WriteLock connection_lock(self.mutex_);
+    self.connection_.reset();
+
     WriteLock create_lock(self.create_mutex_);
     sqlite3_close(self.db_);
     self.db_ = nullptr;
   }
+
+  self.resetPool();
 }
 
 void SQLiteDBManager::setDisabledTables(const std::string& list) {
@@ -473,30 +499,131 @@ SQLiteDBInstanceRef SQLiteDBManager::getUnique() {
 
 SQLiteDBInstanceRef SQLiteDBManager::getConnection(bool primary) {
   auto& self = instance();
-  WriteLock lock(self.create_mutex_);
 
-  if (self.db_ == nullptr) {
-    // Create primary SQLite DB instance.
-    openOptimized(self.db_);
-    self.connection_ = SQLiteDBInstanceRef(new SQLiteDBInstance(self.db_));
-    attachVirtualTables(self.connection_);
-  }
+  {
+    WriteLock lock(self.create_mutex_);
+
+    if (self.db_ == nullptr) {
+      // Create primary SQLite DB instance.
+      openOptimized(self.db_);
+      self.connection_ = SQLiteDBInstanceRef(new SQLiteDBInstance(self.db_));
+      attachVirtualTables(self.connection_);
+    }
+
+    // Internal usage may request the primary connection explicitly.
+    if (primary) {
+      return self.connection_;
+    }
 
-  // Internal usage may request the primary connection explicitly.
-  if (primary) {
-    return self.connection_;
+    // Create a 'database connection' for the managed database instance.
+    WriteLock primary_lock(self.mutex_, boost::try_to_lock);
+    if (primary_lock.owns_lock()) {
+      return SQLiteDBInstanceRef(
+          new SQLiteDBInstance(self.db_, std::move(primary_lock)));
+    }
   }
 
-  // Create a 'database connection' for the managed database instance.
-  auto instance = std::make_shared<SQLiteDBInstance>(self.db_, self.mutex_);
-  if (!instance->isPrimary()) {
-    attachVirtualTables(instance);
+  // The primary is in use, prefer an idle pre-attached connection.
+  auto pooled = self.checkoutPooled();
+  if (pooled != nullptr) {
+    return pooled;
   }
 
+  VLOG(1) << "DBManager contention: opening transient SQLite database";
+  auto instance = std::make_shared<SQLiteDBInstance>();
+  attachVirtualTables(instance);
   return instance;
 }
 
+void SQLiteDBManager::createPool() {
+  WriteLock lock(pool_mutex_);
+  if (pool_ready_) {
+    return;
+  }
+
+  pool_size_ = static_cast<size_t>(FLAGS_sqlite_pool_size);
+  pool_.reset(new PooledConnection[pool_size_]);
+  for (size_t i = 0; i < pool_size_; i++) {
+    pool_[i].instance = std::make_shared<SQLiteDBInstance>();
+    attachVirtualTables(pool_[i].instance);
+  }
+  pool_ready_ = true;
+}
+
+SQLiteDBInstanceRef SQLiteDBManager::checkoutPooled() {
+  if (FLAGS_sqlite_pool_size == 0) {
+    return nullptr;
+  }
+
+  if (!pool_ready_.load(std::memory_order_acquire)) {
+    createPool();
+  }
+
+  for (size_t i = 0; i < pool_size_; i++) {
+    auto* slot = &pool_[i];
+    bool expected = false;
+    if (!slot->in_use.compare_exchange_strong(expected, true)) {
+      continue;
+    }
+
+    // The returned reference aliases the pooled instance, releasing it returns
+    // the connection to the pool instead of closing the database.
+    return SQLiteDBInstanceRef(slot->instance.get(),
+                               [slot](SQLiteDBInstance* instance) {
+                                 instance->clearAffectedTables();
+                                 slot->in_use.store(false);
+                               });
+  }
+  return nullptr;
+}
+
+void SQLiteDBManager::attachPooled(const std::string& name,
+                                   const std::string& statement,
+                                   bool is_extension) {
+  WriteLock lock(pool_mutex_);
+  if (!pool_ready_) {
+    // The pool will attach every registered table when it is created.
+    return;
+  }
+
+  for (size_t i = 0; i < pool_size_; i++) {
+    // The instance attach lock protects connections that are checked out.
+    attachTableInternal(name, statement, pool_[i].instance, is_extension);
+  }
+}
+
+void SQLiteDBManager::detachPooled(const std::string& name) {
+  WriteLock lock(pool_mutex_);
+  if (!pool_ready_) {
+    return;
+  }
+
+  for (size_t i = 0; i < pool_size_; i++) {
+    detachTableInternal(name, pool_[i].instance);
+  }
+}
+
+void SQLiteDBManager::resetPool() {
+  WriteLock lock(pool_mutex_);
+  if (!pool_ready_) {
+    return;
+  }
+
+  for (size_t i = 0; i < pool_size_; i++) {
+    // Connections that are checked out keep their arena until the next reset.
+    bool expected = false;
+    if (!pool_[i].in_use.compare_exchange_strong(expected, true)) {
+      continue;
+    }
+
+    pool_[i].instance = std::make_shared<SQLiteDBInstance>();
+    attachVirtualTables(pool_[i].instance);
+    pool_[i].in_use.store(false);
+  }
+}
+
 SQLiteDBManager::~SQLiteDBManager() {
+  pool_.reset();
   connection_ = nullptr;
   if (db_ != nullptr) {
     sqlite3_close(db_);
@@ -579,28 +706,36 @@ Status QueryPlanner::applyTypes(TableColumns& columns) {
   return Status(0);
 }
 
-// Wrapper for legacy method until all uses can be replaced
-Status queryInternal(const std::string& query,
-                     QueryData& results,
-                     const SQLiteDBInstanceRef& instance) {
-  QueryDataTyped typedResults;
-  Status status = queryInternal(query, typedResults, instance);
-  if (status.ok()) {
-    results.reserve(typedResults.size());
-    for (const auto& row : typedResults) {
-      Row r;
-      for (const auto& col : row) {
-        r[col.first] = castVariant(col.second);
-      }
-      results.push_back(std::move(r));
-    }
+/// Read the typed value of a column of the current result row.
+static inline RowDataTyped readColumn(sqlite3_stmt* prepared_statement,
+                                      int i) {
+  switch (sqlite3_column_type(prepared_statement, i)) {
+  case SQLITE_INTEGER:
+    return static_cast<long long>(sqlite3_column_int64(prepared_statement, i));
+  case SQLITE_FLOAT:
+    return sqlite3_column_double(prepared_statement, i);
+  case SQLITE_NULL:
+    return FLAGS_nullvalue;
+  default:
+    // Everything else (SQLITE_TEXT, SQLITE3_TEXT, SQLITE_BLOB) is
+    // obtained/conveyed as text/string
+    return std::string(reinterpret_cast<const char*>(
+        sqlite3_column_text(prepared_statement, i)));
   }
-  return status;
 }
 
-Status readRows(sqlite3_stmt* prepared_statement,
-                QueryDataTyped& results,
-                const SQLiteDBInstanceRef& instance) {
+/**
+ * @brief Step through and finalize a prepared statement.
+ *
+ * The column names are passed to the columns callback once, before the first
+ * row. The row callback is then called with the statement positioned on each
+ * result row.
+ */
+template <typename ColumnsCallback, typename RowCallback>
+static Status readStatement(sqlite3_stmt* prepared_statement,
+                            const SQLiteDBInstanceRef& instance,
+                            ColumnsCallback on_columns,
+                            RowCallback on_row) {
   // Do nothing with a null prepared_statement (eg, if the sql was just
   // whitespace)
   if (prepared_statement == nullptr) {
@@ -611,34 +746,20 @@ Status readRows(sqlite3_stmt* prepared_statement,
   if (SQLITE_ROW == rc) {
     // First collect the column names
     int num_columns = sqlite3_column_count(prepared_statement);
-    std::vector<std::string> colNames;
+    ColumnNames colNames;
     colNames.reserve(num_columns);
     for (int i = 0; i < num_columns; i++) {
       colNames.push_back(sqlite3_column_name(prepared_statement, i));
     }
 
+    auto status = on_columns(std::move(colNames));
+    if (!status.ok()) {
+      sqlite3_finalize(prepared_statement);
+      return status;
+    }
+
     do {
-      RowTyped row;
-      for (int i = 0; i < num_columns; i++) {
-        switch (sqlite3_column_type(prepared_statement, i)) {
-        case SQLITE_INTEGER:
-          row[colNames[i]] = static_cast<long long>(
-              sqlite3_column_int64(prepared_statement, i));
-          break;
-        case SQLITE_FLOAT:
-          row[colNames[i]] = sqlite3_column_double(prepared_statement, i);
-          break;
-        case SQLITE_NULL:
-          row[colNames[i]] = FLAGS_nullvalue;
-          break;
-        default:
-          // Everything else (SQLITE_TEXT, SQLITE3_TEXT, SQLITE_BLOB) is
-          // obtained/conveyed as text/string
-          row[colNames[i]] = std::string(reinterpret_cast<const char*>(
-              sqlite3_column_text(prepared_statement, i)));
-        }
-      }
-      results.push_back(std::move(row));
+      on_row(prepared_statement, num_columns);
       rc = sqlite3_step(prepared_statement);
     } while (SQLITE_ROW == rc);
   }
@@ -656,9 +777,60 @@ Status readRows(sqlite3_stmt* prepared_statement,
   return Status::success();
 }
 
-Status queryInternal(const std::string& query,
-                     QueryDataTyped& results,
-                     const SQLiteDBInstanceRef& instance) {
+Status readRows(sqlite3_stmt* prepared_statement,
+                QueryDataColumnar& results,
+                const SQLiteDBInstanceRef& instance) {
+  return readStatement(
+      prepared_statement,
+      instance,
+      [&results](ColumnNames colNames) {
+        // Resolve the column names once for every row of this statement, a
+        // statement selecting other columns starts rows with a new schema.
+        if (results.schema() == nullptr ||
+            results.schema()->names() != colNames) {
+          results.setSchema(
+              std::make_shared<const ColumnSchema>(std::move(colNames)));
+        }
+        return Status::success();
+      },
+      [&results](sqlite3_stmt* stmt, int num_columns) {
+        auto* row = results.addRow();
+        for (int i = 0; i < num_columns; i++) {
+          row[i] = readColumn(stmt, i);
+        }
+      });
+}
+
+Status readRows(sqlite3_stmt* prepared_statement,
+                QueryDataTyped& results,
+                const SQLiteDBInstanceRef& instance) {
+  ColumnNames names;
+  return readStatement(
+      prepared_statement,
+      instance,
+      [&names](ColumnNames colNames) {
+        names = std::move(colNames);
+        return Status::success();
+      },
+      [&results, &names](sqlite3_stmt* stmt, int num_columns) {
+        RowTyped row;
+        for (int i = 0; i < num_columns; i++) {
+          row[names[i]] = readColumn(stmt, i);
+        }
+        results.push_back(std::move(row));
+      });
+}
+
+/**
+ * @brief Prepare and step through each statement of a query.
+ *
+ * The reader is called with each prepared statement and is responsible for
+ * stepping and finalizing it.
+ */
+template <typename Reader>
+static Status queryStatements(const std::string& query,
+                              const SQLiteDBInstanceRef& instance,
+                              Reader reader) {
   sqlite3_stmt* prepared_statement{nullptr}; /* Statement to execute. */
 
   int rc = SQLITE_OK; /* Return Code */
@@ -681,7 +853,7 @@ Status queryInternal(const std::string& query,
       return s;
     }
 
-    Status s = readRows(prepared_statement, results, instance);
+    Status s = reader(prepared_statement);
     if (!s.ok()) {
       return s;
     }
@@ -692,6 +864,50 @@ Status queryInternal(const std::string& query,
   return Status::success();
 }
 
+// Wrapper for legacy method until all uses can be replaced
+Status queryInternal(const std::string& query,
+                     QueryData& results,
+                     const SQLiteDBInstanceRef& instance) {
+  // Rows are built directly as strings, each statement may select different
+  // columns.
+  return queryStatements(
+      query, instance, [&results, &instance](sqlite3_stmt* stmt) {
+        ColumnNames names;
+        return readStatement(
+            stmt,
+            instance,
+            [&names](ColumnNames colNames) {
+              names = std::move(colNames);
+              return Status::success();
+            },
+            [&results, &names](sqlite3_stmt* stmt, int num_columns) {
+              Row row;
+              for (int i = 0; i < num_columns; i++) {
+                row[names[i]] = castVariant(readColumn(stmt, i));
+              }
+              results.push_back(std::move(row));
+            });
+      });
+}
+
+Status queryInternal(const std::string& query,
+                     QueryDataColumnar& results,
+                     const SQLiteDBInstanceRef& instance) {
+  return queryStatements(
+      query, instance, [&results, &instance](sqlite3_stmt* stmt) {
+        return readRows(stmt, results, instance);
+      });
+}
+
+Status queryInternal(const std::string& query,
+                     QueryDataTyped& results,
+                     const SQLiteDBInstanceRef& instance) {
+  return queryStatements(
+      query, instance, [&results, &instance](sqlite3_stmt* stmt) {
+        return readRows(stmt, results, instance);
+      });
+}
+
 Status getQueryColumnsInternal(const std::string& q,
                                TableColumns& columns,
                                const SQLiteDBInstanceRef& instance) {
@@ -11,7 +11,9 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <sqlite3.h>
@@ -19,6 +21,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <osquery/core/sql/query_data_columnar.h>
+#include <osquery/core/sql/table_rows.h>
 #include <osquery/sql/sql.h>
 
 #include <osquery/utils/mutex.h>
@@ -123,6 +127,22 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Check if a virtual table had been called already.
   bool tableCalled(VirtualTableContent const& table);
 
+  /**
+   * @brief Share the rows of an earlier scan of a memoizable table.
+   *
+   * Scans are memoized until the affected tables are cleared, at the end of
+   * the statement, see TableAttributes::MEMOIZABLE.
+   *
+   * @param key identifies the table, the constraints and the used columns.
+   * @return nullptr if no such scan was memoized.
+   */
+  std::shared_ptr<const TableRows> getMemoizedScan(
+      const std::string& key) const;
+
+  /// Keep the rows of a scan of a memoizable table, they are not copied.
+  void memoizeScan(const std::string& key,
+                   std::shared_ptr<const TableRows> rows);
+
   /// Request that virtual tables use a warm cache for their results.
   void useCache(bool use_cache);
 
@@ -141,6 +161,10 @@ class SQLiteDBInstance : private boost::noncopyable {
   explicit SQLiteDBInstance(sqlite3* db)
       : primary_(true), managed_(true), db_(db) {}
 
+  /// Wrap the primary database using an already-acquired lock.
+  SQLiteDBInstance(sqlite3* db, WriteLock&& lock)
+      : primary_(true), db_(db), lock_(std::move(lock)) {}
+
  private:
   /// Introspection into the database pointer, primary means managed.
   bool primary_{false};
@@ -177,6 +201,10 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Vector of tables that need their constraints cleared after execution.
   std::map<std::string, std::shared_ptr<VirtualTableContent>> affected_tables_;
 
+  /// Rows of the memoizable table scans, cleared with the affected tables.
+  std::unordered_map<std::string, std::shared_ptr<const TableRows>>
+      memoized_scans_;
+
  private:
   friend class SQLiteDBManager;
   friend class SQLInternal;
@@ -282,6 +310,47 @@ class SQLiteDBManager : private boost::noncopyable {
   /// Request a connection, optionally request the primary connection.
   static SQLiteDBInstanceRef getConnection(bool primary = false);
 
+  /// Check out an idle pooled connection, or nullptr if all are in use.
+  SQLiteDBInstanceRef checkoutPooled();
+
+  /// Open and attach the pooled connections, called on first contention.
+  void createPool();
+
+  /// Replay a table attach to every pooled connection.
+  void attachPooled(const std::string& name,
+                    const std::string& statement,
+                    bool is_extension);
+
+  /// Replay a table detach to every pooled connection.
+  void detachPooled(const std::string& name);
+
+  /// Re-open each idle pooled connection.
+  void resetPool();
+
+ private:
+  /**
+   * @brief A pre-attached connection owned by the connection pool.
+   *
+   * A connection is checked out by atomically claiming `in_use`, it is
+   * returned when the last reference to the checked out instance is released.
+   */
+  struct PooledConnection {
+    SQLiteDBInstanceRef instance{nullptr};
+    std::atomic<bool> in_use{false};
+  };
+
+  /// Fixed set of pooled connections, allocated once and never resized.
+  std::unique_ptr<PooledConnection[]> pool_{nullptr};
+
+  /// Number of pooled connections.
+  size_t pool_size_{0};
+
+  /// Set once the pooled connections are opened and attached.
+  std::atomic<bool> pool_ready_{false};
+
+  /// Serializes pool creation, reset, and attach/detach replay.
+  Mutex pool_mutex_;
+
  private:
   friend class SQLiteDBInstance;
   friend class SQLiteSQLPlugin;
@@ -392,6 +461,23 @@ Status queryInternal(const std::string& q,
                      QueryData& results,
                      const SQLiteDBInstanceRef& instance);
 
+/**
+ * @brief SQLite Internal: Execute a query into a columnar result set
+ *
+ * Column names are resolved once per statement and values are stored in a
+ * contiguous, column-indexed buffer. The rows of each statement of a
+ * multi-statement query keep the columns the statement selected.
+ *
+ * @param q the query to execute
+ * @param results The QueryDataColumnar to emit rows on query success.
+ * @param db the SQLite3 database to execute query q against
+ *
+ * @return A status indicating SQL query results.
+ */
+Status queryInternal(const std::string& q,
+                     QueryDataColumnar& results,
+                     const SQLiteDBInstanceRef& instance);
+
 /**
  * @brief SQLite Intern: Analyze a query, providing information about the
  * result columns
@@ -413,7 +499,7 @@ Status getQueryColumnsInternal(const std::string& q,
 
 /**
  * @brief SQLInternal: like SQL, but backed by internal calls, and deals
- * with QueryDataTyped results.
+ * with QueryDataColumnar results.
  */
 class SQLInternal : private only_movable {
  public:
@@ -425,13 +511,27 @@ class SQLInternal : private only_movable {
    */
   explicit SQLInternal(const std::string& query, bool use_cache = false);
 
+  /**
+   * @brief Instantiate an instance of the class using a specific connection.
+   *
+   * Callers that own a long-lived connection, such as scheduler workers, use
+   * this to avoid contending on the primary database.
+   *
+   * @param query An osquery SQL query.
+   * @param instance The SQLite connection to execute the query against.
+   * @param use_cache [optional] Set true to use the query cache.
+   */
+  SQLInternal(const std::string& query,
+              const SQLiteDBInstanceRef& instance,
+              bool use_cache = false);
+
  public:
   /**
    * @brief Const accessor for the rows returned by the query.
    *
-   * @return A QueryDataTyped object of the query results.
+   * @return A QueryDataColumnar object of the query results.
    */
-  QueryDataTyped& rowsTyped();
+  QueryDataColumnar& rows();
 
   const Status& getStatus() const;
 
@@ -453,7 +553,7 @@ class SQLInternal : private only_movable {
 
  private:
   /// The internal member which holds the typed results of the query.
-  QueryDataTyped resultsTyped_;
+  QueryDataColumnar results_;
 
   /// The internal member which holds the status of the query.
   Status status_;
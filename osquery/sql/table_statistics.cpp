@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <osquery/sql/table_statistics.h>
+
+namespace osquery {
+
+/// The average follows the last scans, tables change over time.
+const size_t kStatisticsWindow{8};
+
+/// Bound the memory of tables queried with many constraint combinations.
+const size_t kMaxScanKeys{64};
+
+TableStatistics& TableStatistics::get() {
+  static TableStatistics instance;
+  return instance;
+}
+
+std::string TableStatistics::scanKey(const ConstraintSet& constraints) {
+  std::vector<std::string> terms;
+  terms.reserve(constraints.size());
+  for (const auto& constraint : constraints) {
+    terms.push_back(constraint.first + ":" +
+                    std::to_string(constraint.second.op));
+  }
+  std::sort(terms.begin(), terms.end());
+
+  std::string key;
+  for (const auto& term : terms) {
+    key += term;
+    key += ',';
+  }
+  return key;
+}
+
+void TableStatistics::record(const std::string& table,
+                             const std::string& scan_key,
+                             size_t rows) {
+  WriteLock lock(mutex_);
+  auto& scans = tables_[table];
+  auto it = scans.find(scan_key);
+  if (it == scans.end()) {
+    if (scans.size() >= kMaxScanKeys) {
+      return;
+    }
+    it = scans.emplace(scan_key, Scan()).first;
+  }
+
+  auto& scan = it->second;
+  scan.count = std::min(scan.count + 1, kStatisticsWindow);
+  scan.rows += (static_cast<double>(rows) - scan.rows) / scan.count;
+}
+
+bool TableStatistics::rows(const std::string& table,
+                           const std::string& scan_key,
+                           double& rows) const {
+  ReadLock lock(mutex_);
+  auto table_it = tables_.find(table);
+  if (table_it == tables_.end()) {
+    return false;
+  }
+
+  auto it = table_it->second.find(scan_key);
+  if (it == table_it->second.end()) {
+    return false;
+  }
+
+  rows = it->second.rows;
+  return true;
+}
+
+void TableStatistics::clear() {
+  WriteLock lock(mutex_);
+  tables_.clear();
+}
+} // namespace osquery
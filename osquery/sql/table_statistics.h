@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core/tables.h>
+#include <osquery/utils/mutex.h>
+
+namespace osquery {
+
+/**
+ * @brief Row counts observed from virtual table scans.
+ *
+ * Every xFilter records the rows a table generated for its set of
+ * constrained columns, and xBestIndex reads them back to estimate the rows
+ * and the cost of a plan. A table that is cheap to scan is then placed in the
+ * outer loop of a join, instead of an expensive one being generated again for
+ * each of its rows.
+ */
+class TableStatistics : private boost::noncopyable {
+ public:
+  static TableStatistics& get();
+
+  /// Identify a set of constrained columns and operators, in any order.
+  static std::string scanKey(const ConstraintSet& constraints);
+
+  /// Record the rows returned by a scan.
+  void record(const std::string& table,
+              const std::string& scan_key,
+              size_t rows);
+
+  /**
+   * @brief Get the average rows returned by the recent scans.
+   *
+   * @return false if no such scan was observed.
+   */
+  bool rows(const std::string& table,
+            const std::string& scan_key,
+            double& rows) const;
+
+  /// Forget every observation.
+  void clear();
+
+ private:
+  TableStatistics() = default;
+
+  struct Scan {
+    double rows{0};
+    size_t count{0};
+  };
+
+ private:
+  mutable Mutex mutex_;
+  std::unordered_map<std::string, std::unordered_map<std::string, Scan>>
+      tables_;
+};
+} // namespace osquery
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <osquery/sql/linear_regex.h>
+
+#include <gtest/gtest.h>
+
+namespace osquery {
+
+class LinearRegexTests : public testing::Test {
+ protected:
+  /// Format the match and groups of a search, or "nomatch".
+  static std::string search(const LinearRegex& regex,
+                            const std::string& input) {
+    std::vector<std::ptrdiff_t> captures;
+    if (!regex.search(
+            input.data(), input.size(), 0, false, false, captures)) {
+      return "nomatch";
+    }
+
+    std::string result;
+    for (size_t i = 0; i < captures.size(); i += 2) {
+      if (captures[i] < 0) {
+        result += "[-]";
+        continue;
+      }
+      result += "[" + input.substr(captures[i], captures[i + 1] - captures[i]) +
+                "@" + std::to_string(captures[i]) + "]";
+    }
+    return result;
+  }
+
+  /// Format the same search with std::regex.
+  static std::string searchStd(const std::string& pattern,
+                               const std::string& input) {
+    std::smatch results;
+    if (!std::regex_search(input, results, std::regex(pattern))) {
+      return "nomatch";
+    }
+
+    std::string result;
+    for (size_t i = 0; i < results.size(); i++) {
+      if (!results[i].matched) {
+        result += "[-]";
+        continue;
+      }
+      result += "[" + results[i].str() + "@" +
+                std::to_string(results.position(i)) + "]";
+    }
+    return result;
+  }
+};
+
+TEST_F(LinearRegexTests, test_matches_std_regex) {
+  const std::vector<std::string> patterns = {
+      "",
+      "|",
+      "(l)(o).*",
+      "(\\w+) .*(or|ld)",
+      ".+/([^./]+)",
+      "^/usr/(s?bin)/",
+      "--config_path=([^ ]+)",
+      "(a|ab)(c|bcd)(d*)",
+      "x*?y",
+      "a{2,3}?",
+      "(?:ab){2}",
+      "\\bworld\\b",
+      "\\Bor",
+      "[\\d.]+$",
+      "(a)|(b)",
+      "\\x2f[a-c-]",
+      "[^\\s/]+\\.conf",
+  };
+  const std::vector<std::string> inputs = {
+      "",
+      "hello world",
+      "/usr/sbin/sshd -D",
+      "/filesystem/path/download.extension.zip",
+      "--flagfile=/etc/osquery.flags --config_path=/etc/osquery.conf",
+      "abcd",
+      "xxxy",
+      "aaaa",
+      "ababab",
+      "version 1.2.3",
+      "b",
+      "/a-/c",
+      "path /etc/osquery.conf\n",
+  };
+
+  for (const auto& pattern : patterns) {
+    auto regex = LinearRegex::compile(pattern);
+    ASSERT_NE(regex, nullptr) << pattern;
+    for (const auto& input : inputs) {
+      EXPECT_EQ(search(*regex, input), searchStd(pattern, input))
+          << pattern << " on " << input;
+    }
+  }
+}
+
+TEST_F(LinearRegexTests, test_unsupported) {
+  // Invalid patterns and syntax outside of the subset are not compiled.
+  EXPECT_EQ(LinearRegex::compile("(/"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("+"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("a{3,2}"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("(a)\\1"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("a(?=b)"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("[[:alpha:]]"), nullptr);
+  EXPECT_EQ(LinearRegex::compile("a{100000}"), nullptr);
+}
+
+TEST_F(LinearRegexTests, test_search_offset) {
+  auto regex = LinearRegex::compile("a*");
+  ASSERT_NE(regex, nullptr);
+
+  std::string input = "baab";
+  std::vector<std::ptrdiff_t> captures;
+  ASSERT_TRUE(regex->search(
+      input.data(), input.size(), 1, false, false, captures));
+  EXPECT_EQ(captures, std::vector<std::ptrdiff_t>({1, 3}));
+
+  // An anchored search does not skip ahead to the next match.
+  EXPECT_FALSE(
+      regex->search(input.data(), input.size(), 3, true, true, captures));
+  ASSERT_TRUE(
+      regex->search(input.data(), input.size(), 0, true, false, captures));
+  EXPECT_EQ(captures, std::vector<std::ptrdiff_t>({0, 0}));
+}
+
+TEST_F(LinearRegexTests, test_linear_time) {
+  // Exponential for a backtracking matcher.
+  auto regex = LinearRegex::compile("(a*)*b");
+  ASSERT_NE(regex, nullptr);
+
+  std::string input(100000, 'a');
+  std::vector<std::ptrdiff_t> captures;
+  EXPECT_FALSE(
+      regex->search(input.data(), input.size(), 0, false, false, captures));
+}
+
+} // namespace osquery
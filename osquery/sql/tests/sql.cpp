@@ -265,6 +265,29 @@ TEST_F(SQLTests, test_regex_match_too_big) {
             0);
 }
 
+TEST_F(SQLTests, test_regex_match_backreference) {
+  QueryData d;
+  // Backreferences are matched by std::regex.
+  query("select regex_match('abab', '(ab)\\1', 0) as test", d);
+  ASSERT_EQ(d.size(), 1U);
+  EXPECT_EQ(d[0]["test"], "abab");
+}
+
+TEST_F(SQLTests, test_regex_match_rows) {
+  QueryData d;
+  // The pattern is compiled once and matched against each row.
+  query(
+      "select regex_match(value, '--config_path=([^ ]+)', 1) as path from "
+      "(select '--verbose --config_path=/a.conf' as value union all "
+      "select '--config_path=/b.conf --verbose' union all "
+      "select '--verbose') order by path",
+      d);
+  ASSERT_EQ(d.size(), 3U);
+  EXPECT_EQ(d[0]["path"], "");
+  EXPECT_EQ(d[1]["path"], "/a.conf");
+  EXPECT_EQ(d[2]["path"], "/b.conf");
+}
+
 /*
  * split
  */
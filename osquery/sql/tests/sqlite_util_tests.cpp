@@ -11,6 +11,7 @@
 #include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/registry/registry_interface.h>
+#include <osquery/sql/dynamic_table_row.h>
 #include <osquery/sql/sql.h>
 #include <osquery/sql/sqlite_util.h>
 #include <osquery/sql/tests/sql_test_utils.h>
@@ -96,6 +97,30 @@ TEST_F(SQLiteUtilTests, test_sqlite_instance) {
   EXPECT_EQ(internal_db, SQLiteDBManager::get()->db());
 }
 
+TEST_F(SQLiteUtilTests, test_sqlite_connection_pool) {
+  // Hold the primary so the following requests use the connection pool.
+  auto primary = SQLiteDBManager::get();
+  EXPECT_TRUE(primary->isPrimary());
+
+  sqlite3* pooled_db = nullptr;
+  {
+    auto pooled = SQLiteDBManager::get();
+    EXPECT_FALSE(pooled->isPrimary());
+    EXPECT_NE(pooled->db(), primary->db());
+    pooled_db = pooled->db();
+
+    // Pooled connections have the virtual tables attached.
+    QueryDataTyped results;
+    EXPECT_TRUE(queryInternal("select * from time", results, pooled).ok());
+    EXPECT_EQ(results.size(), 1U);
+    pooled->clearAffectedTables();
+  }
+
+  // The released connection is returned to the pool and reused.
+  auto pooled = SQLiteDBManager::get();
+  EXPECT_EQ(pooled->db(), pooled_db);
+}
+
 TEST_F(SQLiteUtilTests, test_reset) {
   auto internal_db = SQLiteDBManager::get()->db();
   ASSERT_NE(nullptr, internal_db);
@@ -124,6 +149,40 @@ TEST_F(SQLiteUtilTests, test_direct_query_execution) {
   EXPECT_EQ(results, getTestDBExpectedResults());
 }
 
+TEST_F(SQLiteUtilTests, test_direct_query_execution_columnar) {
+  auto dbc = getTestDBC();
+  QueryDataColumnar results;
+  auto status = queryInternal(kTestQuery, results, dbc);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(results.toQueryDataTyped(), getTestDBExpectedResults());
+
+  // Columns are resolved once and looked up by name from the shared schema.
+  ASSERT_FALSE(results.empty());
+  EXPECT_NE(results[0].find("username"), nullptr);
+  EXPECT_EQ(results[0].find("not_a_column"), nullptr);
+}
+
+TEST_F(SQLiteUtilTests, test_multiple_statements_columnar) {
+  auto dbc = getTestDBC();
+  QueryDataColumnar results;
+  auto status = queryInternal(
+      "SELECT 1 AS a, 'x' AS b; SELECT 2 AS c; SELECT 3 AS a, 'y' AS b;",
+      results,
+      dbc);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+
+  // Each statement keeps the columns it selected.
+  QueryDataTyped expected = {
+      {{"a", 1LL}, {"b", "x"}},
+      {{"c", 2LL}},
+      {{"a", 3LL}, {"b", "y"}},
+  };
+  EXPECT_EQ(results.toQueryDataTyped(), expected);
+  ASSERT_EQ(results.size(), 3U);
+  EXPECT_EQ(results[1].find("a"), nullptr);
+  EXPECT_NE(results[2].find("b"), nullptr);
+}
+
 TEST_F(SQLiteUtilTests, test_aggregate_query) {
   auto dbc = getTestDBC();
   QueryDataTyped results;
@@ -185,6 +244,23 @@ TEST_F(SQLiteUtilTests, test_affected_tables) {
   EXPECT_EQ(dbc->affected_tables_.size(), 0U);
 }
 
+TEST_F(SQLiteUtilTests, test_memoized_scans_are_shared) {
+  auto dbc = getTestDBC();
+  EXPECT_EQ(dbc->getMemoizedScan("scan"), nullptr);
+
+  TableRows rows;
+  rows.push_back(make_table_row());
+  auto memoized = std::make_shared<const TableRows>(std::move(rows));
+  dbc->memoizeScan("scan", memoized);
+
+  // Every later scan shares the memoized rows rather than a copy.
+  EXPECT_EQ(dbc->getMemoizedScan("scan"), memoized);
+  EXPECT_EQ(dbc->getMemoizedScan("scan"), memoized);
+
+  dbc->clearAffectedTables();
+  EXPECT_EQ(dbc->getMemoizedScan("scan"), nullptr);
+}
+
 TEST_F(SQLiteUtilTests, test_table_attributes_event_based) {
   {
     SQLInternal sql_internal("select * from process_events");
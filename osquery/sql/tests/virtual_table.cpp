@@ -7,15 +7,21 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <set>
+
 #include <gtest/gtest.h>
 
 #include <osquery/core/core.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry.h>
 #include <osquery/sql/dynamic_table_row.h>
+#include <osquery/sql/slot_table_row.h>
 #include <osquery/sql/sql.h>
+#include <osquery/sql/table_statistics.h>
 
 #include <osquery/sql/virtual_table.h>
 
@@ -192,6 +198,7 @@ TEST_F(VirtualTableTests, test_tableplugin_aliases) {
       {{"id", "columnAlias"}, {"name", "name2"}, {"target", "name"}},
       {{"id", "columnAlias"}, {"name", "user_name"}, {"target", "username"}},
       {{"attributes", "0"}, {"id", "attributes"}},
+      {{"id", "generateChunk"}, {"version", "1"}},
   };
   EXPECT_EQ(response, expected_response);
 
@@ -681,6 +688,76 @@ TEST_F(VirtualTableTests, test_yield_generator) {
   EXPECT_EQ(results[0]["index"], "10");
 }
 
+class slotYieldTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("index", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("ratio", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  bool usesGenerator() const override {
+    return true;
+  }
+
+  void generator(RowYield& yield, QueryContext& qc) override {
+    for (size_t i = 0; i < 10; i++) {
+      auto r = SlotTableRow::acquire(qc);
+      rows_.insert(r.get());
+      r->setInteger(0, static_cast<long long>(i));
+      if (i % 2 == 0) {
+        r->setText(1, "row_" + std::to_string(i));
+      }
+      r->setDouble(2, 0.5);
+      yield(std::move(r));
+    }
+  }
+
+ public:
+  std::set<const SlotTableRow*> rows_;
+};
+
+TEST_F(VirtualTableTests, test_yield_slot_rows) {
+  auto table = std::make_shared<slotYieldTablePlugin>();
+  auto table_registry = RegistryFactory::get().registry("table");
+  table_registry->add("slot_yield", table);
+
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal("slot_yield", table->columnDefinition(false), dbc, false);
+
+  QueryData results;
+  queryInternal("SELECT * from slot_yield", results, dbc);
+  dbc->clearAffectedTables();
+  ASSERT_EQ(results.size(), 10U);
+  EXPECT_EQ(results[0]["index"], "0");
+  EXPECT_EQ(results[0]["name"], "row_0");
+  EXPECT_EQ(results[0]["ratio"], "0.5");
+  EXPECT_EQ(results[9]["index"], "9");
+
+  // Odd rows did not set the name, the reused slot must read as NULL.
+  EXPECT_EQ(results[1]["name"], "");
+
+  // Every consumed row was handed back to the generator.
+  EXPECT_EQ(table->rows_.size(), 1U);
+
+  // Rows generated for a plugin request are named by the table's columns.
+  PluginResponse response;
+  ASSERT_TRUE(table->call({{"action", "generate_chunk"}}, response).ok());
+  ASSERT_EQ(response.size(), 1U);
+
+  ColumnDictionary dictionary;
+  ASSERT_TRUE(dictionary.deserialize(response[0]["columns"]).ok());
+  QueryData rows;
+  ASSERT_TRUE(
+      deserializeColumnChunk(response[0]["data"], dictionary, rows).ok());
+  ASSERT_EQ(rows.size(), 10U);
+  EXPECT_EQ(rows[0]["name"], "row_0");
+  EXPECT_EQ(rows[0]["ratio"], "0.5");
+}
+
 class likeTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
@@ -1192,6 +1269,198 @@ TEST_F(VirtualTableTests, test_noindex_constraints) {
   ASSERT_EQ("0", results[1]["straints"]);
 }
 
+class statisticsTablePlugin : public TablePlugin {
+ public:
+  explicit statisticsTablePlugin(size_t rows) : rows_(rows) {}
+
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("value", INTEGER_TYPE, ColumnOptions::INDEX),
+    };
+  }
+
+  ColumnSelectivity columnSelectivity() const override {
+    return {{"value", 0.01}};
+  }
+
+ public:
+  TableRows generate(QueryContext& context) override {
+    scans++;
+
+    TableRows results;
+    for (size_t i = 0; i < rows_; i++) {
+      results.push_back(
+          make_table_row({{"id", INTEGER(i)}, {"value", INTEGER(i)}}));
+    }
+    return results;
+  }
+
+  size_t scans{0};
+
+ private:
+  size_t rows_{0};
+};
+
+TEST_F(VirtualTableTests, test_table_statistics) {
+  auto dbc = SQLiteDBManager::getUnique();
+  auto table_registry = RegistryFactory::get().registry("table");
+
+  auto large = std::make_shared<statisticsTablePlugin>(100);
+  table_registry->add("statistics_large", large);
+  attachTableInternal(
+      "statistics_large", large->columnDefinition(false), dbc, false);
+
+  auto single = std::make_shared<statisticsTablePlugin>(1);
+  table_registry->add("statistics_single", single);
+  attachTableInternal(
+      "statistics_single", single->columnDefinition(false), dbc, false);
+
+  PluginResponse response;
+  Registry::call(
+      "table", "statistics_large", {{"action", "columns"}}, response);
+  auto hint = std::find_if(
+      response.begin(), response.end(), [](const PluginRequest& column) {
+        return column.count("id") && column.at("id") == "selectivity";
+      });
+  ASSERT_NE(hint, response.end());
+  EXPECT_EQ((*hint)["name"], "value");
+
+  // Without statistics the tables are scanned in the order of the query.
+  QueryData results;
+  queryInternal(
+      "SELECT * from statistics_large JOIN statistics_single using (id);",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(1U, results.size());
+  EXPECT_EQ(1U, large->scans);
+  EXPECT_EQ(100U, single->scans);
+
+  double rows = 0;
+  ASSERT_TRUE(TableStatistics::get().rows(
+      "statistics_large", TableStatistics::scanKey({}), rows));
+  EXPECT_DOUBLE_EQ(100.0, rows);
+
+  // The observed row counts move the single row table to the outer loop.
+  large->scans = 0;
+  single->scans = 0;
+  results.clear();
+  queryInternal(
+      "SELECT * from statistics_large JOIN statistics_single using (id);",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(1U, results.size());
+  EXPECT_EQ(1U, large->scans);
+  EXPECT_EQ(1U, single->scans);
+}
+
+class memoizedOuterTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("i", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("j", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  TableRows generate(QueryContext& context) override {
+    TableRows results;
+    for (size_t n = 0; n < 10; n++) {
+      results.push_back(
+          make_table_row({{"i", INTEGER(n % 2)}, {"j", INTEGER(n)}}));
+    }
+    return results;
+  }
+};
+
+class memoizedInnerTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("i", INTEGER_TYPE, ColumnOptions::INDEX),
+        std::make_tuple("j", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  TableAttributes attributes() const override {
+    return TableAttributes::MEMOIZABLE;
+  }
+
+ public:
+  TableRows generate(QueryContext& context) override {
+    scans++;
+
+    TableRows results;
+    auto indexes = context.constraints["i"].getAll<int>(EQUALS);
+    for (const auto& i : indexes) {
+      results.push_back(make_table_row({{"i", INTEGER(i)}, {"j", "0"}}));
+    }
+    if (indexes.empty()) {
+      for (size_t n = 0; n < 10; n++) {
+        results.push_back(
+            make_table_row({{"i", INTEGER(n)}, {"j", INTEGER(n)}}));
+      }
+    }
+    return results;
+  }
+
+  size_t scans{0};
+};
+
+TEST_F(VirtualTableTests, test_memoized_scans) {
+  auto dbc = SQLiteDBManager::getUnique();
+  auto table_registry = RegistryFactory::get().registry("table");
+
+  auto outer = std::make_shared<memoizedOuterTablePlugin>();
+  table_registry->add("memoized_outer", outer);
+  attachTableInternal(
+      "memoized_outer", outer->columnDefinition(false), dbc, false);
+
+  auto inner = std::make_shared<memoizedInnerTablePlugin>();
+  table_registry->add("memoized_inner", inner);
+  attachTableInternal(
+      "memoized_inner", inner->columnDefinition(false), dbc, false);
+
+  // Only the distinct constraint values generate the inner table.
+  QueryData results;
+  queryInternal(
+      "SELECT o.j FROM memoized_outer o CROSS JOIN memoized_inner m "
+      "WHERE o.i = m.i;",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(10U, results.size());
+  EXPECT_EQ(2U, inner->scans);
+
+  // Memoized scans do not outlive the statement.
+  inner->scans = 0;
+  results.clear();
+  queryInternal(
+      "SELECT o.j FROM memoized_outer o CROSS JOIN memoized_inner m "
+      "WHERE o.i = m.i;",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(10U, results.size());
+  EXPECT_EQ(2U, inner->scans);
+
+  // Without an index constraint the full scan is generated once.
+  inner->scans = 0;
+  results.clear();
+  queryInternal(
+      "SELECT o.j FROM memoized_outer o CROSS JOIN memoized_inner m "
+      "WHERE o.j = m.j;",
+      results,
+      dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(10U, results.size());
+  EXPECT_EQ(1U, inner->scans);
+}
+
 class exceptionalTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
@@ -1210,6 +1479,76 @@ class exceptionalTablePlugin : public TablePlugin {
   FRIEND_TEST(VirtualTableTests, test_table_exceptions);
 };
 
+class exceptionalYieldTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("index", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  bool usesGenerator() const override {
+    return true;
+  }
+
+  void generator(RowYield& yield, QueryContext& qc) override {
+    for (size_t i = 0; i < 3; i++) {
+      auto r = make_table_row();
+      r["index"] = std::to_string(i);
+      yield(std::move(r));
+    }
+    throw std::runtime_error("error");
+  }
+
+ private:
+  FRIEND_TEST(VirtualTableTests, test_table_exceptions);
+};
+
+TEST_F(VirtualTableTests, test_generate_chunk) {
+  auto table = std::make_shared<yieldTablePlugin>();
+  auto route = table->routeInfo();
+  EXPECT_EQ(route.back()["id"], "generateChunk");
+
+  ColumnDictionary dictionary;
+  QueryData results;
+  PluginRequest request = {{"action", "generate_chunk"}, {"chunk_rows", "4"}};
+  do {
+    PluginResponse response;
+    ASSERT_TRUE(table->call(request, response).ok());
+    ASSERT_EQ(response.size(), 1U);
+
+    auto& chunk = response[0];
+    if (chunk.count("columns") > 0) {
+      ASSERT_TRUE(dictionary.deserialize(chunk["columns"]).ok());
+    }
+
+    QueryData rows;
+    ASSERT_TRUE(deserializeColumnChunk(chunk["data"], dictionary, rows).ok());
+    EXPECT_EQ(chunk["rows"], std::to_string(rows.size()));
+    results.insert(results.end(), rows.begin(), rows.end());
+    request["cursor"] = chunk["cursor"];
+  } while (!request["cursor"].empty());
+
+  ASSERT_EQ(results.size(), 10U);
+  EXPECT_EQ(results[0]["index"], "0");
+  EXPECT_EQ(results[9]["index"], "9");
+
+  // A cancelled generate releases its cursor.
+  PluginResponse response;
+  request.erase("cursor");
+  ASSERT_TRUE(table->call(request, response).ok());
+  auto cursor = response[0]["cursor"];
+  ASSERT_FALSE(cursor.empty());
+
+  request["cursor"] = cursor;
+  request["cancel"] = "1";
+  EXPECT_TRUE(table->call(request, response).ok());
+
+  request.erase("cancel");
+  EXPECT_FALSE(table->call(request, response).ok());
+}
+
 TEST_F(VirtualTableTests, test_table_exceptions) {
   // Add testing table to the registry.
   auto tables = RegistryFactory::get().registry("table");
@@ -1227,6 +1566,20 @@ TEST_F(VirtualTableTests, test_table_exceptions) {
     EXPECT_FALSE(status.ok());
   }
 
+  // A generator failing after yielding rows fails the query.
+  auto exceptional_yield = std::make_shared<exceptionalYieldTablePlugin>();
+  tables->add("exceptional_yield", exceptional_yield);
+  attachTableInternal("exceptional_yield",
+                      exceptional_yield->columnDefinition(false),
+                      dbc,
+                      false);
+  {
+    QueryData results;
+    auto status =
+        queryInternal("SELECT * FROM exceptional_yield", results, dbc);
+    EXPECT_FALSE(status.ok());
+  }
+
   FLAGS_table_exceptions = true;
   {
     EXPECT_THROW(
@@ -7,16 +7,20 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
 #include <atomic>
+#include <cstdlib>
 #include <unordered_set>
 
 #include <osquery/core/core.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/system.h>
 #include <osquery/logger/logger.h>
 #include <osquery/process/process.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/sql/dynamic_table_row.h>
+#include <osquery/sql/table_statistics.h>
 #include <osquery/sql/virtual_table.h>
 #include <osquery/utils/conversions/tryto.h>
 
@@ -36,6 +40,11 @@ FLAG(bool,
 
 FLAG(bool, table_exceptions, false, "Allow tables to throw exceptions");
 
+FLAG(uint32,
+     extensions_chunk_rows,
+     1024,
+     "Rows per chunk requested from extension tables (0 disables chunking)");
+
 SHELL_FLAG(bool, planner, false, "Enable osquery runtime planner output");
 
 DECLARE_bool(disable_events);
@@ -58,6 +67,18 @@ static std::atomic<size_t> kConstraintIndexID{0};
 /// We consider the max-cost as an error-state, e.g., unusable constraints.
 const double kMaxIndexCost{1000000};
 
+/// Fraction of rows kept by an equality on a column without a hint.
+const double kEqualsSelectivity{0.1};
+
+/// Fraction of rows kept by any other operator.
+const double kRangeSelectivity{0.5};
+
+/// Rows assumed for a full scan of a table that was never scanned.
+const double kUnscannedTableRows{1000};
+
+/// Cost added for each constraint that cannot be used by the table.
+const double kUnusableConstraintCost{10};
+
 static inline std::string opString(unsigned char op) {
   switch (op) {
   case EQUALS:
@@ -281,6 +302,115 @@ void setTableErrorMessage(sqlite3_vtab* vtable,
     memcpy(vtable->zErrMsg, error_message.c_str(), buffer_size);
   }
 }
+
+/**
+ * @brief Reads the rows of an extension table one chunk at a time.
+ *
+ * Each generate_chunk call returns the next rows column by column. Only the
+ * current chunk is kept in memory, the next one is requested once SQLite has
+ * consumed it.
+ */
+class ExtensionChunkReader {
+ public:
+  ExtensionChunkReader(std::string table, PluginRequest request)
+      : table_(std::move(table)), request_(std::move(request)) {
+    request_["action"] = "generate_chunk";
+    request_["chunk_rows"] = std::to_string(FLAGS_extensions_chunk_rows);
+  }
+
+  ~ExtensionChunkReader() {
+    if (cursor_.empty()) {
+      return;
+    }
+
+    // Let the extension drop the rows that were not read.
+    try {
+      PluginResponse response;
+      Registry::call("table",
+                     table_,
+                     {{"action", "generate_chunk"},
+                      {"cursor", cursor_},
+                      {"cancel", "1"}},
+                     response);
+    } catch (const std::exception& e) {
+      VLOG(1) << "Cannot cancel generate of " << table_ << ": " << e.what();
+    }
+  }
+
+  /// Request and decode the next chunk, the first one starts the generate.
+  Status next() {
+    if (started_ && cursor_.empty()) {
+      rows_.clear();
+      return Status::success();
+    }
+
+    request_["cursor"] = cursor_;
+    cursor_.clear();
+    started_ = true;
+
+    PluginResponse response;
+    auto status = Registry::call("table", table_, request_, response);
+    if (!status.ok()) {
+      return status;
+    }
+    if (response.size() != 1) {
+      return Status::failure("Invalid generate_chunk response");
+    }
+
+    auto& item = response[0];
+    auto columns = item.find("columns");
+    if (columns != item.end()) {
+      status = dictionary_.deserialize(columns->second);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+
+    rows_.clear();
+    status = deserializeColumnChunk(item["data"], dictionary_, rows_);
+    if (!status.ok()) {
+      return status;
+    }
+    cursor_ = item["cursor"];
+    return Status::success();
+  }
+
+  /**
+   * @brief Yield the rows of the current chunk and of every following chunk.
+   *
+   * A chunk that cannot be read throws, the cursor stepping the rows fails
+   * the statement rather than returning a partial table.
+   */
+  void yieldRows(RowYield& yield) {
+    while (!rows_.empty()) {
+      for (auto& row : rows_) {
+        yield(TableRowHolder(new DynamicTableRow(std::move(row))));
+      }
+
+      auto status = next();
+      if (!status.ok()) {
+        throw std::runtime_error("Cannot read the next rows of " + table_ +
+                                 ": " + status.getMessage());
+      }
+    }
+  }
+
+ private:
+  std::string table_;
+
+  PluginRequest request_;
+
+  /// Columns of the chunks, replaced when a chunk carries its columns.
+  ColumnDictionary dictionary_;
+
+  /// Rows of the current chunk.
+  QueryData rows_;
+
+  /// Cursor of the next chunk, empty once the extension sent the last one.
+  std::string cursor_;
+
+  bool started_{false};
+};
 } // namespace
 
 inline std::string table_doc(const std::string& name) {
@@ -293,6 +423,42 @@ static void plan(const std::string& output) {
   }
 }
 
+/**
+ * @brief Record a scan once all of its rows were generated.
+ *
+ * The row count is kept for the planner's estimates, and the rows of a
+ * memoizable scan are kept for the next identical scan of the statement.
+ */
+static void completeScan(VirtualTable* pVtab, BaseCursor* pCur, size_t rows) {
+  TableStatistics::get().record(pVtab->content->name, pCur->scan_key, rows);
+
+  if (!pCur->memoized_key.empty()) {
+    if (pCur->uses_generator) {
+      pCur->rows =
+          std::make_shared<const TableRows>(std::move(pCur->memoized_rows));
+      pCur->memoized_rows.clear();
+    }
+    pVtab->instance->memoizeScan(pCur->memoized_key, pCur->rows);
+    pCur->memoized_key.clear();
+  }
+
+  if (FLAGS_planner) {
+    plan("xFilter " + pVtab->content->name +
+         " generate returned row count:" + std::to_string(rows));
+  }
+}
+
+/// Report an exception thrown while generating the rows of a table.
+static int generateError(sqlite3_vtab* pVtab, const std::exception& e) {
+  LOG(ERROR) << "Exception while executing table "
+             << ((VirtualTable*)pVtab)->content->name << ": " << e.what();
+  setTableErrorMessage(pVtab, e.what());
+  if (FLAGS_table_exceptions) {
+    throw;
+  }
+  return SQLITE_ERROR;
+}
+
 int xOpen(sqlite3_vtab* tab, sqlite3_vtab_cursor** ppCursor) {
   auto* pCur = new BaseCursor;
   auto* pVtab = (VirtualTable*)tab;
@@ -317,9 +483,14 @@ int xClose(sqlite3_vtab_cursor* cur) {
 int xEof(sqlite3_vtab_cursor* cur) {
   BaseCursor* pCur = (BaseCursor*)cur;
   if (pCur->uses_generator) {
+    if (pCur->generator == nullptr) {
+      return true;
+    }
     if (*pCur->generator) {
       return false;
     }
+    // Generated rows are only counted once they have all been stepped.
+    completeScan((VirtualTable*)cur->pVtab, pCur, pCur->row);
     pCur->generator = nullptr;
     return true;
   }
@@ -341,7 +512,20 @@ int xDestroy(sqlite3_vtab* p) {
 int xNext(sqlite3_vtab_cursor* cur) {
   BaseCursor* pCur = (BaseCursor*)cur;
   if (pCur->uses_generator) {
-    pCur->generator->operator()();
+    if (!pCur->memoized_key.empty()) {
+      // Keep the row, the rows are memoized once the scan completes.
+      pCur->memoized_rows.push_back(std::move(pCur->current));
+    } else {
+      // Hand the consumed row back, the generator may fill it again.
+      *pCur->recycler = std::move(pCur->current);
+    }
+
+    try {
+      pCur->generator->operator()();
+    } catch (const std::exception& e) {
+      pCur->generator = nullptr;
+      return generateError(cur->pVtab, e);
+    }
     if (*pCur->generator) {
       pCur->current = pCur->generator->get();
     }
@@ -354,8 +538,19 @@ int xRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
   *pRowid = 0;
 
   const BaseCursor* pCur = (BaseCursor*)cur;
-  auto data_it = std::next(pCur->rows.begin(), pCur->row);
-  if (data_it >= pCur->rows.end()) {
+  if (pCur->uses_generator) {
+    if (pCur->current == nullptr) {
+      return SQLITE_ERROR;
+    }
+    return pCur->current->get_rowid(pCur->row, pRowid);
+  }
+
+  if (pCur->rows == nullptr) {
+    return SQLITE_ERROR;
+  }
+
+  auto data_it = std::next(pCur->rows->begin(), pCur->row);
+  if (data_it >= pCur->rows->end()) {
     return SQLITE_ERROR;
   }
 
@@ -654,6 +849,21 @@ int xCreate(sqlite3* db,
         }
       }
       pVtab->content->aliases[cname->second] = target_index;
+    } else if (cid->second == "generateChunk") {
+      // The extension can return the generated rows in chunks.
+      pVtab->content->chunked_generate = true;
+    } else if (cid->second == "selectivity" && cname != column.end()) {
+      auto cselectivity = column.find("selectivity");
+      if (cselectivity == column.end()) {
+        continue;
+      }
+
+      char* end = nullptr;
+      auto selectivity = std::strtod(cselectivity->second.c_str(), &end);
+      if (end != cselectivity->second.c_str() && selectivity >= 0 &&
+          selectivity <= 1) {
+        pVtab->content->selectivity[cname->second] = selectivity;
+      }
     } else if (cid->second == "attributes") {
       auto cattr = column.find("attributes");
       // Store the attributes locally so they may be passed to the SQL object.
@@ -684,13 +894,14 @@ int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col) {
     // Requested column index greater than column set size.
     return SQLITE_ERROR;
   }
-  if (!pCur->uses_generator && pCur->row >= pCur->rows.size()) {
+  if (!pCur->uses_generator &&
+      (pCur->rows == nullptr || pCur->row >= pCur->rows->size())) {
     // Request row index greater than row set size.
     return SQLITE_ERROR;
   }
 
-  TableRowHolder& row =
-      pCur->uses_generator ? pCur->current : pCur->rows[pCur->row];
+  const TableRowHolder& row =
+      pCur->uses_generator ? pCur->current : (*pCur->rows)[pCur->row];
   return row->get_column(ctx, cur->pVtab, col);
 }
 
@@ -704,6 +915,47 @@ static inline bool sensibleComparison(ColumnType type, unsigned char op) {
   return true;
 }
 
+/**
+ * @brief Estimate the rows a scan returns.
+ *
+ * Use the rows observed for the same constrained columns, otherwise scale
+ * the rows of a full scan by the selectivity of each constraint. Tables that
+ * were never scanned assume kUnscannedTableRows for a full scan, so every
+ * estimate is on the same row-count scale.
+ */
+static double estimateRows(const VirtualTableContent& content,
+                           const ConstraintSet& constraints) {
+  double rows = 0;
+  const auto& statistics = TableStatistics::get();
+  if (statistics.rows(
+          content.name, TableStatistics::scanKey(constraints), rows)) {
+    return rows;
+  }
+
+  if (!statistics.rows(content.name, TableStatistics::scanKey({}), rows)) {
+    rows = kUnscannedTableRows;
+  }
+
+  for (const auto& constraint : constraints) {
+    if (constraint.second.op != EQUALS) {
+      rows *= kRangeSelectivity;
+      continue;
+    }
+
+    auto hint = content.selectivity.find(constraint.first);
+    rows *= (hint != content.selectivity.end()) ? hint->second
+                                                : kEqualsSelectivity;
+  }
+  return rows;
+}
+
+/// Append a length-prefixed part to the key of a memoized scan.
+static void appendScanKey(std::string& key, const std::string& part) {
+  key += std::to_string(part.size());
+  key += ':';
+  key += part;
+}
+
 static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
   auto* pVtab = (VirtualTable*)tab;
   const auto& columns = pVtab->content->columns;
@@ -713,7 +965,7 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
   // Expect this index to correspond with argv within xFilter.
   size_t expr_index = 0;
   // If any constraints are unusable increment the cost of the index.
-  double cost = kMaxIndexCost;
+  double penalty = 0;
 
   // Tables may have requirements or use indexes.
   bool hasRequiredColumns = false;
@@ -747,7 +999,7 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
       const auto& name = std::get<0>(columns[constraint_info.iColumn]);
       const auto& type = std::get<1>(columns[constraint_info.iColumn]);
       if (!sensibleComparison(type, constraint_info.op)) {
-        cost += 10;
+        penalty += kUnusableConstraintCost;
         continue;
       }
 
@@ -755,10 +1007,8 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
       const auto& options = std::get<2>(columns[constraint_info.iColumn]);
       if (options & ColumnOptions::REQUIRED) {
         hasRequiredConstraints = true;
-        cost = 1;
-      } else if (options & (ColumnOptions::INDEX | ColumnOptions::ADDITIONAL)) {
-        cost = 1;
-      } else {
+      } else if (!(options &
+                   (ColumnOptions::INDEX | ColumnOptions::ADDITIONAL))) {
         // not indexed, let sqlite filter it
         continue;
       }
@@ -819,16 +1069,27 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
     }
   }
 
+  // Each xFilter generates the table again, so a scan costs its rows.
+  // SQLite multiplies this by the rows of the outer loops of a join.
+  auto rows = std::max(estimateRows(*pVtab->content, constraints), 1.0);
+  pIdxInfo->estimatedRows = static_cast<sqlite3_int64>(rows);
+
   // Return max-cost if a required constraint is not present.
   // For example, you can't do a hash of a file if path not provided.
-  if (hasRequiredColumns && !hasRequiredConstraints) {
-    cost = kMaxIndexCost;
+  // Row estimates stay below the max-cost so such plans always lose.
+  double cost = kMaxIndexCost;
+  if (!hasRequiredColumns || hasRequiredConstraints) {
+    cost = std::min(rows + penalty, kMaxIndexCost - 1);
   }
 
+  // Generated rows have no guaranteed order, SQLite must sort them.
+  pIdxInfo->orderByConsumed = 0;
+
   pIdxInfo->idxNum = static_cast<int>(kConstraintIndexID++);
   if (FLAGS_planner) {
     plan("xBestIndex Recording constraint set for table: " +
          pVtab->content->name + " [cost=" + std::to_string(cost) +
+         " rows=" + std::to_string(rows) +
          " size=" + std::to_string(constraints.size()) +
          " idx=" + std::to_string(pIdxInfo->idxNum) + "]");
   }
@@ -857,6 +1118,12 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   pCur->row = 0;
   pCur->n = 0;
+  pCur->scan_key.clear();
+  pCur->memoized_key.clear();
+  pCur->memoized_rows.clear();
+  pCur->uses_generator = false;
+  pCur->generator = nullptr;
+  pCur->current = nullptr;
   QueryContext context(content);
 
   // The SQLite instance communicates to the TablePlugin via the context.
@@ -879,6 +1146,14 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
       ((content->attributes & TableAttributes::EVENT_BASED) == 0 ||
        !FLAGS_disable_events);
 
+  // Tables whose rows only depend on the constraints are generated once for
+  // each distinct scan of a statement, such as the inner side of a JOIN.
+  bool memoizable = (content->attributes & TableAttributes::MEMOIZABLE) > 0;
+  std::string memoized_key;
+  if (memoizable) {
+    appendScanKey(memoized_key, content->name);
+  }
+
   std::map<std::string, ColumnOptions> options;
   for (size_t i = 0; i < content->columns.size(); ++i) {
     // Set the column affinity for each optional constraint list.
@@ -905,6 +1180,7 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
   // Iterate over every argument to xFilter, filling in constraint values.
   if (content->constraints.size() > 0) {
     auto& constraints = content->constraints[idxNum];
+    pCur->scan_key = TableStatistics::scanKey(constraints);
     if (argc > 0) {
       for (size_t i = 0; i < static_cast<size_t>(argc); ++i) {
         auto expr = (const char*)sqlite3_value_text(argv[i]);
@@ -922,6 +1198,11 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
         }
         // Add the constraint to the column-sorted query request map.
         context.constraints[constraint.first].add(constraint.second);
+        if (memoizable) {
+          appendScanKey(memoized_key, constraint.first);
+          appendScanKey(memoized_key, std::to_string(constraint.second.op));
+          appendScanKey(memoized_key, constraint.second.expr);
+        }
       }
     } else if (constraints.size() > 0) {
       // Constraints failed.
@@ -954,7 +1235,7 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
   }
 
   // Reset the virtual table contents.
-  pCur->rows.clear();
+  pCur->rows.reset();
   options.clear();
 
   if (!user_based_satisfied) {
@@ -983,6 +1264,20 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
     }
   }
 
+  if (memoizable) {
+    appendScanKey(memoized_key,
+                  context.colsUsedBitset ? context.colsUsedBitset->to_string()
+                                         : std::string());
+    pCur->rows = pVtab->instance->getMemoizedScan(memoized_key);
+    if (pCur->rows != nullptr) {
+      pCur->n = pCur->rows->size();
+      plan("Reusing memoized rows for cursor (" + std::to_string(pCur->id) +
+           ")");
+      return SQLITE_OK;
+    }
+    pCur->memoized_key = std::move(memoized_key);
+  }
+
   // Generate the row data set.
   plan("Scanning rows for cursor (" + std::to_string(pCur->id) + ")");
   if (Registry::get().exists("table", pVtab->content->name, true)) {
@@ -991,6 +1286,8 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
     try {
       if (table->usesGenerator()) {
         pCur->uses_generator = true;
+        pCur->recycler = std::make_shared<TableRowHolder>();
+        context.row_recycler = pCur->recycler;
         pCur->generator = std::make_unique<RowGenerator::pull_type>(
             std::bind(&TablePlugin::generator,
                       table,
@@ -1001,16 +1298,40 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
         }
         return SQLITE_OK;
       }
-      pCur->rows = table->generate(context);
+      pCur->rows =
+          std::make_shared<const TableRows>(table->generate(context));
     } catch (const std::exception& e) {
-      LOG(ERROR) << "Exception while executing table " << pVtab->content->name
-                 << ": " << e.what();
-      setTableErrorMessage(pVtabCursor->pVtab, e.what());
-      if (FLAGS_table_exceptions) {
-        throw;
-      }
+      return generateError(pVtabCursor->pVtab, e);
+    }
+  } else if (pVtab->content->chunked_generate &&
+             FLAGS_extensions_chunk_rows > 0) {
+    PluginRequest request;
+    TablePlugin::setRequestFromContext(context, request);
+    auto reader = std::make_shared<ExtensionChunkReader>(pVtab->content->name,
+                                                         std::move(request));
+    auto status = reader->next();
+    if (!status.ok()) {
+      VLOG(1) << "Invalid response from the extension table. Error "
+              << status.getCode() << ": " << status.getMessage();
+      setTableErrorMessage(pVtabCursor->pVtab, status.getMessage());
       return SQLITE_ERROR;
     }
+
+    // Later chunks are requested while SQLite steps through the rows, the
+    // scan is recorded once they have all been stepped.
+    pCur->uses_generator = true;
+    pCur->recycler = std::make_shared<TableRowHolder>();
+    try {
+      pCur->generator = std::make_unique<RowGenerator::pull_type>(
+          [reader](RowYield& yield) { reader->yieldRows(yield); });
+    } catch (const std::exception& e) {
+      pCur->generator = nullptr;
+      return generateError(pVtabCursor->pVtab, e);
+    }
+    if (*pCur->generator) {
+      pCur->current = pCur->generator->get();
+    }
+    return SQLITE_OK;
   } else {
     PluginRequest request = {{"action", "generate"}};
     TablePlugin::setRequestFromContext(context, request);
@@ -1022,17 +1343,13 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
       setTableErrorMessage(pVtabCursor->pVtab, status.getMessage());
       return SQLITE_ERROR;
     }
-    pCur->rows = tableRowsFromQueryData(std::move(qd));
+    pCur->rows = std::make_shared<const TableRows>(
+        tableRowsFromQueryData(std::move(qd)));
   }
 
   // Set the number of rows.
-  pCur->n = pCur->rows.size();
-
-  if (FLAGS_planner) {
-    plan("xFilter " + pVtab->content->name +
-         " generate returned row count:" + std::to_string(pCur->n));
-  }
-
+  pCur->n = pCur->rows->size();
+  completeScan(pVtab, pCur, pCur->n);
   return SQLITE_OK;
 }
 
@@ -41,8 +41,8 @@ struct BaseCursor : private boost::noncopyable {
   /// Track cursors for optional planner output.
   size_t id{0};
 
-  /// Table data generated from last access.
-  TableRows rows;
+  /// Table data generated from last access, shared with a memoized scan.
+  std::shared_ptr<const TableRows> rows;
 
   /// Callable generator.
   std::unique_ptr<RowGenerator::pull_type> generator{nullptr};
@@ -50,6 +50,9 @@ struct BaseCursor : private boost::noncopyable {
   /// Results of current call.
   TableRowHolder current;
 
+  /// Consumed generator rows are returned here for the generator to reuse.
+  std::shared_ptr<TableRowHolder> recycler{nullptr};
+
   /// Does the backing local table use a generator type.
   bool uses_generator{false};
 
@@ -58,6 +61,15 @@ struct BaseCursor : private boost::noncopyable {
 
   /// Total number of rows.
   size_t n{0};
+
+  /// The constrained columns of the scan, recorded with its row count.
+  std::string scan_key;
+
+  /// Key of a memoizable scan not yet memoized, its rows are kept until then.
+  std::string memoized_key;
+
+  /// Generated rows of a memoizable scan, kept until the scan completes.
+  TableRows memoized_rows;
 };
 
 /**
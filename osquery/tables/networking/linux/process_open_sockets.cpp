@@ -8,13 +8,129 @@
  */
 
 #include <osquery/core/core.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
 
 namespace osquery {
+
+FLAG(bool,
+     process_open_sockets_netlink,
+     true,
+     "Read process_open_sockets from NETLINK_SOCK_DIAG before procfs");
+
 namespace tables {
 
+/**
+ * @brief Build the kernel-side socket filter from the query constraints.
+ *
+ * An empty state selects the sockets of protocols without a state, it does
+ * not widen the TCP states dumped by the kernel.
+ */
+SockDiagFilter getSockDiagFilter(QueryContext& context, bool& stateless) {
+  SockDiagFilter filter;
+  stateless = true;
+
+  if (context.constraints["state"].exists(EQUALS)) {
+    std::uint32_t states = 0;
+    stateless = false;
+    for (const auto& state : context.constraints["state"].getAll(EQUALS)) {
+      if (state.empty()) {
+        stateless = true;
+        continue;
+      }
+
+      auto it = std::find(tcp_states.begin(), tcp_states.end(), state);
+      if (it == tcp_states.end() || it == tcp_states.begin()) {
+        // UNKNOWN and unexpected states cannot be expressed as a state mask.
+        states = ~0U;
+      } else {
+        states |= 1U << (it - tcp_states.begin());
+      }
+    }
+    filter.tcp_states = states;
+  }
+
+  auto ports = context.constraints["local_port"].getAll<int>(EQUALS);
+  if (ports.size() == 1 && *ports.begin() > 0 && *ports.begin() <= 0xFFFF) {
+    filter.local_port = static_cast<std::uint16_t>(*ports.begin());
+  }
+
+  return filter;
+}
+
+/**
+ * @brief Collect the sockets of a network namespace.
+ *
+ * Sockets are dumped over NETLINK_SOCK_DIAG when the kernel and the
+ * privileges of osquery allow it, each family and protocol falls back to the
+ * /proc/<pid>/net files independently. Protocols without a state are skipped
+ * when the query only selects TCP states.
+ */
+static void genNamespaceSockets(const std::string& pid,
+                                ino_t ns,
+                                const SockDiagFilter& filter,
+                                bool stateless,
+                                SocketInfoList& socket_list) {
+  std::unique_ptr<SockDiagSocket> diag;
+  if (FLAGS_process_open_sockets_netlink) {
+    auto status = SockDiagSocket::open(pid, ns, diag);
+    if (!status.ok()) {
+      VLOG(1) << "Using procfs for the sockets of network namespace " << ns
+              << ": " << status.what();
+    }
+  }
+
+  for (const auto& pair : kLinuxProtocolNames) {
+    if (!stateless && pair.first != IPPROTO_TCP) {
+      continue;
+    }
+
+    for (int family : {AF_INET, AF_INET6}) {
+      if (diag != nullptr && SockDiagSocket::isSupported(pair.first)) {
+        auto status =
+            diag->getInetSockets(family, pair.first, filter, socket_list);
+        if (status.ok()) {
+          continue;
+        }
+        VLOG(1) << "Using procfs for " << pair.second << " sockets: "
+                << status.what();
+      }
+
+      auto status = procGetSocketList(family, pair.first, ns, pid, socket_list);
+      if (!status.ok()) {
+        VLOG(1)
+            << "Results for process_open_sockets might be incomplete. Failed "
+               "to acquire basic socket information for "
+            << (family == AF_INET ? "AF_INET " : "AF_INET6 ") << pair.second
+            << ": " << status.what();
+      }
+    }
+  }
+
+  // UNIX sockets have neither a state nor a port.
+  if (!stateless || filter.local_port) {
+    return;
+  }
+
+  if (diag != nullptr) {
+    auto status = diag->getUnixSockets(socket_list);
+    if (status.ok()) {
+      return;
+    }
+    VLOG(1) << "Using procfs for AF_UNIX sockets: " << status.what();
+  }
+
+  auto status = procGetSocketList(AF_UNIX, IPPROTO_IP, ns, pid, socket_list);
+  if (!status.ok()) {
+    VLOG(1) << "Results for process_open_sockets might be incomplete. Failed "
+               "to acquire basic socket information for AF_UNIX: "
+            << status.what();
+  }
+}
+
 QueryData genOpenSockets(QueryContext& context) {
   Status status;
   QueryData results;
@@ -32,6 +148,9 @@ QueryData genOpenSockets(QueryContext& context) {
   bool pid_filter = !(pids.empty() ||
                       std::find(pids.begin(), pids.end(), "-1") != pids.end());
 
+  // Scanning every /proc/<pid>/fd is only needed to report or filter by pid.
+  bool proc_info = pid_filter || context.isAnyColumnUsed({"pid", "fd"});
+
   if (!pid_filter) {
     pids.clear();
     status = osquery::procProcesses(pids);
@@ -49,33 +168,42 @@ QueryData genOpenSockets(QueryContext& context) {
    * can then be used to correlate pid and fd with the socket information
    * collected on step 3. The map generated in this step will only contain
    * sockets associated with pids in the list, so it will also be used to filter
-   * the sockets later if pid_filter is set.
+   * the sockets later if pid_filter is set. This step is skipped if neither
+   * the pid nor fd columns are used.
    *
    * 2. Collect the inode for the network namespace associated with each pid.
    * Every time a new namespace is found execute step 3 to get socket basic
    * information.
    *
    * 3. Collect basic socket information for all sockets under a specifc network
-   * namespace. This is done by reading through files under /proc/<pid>/net for
-   * the first pid we find in a certain namespace. Notice this will collect
-   * information for all sockets on the namespace not only for sockets
-   * associated with the specific pid, therefore only needs to be run once. From
-   * this step we collect the inodes of each of the sockets, and will use that
-   * to correlate the socket information with the information collect on steps
-   * 1 and 2.
+   * namespace. This is done by dumping the sockets over NETLINK_SOCK_DIAG, or
+   * by reading through files under /proc/<pid>/net, for the first pid we find
+   * in a certain namespace. The state and local_port constraints are passed
+   * to the kernel so it only returns sockets the query may select. Notice this
+   * will collect information for all sockets on the namespace not only for
+   * sockets associated with the specific pid, therefore only needs to be run
+   * once. From this step we collect the inodes of each of the sockets, and
+   * will use that to correlate the socket information with the information
+   * collect on steps 1 and 2.
    */
 
+  bool stateless = true;
+  auto filter = getSockDiagFilter(context, stateless);
+
   /* Use a set to record the namespaces already processed */
   std::set<ino_t> netns_list;
   SocketInodeToProcessInfoMap inode_proc_map;
   SocketInfoList socket_list;
   for (const auto& pid : pids) {
     /* Step 1 */
-    status = procGetSocketInodeToProcessInfoMap(pid, inode_proc_map);
-    if (!status.ok()) {
-      VLOG(1) << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire socket inode to process map for pid "
-              << pid << ": " << status.what();
+    if (proc_info) {
+      status = procGetSocketInodeToProcessInfoMap(pid, inode_proc_map);
+      if (!status.ok()) {
+        VLOG(1)
+            << "Results for process_open_sockets might be incomplete. Failed "
+               "to acquire socket inode to process map for pid "
+            << pid << ": " << status.what();
+      }
     }
 
     /* Step 2 */
@@ -99,30 +227,7 @@ QueryData genOpenSockets(QueryContext& context) {
       netns_list.insert(ns);
 
       /* Step 3 */
-      for (const auto& pair : kLinuxProtocolNames) {
-        status = procGetSocketList(AF_INET, pair.first, ns, pid, socket_list);
-        if (!status.ok()) {
-          VLOG(1)
-              << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET "
-              << pair.second << ": " << status.what();
-        }
-
-        status = procGetSocketList(AF_INET6, pair.first, ns, pid, socket_list);
-        if (!status.ok()) {
-          VLOG(1)
-              << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET6 "
-              << pair.second << ": " << status.what();
-        }
-      }
-      status = procGetSocketList(AF_UNIX, IPPROTO_IP, ns, pid, socket_list);
-      if (!status.ok()) {
-        VLOG(1)
-            << "Results for process_open_sockets might be incomplete. Failed "
-               "to acquire basic socket information for AF_UNIX: "
-            << status.what();
-      }
+      genNamespaceSockets(pid, ns, filter, stateless, socket_list);
     }
   }
 
@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/unix_diag.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <osquery/tables/networking/linux/inet_diag.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
+
+namespace osquery {
+
+namespace {
+
+/// Size of the receive buffer, the kernel fills it with many messages.
+const size_t kSockDiagBufferSize{64 * 1024};
+
+/// Seconds to wait for the kernel before a dump is abandoned.
+const time_t kSockDiagTimeout{5};
+
+/// Attempts of a dump which sockets changing concurrently interrupted.
+const size_t kSockDiagDumpAttempts{3};
+
+/// Inode of osquery's own network namespace, 0 if unknown.
+ino_t currentNetNamespace() {
+  struct stat ns_stat;
+  if (::stat((kLinuxProcPath + "/self/ns/net").c_str(), &ns_stat) != 0) {
+    return 0;
+  }
+  return ns_stat.st_ino;
+}
+
+std::string formatAddress(int family, const __be32* address) {
+  char buffer[INET6_ADDRSTRLEN] = {0};
+  inet_ntop(family, address, buffer, sizeof(buffer));
+  return std::string(buffer);
+}
+
+/// Append an attribute holding the payload to a netlink request.
+void appendAttribute(std::vector<char>& request,
+                     unsigned short type,
+                     const void* payload,
+                     size_t size) {
+  auto offset = request.size();
+  request.resize(offset + RTA_SPACE(size));
+
+  auto* attribute = reinterpret_cast<struct rtattr*>(&request[offset]);
+  attribute->rta_type = type;
+  attribute->rta_len = RTA_LENGTH(size);
+  std::memcpy(RTA_DATA(attribute), payload, size);
+}
+
+} // namespace
+
+SockDiagSocket::SockDiagSocket(int fd, ino_t net_ns)
+    : fd_(fd), net_ns_(net_ns), buffer_(kSockDiagBufferSize) {}
+
+SockDiagSocket::~SockDiagSocket() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+Status SockDiagSocket::open(const std::string& pid,
+                            ino_t net_ns,
+                            std::unique_ptr<SockDiagSocket>& socket) {
+  int fd = -1;
+  int error = 0;
+  if (net_ns == 0 || net_ns == currentNetNamespace()) {
+    fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    error = errno;
+
+  } else {
+    auto ns_path = kLinuxProcPath + "/" + pid + "/ns/net";
+    int ns_fd = ::open(ns_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (ns_fd < 0) {
+      return Status::failure("Cannot open " + ns_path);
+    }
+
+    // The process may have exited and its pid been reused.
+    struct stat ns_stat;
+    if (::fstat(ns_fd, &ns_stat) != 0 || ns_stat.st_ino != net_ns) {
+      ::close(ns_fd);
+      return Status::failure("Network namespace of " + pid + " changed");
+    }
+
+    // Only the temporary thread changes namespace, it exits right after.
+    std::thread([ns_fd, &fd, &error]() {
+      if (::setns(ns_fd, CLONE_NEWNET) != 0) {
+        error = errno;
+        return;
+      }
+      fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+      error = errno;
+    }).join();
+    ::close(ns_fd);
+  }
+
+  if (fd < 0) {
+    return Status::failure("Cannot open NETLINK_SOCK_DIAG socket: " +
+                           std::string(std::strerror(error)));
+  }
+
+  struct timeval timeout = {kSockDiagTimeout, 0};
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  socket.reset(new SockDiagSocket(fd, net_ns));
+  return Status::success();
+}
+
+bool SockDiagSocket::isSupported(int protocol) {
+  // ICMP and raw sockets are not reported by every kernel.
+  return protocol == IPPROTO_TCP || protocol == IPPROTO_UDP ||
+         protocol == IPPROTO_UDPLITE;
+}
+
+Status SockDiagSocket::dump(std::vector<char>& request,
+                            const SockDiagParser& parser,
+                            SocketInfoList& result) {
+  SocketInfoList sockets;
+  for (size_t attempt = 1;; attempt++) {
+    bool interrupted = false;
+    auto status = dumpOnce(request, parser, sockets, interrupted);
+    if (!status.ok()) {
+      return status;
+    }
+
+    if (!interrupted || attempt == kSockDiagDumpAttempts) {
+      // An interrupted dump is as consistent as reading procfs.
+      break;
+    }
+    sockets.clear();
+  }
+
+  result.insert(result.end(),
+                std::make_move_iterator(sockets.begin()),
+                std::make_move_iterator(sockets.end()));
+  return Status::success();
+}
+
+Status SockDiagSocket::dumpOnce(std::vector<char>& request,
+                                const SockDiagParser& parser,
+                                SocketInfoList& sockets,
+                                bool& interrupted) {
+  auto* request_header = reinterpret_cast<struct nlmsghdr*>(request.data());
+  request_header->nlmsg_len = static_cast<__u32>(request.size());
+  request_header->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  request_header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request_header->nlmsg_seq = ++sequence_;
+
+  struct sockaddr_nl kernel = {};
+  kernel.nl_family = AF_NETLINK;
+  auto sent = ::sendto(fd_,
+                       request.data(),
+                       request.size(),
+                       0,
+                       reinterpret_cast<struct sockaddr*>(&kernel),
+                       sizeof(kernel));
+  if (sent < 0 || static_cast<size_t>(sent) != request.size()) {
+    return Status::failure("Cannot send sock_diag request: " +
+                           std::string(std::strerror(errno)));
+  }
+
+  while (true) {
+    auto received = ::recv(fd_, buffer_.data(), buffer_.size(), 0);
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status::failure("Cannot receive sock_diag response: " +
+                             std::string(std::strerror(errno)));
+    }
+
+    auto size = static_cast<int>(received);
+    auto* header = reinterpret_cast<const struct nlmsghdr*>(buffer_.data());
+    for (; NLMSG_OK(header, size); header = NLMSG_NEXT(header, size)) {
+      if (header->nlmsg_seq != sequence_) {
+        continue;
+      }
+
+      // The sockets changed during the dump, some may be missing or repeated.
+      if ((header->nlmsg_flags & NLM_F_DUMP_INTR) != 0) {
+        interrupted = true;
+      }
+
+      if (header->nlmsg_type == NLMSG_DONE) {
+        return Status::success();
+      }
+
+      if (header->nlmsg_type == NLMSG_ERROR) {
+        const auto* error =
+            static_cast<const struct nlmsgerr*>(NLMSG_DATA(header));
+        if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*error))) {
+          return Status::failure("Truncated sock_diag error");
+        }
+        return Status::failure("sock_diag request failed: " +
+                               std::string(std::strerror(-error->error)));
+      }
+
+      parser(header, sockets);
+    }
+
+    if (received == 0) {
+      return Status::failure("sock_diag socket closed");
+    }
+  }
+}
+
+Status SockDiagSocket::getInetSockets(int family,
+                                      int protocol,
+                                      const SockDiagFilter& filter,
+                                      SocketInfoList& result) {
+  if ((family != AF_INET && family != AF_INET6) || !isSupported(protocol)) {
+    return Status::failure("Unsupported sock_diag protocol " +
+                           std::to_string(protocol));
+  }
+
+  std::vector<char> request(NLMSG_LENGTH(sizeof(struct inet_diag_req_v2)));
+  auto* diag_request =
+      static_cast<struct inet_diag_req_v2*>(NLMSG_DATA(request.data()));
+  diag_request->sdiag_family = static_cast<__u8>(family);
+  diag_request->sdiag_protocol = static_cast<__u8>(protocol);
+  diag_request->idiag_states =
+      (protocol == IPPROTO_TCP) ? filter.tcp_states : ~0U;
+
+  if (filter.local_port) {
+    // local_port >= port, then local_port <= port. A failed comparison jumps
+    // past the end of the program, which rejects the socket.
+    auto port = *filter.local_port;
+    struct inet_diag_bc_op program[] = {
+        {INET_DIAG_BC_S_GE, 8, 20},
+        {0, 0, port},
+        {INET_DIAG_BC_S_LE, 8, 12},
+        {0, 0, port},
+    };
+    appendAttribute(
+        request, INET_DIAG_REQ_BYTECODE, program, sizeof(program));
+  }
+
+  auto parser = [&](const nlmsghdr* header, SocketInfoList& sockets) {
+    const auto* message =
+        static_cast<const struct inet_diag_msg*>(NLMSG_DATA(header));
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*message))) {
+      return;
+    }
+
+    SocketInfo socket_info = {};
+    socket_info.socket = std::to_string(message->idiag_inode);
+    socket_info.net_ns = net_ns_;
+    socket_info.family = family;
+    socket_info.protocol = protocol;
+    socket_info.local_address = formatAddress(family, message->id.idiag_src);
+    socket_info.local_port = ntohs(message->id.idiag_sport);
+    socket_info.remote_address = formatAddress(family, message->id.idiag_dst);
+    socket_info.remote_port = ntohs(message->id.idiag_dport);
+
+    if (protocol == IPPROTO_TCP) {
+      auto state = static_cast<size_t>(message->idiag_state);
+      socket_info.state = (state == 0 || state >= tcp_states.size())
+                              ? "UNKNOWN"
+                              : tcp_states[state];
+    }
+
+    sockets.push_back(std::move(socket_info));
+  };
+
+  return dump(request, parser, result);
+}
+
+Status SockDiagSocket::getUnixSockets(SocketInfoList& result) {
+  std::vector<char> request(NLMSG_LENGTH(sizeof(struct unix_diag_req)));
+  auto* diag_request =
+      static_cast<struct unix_diag_req*>(NLMSG_DATA(request.data()));
+  diag_request->sdiag_family = AF_UNIX;
+  diag_request->udiag_states = ~0U;
+  diag_request->udiag_show = UDIAG_SHOW_NAME;
+
+  auto parser = [&](const nlmsghdr* header, SocketInfoList& sockets) {
+    const auto* message =
+        static_cast<const struct unix_diag_msg*>(NLMSG_DATA(header));
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(*message))) {
+      return;
+    }
+
+    SocketInfo socket_info = {};
+    socket_info.socket = std::to_string(message->udiag_ino);
+    socket_info.net_ns = net_ns_;
+    socket_info.family = AF_UNIX;
+    socket_info.protocol = IPPROTO_IP;
+
+    auto length =
+        static_cast<int>(header->nlmsg_len - NLMSG_LENGTH(sizeof(*message)));
+    auto* attribute = reinterpret_cast<const struct rtattr*>(
+        reinterpret_cast<const char*>(message) + NLMSG_ALIGN(sizeof(*message)));
+    for (; RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+      if (attribute->rta_type != UNIX_DIAG_NAME) {
+        continue;
+      }
+
+      const auto* name = static_cast<const char*>(RTA_DATA(attribute));
+      auto size = RTA_PAYLOAD(attribute);
+      if (size > 0 && name[0] != '\0') {
+        // Filesystem paths are NUL terminated.
+        socket_info.unix_socket_path.assign(name, strnlen(name, size));
+        continue;
+      }
+
+      // Abstract names start with a NUL byte, procfs prints them with '@'.
+      socket_info.unix_socket_path.assign(name, size);
+      for (auto& c : socket_info.unix_socket_path) {
+        if (c == '\0') {
+          c = '@';
+        }
+      }
+    }
+
+    sockets.push_back(std::move(socket_info));
+  };
+
+  return dump(request, parser, result);
+}
+
+} // namespace osquery
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <linux/netlink.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <osquery/filesystem/linux/proc.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/**
+ * @brief Socket selection evaluated by the kernel while dumping sockets.
+ *
+ * The filter only ever narrows a dump to a superset of the rows a query can
+ * match, SQLite still applies every constraint to the returned rows.
+ */
+struct SockDiagFilter final {
+  /// Bit mask of the TCP states to dump, indexed like tcp_states.
+  std::uint32_t tcp_states{~0U};
+
+  /// Only dump sockets bound to this local port.
+  boost::optional<std::uint16_t> local_port;
+};
+
+/**
+ * @brief A NETLINK_SOCK_DIAG socket bound to a single network namespace.
+ *
+ * Each dump request returns every matching socket of a family and protocol
+ * in the namespace as batches of binary messages, replacing the parsing of
+ * the /proc/<pid>/net text files.
+ */
+class SockDiagSocket : private boost::noncopyable {
+ public:
+  ~SockDiagSocket();
+
+  /**
+   * @brief Open a socket in the network namespace of a process.
+   *
+   * A namespace other than osquery's own is entered by a short-lived thread,
+   * the netlink socket stays bound to the namespace it was created in. This
+   * requires CAP_SYS_ADMIN, callers should fall back to procfs on failure.
+   *
+   * @param pid a process within the network namespace.
+   * @param net_ns the inode of the network namespace, 0 if unknown.
+   * @param socket [output] the opened socket.
+   */
+  static Status open(const std::string& pid,
+                     ino_t net_ns,
+                     std::unique_ptr<SockDiagSocket>& socket);
+
+  /// Check if the kernel reports sockets of an IP protocol over netlink.
+  static bool isSupported(int protocol);
+
+  /**
+   * @brief Append the AF_INET or AF_INET6 sockets of a protocol.
+   *
+   * Nothing is appended if the dump fails.
+   */
+  Status getInetSockets(int family,
+                        int protocol,
+                        const SockDiagFilter& filter,
+                        SocketInfoList& result);
+
+  /// Append the AF_UNIX sockets, nothing is appended if the dump fails.
+  Status getUnixSockets(SocketInfoList& result);
+
+ private:
+  SockDiagSocket(int fd, ino_t net_ns);
+
+  /// Parse a received message, appending its socket to the list.
+  using SockDiagParser =
+      std::function<void(const nlmsghdr*, SocketInfoList& sockets)>;
+
+  /**
+   * @brief Dump the sockets matching a request and append them to a list.
+   *
+   * A dump the kernel reports as interrupted, by sockets changing while it
+   * was running, is repeated. Nothing is appended if the dump fails.
+   */
+  Status dump(std::vector<char>& request,
+              const SockDiagParser& parser,
+              SocketInfoList& result);
+
+  /// Send a dump request and call the parser for each message received.
+  Status dumpOnce(std::vector<char>& request,
+                  const SockDiagParser& parser,
+                  SocketInfoList& sockets,
+                  bool& interrupted);
+
+ private:
+  /// The netlink socket descriptor.
+  int fd_{-1};
+
+  /// The network namespace reported for each socket.
+  ino_t net_ns_{0};
+
+  /// Sequence number of the last dump request.
+  std::uint32_t sequence_{0};
+
+  /// Receive buffer, reused by every dump.
+  std::vector<char> buffer_;
+};
+
+} // namespace osquery
@@ -8,7 +8,7 @@
  */
 
 #include <osquery/core/tables.h>
-#include <osquery/sql/sql.h>
+#include <osquery/registry/registry.h>
 #include <osquery/utils/info/platform_type.h>
 
 namespace {
@@ -19,10 +19,31 @@ const std::string kAF_INET6 = "10";
 
 namespace osquery {
 namespace tables {
+
+/**
+ * @brief Select the sockets which may be listening.
+ *
+ * Only TCP sockets in the LISTEN state, and sockets of protocols without a
+ * state, are requested. On Linux the state is passed to the kernel, so
+ * connected TCP sockets are not dumped.
+ */
+static QueryData selectListeningSockets() {
+  QueryContext context;
+  context.constraints["state"].add(Constraint(EQUALS, "LISTEN"));
+  context.constraints["state"].add(Constraint(EQUALS, ""));
+
+  PluginRequest request = {{"action", "generate"}};
+  TablePlugin::setRequestFromContext(context, request);
+
+  PluginResponse response;
+  Registry::call("table", "process_open_sockets", request, response);
+  return response;
+}
+
 QueryData genListeningPorts(QueryContext& context) {
   QueryData results;
 
-  auto sockets = SQL::selectAllFrom("process_open_sockets");
+  auto sockets = selectListeningSockets();
 
   for (const auto& socket : sockets) {
     if (socket.at("family") == kAF_UNIX && socket.at("path").empty()) {
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <netinet/tcp.h>
+
+#include <osquery/core/tables.h>
+#include <osquery/tables/networking/linux/sock_diag.h>
+
+namespace osquery {
+namespace tables {
+
+SockDiagFilter getSockDiagFilter(QueryContext& context, bool& stateless);
+
+class ProcessOpenSocketsTests : public testing::Test {};
+
+TEST_F(ProcessOpenSocketsTests, test_sock_diag_filter_states) {
+  bool stateless = false;
+  QueryContext context;
+  auto filter = getSockDiagFilter(context, stateless);
+  EXPECT_EQ(filter.tcp_states, ~0U);
+  EXPECT_TRUE(stateless);
+
+  // An empty state only selects protocols without a state.
+  context.constraints["state"].add(Constraint(EQUALS, "LISTEN"));
+  context.constraints["state"].add(Constraint(EQUALS, ""));
+  filter = getSockDiagFilter(context, stateless);
+  EXPECT_EQ(filter.tcp_states, 1U << TCP_LISTEN);
+  EXPECT_TRUE(stateless);
+
+  context = QueryContext();
+  context.constraints["state"].add(Constraint(EQUALS, "LISTEN"));
+  filter = getSockDiagFilter(context, stateless);
+  EXPECT_EQ(filter.tcp_states, 1U << TCP_LISTEN);
+  EXPECT_FALSE(stateless);
+
+  // States without a bit in the mask dump every state.
+  context.constraints["state"].add(Constraint(EQUALS, "UNKNOWN"));
+  filter = getSockDiagFilter(context, stateless);
+  EXPECT_EQ(filter.tcp_states, ~0U);
+  EXPECT_FALSE(stateless);
+}
+
+TEST_F(ProcessOpenSocketsTests, test_sock_diag_filter_port) {
+  bool stateless = false;
+  QueryContext context;
+  context.constraints["local_port"].add(Constraint(EQUALS, "22"));
+  auto filter = getSockDiagFilter(context, stateless);
+  ASSERT_TRUE(filter.local_port.is_initialized());
+  EXPECT_EQ(*filter.local_port, 22U);
+
+  context.constraints["local_port"].add(Constraint(EQUALS, "443"));
+  filter = getSockDiagFilter(context, stateless);
+  EXPECT_FALSE(filter.local_port.is_initialized());
+}
+
+} // namespace tables
+} // namespace osquery
@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 
 #include <osquery/config/tests/test_utils.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/filesystem/filesystem.h>
@@ -19,6 +20,11 @@
 #include <osquery/sql/sql.h>
 
 namespace osquery {
+
+#ifdef __linux__
+DECLARE_bool(process_open_sockets_netlink);
+#endif
+
 namespace tables {
 
 // generate the content that would be found in an /etc/hosts file
@@ -155,6 +161,38 @@ TEST_F(NetworkingTablesTests, test_listening_ports) {
   server.stop();
 }
 
+#ifdef __linux__
+TEST_F(NetworkingTablesTests, test_open_sockets_netlink_filter) {
+  auto& server = TLSServerRunner::instance();
+  ASSERT_TRUE(server.start());
+
+  // The kernel-side filter must select the same sockets as procfs.
+  auto query =
+      "select socket, local_port from process_open_sockets where state = "
+      "'LISTEN' and local_port = " +
+      server.port();
+  auto netlink_setting = FLAGS_process_open_sockets_netlink;
+  FLAGS_process_open_sockets_netlink = true;
+  auto netlink_results = SQL(query);
+  FLAGS_process_open_sockets_netlink = false;
+  auto procfs_results = SQL(query);
+  FLAGS_process_open_sockets_netlink = netlink_setting;
+  server.stop();
+
+  std::set<std::string> netlink_sockets;
+  for (const auto& row : netlink_results.rows()) {
+    netlink_sockets.insert(row.at("socket"));
+  }
+  std::set<std::string> procfs_sockets;
+  for (const auto& row : procfs_results.rows()) {
+    procfs_sockets.insert(row.at("socket"));
+  }
+
+  EXPECT_FALSE(netlink_sockets.empty());
+  EXPECT_EQ(netlink_sockets, procfs_sockets);
+}
+#endif
+
 TEST_F(NetworkingTablesTests, test_address_details_join) {
   // Expect that we can join interface addresses with details
   auto query =
@@ -20,17 +20,29 @@
 #include <fuzzy.h>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
 #include <set>
 #include <thread>
+#include <vector>
 
 #include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <osquery/core/flags.h>
+#include <osquery/database/database.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/hashing/hashing.h>
 #include <osquery/logger/logger.h>
 #include <osquery/core/tables.h>
 #include <osquery/sql/dynamic_table_row.h>
+#include <osquery/utils/conversions/split.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/mutex.h>
 #include <osquery/utils/info/platform_type.h>
 #include <osquery/worker/ipc/platform_table_container_ipc.h>
@@ -46,16 +58,164 @@ FLAG(bool,
 
 FLAG(uint32, hash_cache_max, 500, "Size of LRU file hash cache");
 
+FLAG(bool,
+     hash_cache_persist,
+     false,
+     "Persist calculated file hashes in the backing store");
+
+FLAG(uint32,
+     hash_cache_persist_max,
+     100000,
+     "Maximum number of file hashes persisted in the backing store");
+
 HIDDEN_FLAG(uint32,
             hash_delay,
             20,
             "Number of milliseconds to delay after hashing");
 
+FLAG(uint32,
+     hash_workers,
+     1,
+     "Number of threads hashing files, shared by all hash queries");
+
+FLAG(uint64,
+     hash_rate_limit,
+     0,
+     "Maximum bytes per second read by a hash query (0 for unlimited)");
+
 namespace tables {
 
 /// Clear this amount of rows every time cache eviction is triggered.
 const size_t kHashCacheEvictSize{5};
 
+/// Evict this fraction of the persisted hashes when the store is full.
+const size_t kHashStoreEvictDivisor{10};
+
+/// Seconds between writes refreshing the access time of a persisted hash.
+const long long kHashStoreTouchInterval{3600};
+
+/// Number of independently locked partitions of the file hash cache.
+const size_t kHashCacheStripes{16};
+
+/**
+ * @brief Limits the rate at which a single query reads files to hash.
+ *
+ * The limiter is shared by every worker of a query. Each file is admitted
+ * once the bytes admitted before it fit within the rate since the start.
+ */
+class HashRateLimiter {
+ public:
+  explicit HashRateLimiter(std::uint64_t rate)
+      : rate_(rate), start_(std::chrono::steady_clock::now()) {}
+
+  /// Block until the budget allows reading a file of this size.
+  void consume(std::uint64_t bytes) {
+    if (rate_ == 0) {
+      return;
+    }
+
+    auto admitted = bytes_.fetch_add(bytes);
+    std::this_thread::sleep_until(
+        start_ + std::chrono::microseconds(admitted * 1000000 / rate_));
+  }
+
+ private:
+  const std::uint64_t rate_;
+  const std::chrono::steady_clock::time_point start_;
+  std::atomic<std::uint64_t> bytes_{0};
+};
+
+/**
+ * @brief A bounded pool of threads hashing files for every hash query.
+ *
+ * Concurrent hash queries, for example from the scheduler's workers, share
+ * these threads instead of each starting their own. The pool grows to the
+ * largest hash_workers requested and its threads live until shutdown.
+ */
+class HashWorkerPool : private boost::noncopyable {
+ public:
+  static HashWorkerPool& get() {
+    static HashWorkerPool pool;
+    return pool;
+  }
+
+  ~HashWorkerPool() {
+    {
+      WriteLock lock(mutex_);
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /// Run the tasks on at most workers threads, block until all finished.
+  void run(std::vector<std::function<void()>>& tasks, size_t workers) {
+    size_t remaining = tasks.size();
+    {
+      WriteLock lock(mutex_);
+      while (threads_.size() < workers) {
+        threads_.emplace_back(&HashWorkerPool::work, this);
+      }
+
+      for (auto& task : tasks) {
+        queue_.push_back([this, &task, &remaining]() {
+          task();
+
+          WriteLock done_lock(mutex_);
+          if (--remaining == 0) {
+            done_cv_.notify_all();
+          }
+        });
+      }
+    }
+    work_cv_.notify_all();
+
+    WriteLock lock(mutex_);
+    done_cv_.wait(lock, [&remaining]() { return remaining == 0; });
+  }
+
+ private:
+  HashWorkerPool() = default;
+
+  /// Worker thread entry point.
+  void work() {
+    WriteLock lock(mutex_);
+    while (true) {
+      work_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        break;
+      }
+
+      auto task = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+ private:
+  /// Worker threads.
+  std::vector<std::thread> threads_;
+
+  /// Files waiting for a worker, from every query.
+  std::deque<std::function<void()>> queue_;
+
+  /// Set when the pool is destroyed.
+  bool stopping_{false};
+
+  /// Protects the threads, queue, and every query's remaining count.
+  Mutex mutex_;
+
+  /// Signaled when files are queued.
+  ConditionVariable work_cv_;
+
+  /// Signaled when a query's files are all hashed.
+  ConditionVariable done_cv_;
+};
+
 /**
  * @brief Implements persistent in-memory caching of files' hashes.
  *
@@ -91,15 +251,37 @@ struct FileHashCache {
    *
    * Maintains the cache of hash sums, stats file at path, if it has changed or
    * it is not present in cache calculates the hashes and caches the result.
+   * The cache is striped by path and files are hashed without holding a
+   * stripe lock, so concurrent hash workers do not serialize on the cache.
    *
    * @param path the path of file to hash.
    * @param out stores the calculated hashes.
+   * @param limiter the rate limit applied when a file is hashed.
    *
-   * @return true if succeeded, false if something went wrong.
+   * @return Status indicating if the file could be hashed.
    */
-  static bool load(const std::string& path, MultiHashes& out, Logger& logger);
+  static Status load(const std::string& path,
+                     MultiHashes& out,
+                     HashRateLimiter& limiter);
+};
+
+/// A partition of the file hash cache with its own lock and LRU heap.
+struct FileHashCacheStripe {
+  /// Synchronize the access to this partition.
+  Mutex mutex;
+
+  /// path => cache entry
+  std::unordered_map<std::string, FileHashCache> cache;
+
+  /// minheap on cache_access_time
+  std::vector<FileHashCache*> lru;
 };
 
+static FileHashCacheStripe& getFileHashCacheStripe(const std::string& path) {
+  static std::array<FileHashCacheStripe, kHashCacheStripes> stripes;
+  return stripes[std::hash<std::string>()(path) % kHashCacheStripes];
+}
+
 #if defined(WIN32)
 
 #define stat _stat
@@ -126,71 +308,264 @@ static inline bool statInvalid(const struct stat& st, const FileHashCache& fh) {
   return false;
 }
 
-bool FileHashCache::load(const std::string& path,
-                         MultiHashes& out,
-                         Logger& logger) {
-  // synchronize the access to cache
-  static Mutex mx;
-  // path => cache entry
-  static std::unordered_map<std::string, FileHashCache> cache;
-  // minheap on cache_access_time
-  static std::vector<FileHashCache*> lru;
+/**
+ * @brief The persistent tier of the file hash cache.
+ *
+ * Hashes are stored in the kHashes domain keyed by the file's device and
+ * inode and are only used while the mtime, ctime, and size are unchanged.
+ * The in-memory cache is the hot tier in front of this store, which allows
+ * a restarted worker to rehash only the files that changed.
+ *
+ * Hash workers only queue writes, the query thread writes them in one batch
+ * once the files are hashed.
+ */
+class FileHashStore {
+ public:
+  /**
+   * @brief Check if hashes are persisted.
+   *
+   * Device and inode numbers are not stable on Windows. A container worker
+   * sees the container's devices and inodes and does not own the database
+   * handle it inherited from osquery.
+   */
+  static bool enabled() {
+    return FLAGS_hash_cache_persist &&
+           !isPlatform(PlatformType::TYPE_WINDOWS) && !isContainerWorker();
+  }
+
+  /// Read the persisted hashes of a file, false if missing or stale.
+  static bool get(const struct stat& st, MultiHashes& out);
+
+  /// Queue the hashes of a file to be persisted by the next flush.
+  static void put(const struct stat& st, const MultiHashes& hashes);
+
+  /// Write the queued hashes, evicting the least recently used when full.
+  static void flush();
+
+ private:
+  static std::string key(const struct stat& st) {
+    return std::to_string(st.st_dev) + "." + std::to_string(st.st_ino);
+  }
+
+  /// The file's identity used to validate a persisted hash.
+  static std::string version(const struct stat& st) {
+    return std::to_string(st.st_mtime) + "," + std::to_string(st.st_ctime) +
+           "," + std::to_string(st.st_size);
+  }
+
+  /// The last access time of a persisted value, 0 if it is malformed.
+  static long long accessTime(const std::vector<std::string>& fields) {
+    if (fields.size() != 7) {
+      return 0;
+    }
+    auto access_time = tryTo<long long>(fields[3]);
+    return access_time ? access_time.take() : 0;
+  }
+
+  /// Queue an entry recording the current time as its last access.
+  static void queue(const struct stat& st, const MultiHashes& hashes);
+
+  /// Delete the least recently used entries until the store has room.
+  static void evict();
+
+ private:
+  /// Synchronize the queued writes.
+  static Mutex pending_mutex_;
+
+  /// Entries queued by hash workers since the last flush.
+  static DatabaseStringValueList pending_;
+
+  /// Serialize flushes, and synchronize the entry count.
+  static Mutex flush_mutex_;
+
+  /// Upper bound of the persisted entries, counted at the first flush.
+  static size_t count_;
+  static bool counted_;
+};
+
+Mutex FileHashStore::pending_mutex_;
+DatabaseStringValueList FileHashStore::pending_;
+Mutex FileHashStore::flush_mutex_;
+size_t FileHashStore::count_{0};
+bool FileHashStore::counted_{false};
+
+bool FileHashStore::get(const struct stat& st, MultiHashes& out) {
+  if (!enabled()) {
+    return false;
+  }
+
+  std::string value;
+  if (!getDatabaseValue(kHashes, key(st), value).ok()) {
+    return false;
+  }
+
+  // The value is: mtime,ctime,size,access_time,md5,sha1,sha256
+  auto fields = split(value, ",");
+  if (fields.size() != 7 ||
+      fields[0] + "," + fields[1] + "," + fields[2] != version(st)) {
+    return false;
+  }
+
+  out.mask = HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256;
+  out.md5 = std::move(fields[4]);
+  out.sha1 = std::move(fields[5]);
+  out.sha256 = std::move(fields[6]);
+
+  // Refresh the access time of used entries, at most once per interval.
+  if (accessTime(fields) + kHashStoreTouchInterval < time(nullptr)) {
+    queue(st, out);
+  }
+  return true;
+}
+
+void FileHashStore::put(const struct stat& st, const MultiHashes& hashes) {
+  if (!enabled() || hashes.md5.empty() || hashes.sha1.empty() ||
+      hashes.sha256.empty()) {
+    return;
+  }
+
+  queue(st, hashes);
+}
+
+void FileHashStore::queue(const struct stat& st, const MultiHashes& hashes) {
+  auto value = version(st) + "," + std::to_string(time(nullptr)) + "," +
+               hashes.md5 + "," + hashes.sha1 + "," + hashes.sha256;
+
+  WriteLock lock(pending_mutex_);
+  pending_.emplace_back(key(st), std::move(value));
+}
+
+void FileHashStore::flush() {
+  DatabaseStringValueList data;
+  {
+    WriteLock lock(pending_mutex_);
+    data.swap(pending_);
+  }
+
+  if (data.empty()) {
+    return;
+  }
+
+  WriteLock lock(flush_mutex_);
+  if (!counted_) {
+    std::vector<std::string> keys;
+    if (!scanDatabaseKeys(kHashes, keys).ok()) {
+      return;
+    }
+    count_ = keys.size();
+    counted_ = true;
+  }
+
+  if (!setDatabaseBatch(kHashes, data).ok()) {
+    return;
+  }
+
+  // Rewritten entries are counted too, eviction recounts the store.
+  count_ += data.size();
+  if (count_ > FLAGS_hash_cache_persist_max) {
+    evict();
+  }
+}
+
+void FileHashStore::evict() {
+  // Keys are the decimal device and inode: they sort between "0" and ":".
+  DatabaseStringValueList entries;
+  if (!getDatabaseRange(kHashes, "0", ":", entries).ok()) {
+    return;
+  }
+
+  count_ = entries.size();
+  if (count_ <= FLAGS_hash_cache_persist_max) {
+    return;
+  }
 
-  WriteLock guard(mx);
+  // Evict the least recently used entries, and a chunk more to leave room.
+  std::vector<std::pair<long long, const std::string*>> order;
+  order.reserve(entries.size());
+  for (const auto& entry : entries) {
+    order.emplace_back(accessTime(split(entry.second, ",")), &entry.first);
+  }
+  std::sort(order.begin(), order.end());
+
+  auto evict_count = count_ - FLAGS_hash_cache_persist_max +
+                     FLAGS_hash_cache_persist_max / kHashStoreEvictDivisor;
+  evict_count = std::min(evict_count, order.size());
+  for (size_t i = 0; i < evict_count; i++) {
+    if (deleteDatabaseValue(kHashes, *order[i].second).ok()) {
+      count_--;
+    }
+  }
+}
 
+Status FileHashCache::load(const std::string& path,
+                           MultiHashes& out,
+                           HashRateLimiter& limiter) {
   struct stat st;
   if (stat(path.c_str(), &st) != 0) {
     char buf[0x200] = {0};
     strerror_r(errno, buf, sizeof(buf));
-    logger.log(google::GLOG_WARNING, "Cannot stat file: " + path + ": " + buf);
-    return false;
+    return Status::failure("Cannot stat file: " + path + ": " + buf);
+  }
+
+  auto& stripe = getFileHashCacheStripe(path);
+  {
+    WriteLock guard(stripe.mutex);
+    auto entry = stripe.cache.find(path);
+    if (entry != stripe.cache.end() && !statInvalid(st, entry->second)) {
+      // ok, got it
+      out = entry->second.hashes;
+      entry->second.cache_access_time = time(nullptr);
+      std::make_heap(stripe.lru.begin(), stripe.lru.end(), greater);
+      return Status::success();
+    }
   }
 
-  auto entry = cache.find(path);
-  if (entry == cache.end()) { // none, load
-    if (cache.size() >= FLAGS_hash_cache_max) {
+  // none or changed, check the persistent tier then hash without holding the
+  // stripe lock
+  if (!FileHashStore::get(st, out)) {
+    limiter.consume(static_cast<std::uint64_t>(st.st_size));
+    out = hashMultiFromFile(
+        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
+    FileHashStore::put(st, out);
+  }
+
+  WriteLock guard(stripe.mutex);
+  auto entry = stripe.cache.find(path);
+  if (entry == stripe.cache.end()) { // none, load
+    size_t stripe_max = std::max<size_t>(
+        1, (FLAGS_hash_cache_max + kHashCacheStripes - 1) / kHashCacheStripes);
+    if (stripe.cache.size() >= stripe_max) {
       // too large, evict
       for (size_t i = 0; i < kHashCacheEvictSize; ++i) {
-        if (lru.empty()) {
+        if (stripe.lru.empty()) {
           continue;
         }
-        std::string key = lru[0]->path;
-        std::pop_heap(lru.begin(), lru.end(), FileHashCache::greater);
-        lru.pop_back();
-        if (cache.find(key) != cache.end()) {
-          cache.erase(key);
-        }
+        std::string key = stripe.lru[0]->path;
+        std::pop_heap(stripe.lru.begin(), stripe.lru.end(), greater);
+        stripe.lru.pop_back();
+        stripe.cache.erase(key);
       }
     }
 
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
     FileHashCache rec = {st.st_mtime, // .file_mtime
                          st.st_ino, // .file_inode
                          st.st_size, // .file_size
                          time(nullptr), // .cache_access_time
-                         std::move(hashes), // .hashes
+                         out, // .hashes
                          path}; // .path
-    cache[path] = std::move(rec);
-    lru.push_back(&cache[path]);
-    std::push_heap(lru.begin(), lru.end(), FileHashCache::greater);
-    out = cache[path].hashes;
-  } else if (statInvalid(st, entry->second)) { // changed, update
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
+    auto& cached = stripe.cache[path];
+    cached = std::move(rec);
+    stripe.lru.push_back(&cached);
+    std::push_heap(stripe.lru.begin(), stripe.lru.end(), greater);
+  } else { // changed, update
     entry->second.cache_access_time = time(nullptr);
     entry->second.file_inode = st.st_ino;
     entry->second.file_mtime = st.st_mtime;
     entry->second.file_size = st.st_size;
-    entry->second.hashes = std::move(hashes);
-    std::make_heap(lru.begin(), lru.end(), FileHashCache::greater);
-    out = entry->second.hashes;
-  } else { // ok, got it
-    out = entry->second.hashes;
-    entry->second.cache_access_time = time(nullptr);
-    std::make_heap(lru.begin(), lru.end(), FileHashCache::greater);
+    entry->second.hashes = out;
+    std::make_heap(stripe.lru.begin(), stripe.lru.end(), greater);
   }
-  return true;
+  return Status::success();
 }
 
 Status genSsdeepForFile(const std::string& path, std::string& ssdeep_hash) {
@@ -209,46 +584,86 @@ Status genSsdeepForFile(const std::string& path, std::string& ssdeep_hash) {
 #endif
 }
 
-void genHashForFile(const std::string& path,
-                    const std::string& dir,
-                    QueryContext& context,
-                    QueryData& results,
-                    Logger& logger) {
-  // Must provide the path, filename, directory separate from boost path->string
-  // helpers to match any explicit (query-parsed) predicate constraints.
-  auto tr = TableRowHolder(new DynamicTableRow());
+/// A file selected by the query constraints and the hashes computed for it.
+struct HashTarget {
+  std::string path;
+  std::string directory;
+
+  /// Set when the inner-query cache already contains the row.
+  bool cached{false};
+
   MultiHashes hashes;
+  std::string ssdeep;
+
+  /// Warnings are collected by hash workers and logged by the query thread.
+  std::vector<std::string> warnings;
+};
+
+/**
+ * @brief Compute the hashes of a target file.
+ *
+ * This does not access the query context and may run on a hash worker.
+ */
+static void hashTarget(HashTarget& target,
+                       bool use_ssdeep,
+                       HashRateLimiter& limiter) {
   if (!FLAGS_disable_hash_cache) {
-    FileHashCache::load(path, hashes, logger);
+    auto status = FileHashCache::load(target.path, target.hashes, limiter);
+    if (!status.ok()) {
+      target.warnings.push_back(status.getMessage());
+    }
   } else {
-    if (context.isCached(path)) {
-      // Use the inner-query cache if the global hash cache is disabled.
-      // This protects against hashing the same content twice in the same query.
-      tr = context.getCache(path);
-    } else {
-      hashes = hashMultiFromFile(
-          HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-      std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_hash_delay));
+    boost::system::error_code ec;
+    auto size = boost::filesystem::file_size(target.path, ec);
+    limiter.consume(ec ? 0 : static_cast<std::uint64_t>(size));
+    target.hashes = hashMultiFromFile(
+        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, target.path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_hash_delay));
+  }
+
+  if (use_ssdeep) {
+    auto status = genSsdeepForFile(target.path, target.ssdeep);
+    if (!status.ok()) {
+      target.warnings.push_back(status.getMessage());
     }
   }
+}
 
-  DynamicTableRow& r = *dynamic_cast<DynamicTableRow*>(tr.get());
-  r["path"] = path;
-  r["directory"] = dir;
-  r["md5"] = std::move(hashes.md5);
-  r["sha1"] = std::move(hashes.sha1);
-  r["sha256"] = std::move(hashes.sha256);
+/// Add the result row for a hashed target, this runs on the query thread.
+static void addHashRow(HashTarget& target,
+                       QueryContext& context,
+                       QueryData& results,
+                       Logger& logger) {
+  for (const auto& warning : target.warnings) {
+    logger.log(google::GLOG_WARNING, warning);
+  }
 
-  if (isPlatform(PlatformType::TYPE_POSIX) && context.isColumnUsed("ssdeep")) {
-    auto status = genSsdeepForFile(path, r["ssdeep"]);
+  // Must provide the path, filename, directory separate from boost path->string
+  // helpers to match any explicit (query-parsed) predicate constraints.
+  TableRowHolder tr;
+  if (target.cached) {
+    // Use the inner-query cache if the global hash cache is disabled.
+    // This protects against hashing the same content twice in the same query.
+    tr = context.getCache(target.path);
+  } else {
+    tr = TableRowHolder(new DynamicTableRow());
+  }
 
-    if (!status.ok()) {
-      logger.log(google::GLOG_WARNING, status.getMessage());
+  DynamicTableRow& r = *dynamic_cast<DynamicTableRow*>(tr.get());
+  r["path"] = target.path;
+  r["directory"] = target.directory;
+  if (!target.cached) {
+    r["md5"] = std::move(target.hashes.md5);
+    r["sha1"] = std::move(target.hashes.sha1);
+    r["sha256"] = std::move(target.hashes.sha256);
+    if (isPlatform(PlatformType::TYPE_POSIX) &&
+        context.isColumnUsed("ssdeep")) {
+      r["ssdeep"] = std::move(target.ssdeep);
     }
   }
 
   if (FLAGS_disable_hash_cache) {
-    context.setCache(path, tr);
+    context.setCache(target.path, tr);
   }
 
   r["pid_with_namespace"] = "0";
@@ -256,6 +671,70 @@ void genHashForFile(const std::string& path,
   results.push_back(static_cast<Row>(r));
 }
 
+/**
+ * @brief Hash the targets and add a row for each, in target order.
+ *
+ * With more than one hash worker the files are hashed by the shared
+ * HashWorkerPool, at most hash_workers files at a time across all queries.
+ * A container worker is a forked process without the pool's threads and
+ * hashes on the calling thread. The query context and the logger are only
+ * used by the calling thread.
+ */
+static void genHashTargets(std::vector<HashTarget>& targets,
+                           QueryContext& context,
+                           QueryData& results,
+                           Logger& logger) {
+  auto use_ssdeep =
+      isPlatform(PlatformType::TYPE_POSIX) && context.isColumnUsed("ssdeep");
+  HashRateLimiter limiter(FLAGS_hash_rate_limit);
+
+  // A file may be selected by both a path and a directory constraint. It is
+  // hashed once, and its duplicates copy the hashes before rows are added.
+  std::vector<HashTarget*> pending;
+  std::map<std::string, HashTarget*> hashed;
+  std::vector<std::pair<HashTarget*, const HashTarget*>> duplicates;
+  for (auto& target : targets) {
+    target.cached = FLAGS_disable_hash_cache && context.isCached(target.path);
+    if (target.cached) {
+      continue;
+    }
+
+    auto first = hashed.emplace(target.path, &target);
+    if (first.second) {
+      pending.push_back(&target);
+    } else {
+      duplicates.emplace_back(&target, first.first->second);
+    }
+  }
+
+  if (FLAGS_hash_workers > 1 && pending.size() > 1 && !isContainerWorker()) {
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(pending.size());
+    for (auto* target : pending) {
+      tasks.push_back([target, &limiter, use_ssdeep]() {
+        hashTarget(*target, use_ssdeep, limiter);
+      });
+    }
+    HashWorkerPool::get().run(tasks, FLAGS_hash_workers);
+  } else {
+    for (auto* target : pending) {
+      hashTarget(*target, use_ssdeep, limiter);
+    }
+  }
+
+  // Persist the hashes computed by the workers in one batch.
+  FileHashStore::flush();
+
+  for (auto& duplicate : duplicates) {
+    duplicate.first->hashes = duplicate.second->hashes;
+    duplicate.first->ssdeep = duplicate.second->ssdeep;
+  }
+
+  for (auto& target : targets) {
+    addHashRow(target, context, results, logger);
+  }
+}
+
 void expandFSPathConstraints(QueryContext& context,
                              const std::string& path_column_name,
                              std::set<std::string>& paths) {
@@ -279,6 +758,7 @@ void expandFSPathConstraints(QueryContext& context,
 QueryData genHashImpl(QueryContext& context, Logger& logger) {
   QueryData results;
   boost::system::error_code ec;
+  std::vector<HashTarget> targets;
 
   // The query must provide a predicate with constraints including path or
   // directory. We search for the parsed predicate constraints with the equals
@@ -286,15 +766,17 @@ QueryData genHashImpl(QueryContext& context, Logger& logger) {
   auto paths = context.constraints["path"].getAll(EQUALS);
   expandFSPathConstraints(context, "path", paths);
 
-  // Iterate through the file paths, adding the hash results
+  // Iterate through the file paths, adding the hash targets
   for (const auto& path_string : paths) {
     boost::filesystem::path path = path_string;
     if (!boost::filesystem::is_regular_file(path, ec)) {
       continue;
     }
 
-    genHashForFile(
-        path_string, path.parent_path().string(), context, results, logger);
+    HashTarget target;
+    target.path = path_string;
+    target.directory = path.parent_path().string();
+    targets.push_back(std::move(target));
   }
 
   // Now loop through constraints using the directory column constraint.
@@ -308,17 +790,20 @@ QueryData genHashImpl(QueryContext& context, Logger& logger) {
       continue;
     }
 
-    // Iterate over the directory files and generate a hash for each regular
+    // Iterate over the directory files and add a target for each regular
     // file.
     boost::filesystem::directory_iterator begin(directory), end;
     for (; begin != end; ++begin) {
       if (boost::filesystem::is_regular_file(begin->path(), ec)) {
-        genHashForFile(
-            begin->path().string(), directory_string, context, results, logger);
+        HashTarget target;
+        target.path = begin->path().string();
+        target.directory = directory_string;
+        targets.push_back(std::move(target));
       }
     }
   }
 
+  genHashTargets(targets, context, results, logger);
   return results;
 }
 
@@ -24,6 +24,7 @@
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
 #include <osquery/logger/logger.h>
+#include <osquery/rows/processes.h>
 #include <osquery/sql/dynamic_table_row.h>
 
 #include <osquery/utils/conversions/split.h>
@@ -201,6 +202,44 @@ void genProcessMap(const std::string& pid, QueryData& results) {
   }
 }
 
+/**
+ * @brief The procfs sources needed by the columns used in a processes query.
+ *
+ * Each source is read per pid, so sources that only provide unused columns
+ * are skipped.
+ */
+struct ProcessSources {
+  bool stat{true};
+  bool status{true};
+  bool io{true};
+  bool cmdline{true};
+  bool exe{true};
+  bool on_disk{true};
+  bool cwd{true};
+  bool root{true};
+
+  explicit ProcessSources(const QueryContext& context);
+};
+
+ProcessSources::ProcessSources(const QueryContext& context) {
+  stat = context.isAnyColumnUsed(
+      ProcessesRow::STATE | ProcessesRow::PARENT | ProcessesRow::PGROUP |
+      ProcessesRow::NICE | ProcessesRow::THREADS | ProcessesRow::USER_TIME |
+      ProcessesRow::SYSTEM_TIME | ProcessesRow::START_TIME);
+  status = context.isAnyColumnUsed(
+      ProcessesRow::NAME | ProcessesRow::UID | ProcessesRow::GID |
+      ProcessesRow::EUID | ProcessesRow::EGID | ProcessesRow::SUID |
+      ProcessesRow::SGID | ProcessesRow::RESIDENT_SIZE |
+      ProcessesRow::TOTAL_SIZE);
+  io = context.isAnyColumnUsed(ProcessesRow::DISK_BYTES_READ |
+                               ProcessesRow::DISK_BYTES_WRITTEN);
+  cmdline = context.isAnyColumnUsed(ProcessesRow::CMDLINE);
+  on_disk = context.isAnyColumnUsed(ProcessesRow::ON_DISK);
+  exe = on_disk || context.isAnyColumnUsed(ProcessesRow::PATH);
+  cwd = context.isAnyColumnUsed(ProcessesRow::CWD);
+  root = context.isAnyColumnUsed(ProcessesRow::ROOT);
+}
+
 /**
  *  Output from string parsing /proc/<pid>/status.
  */
@@ -227,12 +266,13 @@ struct SimpleProcStat : private boost::noncopyable {
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcStat(const std::string& pid);
+  SimpleProcStat(const std::string& pid, const ProcessSources& sources);
 };
 
-SimpleProcStat::SimpleProcStat(const std::string& pid) {
+SimpleProcStat::SimpleProcStat(const std::string& pid,
+                               const ProcessSources& sources) {
   std::string content;
-  if (readFile(getProcAttr("stat", pid), content).ok()) {
+  if (sources.stat && readFile(getProcAttr("stat", pid), content).ok()) {
     auto start = content.find_last_of(")");
     // Start parsing stats from ") <MODE>..."
     if (start == std::string::npos || content.size() <= start + 2) {
@@ -256,6 +296,10 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
     this->start_time = details.at(19);
   }
 
+  if (!sources.status) {
+    return;
+  }
+
   // /proc/N/status may be not available, or readable by this user.
   if (!readFile(getProcAttr("status", pid), content).ok()) {
     status = Status(1, "Cannot read /proc/status");
@@ -394,11 +438,10 @@ int getOnDisk(const std::string& pid, std::string& path) {
 
 void genProcess(const std::string& pid,
                 long system_boot_time,
+                const ProcessSources& sources,
                 TableRows& results) {
   // Parse the process stat and status.
-  SimpleProcStat proc_stat(pid);
-  // Parse the process io
-  SimpleProcIo proc_io(pid);
+  SimpleProcStat proc_stat(pid, sources);
 
   if (!proc_stat.status.ok()) {
     VLOG(1) << proc_stat.status.getMessage() << " for pid " << pid;
@@ -407,56 +450,84 @@ void genProcess(const std::string& pid,
 
   auto r = make_table_row();
   r["pid"] = pid;
-  r["parent"] = proc_stat.parent;
-  r["path"] = readProcLink("exe", pid);
-  r["name"] = proc_stat.name;
-  r["pgroup"] = proc_stat.group;
-  r["state"] = proc_stat.state;
-  r["nice"] = proc_stat.nice;
-  r["threads"] = proc_stat.threads;
-  // Read/parse cmdline arguments.
-  r["cmdline"] = readProcCMDLine(pid);
-  r["cwd"] = readProcLink("cwd", pid);
-  r["root"] = readProcLink("root", pid);
-  r["uid"] = proc_stat.real_uid;
-  r["euid"] = proc_stat.effective_uid;
-  r["suid"] = proc_stat.saved_uid;
-  r["gid"] = proc_stat.real_gid;
-  r["egid"] = proc_stat.effective_gid;
-  r["sgid"] = proc_stat.saved_gid;
-
-  r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
+  if (sources.stat) {
+    r["parent"] = proc_stat.parent;
+    r["pgroup"] = proc_stat.group;
+    r["state"] = proc_stat.state;
+    r["nice"] = proc_stat.nice;
+    r["threads"] = proc_stat.threads;
+  }
+
+  if (sources.exe) {
+    r["path"] = readProcLink("exe", pid);
+  }
+
+  if (sources.cmdline) {
+    // Read/parse cmdline arguments.
+    r["cmdline"] = readProcCMDLine(pid);
+  }
+
+  if (sources.cwd) {
+    r["cwd"] = readProcLink("cwd", pid);
+  }
+
+  if (sources.root) {
+    r["root"] = readProcLink("root", pid);
+  }
+
+  if (sources.status) {
+    r["name"] = proc_stat.name;
+    r["uid"] = proc_stat.real_uid;
+    r["euid"] = proc_stat.effective_uid;
+    r["suid"] = proc_stat.saved_uid;
+    r["gid"] = proc_stat.real_gid;
+    r["egid"] = proc_stat.effective_gid;
+    r["sgid"] = proc_stat.saved_gid;
+  }
+
+  if (sources.on_disk) {
+    r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
+  }
 
   // size/memory information
   r["wired_size"] = "0"; // No support for unpagable counters in linux.
-  r["resident_size"] = proc_stat.resident_size;
-  r["total_size"] = proc_stat.total_size;
-
-  // time information
-  auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
-  r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
-  auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
-  r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
-
-  auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
-  if (proc_start_time_exp.isValue() && system_boot_time > 0) {
-    r["start_time"] = INTEGER(system_boot_time + proc_start_time_exp.take() /
-                                                     sysconf(_SC_CLK_TCK));
-  } else {
-    r["start_time"] = "-1";
+  if (sources.status) {
+    r["resident_size"] = proc_stat.resident_size;
+    r["total_size"] = proc_stat.total_size;
   }
 
-  if (!proc_io.status.ok()) {
-    // /proc/<pid>/io can require root to access, so don't fail if we can't
-    VLOG(1) << proc_io.status.getMessage();
-  } else {
-    r["disk_bytes_read"] = proc_io.read_bytes;
-    long long write_bytes = tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
-    long long cancelled_write_bytes =
-        tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
+  if (sources.stat) {
+    // time information
+    auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
+    r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
+    auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
+    r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
+
+    auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
+    if (proc_start_time_exp.isValue() && system_boot_time > 0) {
+      r["start_time"] = INTEGER(system_boot_time + proc_start_time_exp.take() /
+                                                       sysconf(_SC_CLK_TCK));
+    } else {
+      r["start_time"] = "-1";
+    }
+  }
 
-    r["disk_bytes_written"] =
-        std::to_string(write_bytes - cancelled_write_bytes);
+  if (sources.io) {
+    // Parse the process io
+    SimpleProcIo proc_io(pid);
+    if (!proc_io.status.ok()) {
+      // /proc/<pid>/io can require root to access, so don't fail if we can't
+      VLOG(1) << proc_io.status.getMessage();
+    } else {
+      r["disk_bytes_read"] = proc_io.read_bytes;
+      long long write_bytes =
+          tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
+      long long cancelled_write_bytes =
+          tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
+
+      r["disk_bytes_written"] =
+          std::to_string(write_bytes - cancelled_write_bytes);
+    }
   }
 
   results.push_back(r);
@@ -487,9 +558,12 @@ TableRows genProcesses(QueryContext& context) {
     system_boot_time = std::time(nullptr) - system_boot_time;
   }
 
+  // Only read the procfs sources needed by the used columns.
+  ProcessSources sources(context);
+
   auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genProcess(pid, system_boot_time, results);
+    genProcess(pid, system_boot_time, sources, results);
   }
 
   return results;
@@ -21,7 +21,7 @@
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/logger/logger.h>
-#include <osquery/sql/dynamic_table_row.h>
+#include <osquery/sql/slot_table_row.h>
 #include <osquery/worker/ipc/platform_table_container_ipc.h>
 #include <osquery/worker/logging/glog/glog_logger.h>
 
@@ -192,6 +192,17 @@ QueryData genRpmPackages(QueryContext& context) {
   }
 }
 
+/// Column positions of rpm_package_files, in the order of its spec.
+enum RpmFileColumn : size_t {
+  kRpmFilePackage,
+  kRpmFilePath,
+  kRpmFileUsername,
+  kRpmFileGroupname,
+  kRpmFileMode,
+  kRpmFileSize,
+  kRpmFileSha256,
+};
+
 void genRpmPackageFiles(RowYield& yield, QueryContext& context) {
   GLOGLogger logger;
   auto dropper = DropPrivileges::get();
@@ -241,21 +252,22 @@ void genRpmPackageFiles(RowYield& yield, QueryContext& context) {
 
     // Iterate over every file in this package.
     for (size_t i = 0; rpmfiNext(fi) >= 0 && i < file_count; i++) {
-      auto r = make_table_row();
+      // Packages may contain many files, reuse the row consumed by SQLite.
+      auto r = SlotTableRow::acquire(context);
       auto path = rpmfiFN(fi);
-      r["package"] = package_name;
-      r["path"] = (path != nullptr) ? path : "";
+      r->setText(kRpmFilePackage, package_name);
+      r->setText(kRpmFilePath, (path != nullptr) ? path : "");
       auto username = rpmfiFUser(fi);
-      r["username"] = (username != nullptr) ? username : "";
+      r->setText(kRpmFileUsername, (username != nullptr) ? username : "");
       auto groupname = rpmfiFGroup(fi);
-      r["groupname"] = (groupname != nullptr) ? groupname : "";
-      r["mode"] = lsperms(rpmfiFMode(fi));
-      r["size"] = BIGINT(rpmfiFSize(fi));
+      r->setText(kRpmFileGroupname, (groupname != nullptr) ? groupname : "");
+      r->setText(kRpmFileMode, lsperms(rpmfiFMode(fi)));
+      r->setInteger(kRpmFileSize, static_cast<long long>(rpmfiFSize(fi)));
 
       int digest_algo;
       auto digest = rpmfiFDigestHex(fi, &digest_algo);
       if (digest_algo == PGPHASHALGO_SHA256) {
-        r["sha256"] = (digest != nullptr) ? digest : "";
+        r->setText(kRpmFileSha256, (digest != nullptr) ? digest : "");
       }
       if (digest != nullptr) {
         free(digest);
@@ -7,6 +7,10 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <sys/stat.h>
+
+#include <thread>
+
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
@@ -28,6 +32,11 @@
 #include <osquery/utils/info/platform_type.h>
 
 namespace osquery {
+
+DECLARE_bool(hash_cache_persist);
+DECLARE_uint32(hash_cache_persist_max);
+DECLARE_uint32(hash_workers);
+
 namespace tables {
 
 class SystemsTablesTests : public testing::Test {
@@ -315,6 +324,8 @@ class HashTableTest : public testing::Test {
 
  protected:
   virtual void SetUp() {
+    initDatabasePluginForTesting();
+
     tmpPath = boost::filesystem::temp_directory_path();
     tmpPath /= boost::filesystem::unique_path(
         "osquery_hash_t_test-%%%%-%%%%-%%%%-%%%%");
@@ -379,5 +390,117 @@ TEST_F(HashTableTest, test_cache_updates) {
   EXPECT_NE(rows[0].at("md5"), contentMd5);
   EXPECT_EQ(rows[0].at("md5"), badContentMd5);
 }
+
+TEST_F(HashTableTest, test_cache_persists) {
+  SetContent(0);
+
+  auto persist = FLAGS_hash_cache_persist;
+  FLAGS_hash_cache_persist = true;
+  SQL results(qry);
+  FLAGS_hash_cache_persist = persist;
+  ASSERT_EQ(results.rows().size(), 1U);
+
+#ifndef WIN32
+  // The hashes are keyed by device and inode.
+  struct stat st;
+  ASSERT_EQ(stat(tmpPath.string().c_str(), &st), 0);
+  auto key = std::to_string(st.st_dev) + "." + std::to_string(st.st_ino);
+
+  std::string value;
+  ASSERT_TRUE(getDatabaseValue(kHashes, key, value).ok());
+  EXPECT_NE(value.find(contentMd5), std::string::npos);
+  EXPECT_NE(value.find(contentSha256), std::string::npos);
+  deleteDatabaseValue(kHashes, key);
+#endif
+}
+
+TEST_F(HashTableTest, test_cache_persist_evicts_least_recently_used) {
+#ifndef WIN32
+  // Seed entries last accessed long ago.
+  for (const auto& key : {"1.1", "1.2", "1.3"}) {
+    ASSERT_TRUE(setDatabaseValue(kHashes, key, "0,0,0,100,a,b,c").ok());
+  }
+  SetContent(0);
+
+  auto persist = FLAGS_hash_cache_persist;
+  auto persist_max = FLAGS_hash_cache_persist_max;
+  FLAGS_hash_cache_persist = true;
+  FLAGS_hash_cache_persist_max = 1;
+  SQL results(qry);
+  FLAGS_hash_cache_persist = persist;
+  FLAGS_hash_cache_persist_max = persist_max;
+  ASSERT_EQ(results.rows().size(), 1U);
+
+  // The store keeps the most recently used entry, the queried file.
+  std::string value;
+  for (const auto& key : {"1.1", "1.2", "1.3"}) {
+    EXPECT_FALSE(getDatabaseValue(kHashes, key, value).ok());
+  }
+
+  struct stat st;
+  ASSERT_EQ(stat(tmpPath.string().c_str(), &st), 0);
+  auto key = std::to_string(st.st_dev) + "." + std::to_string(st.st_ino);
+  EXPECT_TRUE(getDatabaseValue(kHashes, key, value).ok());
+  deleteDatabaseValue(kHashes, key);
+#endif
+}
+
+TEST_F(HashTableTest, test_parallel_hashing) {
+  auto directory = tmpPath;
+  ASSERT_TRUE(boost::filesystem::create_directory(directory));
+  for (size_t i = 0; i < 16; i++) {
+    writeTextFile(directory / std::to_string(i), content[i % 2]);
+  }
+
+  auto query = "select path, md5 from hash where directory = '" +
+               directory.string() + "' order by path";
+  auto workers = FLAGS_hash_workers;
+  FLAGS_hash_workers = 1;
+  SQL serial(query);
+  FLAGS_hash_workers = 4;
+  SQL parallel(query);
+  FLAGS_hash_workers = workers;
+
+  ASSERT_EQ(serial.rows().size(), 16U);
+  EXPECT_EQ(serial.rows(), parallel.rows());
+  for (const auto& row : parallel.rows()) {
+    EXPECT_TRUE(row.at("md5") == contentMd5 || row.at("md5") == badContentMd5);
+  }
+
+  boost::filesystem::remove_all(directory);
+}
+
+TEST_F(HashTableTest, test_concurrent_parallel_hashing) {
+  auto directory = tmpPath;
+  ASSERT_TRUE(boost::filesystem::create_directory(directory));
+  for (size_t i = 0; i < 16; i++) {
+    writeTextFile(directory / std::to_string(i), content[i % 2]);
+  }
+
+  auto query = "select path, md5 from hash where directory = '" +
+               directory.string() + "' order by path";
+  auto workers = FLAGS_hash_workers;
+  FLAGS_hash_workers = 1;
+  SQL serial(query);
+  ASSERT_EQ(serial.rows().size(), 16U);
+
+  // Concurrent queries share the same hash workers.
+  FLAGS_hash_workers = 2;
+  std::vector<QueryData> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&query, &result]() { result = SQL(query).rows(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  FLAGS_hash_workers = workers;
+
+  for (const auto& result : results) {
+    EXPECT_EQ(serial.rows(), result);
+  }
+
+  boost::filesystem::remove_all(directory);
+}
 } // namespace tables
 } // namespace osquery
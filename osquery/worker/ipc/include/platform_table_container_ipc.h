@@ -20,6 +20,10 @@ namespace osquery {
 using TableGeneratePtr = QueryData (*)(QueryContext& query_context,
                                        Logger& logger_);
 
+inline bool isContainerWorker() {
+  return false;
+}
+
 inline bool hasNamespaceConstraint(const QueryContext&) {
   return false;
 }
@@ -14,6 +14,7 @@
 #include <unordered_map>
 
 #include <osquery/core/sql/query_data.h>
+#include <osquery/worker/ipc/table_ipc_binary_converter.h>
 #include <osquery/worker/ipc/table_ipc_json_converter.h>
 
 #include <osquery/worker/logging/glog_logger_types.h>
@@ -23,23 +24,15 @@ template <typename Derived>
 class TableIPCBase {
  public:
   Status sendQueryData(const QueryData& query_data) {
-    JSON json_helper;
+    std::string message;
     auto status =
-        TableIPCJSONConverter::queryDataToJSON(query_data, json_helper);
+        TableIPCBinaryConverter::queryDataToBinary(query_data, message);
 
     if (!status.ok()) {
       return status;
     }
 
-    json_helper.add("Type", "QueryData");
-
-    std::string json_string;
-    status = json_helper.toString(json_string);
-
-    if (!status.ok())
-      return status;
-
-    return static_cast<Derived&>(*this).sendJSONString(json_string);
+    return static_cast<Derived&>(*this).sendJSONString(message);
   }
 
   Status sendLogMessage(int severity,
@@ -65,10 +58,11 @@ class TableIPCBase {
     return static_cast<Derived&>(*this).sendJSONString(json_string);
   }
 
-  Status sendJob(const QueryContext& context) {
+  Status sendJob(const std::string& table_name, const QueryContext& context) {
     JSON json_helper;
     serializeQueryContextJSON(context, json_helper);
     json_helper.add("Type", "Job");
+    json_helper.add("Table", table_name);
 
     std::string json_string;
     auto status = json_helper.toString(json_string);
@@ -88,7 +82,13 @@ class TableIPCBase {
       return status;
     }
 
-    status = json_message.fromString(json_string);
+    return parseJSONMessage(json_string, json_message, message_type);
+  }
+
+  Status parseJSONMessage(const std::string& json_string,
+                          JSON& json_message,
+                          JSONMessageType& message_type) {
+    auto status = json_message.fromString(json_string);
 
     if (!status.ok()) {
       return status;
@@ -104,8 +104,26 @@ class TableIPCBase {
 
   Status processOneMessage(QueryData* query_results,
                            JSONMessageType& message_type) {
+    std::string message;
+    auto status = static_cast<Derived&>(*this).recvJSONString(message);
+
+    if (!status.ok()) {
+      return status;
+    }
+
+    // Rows are framed in binary, every other message is JSON.
+    if (TableIPCBinaryConverter::isQueryDataMessage(message)) {
+      message_type = JSONMessageType::QueryData;
+      if (!query_results) {
+        return Status::failure(1, "Received unexpected QueryData message");
+      }
+
+      return TableIPCBinaryConverter::binaryToQueryData(message,
+                                                        *query_results);
+    }
+
     JSON json_message;
-    Status status = recvJSONMessage(json_message, message_type);
+    status = parseJSONMessage(message, json_message, message_type);
 
     if (!status.ok()) {
       return status;
@@ -116,16 +134,6 @@ class TableIPCBase {
       status = static_cast<Derived&>(*this).processLogMessage(json_message);
       break;
     }
-    case JSONMessageType::QueryData: {
-      if (!query_results) {
-        status = Status::failure(1, "Received unexpected QueryData message");
-        break;
-      }
-
-      status = static_cast<Derived&>(*this).processQueryDataMessage(
-          json_message, *query_results);
-      break;
-    }
     case JSONMessageType::Job: {
       status = static_cast<Derived&>(*this).processJobMessage(json_message);
       break;
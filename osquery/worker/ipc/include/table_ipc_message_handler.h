@@ -23,7 +23,8 @@ class TableIPCMessageHandler {
   virtual Status handleLog(GLOGLogType log_type,
                            int priority,
                            const std::string& message) = 0;
-  virtual Status handleJob(QueryContext& context) = 0;
+  virtual Status handleJob(const std::string& table_name,
+                           QueryContext& context) = 0;
 };
 
 } // namespace osquery
@@ -17,9 +17,14 @@
 #include <syslog.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
@@ -36,8 +41,20 @@ DECLARE_bool(verbose);
 CLI_FLAG(bool,
          keep_container_worker_open,
          false,
-         "Keep the container worker running to be reused instead of closing it "
-         "after each query");
+         "Keep the container workers running to be reused instead of closing "
+         "them after each query");
+
+CLI_FLAG(uint32,
+         container_worker_idle_timeout,
+         300,
+         "Seconds a container worker kept open can stay idle before it is "
+         "stopped");
+
+CLI_FLAG(uint32,
+         container_worker_pool_size,
+         256,
+         "Maximum number of container workers kept open, one per mount "
+         "namespace");
 
 namespace {
 
@@ -53,7 +70,14 @@ const std::string kMountNamespace = "/ns/mnt";
  */
 const int kMaxNamespaceIdLinkChars = 16;
 
-PlatformProcess current_running_process;
+/// Held while a worker is started, it inherits the state guarded by it.
+Mutex worker_fork_mutex;
+
+/// The table generators that new workers inherit.
+std::map<std::string, TableGeneratePtr> container_tables;
+
+/// Pipes to the running workers, new workers close them after the fork.
+std::set<int> worker_channel_fds;
 
 Status extractMountNamespaceId(const std::string& mount_namespace_path,
                                std::string& mount_namespace_id) {
@@ -133,97 +157,129 @@ ProcessState checkProcessStateAndLog(const PlatformProcess& process,
 extern template std::set<int> ConstraintList::getAll<int>(
     ConstraintOperator) const;
 
+/// Set in a forked container worker, before it runs any table generator.
+static bool kContainerWorker{false};
+
+bool isContainerWorker() {
+  return kContainerWorker;
+}
+
+void registerContainerTable(const std::string& table_name,
+                            TableGeneratePtr table_generate_ptr) {
+  {
+    ReadLock lock(worker_fork_mutex);
+    auto it = container_tables.find(table_name);
+    if (it != container_tables.end() && it->second == table_generate_ptr) {
+      return;
+    }
+  }
+
+  WriteLock lock(worker_fork_mutex);
+  container_tables[table_name] = table_generate_ptr;
+}
+
 LinuxTableContainerIPC::LinuxTableContainerIPC(PipeChannelFactory& factory)
     : ipc_(factory, *this) {}
 
-LinuxTableContainerIPC::~LinuxTableContainerIPC() {
-  close(original_mnt_fd_);
-}
+LinuxTableContainerIPC::~LinuxTableContainerIPC() {}
 
 Status LinuxTableContainerIPC::connectToContainer(
-    const std::string& table_name,
-    bool keep_process_open,
-    TableGeneratePtr function_ptr) {
+    const std::string& worker_name,
+    int mount_namespace_fd,
+    bool keep_process_open) {
+  stopContainerWorker();
   keep_process_open_ = keep_process_open;
 
-  auto current_pid = getpid();
-  std::string original_mnt_path =
-      kProc + "/" + std::to_string(current_pid) + kMountNamespace;
-
-  if (original_mnt_fd_ > 0) {
-    close(original_mnt_fd_);
-  }
+  auto process_group = getpgrp();
 
-  original_mnt_fd_ = open(original_mnt_path.c_str(), O_RDONLY);
+  // A worker holding a copy of the pipes of another worker would keep them
+  // open after they have been closed to stop that worker.
+  WriteLock lock(worker_fork_mutex);
+  PipeChannelTicket channel_ticket = ipc_.createChannelTicket();
 
-  if (original_mnt_fd_ < 0) {
-    return Status::failure(
-        "Failed to open the original mount namespace of the worker");
+  tables_.clear();
+  for (const auto& table : container_tables) {
+    tables_.insert(table.first);
   }
 
-  bool is_open = ipc_.setActiveChannelIfOpen(table_name);
+  pid_t pid = fork();
 
-  if (!is_open) {
-    // This will stop any worker connected to another table,
-    // so that we only have one open each time
-    if (keep_process_open_) {
-      stopContainerWorker();
-    }
+  if (pid == 0) {
+    kContainerWorker = true;
 
-    PipeChannelTicket channel_ticket = ipc_.createChannelTicket();
+    auto result = setpgid(0, process_group);
 
-    auto process_group = getpgrp();
-    table_generate_ptr_ = function_ptr;
+    if (result < 0) {
+      std::_Exit(1);
+    }
 
-    pid_t pid = fork();
+    for (auto fd : worker_channel_fds) {
+      close(fd);
+    }
 
-    if (pid == 0) {
-      auto result = setpgid(0, process_group);
+    if (mount_namespace_fd >= 0) {
+      // We call the syscall directly because setns() has been added as a
+      // function from glibc 2.14 and on only.
+      result = static_cast<int>(syscall(SYS_setns, mount_namespace_fd, 0));
 
       if (result < 0) {
+        syslog(LOG_NOTICE,
+               "Failed to enter the mount namespace of %s, error: %d",
+               worker_name.c_str(),
+               errno);
         std::_Exit(1);
       }
 
-      try {
-        ipc_.connectToParent(table_name, std::move(channel_ticket));
-      } catch (const std::exception& e) {
-        syslog(LOG_NOTICE, "Failed to connect to parent: %s", e.what());
-        std::_Exit(1);
-      }
+      close(mount_namespace_fd);
+    }
 
-      executeQueryJobs();
-    } else if (pid == -1) {
-      return Status::failure("Failed to start container worker to table " +
-                             table_name);
-    } else {
-      current_running_process = PlatformProcess(pid);
-      ipc_.connectToChild(table_name, std::move(channel_ticket), pid);
+    try {
+      ipc_.connectToParent(worker_name, std::move(channel_ticket));
+    } catch (const std::exception& e) {
+      syslog(LOG_NOTICE, "Failed to connect to parent: %s", e.what());
+      std::_Exit(1);
     }
+
+    executeQueryJobs();
+  } else if (pid == -1) {
+    return Status::failure("Failed to start container worker " + worker_name);
+  }
+
+  worker_process_ = PlatformProcess(pid);
+  ipc_.connectToChild(worker_name, std::move(channel_ticket), pid);
+
+  for (auto fd : ipc_.getChannelFds()) {
+    worker_channel_fds.insert(fd);
   }
 
   return Status::success();
 }
+
 void LinuxTableContainerIPC::stopContainerWorker() {
-  PlatformProcess child_process(std::move(current_running_process));
+  PlatformProcess child_process(std::move(worker_process_));
 
   if (child_process.pid() == kInvalidPid) {
     return;
   }
 
-  std::string table_name = ipc_.isChannelOpen()
-                               ? ipc_.getTableName()
-                               : ipc_.getTableNameFromPid(child_process.pid());
+  std::string worker_name = ipc_.getTableName();
 
-  ipc_.setActiveChannelIfOpen(table_name);
-  ipc_.closeActiveChannel();
+  {
+    // The descriptors must be forgotten before they can be reused.
+    WriteLock lock(worker_fork_mutex);
+    for (auto fd : ipc_.getChannelFds()) {
+      worker_channel_fds.erase(fd);
+    }
+    ipc_.closeActiveChannel();
+  }
 
   ProcessState process_state =
-      checkProcessStateAndLog(child_process, table_name);
+      checkProcessStateAndLog(child_process, worker_name);
 
   if (process_state == ProcessState::PROCESS_STILL_ALIVE) {
     // Wait for the process to close on a separate thread.
     // If it doesn't close in a timely fashion it will be forcefully terminated.
-    auto wait_and_kill = [](PlatformProcess process, std::string table_name) {
+    auto wait_and_kill = [](PlatformProcess process, std::string worker_name) {
       auto time_passed = std::chrono::milliseconds(0);
       auto interval = std::chrono::milliseconds(500);
       auto max_delay = std::chrono::milliseconds(2000);
@@ -233,7 +289,7 @@ void LinuxTableContainerIPC::stopContainerWorker() {
         sleepFor(static_cast<size_t>(interval.count()));
         time_passed += interval;
 
-        process_state = checkProcessStateAndLog(process, table_name);
+        process_state = checkProcessStateAndLog(process, worker_name);
 
         if (process_state == ProcessState::PROCESS_ERROR ||
             process_state == ProcessState::PROCESS_EXITED) {
@@ -242,7 +298,7 @@ void LinuxTableContainerIPC::stopContainerWorker() {
       }
 
       if (process_state == ProcessState::PROCESS_STILL_ALIVE) {
-        LOG(ERROR) << "Container worker to table " << table_name << " and pid "
+        LOG(ERROR) << "Container worker " << worker_name << " with pid "
                    << process.pid()
                    << " did not stop in a timely fashion, so it will be "
                       "forcefully terminated";
@@ -252,7 +308,7 @@ void LinuxTableContainerIPC::stopContainerWorker() {
     };
 
     auto wait_and_kill_thread =
-        std::thread(wait_and_kill, std::move(child_process), table_name);
+        std::thread(wait_and_kill, std::move(child_process), worker_name);
     wait_and_kill_thread.detach();
   }
 }
@@ -279,84 +335,18 @@ Status LinuxTableContainerIPC::handleLog(GLOGLogType log_type,
   return Status::success();
 }
 
-Status LinuxTableContainerIPC::handleJob(QueryContext& context) {
-  QueryData query_data;
-  auto pids_with_namespace =
-      context.constraints.at("pid_with_namespace").getAll<int>(EQUALS);
+Status LinuxTableContainerIPC::handleJob(const std::string& table_name,
+                                         QueryContext& context) {
+  // The worker is single threaded, the generators it inherited never change.
+  auto it = container_tables.find(table_name);
 
-  if (pids_with_namespace.empty()) {
-    return Status::failure(
-        "Column constraint pid_with_namespace has been passed but there's no "
-        "value in it");
+  if (it == container_tables.end()) {
+    return Status::failure("The container worker cannot generate table " +
+                           table_name);
   }
 
-  for (const auto pid : pids_with_namespace) {
-    std::string path = kProc + "/" + std::to_string(pid) + kMountNamespace;
-    auto fd = open(path.c_str(), O_RDONLY);
-
-    if (fd < 0) {
-      logger_.vlog(1,
-                   "Could not open mount namespace of pid " +
-                       std::to_string(pid) +
-                       ", error: " + std::to_string(errno));
-      continue;
-    }
-
-    std::string mount_namespace_id;
-    auto status = extractMountNamespaceId(path, mount_namespace_id);
-
-    if (!status.ok()) {
-      logger_.vlog(1, status.getMessage());
-      close(fd);
-      continue;
-    }
-
-    // We call the syscall directly because setns() has been added as a function
-    // from glibc 2.14 and on only.
-    int result = static_cast<int>(syscall(SYS_setns, fd, 0));
-
-    close(fd);
-
-    if (result < 0) {
-      logger_.vlog(1,
-                   "Could not switch namespace of pid " + std::to_string(pid) +
-                       ", error: " + std::to_string(errno));
-      continue;
-    }
-
-    QueryData namespace_query_data = table_generate_ptr_(context, logger_);
-    for (auto& row : namespace_query_data) {
-      row["pid_with_namespace"] = INTEGER(pid);
-      row["mount_namespace_id"] = mount_namespace_id;
-    }
-
-    query_data.insert(query_data.end(),
-                      std::make_move_iterator(namespace_query_data.begin()),
-                      std::make_move_iterator(namespace_query_data.end()));
-  }
-
-  /*
-    While we still want to return results to the parent,
-    but not being able to restore the original namespace means that
-    if the child is kept around, it won't be able to be reused.
-    So after delivering the results, we return with an error so
-    that the process will be always closed.
-  */
-  auto write_status = ipc_.sendQueryData(query_data);
-
-  if (keep_process_open_) {
-    int result = static_cast<int>(syscall(SYS_setns, original_mnt_fd_, 0));
-
-    if (result < 0) {
-      auto status = Status::failure(
-          "Failed to restore the original mount namespace, due to error: " +
-          std::to_string(errno));
-      logger_.vlog(1, status.getMessage());
-      return status;
-    }
-  }
-
-  return write_status;
+  QueryData query_data = it->second(context, logger_);
+  return ipc_.sendQueryData(query_data);
 }
 
 void LinuxTableContainerIPC::executeQueryJobs() {
@@ -392,9 +382,11 @@ void LinuxTableContainerIPC::executeQueryJobs() {
 }
 
 Status LinuxTableContainerIPC::retrieveQueryDataFromContainer(
-    const QueryContext& context, QueryData& result) {
+    const std::string& table_name,
+    const QueryContext& context,
+    QueryData& result) {
   CleanupWorkerOnError cleanupOnError(*this);
-  auto status = ipc_.sendJob(context);
+  auto status = ipc_.sendJob(table_name, context);
 
   if (!status.ok()) {
     return status;
@@ -417,39 +409,225 @@ Status LinuxTableContainerIPC::retrieveQueryDataFromContainer(
   return status;
 }
 
+Status ContainerWorkerPool::generate(const std::string& table_name,
+                                     const std::string& mount_namespace_id,
+                                     const std::vector<int>& pids,
+                                     const QueryContext& context,
+                                     QueryData& results) {
+  std::shared_ptr<Worker> worker;
+  auto status = getWorker(table_name, mount_namespace_id, pids, worker);
+
+  if (!status.ok()) {
+    return status;
+  }
+
+  WriteLock lock(worker->mutex);
+  status =
+      worker->ipc.retrieveQueryDataFromContainer(table_name, context, results);
+  worker->last_used = std::chrono::steady_clock::now();
+
+  // A worker that is not kept open exits after its job.
+  if (!status.ok() || !keep_process_open_) {
+    dropWorker(mount_namespace_id, worker);
+  }
+
+  return status;
+}
+
+Status ContainerWorkerPool::getWorker(const std::string& table_name,
+                                      const std::string& mount_namespace_id,
+                                      const std::vector<int>& pids,
+                                      std::shared_ptr<Worker>& worker) {
+  WriteLock lock(mutex_);
+  auto it = workers_.find(mount_namespace_id);
+
+  if (it != workers_.end() && it->second->ipc.hasTable(table_name)) {
+    worker = it->second;
+    return Status::success();
+  }
+
+  // Any process still in the namespace can be used to enter it, the pids
+  // may have been reused since the namespace ids were read.
+  int fd = -1;
+  for (const auto pid : pids) {
+    std::string path = kProc + "/" + std::to_string(pid) + kMountNamespace;
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+      continue;
+    }
+
+    struct stat namespace_stat;
+    if (fstat(fd, &namespace_stat) == 0 &&
+        std::to_string(namespace_stat.st_ino) == mount_namespace_id) {
+      break;
+    }
+
+    close(fd);
+    fd = -1;
+  }
+
+  if (fd < 0) {
+    return Status::failure("No process left in the mount namespace " +
+                           mount_namespace_id);
+  }
+
+  // A worker started before the table was registered is replaced, it stops
+  // once the jobs it is running are done.
+  auto new_worker = std::make_shared<Worker>();
+  auto status = new_worker->ipc.connectToContainer(
+      "mnt:[" + mount_namespace_id + "]", fd, keep_process_open_);
+  close(fd);
+
+  if (!status.ok()) {
+    return status;
+  }
+
+  new_worker->last_used = std::chrono::steady_clock::now();
+  workers_[mount_namespace_id] = new_worker;
+  worker = std::move(new_worker);
+  return Status::success();
+}
+
+void ContainerWorkerPool::dropWorker(const std::string& mount_namespace_id,
+                                     const std::shared_ptr<Worker>& worker) {
+  WriteLock lock(mutex_);
+  auto it = workers_.find(mount_namespace_id);
+
+  if (it != workers_.end() && it->second == worker) {
+    workers_.erase(it);
+  }
+}
+
+void ContainerWorkerPool::evict(std::chrono::seconds idle_timeout,
+                                size_t max_workers) {
+  // Stopped once the pool is unlocked.
+  std::vector<std::shared_ptr<Worker>> stopped;
+
+  WriteLock lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+
+  std::vector<std::pair<std::chrono::steady_clock::time_point, std::string>>
+      idle;
+  for (auto it = workers_.begin(); it != workers_.end();) {
+    WriteLock worker_lock(it->second->mutex, boost::try_to_lock);
+
+    if (!worker_lock.owns_lock()) {
+      ++it;
+      continue;
+    }
+
+    if (now - it->second->last_used >= idle_timeout) {
+      stopped.push_back(it->second);
+      it = workers_.erase(it);
+      continue;
+    }
+
+    idle.emplace_back(it->second->last_used, it->first);
+    ++it;
+  }
+
+  std::sort(idle.begin(), idle.end());
+  for (const auto& worker : idle) {
+    if (workers_.size() <= max_workers) {
+      break;
+    }
+
+    auto it = workers_.find(worker.second);
+    stopped.push_back(it->second);
+    workers_.erase(it);
+  }
+}
+
+size_t ContainerWorkerPool::size() {
+  ReadLock lock(mutex_);
+  return workers_.size();
+}
+
 QueryData generateInNamespace(const QueryContext& context,
                               const std::string& table_name,
                               TableGeneratePtr generate_ptr) {
-  bool keep_container_worker_open = FLAGS_keep_container_worker_open;
   QueryData results;
 
-  static PipeChannelFactory factory;
+  auto pids_with_namespace =
+      context.constraints.at("pid_with_namespace").getAll<int>(EQUALS);
 
-  try {
-    LinuxTableContainerIPC ipc(factory);
-    auto status = ipc.connectToContainer(
-        table_name, keep_container_worker_open, generate_ptr);
+  if (pids_with_namespace.empty()) {
+    LOG(ERROR) << "Table " << table_name
+               << " has a pid_with_namespace constraint without a value";
+    return results;
+  }
+
+  // The processes of a mount namespace see the same files, the rows are
+  // generated once and then reported for each of them.
+  std::map<std::string, std::vector<int>> namespaces;
+  for (const auto pid : pids_with_namespace) {
+    std::string path = kProc + "/" + std::to_string(pid) + kMountNamespace;
+    std::string mount_namespace_id;
+    auto status = extractMountNamespaceId(path, mount_namespace_id);
 
     if (!status.ok()) {
-      LOG(ERROR) << "Table " << table_name
-                 << " failed to connect to the container: "
-                 << status.getMessage();
-      return results;
+      VLOG(1) << status.getMessage();
+      continue;
     }
 
-    status = ipc.retrieveQueryDataFromContainer(context, results);
+    namespaces[mount_namespace_id].push_back(pid);
+  }
 
-    if (!status.ok()) {
+  registerContainerTable(table_name, generate_ptr);
+
+  // Never destroyed, the workers exit on their own with the process.
+  static auto* kept_workers = new ContainerWorkerPool(true);
+  ContainerWorkerPool query_workers(false);
+  auto& workers =
+      FLAGS_keep_container_worker_open ? *kept_workers : query_workers;
+
+  for (const auto& mount_namespace : namespaces) {
+    QueryData namespace_results;
+
+    try {
+      auto status = workers.generate(table_name,
+                                     mount_namespace.first,
+                                     mount_namespace.second,
+                                     context,
+                                     namespace_results);
+
+      if (!status.ok()) {
+        LOG(ERROR) << "Table " << table_name
+                   << " failed to run in the mount namespace "
+                   << mount_namespace.first << ": " << status.getMessage();
+        continue;
+      }
+    } catch (const std::exception& e) {
       LOG(ERROR) << "Table " << table_name
-                 << " failed to retrieve QueryData from the container: "
-                 << status.getMessage();
+                 << " failed to run query in the container: " << e.what();
+      continue;
     }
 
-    if (!keep_container_worker_open)
-      ipc.stopContainerWorker();
-  } catch (const std::exception& e) {
-    LOG(ERROR) << "Table " << table_name
-               << " failed to run query in the container: " << e.what();
+    const auto& pids = mount_namespace.second;
+    for (size_t i = 0; i < pids.size(); i++) {
+      auto begin = results.size();
+
+      // The rows are copied for every process but the last.
+      if (i + 1 < pids.size()) {
+        results.insert(
+            results.end(), namespace_results.begin(), namespace_results.end());
+      } else {
+        results.insert(results.end(),
+                       std::make_move_iterator(namespace_results.begin()),
+                       std::make_move_iterator(namespace_results.end()));
+      }
+
+      for (auto row = results.begin() + begin; row != results.end(); ++row) {
+        (*row)["pid_with_namespace"] = INTEGER(pids[i]);
+        (*row)["mount_namespace_id"] = mount_namespace.first;
+      }
+    }
+  }
+
+  if (FLAGS_keep_container_worker_open) {
+    workers.evict(std::chrono::seconds(FLAGS_container_worker_idle_timeout),
+                  FLAGS_container_worker_pool_size);
   }
 
   return results;
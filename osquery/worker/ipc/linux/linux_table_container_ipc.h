@@ -11,10 +11,17 @@
 
 #include "osquery/worker/ipc/linux/linux_table_ipc.h"
 
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <osquery/core/tables.h>
 #include <osquery/logger/logger.h>
+#include <osquery/process/process.h>
+#include <osquery/utils/mutex.h>
 #include <osquery/utils/status/status.h>
 
 #include "osquery/worker/ipc/posix/pipe_channel.h"
@@ -27,10 +34,29 @@ namespace osquery {
 using TableGeneratePtr = QueryData (*)(QueryContext& query_context,
                                        Logger& logger_);
 
+/**
+ * @brief Make a table generator available to the container workers.
+ *
+ * Workers inherit the generators registered before they are started.
+ */
+void registerContainerTable(const std::string& table_name,
+                            TableGeneratePtr table_generate_ptr);
+
+/**
+ * @brief Check if this process is a container worker.
+ *
+ * A worker is forked from osquery and must not use resources owned by the
+ * parent, such as the database.
+ */
+bool isContainerWorker();
+
 /**
  * @brief The LinuxTableContainerIPC class drives the logic to connect to, query
  * and retrieve results from a container, together with managing the container
  * worker lifetime.
+ *
+ * The worker enters the mount namespace of the container once, when it starts,
+ * and then runs jobs for any of the tables it inherited.
  */
 class LinuxTableContainerIPC : TableIPCMessageHandler {
  public:
@@ -38,25 +64,43 @@ class LinuxTableContainerIPC : TableIPCMessageHandler {
   LinuxTableContainerIPC(PipeChannelFactory& factory);
   ~LinuxTableContainerIPC();
 
-  Status connectToContainer(const std::string& table_name,
-                            bool keep_process_open,
-                            TableGeneratePtr table_generate_ptr_);
-  Status retrieveQueryDataFromContainer(const QueryContext& context,
+  /**
+   * @brief Start a worker and connect to it.
+   *
+   * @param worker_name the name of the channel to the worker.
+   * @param mount_namespace_fd the mount namespace the worker enters, -1 to
+   * stay in the current one.
+   * @param keep_process_open serve jobs until the worker is stopped, instead
+   * of exiting after the first one.
+   */
+  Status connectToContainer(const std::string& worker_name,
+                            int mount_namespace_fd,
+                            bool keep_process_open);
+  Status retrieveQueryDataFromContainer(const std::string& table_name,
+                                        const QueryContext& context,
                                         QueryData& result);
   [[noreturn]] void executeQueryJobs();
   void stopContainerWorker();
 
+  /// Check if the worker inherited the generator of a table.
+  bool hasTable(const std::string& table_name) const {
+    return tables_.count(table_name) > 0;
+  }
+
   Status handleLog(GLOGLogType log_type,
                    int priority,
                    const std::string& message) override;
-  Status handleJob(QueryContext& context) override;
+  Status handleJob(const std::string& table_name,
+                   QueryContext& context) override;
 
  private:
   LinuxTableIPC ipc_;
   LinuxTableIPCLogger logger_{ipc_};
-  TableGeneratePtr table_generate_ptr_;
   bool keep_process_open_{false};
-  int original_mnt_fd_{-1};
+  PlatformProcess worker_process_;
+
+  /// The tables registered when the worker was started.
+  std::set<std::string> tables_;
 
   class CleanupWorkerOnError {
    public:
@@ -80,6 +124,74 @@ class LinuxTableContainerIPC : TableIPCMessageHandler {
   FRIEND_TEST(WorkerTableContainerTests, test_ipc_container_connect);
 };
 
+/**
+ * @brief Container workers, one for each mount namespace.
+ *
+ * Workers serve every table queried in their namespace until they are
+ * evicted, or until the pool is destroyed.
+ */
+class ContainerWorkerPool {
+ public:
+  explicit ContainerWorkerPool(bool keep_process_open)
+      : keep_process_open_(keep_process_open) {}
+
+  /**
+   * @brief Run a table generator in a mount namespace.
+   *
+   * @param table_name a table registered with registerContainerTable.
+   * @param mount_namespace_id the id of the mount namespace.
+   * @param pids processes in the namespace, used to start its worker.
+   * @param context the query context given to the generator.
+   * @param results [output] the generated rows.
+   */
+  Status generate(const std::string& table_name,
+                  const std::string& mount_namespace_id,
+                  const std::vector<int>& pids,
+                  const QueryContext& context,
+                  QueryData& results);
+
+  /**
+   * @brief Stop idle workers.
+   *
+   * Workers idle for longer than the timeout are stopped, then the least
+   * recently used ones until at most max_workers are left. Busy workers are
+   * never stopped.
+   */
+  void evict(std::chrono::seconds idle_timeout, size_t max_workers);
+
+  /// The number of running workers.
+  size_t size();
+
+ private:
+  struct Worker {
+    Worker() : ipc(factory) {}
+    ~Worker() {
+      ipc.stopContainerWorker();
+    }
+
+    /// Held while the worker runs a job.
+    Mutex mutex;
+    PipeChannelFactory factory;
+    LinuxTableContainerIPC ipc;
+    std::chrono::steady_clock::time_point last_used;
+  };
+
+  /// Get the worker of a namespace, starting one if needed.
+  Status getWorker(const std::string& table_name,
+                   const std::string& mount_namespace_id,
+                   const std::vector<int>& pids,
+                   std::shared_ptr<Worker>& worker);
+
+  /// Forget a worker, unless it was already replaced.
+  void dropWorker(const std::string& mount_namespace_id,
+                  const std::shared_ptr<Worker>& worker);
+
+ private:
+  bool keep_process_open_{false};
+  Mutex mutex_;
+  std::map<std::string, std::shared_ptr<Worker>> workers_;
+};
+
 inline bool hasNamespaceConstraint(const QueryContext& context) {
   return context.hasConstraint("pid_with_namespace");
 }
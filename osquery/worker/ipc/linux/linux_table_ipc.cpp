@@ -49,6 +49,11 @@ Status LinuxTableIPC::processLogMessage(const JSON& json_message) {
 }
 
 Status LinuxTableIPC::processJobMessage(const JSON& json_message) {
+  const auto& doc = json_message.doc();
+  if (!doc.HasMember("Table") || !doc["Table"].IsString()) {
+    return Status::failure("Job message has no Table member");
+  }
+
   QueryContext context;
 
   auto status = deserializeQueryContextJSON(json_message, context);
@@ -58,19 +63,7 @@ Status LinuxTableIPC::processJobMessage(const JSON& json_message) {
     return Status::failure(error_message);
   }
 
-  return message_handler_->handleJob(context);
-}
-
-Status LinuxTableIPC::processQueryDataMessage(const JSON& json_message,
-                                              QueryData& query_results) {
-  auto status =
-      TableIPCJSONConverter::JSONToQueryData(json_message, query_results);
-
-  if (!status.ok()) {
-    return status;
-  }
-
-  return Status::success();
+  return message_handler_->handleJob(doc["Table"].GetString(), context);
 }
 
 bool LinuxTableIPC::setActiveChannelIfOpen(const std::string table_name) {
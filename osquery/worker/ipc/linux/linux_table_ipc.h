@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <osquery/worker/ipc/posix/pipe_channel.h>
 #include <osquery/worker/ipc/posix/pipe_channel_factory.h>
 
@@ -21,8 +23,8 @@ namespace osquery {
 
 /**
  * @brief The LinuxTableIPC class manages the communication and connection
- * between processes handling table logic, using JSON as message protocol and
- * blocking pipes as communication channel.
+ * between processes handling table logic, using JSON as message protocol,
+ * binary framing for rows, and blocking pipes as communication channel.
  *
  */
 class LinuxTableIPC : public TableIPCBase<LinuxTableIPC> {
@@ -36,8 +38,6 @@ class LinuxTableIPC : public TableIPCBase<LinuxTableIPC> {
 
   Status processLogMessage(const JSON& json_message);
   Status processJobMessage(const JSON& json_message);
-  Status processQueryDataMessage(const JSON& json_message,
-                                 QueryData& query_results);
 
   PipeChannelTicket createChannelTicket() {
     return factory_->createChannelTicket();
@@ -59,6 +59,15 @@ class LinuxTableIPC : public TableIPCBase<LinuxTableIPC> {
   pid_t getRemotePid() {
     return active_channel_ ? active_channel_->getRemotePid() : -1;
   }
+
+  /// The pipe descriptors of the active channel, empty if not connected.
+  std::vector<int> getChannelFds() {
+    if (active_channel_ == nullptr) {
+      return {};
+    }
+    return {active_channel_->getReadFd(), active_channel_->getWriteFd()};
+  }
+
   std::string getTableName() {
     return active_channel_ ? active_channel_->table_name_ : "Not Connected";
   }
@@ -7,6 +7,13 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <osquery/core/tables.h>
@@ -43,9 +50,16 @@ TEST_F(WorkerTableContainerTests, test_ipc_container_connect) {
   PipeChannelFactory factory;
 
   LinuxTableContainerIPC container_ipc(factory);
+  registerContainerTable("test", genTest1);
 
-  auto status = container_ipc.connectToContainer("test", false, genTest1);
+  int mount_namespace_fd = open("/proc/self/ns/mnt", O_RDONLY);
+  ASSERT_GE(mount_namespace_fd, 0);
+
+  auto status =
+      container_ipc.connectToContainer("test", mount_namespace_fd, false);
+  close(mount_namespace_fd);
   ASSERT_TRUE(status.ok()) << status.getMessage();
+  EXPECT_TRUE(container_ipc.hasTable("test"));
 
   auto my_pid = getpid();
 
@@ -62,7 +76,8 @@ TEST_F(WorkerTableContainerTests, test_ipc_container_connect) {
   ASSERT_EQ(constraints.size(), 1);
 
   QueryData results;
-  status = container_ipc.retrieveQueryDataFromContainer(context, results);
+  status =
+      container_ipc.retrieveQueryDataFromContainer("test", context, results);
   ASSERT_TRUE(status.ok()) << status.getMessage();
 
   ASSERT_EQ(results.size(), 1);
@@ -71,4 +86,65 @@ TEST_F(WorkerTableContainerTests, test_ipc_container_connect) {
 
   container_ipc.stopContainerWorker();
 }
+
+QueryData genContainerWorker(QueryContext&, Logger&) {
+  Row r;
+  r["container_worker"] = isContainerWorker() ? "1" : "0";
+  return {r};
+}
+
+TEST_F(WorkerTableContainerTests, test_is_container_worker) {
+  registerContainerTable("container_worker", genContainerWorker);
+
+  struct stat namespace_stat;
+  ASSERT_EQ(stat("/proc/self/ns/mnt", &namespace_stat), 0);
+  auto mount_namespace_id = std::to_string(namespace_stat.st_ino);
+  std::vector<int> pids = {getpid()};
+
+  // Generators run by a worker see that they are not in osquery itself.
+  ContainerWorkerPool pool(false);
+  QueryContext context;
+  QueryData results;
+  auto status = pool.generate(
+      "container_worker", mount_namespace_id, pids, context, results);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results[0]["container_worker"], "1");
+  EXPECT_FALSE(isContainerWorker());
+}
+
+TEST_F(WorkerTableContainerTests, test_container_worker_pool) {
+  registerContainerTable("test", genTest1);
+
+  struct stat namespace_stat;
+  ASSERT_EQ(stat("/proc/self/ns/mnt", &namespace_stat), 0);
+  auto mount_namespace_id = std::to_string(namespace_stat.st_ino);
+  std::vector<int> pids = {getpid()};
+
+  ContainerWorkerPool pool(true);
+  QueryContext context;
+
+  // The worker started for the first job runs the next ones.
+  for (size_t i = 0; i < 3; i++) {
+    QueryData results;
+    auto status =
+        pool.generate("test", mount_namespace_id, pids, context, results);
+    ASSERT_TRUE(status.ok()) << status.getMessage();
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results[0]["test"], "Hello");
+    EXPECT_EQ(pool.size(), 1);
+  }
+
+  pool.evict(std::chrono::seconds(300), 1);
+  EXPECT_EQ(pool.size(), 1);
+
+  pool.evict(std::chrono::seconds(0), 1);
+  EXPECT_EQ(pool.size(), 0);
+
+  // A namespace without processes cannot be entered.
+  QueryData results;
+  auto status = pool.generate("test", "0", pids, context, results);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(pool.size(), 0);
+}
 } // namespace osquery
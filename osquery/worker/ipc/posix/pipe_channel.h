@@ -33,6 +33,14 @@ class PipeChannel : public TableChannelBase<PipeChannel> {
     return remote_pid;
   }
 
+  int getReadFd() const {
+    return read_pipe_fd;
+  }
+
+  int getWriteFd() const {
+    return write_pipe_fd;
+  }
+
  private:
   friend TableChannelBase<PipeChannel>;
 
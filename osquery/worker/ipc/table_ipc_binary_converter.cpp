@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "table_ipc_binary_converter.h"
+
+#include <cstdint>
+#include <iterator>
+
+#include <osquery/core/sql/row_binary.h>
+
+namespace osquery {
+
+namespace {
+
+/// First byte of a binary rows message, JSON messages start with '{'.
+const char kQueryDataMarker = '\x01';
+
+} // namespace
+
+bool TableIPCBinaryConverter::isQueryDataMessage(const std::string& message) {
+  return !message.empty() && message[0] == kQueryDataMarker;
+}
+
+Status TableIPCBinaryConverter::queryDataToBinary(const QueryData& query_data,
+                                                  std::string& message) {
+  ColumnDictionary dictionary;
+  std::string chunk;
+  serializeColumnChunk(query_data, dictionary, chunk);
+
+  std::string columns;
+  dictionary.serialize(columns);
+
+  message.clear();
+  message.push_back(kQueryDataMarker);
+  putVarint(message, columns.size());
+  message.append(columns);
+  message.append(chunk);
+  return Status::success();
+}
+
+Status TableIPCBinaryConverter::binaryToQueryData(const std::string& message,
+                                                  QueryData& query_data) {
+  if (!isQueryDataMessage(message)) {
+    return Status::failure("Not a binary QueryData message");
+  }
+
+  std::size_t offset = 1;
+  std::uint64_t size = 0;
+  if (!getVarint(message, offset, size) || size > message.size() - offset) {
+    return Status::failure("Truncated columns in QueryData message");
+  }
+
+  ColumnDictionary dictionary;
+  auto status = dictionary.deserialize(
+      message.substr(offset, static_cast<std::size_t>(size)));
+  if (!status.ok()) {
+    return status;
+  }
+  offset += static_cast<std::size_t>(size);
+
+  QueryData rows;
+  status = deserializeColumnChunk(message.substr(offset), dictionary, rows);
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (query_data.empty()) {
+    query_data = std::move(rows);
+  } else {
+    query_data.insert(query_data.end(),
+                      std::make_move_iterator(rows.begin()),
+                      std::make_move_iterator(rows.end()));
+  }
+  return Status::success();
+}
+} // namespace osquery
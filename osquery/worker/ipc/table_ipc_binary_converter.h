@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <string>
+
+#include <osquery/core/sql/query_data.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/**
+ * @brief Binary framing of the rows sent by a container worker.
+ *
+ * The message starts with a marker byte that cannot start a JSON message,
+ * followed by the varint length of the serialized ColumnDictionary, the
+ * dictionary and the rows as a column chunk, see row_binary.h. Each column
+ * name is sent once per message.
+ */
+class TableIPCBinaryConverter {
+ public:
+  /// Check if a message holds binary rows rather than JSON.
+  static bool isQueryDataMessage(const std::string& message);
+
+  static Status queryDataToBinary(const QueryData& query_data,
+                                  std::string& message);
+  static Status binaryToQueryData(const std::string& message,
+                                  QueryData& query_data);
+};
+} // namespace osquery
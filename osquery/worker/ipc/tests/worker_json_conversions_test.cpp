@@ -15,12 +15,19 @@
 #include <osquery/core/tables.h>
 #include <osquery/utils/status/status.h>
 #include <osquery/worker/ipc/table_ipc_base.h>
+#include <osquery/worker/ipc/table_ipc_binary_converter.h>
 
 namespace osquery {
 
 class TestTableIPC : public TableIPCBase<TestTableIPC> {
  public:
   Status sendJSONString(const std::string json_string) {
+    message = json_string;
+
+    if (TableIPCBinaryConverter::isQueryDataMessage(message)) {
+      return Status::success();
+    }
+
     auto status = json_helper.fromString(json_string);
 
     if (!status.ok()) {
@@ -31,9 +38,11 @@ class TestTableIPC : public TableIPCBase<TestTableIPC> {
   }
 
   Status recvJSONString(std::string& json_string) {
-    return json_helper.toString(json_string);
+    json_string = message;
+    return Status::success();
   }
 
+  std::string message;
   JSON json_helper;
 };
 
@@ -60,11 +69,12 @@ TEST_F(WorkerJSONConversionsTests, test_querydata_and_json_conversions) {
   r2["column2"] = "2";
   data.push_back(r2);
 
-  TestTableIPC ipc;
-  auto status = ipc.sendQueryData(data);
+  JSON json_helper;
+  auto status = TableIPCJSONConverter::queryDataToJSON(data, json_helper);
   ASSERT_TRUE(status.ok()) << status.getMessage();
+  json_helper.add("Type", "QueryData");
 
-  auto& rapidjson_doc = ipc.json_helper.doc();
+  auto& rapidjson_doc = json_helper.doc();
 
   ASSERT_TRUE(rapidjson_doc.IsObject());
 
@@ -94,8 +104,8 @@ TEST_F(WorkerJSONConversionsTests, test_querydata_and_json_conversions) {
   EXPECT_EQ(std::string(query_data_array[1]["column2"].GetString()), "2");
 
   JSONMessageType message_type;
-  JSON json_helper;
-  status = ipc.recvJSONMessage(json_helper, message_type);
+  status = TableIPCJSONConverter::JSONTypeToMessageType(json_helper,
+                                                       message_type);
   ASSERT_TRUE(status.ok()) << status.getMessage();
   ASSERT_TRUE(message_type == JSONMessageType::QueryData);
 
@@ -119,6 +129,48 @@ TEST_F(WorkerJSONConversionsTests, test_querydata_and_json_conversions) {
   EXPECT_FALSE(status.ok()) << status.getMessage();
 }
 
+TEST_F(WorkerJSONConversionsTests, test_querydata_and_binary_conversions) {
+  QueryData data;
+  Row r1;
+  r1["column1"] = "test";
+  r1["column2"] = std::string("with\0zero", 9);
+  data.push_back(r1);
+
+  Row r2;
+  r2["column1"] = std::string(300, 'x');
+  r2["column3"] = "";
+  data.push_back(r2);
+
+  data.push_back(Row());
+
+  TestTableIPC ipc;
+  auto status = ipc.sendQueryData(data);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_TRUE(TableIPCBinaryConverter::isQueryDataMessage(ipc.message));
+
+  // Column names are only sent once.
+  EXPECT_EQ(ipc.message.find("column1"), ipc.message.rfind("column1"));
+
+  JSONMessageType message_type;
+  QueryData read_query_data;
+  status = ipc.processOneMessage(&read_query_data, message_type);
+  ASSERT_TRUE(status.ok()) << status.getMessage();
+  ASSERT_TRUE(message_type == JSONMessageType::QueryData);
+  EXPECT_EQ(read_query_data, data);
+
+  // A worker never expects rows.
+  status = ipc.processOneMessage(nullptr, message_type);
+  EXPECT_FALSE(status.ok());
+
+  // Truncated messages are rejected.
+  for (size_t size = 1; size < ipc.message.size(); ++size) {
+    QueryData truncated;
+    status = TableIPCBinaryConverter::binaryToQueryData(
+        ipc.message.substr(0, size), truncated);
+    EXPECT_FALSE(status.ok()) << "size " << size;
+  }
+}
+
 TEST_F(WorkerJSONConversionsTests, test_log_message_and_json_conversions) {
   TestTableIPC ipc;
   auto status =
@@ -180,7 +232,7 @@ TEST_F(WorkerJSONConversionsTests, test_job_and_json_conversions) {
   used_columns.emplace("job_test_3");
   context.colsUsed = std::move(used_columns);
 
-  auto status = ipc.sendJob(context);
+  auto status = ipc.sendJob("job_test", context);
 
   ASSERT_TRUE(status.ok()) << status.getMessage();
 
@@ -190,6 +242,10 @@ TEST_F(WorkerJSONConversionsTests, test_job_and_json_conversions) {
 
   verifyMessageType(rapidjson_doc, "Job");
 
+  ASSERT_TRUE(rapidjson_doc.HasMember("Table"));
+  ASSERT_TRUE(rapidjson_doc["Table"].IsString());
+  EXPECT_EQ(std::string(rapidjson_doc["Table"].GetString()), "job_test");
+
   ASSERT_TRUE(rapidjson_doc.HasMember("constraints"));
   ASSERT_TRUE(rapidjson_doc["constraints"].IsArray());
 
@@ -424,4 +424,50 @@ Status RocksDBDatabasePlugin::scan(const std::string& domain,
   delete it;
   return Status::success();
 }
+
+Status RocksDBDatabasePlugin::getRange(const std::string& domain,
+                                       const std::string& low,
+                                       const std::string& high,
+                                       DatabaseStringValueList& results,
+                                       uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  // The iterator stops at the upper bound instead of scanning the domain.
+  // The bound is exclusive, the inclusive high key is checked in the loop.
+  std::string upper_bound = high + '\0';
+  rocksdb::Slice upper_bound_slice(upper_bound);
+  auto options = rocksdb::ReadOptions();
+  options.verify_checksums = false;
+  options.fill_cache = false;
+  options.iterate_upper_bound = &upper_bound_slice;
+
+  std::unique_ptr<rocksdb::Iterator> it(getDB()->NewIterator(options, cfh));
+  if (it == nullptr) {
+    return Status(1, "Could not get iterator for " + domain);
+  }
+
+  size_t count = 0;
+  for (it->Seek(low); it->Valid(); it->Next()) {
+    results.emplace_back(it->key().ToString(), it->value().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+
+  if (!it->status().ok()) {
+    return Status(1, it->status().ToString());
+  }
+  return Status::success();
+}
 } // namespace osquery
@@ -71,6 +71,13 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Ordered key and value range lookup method.
+  Status getRange(const std::string& domain,
+                  const std::string& low,
+                  const std::string& high,
+                  DatabaseStringValueList& results,
+                  uint64_t max) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -112,23 +112,32 @@ static int getData(void* argument, int argc, char* argv[], char* column[]) {
   return 0;
 }
 
+/// Read a text column, values may contain NUL bytes.
+static std::string getColumnValue(sqlite3_stmt* stmt, int column) {
+  auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+  if (data == nullptr) {
+    return std::string();
+  }
+  return std::string(data, sqlite3_column_bytes(stmt, column));
+}
+
 Status SQLiteDatabasePlugin::get(const std::string& domain,
                                  const std::string& key,
                                  std::string& value) const {
-  QueryData results;
-  char* err = nullptr;
-  std::string q = "select value from " + domain + " where key = '" + key + "';";
-  sqlite3_exec(db_, q.c_str(), getData, &results, &err);
-  if (err != nullptr) {
-    sqlite3_free(err);
-  }
+  sqlite3_stmt* stmt = nullptr;
+  std::string q = "select value from " + domain + " where key = ?1;";
+  sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr);
+
+  sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
 
   // Only assign value if the query found a result.
-  if (results.size() > 0) {
-    value = std::move(results[0]["value"]);
-    return Status(0);
+  auto rc = sqlite3_step(stmt);
+  if (rc == SQLITE_ROW) {
+    value = getColumnValue(stmt, 0);
   }
-  return Status(1);
+
+  sqlite3_finalize(stmt);
+  return (rc == SQLITE_ROW) ? Status(0) : Status(1);
 }
 
 Status SQLiteDatabasePlugin::get(const std::string& domain,
@@ -205,7 +214,11 @@ Status SQLiteDatabasePlugin::putBatch(const std::string& domain,
       const auto& value = p.second;
 
       sqlite3_bind_text(stmt, i, key.c_str(), -1, SQLITE_STATIC);
-      sqlite3_bind_text(stmt, i + 1, value.c_str(), -1, SQLITE_STATIC);
+      sqlite3_bind_text(stmt,
+                        i + 1,
+                        value.data(),
+                        static_cast<int>(value.size()),
+                        SQLITE_STATIC);
 
       i += 2;
     }
@@ -292,4 +305,36 @@ Status SQLiteDatabasePlugin::scan(const std::string& domain,
 
   return Status::success();
 }
+
+Status SQLiteDatabasePlugin::getRange(const std::string& domain,
+                                      const std::string& low,
+                                      const std::string& high,
+                                      DatabaseStringValueList& results,
+                                      uint64_t max) const {
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  std::string q = "select key, value from " + domain +
+                  " where key >= ?1 and key <= ?2 order by key";
+  if (max > 0) {
+    q += " limit " + std::to_string(max);
+  }
+  sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr);
+
+  sqlite3_bind_text(stmt, 1, low.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, high.c_str(), -1, SQLITE_STATIC);
+
+  int rc = SQLITE_DONE;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    results.emplace_back(getColumnValue(stmt, 0), getColumnValue(stmt, 1));
+  }
+
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    return Status(1);
+  }
+  return Status::success();
+}
 } // namespace osquery
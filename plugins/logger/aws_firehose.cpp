@@ -51,6 +51,11 @@ Status FirehoseLoggerPlugin::logString(const std::string& s) {
   return forwarder_->logString(s);
 }
 
+Status FirehoseLoggerPlugin::logStringBatch(
+    const std::vector<std::string>& strings) {
+  return forwarder_->logStringBatch(strings);
+}
+
 Status FirehoseLoggerPlugin::logStatus(const std::vector<StatusLogLine>& log) {
   return forwarder_->logStatus(log);
 }
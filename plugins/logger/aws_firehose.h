@@ -77,6 +77,9 @@ class FirehoseLoggerPlugin : public LoggerPlugin {
 
   Status logString(const std::string& s) override;
 
+  /// Buffer the results of a query with a single backing store write.
+  Status logStringBatch(const std::vector<std::string>& strings) override;
+
   /// Log a status (ERROR/WARNING/INFO) message.
   Status logStatus(const std::vector<StatusLogLine>& log) override;
 
@@ -66,6 +66,11 @@ Status KinesisLoggerPlugin::logString(const std::string& s) {
   return forwarder_->logString(s);
 }
 
+Status KinesisLoggerPlugin::logStringBatch(
+    const std::vector<std::string>& strings) {
+  return forwarder_->logStringBatch(strings);
+}
+
 Status KinesisLoggerPlugin::logStatus(const std::vector<StatusLogLine>& log) {
   return forwarder_->logStatus(log);
 }
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <chrono>
 #include <thread>
+#include <tuple>
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -21,6 +22,8 @@
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry.h>
+#include <osquery/utils/conversions/split.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/info/version.h>
 #include <osquery/utils/json/json.h>
 #include <osquery/utils/system/time.h>
@@ -39,34 +42,126 @@ const std::chrono::seconds BufferedLogForwarder::kLogPeriod{
     std::chrono::seconds(4)};
 const uint64_t BufferedLogForwarder::kMaxLogLines{1024};
 
+namespace {
+
+/// Width of the zero-padded sequence number within an index.
+const size_t kSequenceWidth{20};
+
+/// Parse a number of an index, 0 if the field is not a number.
+uint64_t parseIndexField(const std::string& field) {
+  return static_cast<uint64_t>(
+      tryTo<unsigned long long>(field, 10).takeOr(0ull));
+}
+
+/// Return the sequence number of an index, 0 for a time-ordered index.
+uint64_t parseSequence(const std::string& index, size_t offset) {
+  if (index.size() <= offset + kSequenceWidth ||
+      index[offset + kSequenceWidth] != '_') {
+    return 0;
+  }
+  return parseIndexField(index.substr(offset, kSequenceWidth));
+}
+
+} // namespace
+
 Status BufferedLogForwarder::setUp() {
-  // initialize buffer_count_ by scanning the DB
-  std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, (uint64_t)0);
+  // Load the pending indexes by scanning the DB
+  WriteLock lock(index_mutex_);
+  std::vector<std::string> legacy_indexes;
+  for (bool results : {true, false}) {
+    auto prefix = genIndexPrefix(results);
+    std::vector<std::string> indexes;
+    auto status = scanDatabaseKeys(kLogs, indexes, prefix, (uint64_t)0);
+    if (!status.ok()) {
+      return Status(1, "Error scanning for buffered log count");
+    }
 
+    auto& pending = pendingIndex(results);
+    pending.clear();
+    for (auto& index : indexes) {
+      auto sequence = parseSequence(index, prefix.size());
+      if (sequence == 0) {
+        legacy_indexes.push_back(std::move(index));
+        continue;
+      }
+      pending.push_back(sequence);
+    }
+
+    std::sort(pending.begin(), pending.end());
+    if (!pending.empty()) {
+      log_index_ = std::max(log_index_, pending.back());
+    }
+  }
+
+  if (!legacy_indexes.empty()) {
+    return migrateIndexes(legacy_indexes);
+  }
+  return Status(0);
+}
+
+Status BufferedLogForwarder::migrateIndexes(std::vector<std::string>& indexes) {
+  // Time-ordered indexes are "<prefix><time>_<counter>", and their counters
+  // do not sort as strings. Order them by time then counter.
+  size_t prefix_size = genIndexPrefix(true).size();
+  std::vector<std::tuple<uint64_t, uint64_t, std::string>> ordered;
+  for (auto& index : indexes) {
+    auto fields = osquery::split(index.substr(prefix_size), "_");
+    if (fields.size() != 2) {
+      continue;
+    }
+    ordered.emplace_back(parseIndexField(fields[0]),
+                         parseIndexField(fields[1]),
+                         std::move(index));
+  }
+  std::sort(ordered.begin(), ordered.end());
+
+  DatabaseStringValueList batch;
+  std::vector<std::pair<bool, uint64_t>> added;
+  for (const auto& item : ordered) {
+    const auto& index = std::get<2>(item);
+    std::string value;
+    if (!getDatabaseValue(kLogs, index, value).ok()) {
+      continue;
+    }
+
+    bool results = isResultIndex(index);
+    auto sequence = ++log_index_;
+    batch.emplace_back(genSequenceIndex(results, sequence) + '_' +
+                           std::to_string(std::get<0>(item)),
+                       std::move(value));
+    added.emplace_back(results, sequence);
+  }
+
+  auto status = setDatabaseBatch(kLogs, batch);
   if (!status.ok()) {
-    return Status(1, "Error scanning for buffered log count");
+    return Status(1, "Error migrating buffered logs");
   }
 
-  RecursiveLock lock(count_mutex_);
-  buffer_count_ = indexes.size();
+  for (const auto& sequence : added) {
+    pendingIndex(sequence.first).push_back(sequence.second);
+  }
+
+  for (const auto& item : ordered) {
+    deleteDatabaseValue(kLogs, std::get<2>(item));
+  }
   return Status(0);
 }
 
 void BufferedLogForwarder::check() {
-  // Get a list of all the buffered log items, with a max of 1024 lines.
-  std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, max_log_lines_);
-
-  // For each index, accumulate the log line into the result or status set.
+  // Read the oldest buffered log items, with a max of 1024 lines.
   std::vector<std::string> results, statuses;
-  iterate(indexes, ([&results, &statuses, this](std::string& index) {
-            std::string value;
-            auto& target = isResultIndex(index) ? results : statuses;
-            if (getDatabaseValue(kLogs, index, value)) {
-              target.emplace_back(std::move(value));
-            }
-          }));
+  uint64_t last_result = 0;
+  auto status = readValues(true, max_log_lines_, results, last_result);
+  if (!status.ok()) {
+    VLOG(1) << "Error reading buffered results: " << status.getMessage();
+  }
+
+  uint64_t last_status = 0;
+  status = readValues(
+      false, max_log_lines_ - results.size(), statuses, last_status);
+  if (!status.ok()) {
+    VLOG(1) << "Error reading buffered statuses: " << status.getMessage();
+  }
 
   // If any results/statuses were found in the flushed buffer, send.
   if (results.size() > 0) {
@@ -75,12 +170,7 @@ void BufferedLogForwarder::check() {
       VLOG(1) << "Error sending results to logger: " << status.getMessage();
     } else {
       // Clear the results logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isResultIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+      removeValues(true, last_result);
     }
   }
 
@@ -90,12 +180,7 @@ void BufferedLogForwarder::check() {
       VLOG(1) << "Error sending status to logger: " << status.getMessage();
     } else {
       // Clear the status logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isStatusIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+      removeValues(false, last_status);
     }
   }
 
@@ -106,65 +191,41 @@ void BufferedLogForwarder::check() {
 }
 
 void BufferedLogForwarder::purge() {
-  RecursiveLock lock(count_mutex_);
-  if (buffer_count_ <= FLAGS_buffered_log_max) {
-    return;
-  }
-
-  unsigned long long int purge_count = buffer_count_ - FLAGS_buffered_log_max;
+  uint64_t last_result = 0;
+  uint64_t last_status = 0;
+  {
+    WriteLock lock(index_mutex_);
+    auto buffer_count = pending_results_.size() + pending_statuses_.size();
+    if (buffer_count <= FLAGS_buffered_log_max) {
+      return;
+    }
 
-  // Collect purge_count indexes of each type (result/status) before
-  // partitioning to find the oldest. Note this assumes that the indexes are
-  // returned in ascending lexicographic order (true for RocksDB).
-  std::vector<std::string> indexes;
-  auto status =
-      scanDatabaseKeys(kLogs, indexes, genIndexPrefix(true), purge_count);
-  if (!status.ok()) {
-    LOG(ERROR) << "Error scanning DB during buffered log purge";
-    return;
+    LOG(WARNING) << "Purging buffered logs limit (" << FLAGS_buffered_log_max
+                 << ") exceeded: " << buffer_count;
+
+    // Both pending indexes are in sequence order, walk them together to find
+    // the last of the oldest lines of each type.
+    auto purge_count = buffer_count - FLAGS_buffered_log_max;
+    size_t result_count = 0;
+    size_t status_count = 0;
+    while (result_count + status_count < purge_count) {
+      if (status_count == pending_statuses_.size() ||
+          (result_count < pending_results_.size() &&
+           pending_results_[result_count] < pending_statuses_[status_count])) {
+        last_result = pending_results_[result_count++];
+      } else {
+        last_status = pending_statuses_[status_count++];
+      }
+    }
   }
 
-  LOG(WARNING) << "Purging buffered logs limit (" << FLAGS_buffered_log_max
-               << ") exceeded: " << buffer_count_;
-
-  std::vector<std::string> status_indexes;
-  status = scanDatabaseKeys(
-      kLogs, status_indexes, genIndexPrefix(false), purge_count);
-  if (!status.ok()) {
-    LOG(ERROR) << "Error scanning DB during buffered log purge";
-    return;
+  if (last_result > 0 && !removeValues(true, last_result).ok()) {
+    LOG(ERROR) << "Error deleting results during buffered log purge";
   }
 
-  indexes.insert(indexes.end(), status_indexes.begin(), status_indexes.end());
-
-  if (indexes.size() < purge_count) {
-    LOG(ERROR) << "Trying to purge " << purge_count << " logs but only found "
-               << indexes.size();
-    return;
+  if (last_status > 0 && !removeValues(false, last_status).ok()) {
+    LOG(ERROR) << "Error deleting statuses during buffered log purge";
   }
-
-  size_t prefix_size = genIndexPrefix(true).size();
-  // Partition the indexes so that the first purge_count elements are the
-  // oldest indexes (the ones to be purged)
-  std::nth_element(indexes.begin(),
-                   indexes.begin() + (unsigned int)purge_count - 1,
-                   indexes.end(),
-                   [&](const std::string& a, const std::string& b) {
-                     // Skip the prefix when doing comparisons
-                     return a.compare(prefix_size,
-                                      std::string::npos,
-                                      b,
-                                      prefix_size,
-                                      std::string::npos) < 0;
-                   });
-  indexes.erase(indexes.begin() + (unsigned int)purge_count, indexes.end());
-
-  // Now only indexes of logs to be deleted remain
-  iterate(indexes, [this](const std::string& index) {
-    if (!deleteValueWithCount(kLogs, index).ok()) {
-      LOG(ERROR) << "Error deleting value during buffered log purge";
-    }
-  });
 }
 
 void BufferedLogForwarder::start() {
@@ -177,8 +238,12 @@ void BufferedLogForwarder::start() {
 }
 
 Status BufferedLogForwarder::logString(const std::string& s, uint64_t time) {
-  std::string index = genResultIndex(time);
-  return addValueWithCount(kLogs, index, s);
+  return addValues(true, {s}, time);
+}
+
+Status BufferedLogForwarder::logStringBatch(
+    const std::vector<std::string>& strings, uint64_t time) {
+  return addValues(true, strings, time);
 }
 
 Status BufferedLogForwarder::logStatus(const std::vector<StatusLogLine>& log,
@@ -192,6 +257,8 @@ Status BufferedLogForwarder::logStatus(const std::vector<StatusLogLine>& log,
     dtree.put(decoration.first, decoration.second);
   }
 
+  std::vector<std::string> lines;
+  lines.reserve(log.size());
   for (const auto& item : log) {
     // Convert the StatusLogLine into ptree format, to convert to JSON.
     pt::ptree buffer;
@@ -218,19 +285,14 @@ Status BufferedLogForwarder::logStatus(const std::vector<StatusLogLine>& log,
       return Status(1, e.what());
     }
 
-    // Store the status line in a backing store.
     if (!json.empty()) {
       json.pop_back();
     }
-    std::string index = genStatusIndex(time);
-    Status status = addValueWithCount(kLogs, index, json);
-    if (!status.ok()) {
-      // Do not continue if any line fails.
-      return status;
-    }
+    lines.push_back(std::move(json));
   }
 
-  return Status(0);
+  // Store the status lines in a backing store.
+  return addValues(false, lines, time);
 }
 
 bool BufferedLogForwarder::isIndex(const std::string& index, bool results) {
@@ -262,28 +324,109 @@ std::string BufferedLogForwarder::genIndex(bool results, uint64_t time) {
   if (time == 0) {
     time = getUnixTime();
   }
-  return genIndexPrefix(results) + std::to_string(time) + '_' +
-         std::to_string(++log_index_);
+
+  WriteLock lock(index_mutex_);
+  return genSequenceIndex(results, ++log_index_) + '_' + std::to_string(time);
+}
+
+std::string BufferedLogForwarder::genSequenceIndex(bool results,
+                                                   uint64_t sequence) {
+  auto digits = std::to_string(sequence);
+  if (digits.size() < kSequenceWidth) {
+    digits.insert(0, kSequenceWidth - digits.size(), '0');
+  }
+  return genIndexPrefix(results) + digits;
+}
+
+std::deque<uint64_t>& BufferedLogForwarder::pendingIndex(bool results) {
+  return (results) ? pending_results_ : pending_statuses_;
 }
 
-Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
-                                               const std::string& key,
-                                               const std::string& value) {
-  Status status = setDatabaseValue(domain, key, value);
+Status BufferedLogForwarder::addValues(bool results,
+                                       const std::vector<std::string>& values,
+                                       uint64_t time) {
+  if (values.empty()) {
+    return Status(0);
+  }
+
+  if (time == 0) {
+    time = getUnixTime();
+  }
+  auto time_suffix = '_' + std::to_string(time);
+
+  WriteLock lock(index_mutex_);
+  auto first = log_index_ + 1;
+  DatabaseStringValueList batch;
+  batch.reserve(values.size());
+  for (const auto& value : values) {
+    batch.emplace_back(genSequenceIndex(results, ++log_index_) + time_suffix,
+                       value);
+  }
+
+  auto status = setDatabaseBatch(kLogs, batch);
   if (status.ok()) {
-    RecursiveLock lock(count_mutex_);
-    buffer_count_++;
+    auto& pending = pendingIndex(results);
+    for (auto sequence = first; sequence <= log_index_; ++sequence) {
+      pending.push_back(sequence);
+    }
   }
   return status;
 }
 
-Status BufferedLogForwarder::deleteValueWithCount(const std::string& domain,
-                                                  const std::string& key) {
-  Status status = deleteDatabaseValue(domain, key);
+Status BufferedLogForwarder::readValues(bool results,
+                                        uint64_t max,
+                                        std::vector<std::string>& values,
+                                        uint64_t& last) {
+  uint64_t first = 0;
+  {
+    WriteLock lock(index_mutex_);
+    const auto& pending = pendingIndex(results);
+    if (pending.empty() || max == 0) {
+      return Status(0);
+    }
+
+    auto count = std::min<uint64_t>(max, pending.size());
+    first = pending.front();
+    last = pending[count - 1];
+  }
+
+  // Lines buffered later have greater sequence numbers, so the range only
+  // contains the pending lines read from the index.
+  DatabaseStringValueList lines;
+  auto status = getDatabaseRange(kLogs,
+                                 genSequenceIndex(results, first),
+                                 genSequenceIndex(results, last + 1),
+                                 lines,
+                                 max);
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (lines.empty()) {
+    // The lines are missing from the backing store, stop reading them.
+    return removeValues(results, last);
+  }
+
+  values.reserve(values.size() + lines.size());
+  for (auto& line : lines) {
+    values.push_back(std::move(line.second));
+  }
+  return Status(0);
+}
+
+Status BufferedLogForwarder::removeValues(bool results, uint64_t last) {
+  WriteLock lock(index_mutex_);
+  auto& pending = pendingIndex(results);
+  if (pending.empty() || pending.front() > last) {
+    return Status(0);
+  }
+
+  auto status = deleteDatabaseRange(kLogs,
+                                    genSequenceIndex(results, pending.front()),
+                                    genSequenceIndex(results, last + 1));
   if (status.ok()) {
-    RecursiveLock lock(count_mutex_);
-    if (buffer_count_ > 0) {
-      buffer_count_--;
+    while (!pending.empty() && pending.front() <= last) {
+      pending.pop_front();
     }
   }
   return status;
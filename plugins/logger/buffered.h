@@ -10,6 +10,7 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <string>
@@ -93,7 +94,7 @@ class BufferedLogForwarder : public InternalRunnable {
    * @brief Set up the forwarder. May be used to init remote clients, etc.
    *
    * This base class setUp() **MUST** be called by subclasses of
-   * BufferedLogForwarder in order to properly initialize the buffer count.
+   * BufferedLogForwarder in order to load the index of buffered logs.
   */
   virtual Status setUp();
 
@@ -108,6 +109,17 @@ class BufferedLogForwarder : public InternalRunnable {
    */
   Status logString(const std::string& s, uint64_t time = 0);
 
+  /**
+   * @brief Log several results strings
+   *
+   * Writes the result strings to the backing store in a single write batch,
+   * like logString the strings are sent when check() runs.
+   *
+   * @param strings Results strings to log
+   */
+  Status logStringBatch(const std::vector<std::string>& strings,
+                        uint64_t time = 0);
+
   /**
    * @brief Log a vector of status lines
    *
@@ -133,9 +145,9 @@ class BufferedLogForwarder : public InternalRunnable {
   /**
    * @brief Check for new logs and send.
    *
-   * Scan the logs domain for up to max_log_lines_ log lines.
-   * Sort those lines into status and request types then forward (send) each
-   * set. On success, clear the data and indexes. Calls purge upon completion.
+   * Read up to max_log_lines_ of the oldest log lines, results first, with a
+   * range read per log type then forward (send) each set. On success, remove
+   * the sent range of lines. Calls purge upon completion.
    */
   void check();
 
@@ -143,8 +155,7 @@ class BufferedLogForwarder : public InternalRunnable {
    * @brief Purge the oldest logs, if the max is exceeded
    *
    * Uses the buffered_log_max flag to determine the maximum number of buffered
-   * logs. If this number is exceeded, the logs with the oldest timestamp are
-   * purged. Order of purging for logs with the same timestamp is undefined.
+   * logs. If this number is exceeded, the logs buffered first are purged.
    */
   void purge();
 
@@ -172,19 +183,52 @@ class BufferedLogForwarder : public InternalRunnable {
   std::string genIndex(bool results, uint64_t time = 0);
 
   /**
-   * @brief Add a database value while maintaining count
+   * @brief Generate the index of a sequence number, without the time.
+   *
+   * Sequence numbers are zero-padded so that indexes sort in the order the
+   * logs were buffered. The index is also the exclusive upper bound of every
+   * log buffered before the sequence number.
+   */
+  std::string genSequenceIndex(bool results, uint64_t sequence);
+
+  /// Return the pending sequence numbers of a log type.
+  std::deque<uint64_t>& pendingIndex(bool results);
+
+  /**
+   * @brief Write log lines in one batch and append them to the pending index.
+   *
+   */
+  Status addValues(bool results,
+                   const std::vector<std::string>& values,
+                   uint64_t time);
+
+  /**
+   * @brief Read the oldest pending log lines of a type with one range read.
    *
+   * @param results read result lines if true, otherwise status lines.
+   * @param max the maximum number of lines to read.
+   * @param values [output] the log lines in the order they were buffered.
+   * @param last [output] the sequence number of the last line read.
    */
-  Status addValueWithCount(const std::string& domain,
-                           const std::string& key,
-                           const std::string& value);
+  Status readValues(bool results,
+                    uint64_t max,
+                    std::vector<std::string>& values,
+                    uint64_t& last);
 
   /**
-   * @brief Delete a database value while maintaining count
+   * @brief Remove the pending log lines of a type up to a sequence number.
    *
+   * The lines are contiguous in the backing store, so they are removed with
+   * a single range delete.
    */
-  Status deleteValueWithCount(const std::string& domain,
-                              const std::string& key);
+  Status removeValues(bool results, uint64_t last);
+
+  /**
+   * @brief Rewrite logs buffered with the time-ordered index format.
+   *
+   * Called by setUp with the index lock held.
+   */
+  Status migrateIndexes(std::vector<std::string>& indexes);
 
  protected:
   /// Seconds between flushing logs
@@ -203,13 +247,21 @@ class BufferedLogForwarder : public InternalRunnable {
   std::string index_name_;
 
  private:
-  /// Hold an incrementing index for buffering logs
-  std::atomic<size_t> log_index_{0};
+  /// Hold an incrementing sequence number for buffering logs
+  uint64_t log_index_{0};
+
+  /// Sequence numbers of the buffered result logs, oldest first
+  std::deque<uint64_t> pending_results_;
 
-  /// Stores the count of buffered logs
-  unsigned long long int buffer_count_{0};
+  /// Sequence numbers of the buffered status logs, oldest first
+  std::deque<uint64_t> pending_statuses_;
 
-  /// Protects the count of buffered logs
-  RecursiveMutex count_mutex_;
+  /**
+   * @brief Protects the sequence number and pending indexes
+   *
+   * Writes hold the lock while buffering so that the pending indexes only
+   * contain lines that are in the backing store, in sequence order.
+   */
+  Mutex index_mutex_;
 };
 }
@@ -11,9 +11,18 @@
 
 #include <exception>
 
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 #include <osquery/core/flags.h>
 #include <osquery/logger/logger.h>
 #include <osquery/utils/config/default_paths.h>
+#if WIN32
+#include <osquery/utils/conversions/windows/strings.h>
+#endif
 
 namespace fs = boost::filesystem;
 
@@ -34,9 +43,199 @@ FLAG_ALIAS(std::string, osquery_log_dir, logger_path);
 
 FLAG(int32, logger_mode, 0640, "Decimal mode for log files (default '0640')");
 
+FLAG(uint64,
+     logger_filesystem_buffer_size,
+     0,
+     "Bytes of results to buffer before writing log files (default 0)");
+
+FLAG(uint64,
+     logger_filesystem_flush_interval,
+     1000,
+     "Milliseconds before buffered results are written (default 1000)");
+
+FLAG(bool,
+     logger_filesystem_sync,
+     false,
+     "Sync result and snapshot log files to disk after each write");
+
 const std::string kFilesystemLoggerFilename = "osqueryd.results.log";
 const std::string kFilesystemLoggerSnapshots = "osqueryd.snapshots.log";
 
+FilesystemLogAppender::FilesystemLogAppender(fs::path path, int permissions)
+    : path_(std::move(path)), permissions_(permissions) {}
+
+FilesystemLogAppender::~FilesystemLogAppender() {
+  flush(false);
+}
+
+Status FilesystemLogAppender::open() {
+  WriteLock lock(mutex_);
+  return openFile();
+}
+
+Status FilesystemLogAppender::openFile() {
+#ifndef WIN32
+  if (file_ != nullptr) {
+    struct stat path_stat;
+    if (::stat(path_.string().c_str(), &path_stat) == 0 &&
+        static_cast<std::uint64_t>(path_stat.st_dev) == device_ &&
+        static_cast<std::uint64_t>(path_stat.st_ino) == inode_) {
+      return Status::success();
+    }
+
+    // The log file was moved or removed, for example by log rotation.
+    file_.reset();
+  }
+#else
+  if (file_ != nullptr) {
+    return Status::success();
+  }
+#endif
+
+  auto file = std::make_unique<PlatformFile>(
+      path_, PF_OPEN_ALWAYS | PF_WRITE | PF_APPEND, permissions_);
+  if (!file->isValid()) {
+    return Status::failure("Could not create file: " + path_.string());
+  }
+
+  // If the file existed with different permissions before our open
+  // they must be restricted.
+#if WIN32
+  const std::string p = wstringToString(path_.wstring());
+#else
+  const std::string p = path_.string();
+#endif
+  if (!platformChmod(p, permissions_)) {
+    return Status::failure("Failed to change permissions for file: " +
+                           path_.string());
+  }
+
+#ifndef WIN32
+  struct stat file_stat;
+  if (::fstat(file->nativeHandle(), &file_stat) != 0) {
+    return Status::failure("Failed to stat file: " + path_.string());
+  }
+
+  device_ = static_cast<std::uint64_t>(file_stat.st_dev);
+  inode_ = static_cast<std::uint64_t>(file_stat.st_ino);
+#endif
+
+  file_ = std::move(file);
+  return Status::success();
+}
+
+Status FilesystemLogAppender::append(const std::string& line,
+                                     std::size_t buffer_size,
+                                     std::chrono::milliseconds flush_interval,
+                                     bool sync) {
+  WriteLock lock(mutex_);
+
+  auto now = std::chrono::steady_clock::now();
+  if (buffer_.empty()) {
+    buffer_time_ = now;
+  }
+
+  buffer_.append(line);
+  buffer_.push_back('\n');
+  ++buffered_lines_;
+
+  if (buffer_.size() < buffer_size && now - buffer_time_ < flush_interval) {
+    return Status::success();
+  }
+
+  return writeBuffer(sync);
+}
+
+Status FilesystemLogAppender::append(const std::vector<std::string>& lines,
+                                     std::size_t buffer_size,
+                                     std::chrono::milliseconds flush_interval,
+                                     bool sync) {
+  WriteLock lock(mutex_);
+
+  auto now = std::chrono::steady_clock::now();
+  if (buffer_.empty()) {
+    buffer_time_ = now;
+  }
+
+  std::size_t size = buffer_.size();
+  for (const auto& line : lines) {
+    size += line.size() + 1;
+  }
+  buffer_.reserve(size);
+
+  for (const auto& line : lines) {
+    buffer_.append(line);
+    buffer_.push_back('\n');
+  }
+  buffered_lines_ += lines.size();
+
+  if (buffer_.size() < buffer_size && now - buffer_time_ < flush_interval) {
+    return Status::success();
+  }
+
+  return writeBuffer(sync);
+}
+
+Status FilesystemLogAppender::flush(bool sync) {
+  WriteLock lock(mutex_);
+  if (buffer_.empty()) {
+    return Status::success();
+  }
+
+  return writeBuffer(sync);
+}
+
+Status FilesystemLogAppender::writeBuffer(bool sync) {
+  auto status = openFile();
+
+  if (status.ok()) {
+    auto bytes = file_->write(buffer_.data(), buffer_.size());
+    if (bytes < 0 || static_cast<std::size_t>(bytes) != buffer_.size()) {
+      status = Status::failure("Failed to write contents to file: " +
+                               path_.string());
+
+      // Reopen the log file before the next write.
+      file_.reset();
+
+    } else {
+      bytes_written_ += buffer_.size();
+      lines_written_ += buffered_lines_;
+    }
+  }
+
+  if (status.ok() && sync) {
+#if defined(WIN32)
+    auto synced = (::FlushFileBuffers(file_->nativeHandle()) != FALSE);
+#elif defined(__linux__)
+    auto synced = (::fdatasync(file_->nativeHandle()) == 0);
+#else
+    auto synced = (::fsync(file_->nativeHandle()) == 0);
+#endif
+    if (!synced) {
+      status = Status::failure("Failed to sync file: " + path_.string());
+    }
+  }
+
+  // Lines that failed to write are dropped, as they were before buffering.
+  buffer_.clear();
+  buffered_lines_ = 0;
+  return status;
+}
+
+void FilesystemLogFlusher::start() {
+  while (!interrupted()) {
+    pause(std::chrono::milliseconds(FLAGS_logger_filesystem_flush_interval));
+
+    for (const auto& appender : appenders_) {
+      auto status = appender->flush(FLAGS_logger_filesystem_sync);
+      if (!status.ok()) {
+        VLOG(1) << "Failed to flush the filesystem logger: "
+                << status.getMessage();
+      }
+    }
+  }
+}
+
 Status FilesystemLoggerPlugin::setUp() {
   log_path_ = fs::path(FLAGS_logger_path);
 
@@ -44,27 +243,88 @@ Status FilesystemLoggerPlugin::setUp() {
   // Glog 0.3.4 does not support a logfile mode.
   // FLAGS_logfile_mode = FLAGS_logger_mode;
 
+  results_ = std::make_shared<FilesystemLogAppender>(
+      log_path_ / kFilesystemLoggerFilename, FLAGS_logger_mode);
+  snapshots_ = std::make_shared<FilesystemLogAppender>(
+      log_path_ / kFilesystemLoggerSnapshots, FLAGS_logger_mode);
+
+  // Buffered lines of idle log files are written by a service.
+  if (FLAGS_logger_filesystem_buffer_size > 0) {
+    Dispatcher::addService(std::make_shared<FilesystemLogFlusher>(
+        std::vector<FilesystemLogAppenderRef>{results_, snapshots_}));
+  }
+
   // Ensure that we create the results log here.
-  return logStringToFile("", kFilesystemLoggerFilename, true);
+  try {
+    return results_->open();
+  } catch (const std::exception& e) {
+    return Status(1, e.what());
+  }
+}
+
+void FilesystemLoggerPlugin::tearDown() {
+  for (const auto& appender : {results_, snapshots_}) {
+    if (appender != nullptr) {
+      appender->flush(FLAGS_logger_filesystem_sync);
+    }
+  }
 }
 
 Status FilesystemLoggerPlugin::logString(const std::string& s) {
-  return logStringToFile(s, kFilesystemLoggerFilename);
+  return logStringToFile(s, results_);
 }
 
-Status FilesystemLoggerPlugin::logStringToFile(const std::string& s,
-                                               const std::string& filename,
-                                               bool empty) {
-  WriteLock lock(mutex_);
-  Status status;
+namespace {
+
+/// Append one or several lines with the configured buffering.
+template <typename Lines>
+Status appendToFile(const Lines& lines,
+                    const FilesystemLogAppenderRef& appender) {
+  if (appender == nullptr) {
+    return Status::failure("The filesystem logger is not set up");
+  }
+
   try {
-    status = writeTextFile((log_path_ / filename).string(),
-                           (empty) ? "" : s + '\n',
-                           FLAGS_logger_mode);
+    return appender->append(
+        lines,
+        FLAGS_logger_filesystem_buffer_size,
+        std::chrono::milliseconds(FLAGS_logger_filesystem_flush_interval),
+        FLAGS_logger_filesystem_sync);
   } catch (const std::exception& e) {
     return Status(1, e.what());
   }
-  return status;
+}
+
+} // namespace
+
+Status FilesystemLoggerPlugin::logStringBatch(
+    const std::vector<std::string>& strings) {
+  return appendToFile(strings, results_);
+}
+
+Status FilesystemLoggerPlugin::logStringToFile(
+    const std::string& s, const FilesystemLogAppenderRef& appender) {
+  return appendToFile(s, appender);
+}
+
+std::uint64_t FilesystemLoggerPlugin::bytesWritten() const {
+  std::uint64_t bytes = 0;
+  for (const auto& appender : {results_, snapshots_}) {
+    if (appender != nullptr) {
+      bytes += appender->bytesWritten();
+    }
+  }
+  return bytes;
+}
+
+std::uint64_t FilesystemLoggerPlugin::linesWritten() const {
+  std::uint64_t lines = 0;
+  for (const auto& appender : {results_, snapshots_}) {
+    if (appender != nullptr) {
+      lines += appender->linesWritten();
+    }
+  }
+  return lines;
 }
 
 Status FilesystemLoggerPlugin::logStatus(
@@ -83,7 +343,7 @@ Status FilesystemLoggerPlugin::logStatus(
 
 Status FilesystemLoggerPlugin::logSnapshot(const std::string& s) {
   // Send the snapshot data to a separate filename.
-  return logStringToFile(s, kFilesystemLoggerSnapshots);
+  return logStringToFile(s, snapshots_);
 }
 
 void FilesystemLoggerPlugin::init(const std::string& name,
@@ -9,22 +9,134 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <atomic>
+#include <chrono>
 #include <exception>
+#include <memory>
 
 #include <osquery/core/flagalias.h>
 #include <osquery/core/plugins/logger.h>
+#include <osquery/dispatcher/dispatcher.h>
+#include <osquery/filesystem/fileops.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/registry/registry_factory.h>
 
 namespace osquery {
 
+/**
+ * @brief A long-lived appender for a single log file.
+ *
+ * The file is kept open between writes and lines are coalesced into a buffer,
+ * which is written once it exceeds a size threshold or becomes older than
+ * the flush interval. Before each write the appender checks if the path
+ * still refers to the open file and reopens it if the file was rotated.
+ */
+class FilesystemLogAppender : private boost::noncopyable {
+ public:
+  FilesystemLogAppender(boost::filesystem::path path, int permissions);
+
+  /// Buffered lines are written when the appender is destroyed.
+  ~FilesystemLogAppender();
+
+  /// Open or create the log file without writing.
+  Status open();
+
+  /**
+   * @brief Append a line, a newline is added by the appender.
+   *
+   * @param line the log line.
+   * @param buffer_size bytes to buffer before writing, 0 writes immediately.
+   * @param flush_interval the maximum age of buffered lines.
+   * @param sync sync the file to disk after writing.
+   */
+  Status append(const std::string& line,
+                std::size_t buffer_size,
+                std::chrono::milliseconds flush_interval,
+                bool sync);
+
+  /// Append several lines, they are written together.
+  Status append(const std::vector<std::string>& lines,
+                std::size_t buffer_size,
+                std::chrono::milliseconds flush_interval,
+                bool sync);
+
+  /// Write the buffered lines to the log file.
+  Status flush(bool sync);
+
+  /// Number of bytes written to the log file.
+  std::uint64_t bytesWritten() const {
+    return bytes_written_;
+  }
+
+  /// Number of lines written to the log file.
+  std::uint64_t linesWritten() const {
+    return lines_written_;
+  }
+
+ private:
+  /// Open the log file, reopening it if the path no longer refers to it.
+  Status openFile();
+
+  /// Write the buffer, the caller must hold the appender mutex.
+  Status writeBuffer(bool sync);
+
+ private:
+  /// The log file path.
+  const boost::filesystem::path path_;
+
+  /// Permissions requested when the log file is created.
+  const int permissions_;
+
+  /// The open log file, nullptr until the first write.
+  std::unique_ptr<PlatformFile> file_;
+
+  /// Identity of the open log file, used to detect rotation.
+  std::uint64_t device_{0};
+  std::uint64_t inode_{0};
+
+  /// Lines that have not been written yet.
+  std::string buffer_;
+  std::size_t buffered_lines_{0};
+
+  /// Time of the first buffered line.
+  std::chrono::steady_clock::time_point buffer_time_;
+
+  std::atomic<std::uint64_t> bytes_written_{0};
+  std::atomic<std::uint64_t> lines_written_{0};
+
+  /// Appender mutex, guards the file and buffer.
+  Mutex mutex_;
+};
+
+using FilesystemLogAppenderRef = std::shared_ptr<FilesystemLogAppender>;
+
+/// A service writing the buffered lines of idle log appenders.
+class FilesystemLogFlusher : public InternalRunnable {
+ public:
+  explicit FilesystemLogFlusher(std::vector<FilesystemLogAppenderRef> appenders)
+      : InternalRunnable("FilesystemLogFlusher"),
+        appenders_(std::move(appenders)) {}
+
+ protected:
+  void start() override;
+
+ private:
+  std::vector<FilesystemLogAppenderRef> appenders_;
+};
+
 class FilesystemLoggerPlugin : public LoggerPlugin {
  public:
   Status setUp() override;
 
+  /// Write any buffered lines.
+  void tearDown() override;
+
   /// Log results (differential) to a distinct path.
   Status logString(const std::string& s) override;
 
+  /// Log the results of a query with a single write.
+  Status logStringBatch(const std::vector<std::string>& strings) override;
+
   /// Log snapshot data to a distinct path.
   Status logSnapshot(const std::string& s) override;
 
@@ -41,18 +153,24 @@ class FilesystemLoggerPlugin : public LoggerPlugin {
   /// Write a status to Glog.
   Status logStatus(const std::vector<StatusLogLine>& log) override;
 
+  /// Number of result and snapshot bytes written to the log files.
+  std::uint64_t bytesWritten() const;
+
+  /// Number of result and snapshot lines written to the log files.
+  std::uint64_t linesWritten() const;
+
  private:
   /// The plugin-internal filesystem writer method.
   Status logStringToFile(const std::string& s,
-                         const std::string& filename,
-                         bool empty = false);
+                         const FilesystemLogAppenderRef& appender);
 
  private:
   /// The folder where Glog and the result/snapshot files are written.
   boost::filesystem::path log_path_;
 
-  /// Filesystem writer mutex.
-  Mutex mutex_;
+  /// Appenders for the results and snapshots log files.
+  FilesystemLogAppenderRef results_{nullptr};
+  FilesystemLogAppenderRef snapshots_{nullptr};
 
   /*
  private:
@@ -20,6 +20,8 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+
 #include <boost/algorithm/string/find.hpp>
 
 #include <osquery/config/config.h>
@@ -242,13 +244,9 @@ void KafkaProducerPlugin::init(const std::string& name,
       this, [](KafkaProducerPlugin* k) { k->stop(); }));
 }
 
-Status KafkaProducerPlugin::logString(const std::string& payload) {
-  if (!running_.load()) {
-    return Status(
-        1, "Cannot log because Kafka producer did not initiate properly.");
-  }
-
-  std::string name(getMsgName(payload));
+rd_kafka_topic_t* KafkaProducerPlugin::getMsgTopic(const std::string& payload,
+                                                  std::string& name) {
+  name = getMsgName(payload);
 
   rd_kafka_topic_t* topic = nullptr;
   try {
@@ -256,7 +254,17 @@ Status KafkaProducerPlugin::logString(const std::string& payload) {
   } catch (const std::out_of_range& _) {
     topic = queryToTopics_[kKafkaBaseTopic];
   }
+  return topic;
+}
+
+Status KafkaProducerPlugin::logString(const std::string& payload) {
+  if (!running_.load()) {
+    return Status(
+        1, "Cannot log because Kafka producer did not initiate properly.");
+  }
 
+  std::string name;
+  auto* topic = getMsgTopic(payload, name);
   if (topic == nullptr) {
     std::string errMsg(
         "Could not publish message: Topic not configured for message name '" +
@@ -276,6 +284,91 @@ Status KafkaProducerPlugin::logString(const std::string& payload) {
   return status;
 }
 
+Status KafkaProducerPlugin::logStringBatch(
+    const std::vector<std::string>& payloads) {
+  if (!running_.load()) {
+    return Status(
+        1, "Cannot log because Kafka producer did not initiate properly.");
+  }
+
+  // Group the payloads by topic, each group is produced in one call.
+  std::vector<std::pair<rd_kafka_topic_t*, std::vector<const std::string*>>>
+      batches;
+  Status status;
+  for (const auto& payload : payloads) {
+    std::string name;
+    auto* topic = getMsgTopic(payload, name);
+    if (topic == nullptr) {
+      std::string errMsg(
+          "Could not publish message: Topic not configured for message name '" +
+          name + "'");
+      LOG(ERROR) << errMsg;
+      status = Status(2, errMsg);
+      continue;
+    }
+
+    auto batch = std::find_if(
+        batches.begin(), batches.end(), [topic](const auto& existing) {
+          return existing.first == topic;
+        });
+    if (batch == batches.end()) {
+      batch = batches.emplace(batches.end(),
+                              topic,
+                              std::vector<const std::string*>());
+    }
+    batch->second.push_back(&payload);
+  }
+
+  for (const auto& batch : batches) {
+    auto batch_status = publishMsgBatch(batch.first, batch.second);
+    if (!batch_status.ok()) {
+      LOG(ERROR) << "Could not publish message: " << batch_status.getMessage();
+      status = std::move(batch_status);
+    }
+  }
+
+  // Poll once for the whole batch.
+  pollKafka();
+
+  return status;
+}
+
+Status KafkaProducerPlugin::publishMsgBatch(
+    rd_kafka_topic_t* topic, const std::vector<const std::string*>& payloads) {
+  std::vector<rd_kafka_message_t> messages(payloads.size());
+  for (size_t i = 0; i < payloads.size(); i++) {
+    messages[i].payload = const_cast<char*>(payloads[i]->c_str());
+    messages[i].len = payloads[i]->length();
+    messages[i].key = const_cast<char*>(msgKey_.c_str());
+    messages[i].key_len = msgKey_.length();
+  }
+
+  auto produced = rd_kafka_produce_batch(topic,
+                                         RD_KAFKA_PARTITION_UA,
+                                         RD_KAFKA_MSG_F_COPY,
+                                         messages.data(),
+                                         static_cast<int>(messages.size()));
+  if (produced == static_cast<int>(messages.size())) {
+    return Status(0, "OK");
+  }
+
+  // Each message that was not enqueued has its own error.
+  auto error = rd_kafka_last_error();
+  for (const auto& message : messages) {
+    if (message.err != RD_KAFKA_RESP_ERR_NO_ERROR) {
+      error = message.err;
+      break;
+    }
+  }
+  return Status(1,
+                "Failed to produce " +
+                    std::to_string(messages.size() -
+                                   static_cast<size_t>(std::max(produced, 0))) +
+                    " messages on Kafka topic " +
+                    std::string(rd_kafka_topic_name(topic)) + " : " +
+                    rd_kafka_err2str(error));
+}
+
 Status KafkaProducerPlugin::publishMsg(rd_kafka_topic_t* topic,
                                        const std::string& payload) {
   if (rd_kafka_produce(topic,
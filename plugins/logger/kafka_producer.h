@@ -37,6 +37,14 @@ class KafkaProducerPlugin : public LoggerPlugin, public InternalRunnable {
    */
   Status logString(const std::string& s) override;
 
+  /**
+   * @brief Logs the strings with one produce call per topic.
+   *
+   * Strings are grouped by the topic of their query name, keeping their
+   * order, and rd_kafka_poll is called once for the whole batch.
+   */
+  Status logStringBatch(const std::vector<std::string>& strings) override;
+
   /**
    * @brief Initializes the Kafka producer.
    *
@@ -79,6 +87,17 @@ class KafkaProducerPlugin : public LoggerPlugin, public InternalRunnable {
   virtual Status publishMsg(rd_kafka_topic_t* topic,
                             const std::string& payload);
 
+  /**
+   * @brief Publishes several messages to a Kafka topic in one produce call.
+   *
+   * @param topic Kafka topic to publish to
+   * @param payloads message bodies
+   *
+   * @return Status of publish attempt, an error if any message failed
+   */
+  virtual Status publishMsgBatch(
+      rd_kafka_topic_t* topic, const std::vector<const std::string*>& payloads);
+
   /**
    * @brief Flushes all buffered messages to Kafka, waiting for a maximum of 3
    * seconds.  Wrapper with mutex locking around rd_kafka_flush.
@@ -101,6 +120,10 @@ class KafkaProducerPlugin : public LoggerPlugin, public InternalRunnable {
   /// Configures Kafka topics accordingly.
   bool configureTopics();
 
+  /// Returns the topic of a message, nullptr if none is configured.
+  rd_kafka_topic_t* getMsgTopic(const std::string& payload,
+                                std::string& name);
+
   /// Initiates Kafka topic.  Caller needs to handle rd_kafka_topic_t* cleanup.
   rd_kafka_topic_t* initTopic(const std::string& topicName);
 
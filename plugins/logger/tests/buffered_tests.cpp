@@ -99,12 +99,14 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
                       const std::string& log_type));
   FRIEND_TEST(BufferedLogForwarderTests, test_index);
   FRIEND_TEST(BufferedLogForwarderTests, test_basic);
+  FRIEND_TEST(BufferedLogForwarderTests, test_batch);
   FRIEND_TEST(BufferedLogForwarderTests, test_retry);
   FRIEND_TEST(BufferedLogForwarderTests, test_multiple);
   FRIEND_TEST(BufferedLogForwarderTests, test_async);
   FRIEND_TEST(BufferedLogForwarderTests, test_split);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge_max);
+  FRIEND_TEST(BufferedLogForwarderTests, test_set_up);
 
  private:
   bool checked_{false};
@@ -113,10 +115,10 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
 TEST_F(BufferedLogForwarderTests, test_index) {
   MockBufferedLogForwarder runner;
   if (!isPlatform(PlatformType::TYPE_WINDOWS)) {
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_1"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_2"));
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_3"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_4"));
+    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_0+1_[0-9]+"));
+    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_0+2_[0-9]+"));
+    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_0+3_[0-9]+"));
+    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_0+4_[0-9]+"));
   }
 
   EXPECT_TRUE(runner.isResultIndex(runner.genResultIndex()));
@@ -154,6 +156,44 @@ TEST_F(BufferedLogForwarderTests, test_basic) {
   runner.check();
 }
 
+TEST_F(BufferedLogForwarderTests, test_batch) {
+  StrictMock<MockBufferedLogForwarder> runner;
+  runner.logString("foo");
+  EXPECT_TRUE(runner.logStringBatch({"bar", "baz"}));
+  EXPECT_TRUE(runner.logStringBatch({}));
+
+  // Batched strings are sent in order, after the strings logged before.
+  EXPECT_CALL(runner, send(ElementsAre("foo", "bar", "baz"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  runner.check();
+}
+
+TEST_F(BufferedLogForwarderTests, test_set_up) {
+  // Logs buffered with time-ordered indexes, the counters do not sort as
+  // strings.
+  setDatabaseValue(kLogs, "reload_r_1500000000_10", "b");
+  setDatabaseValue(kLogs, "reload_r_1500000000_9", "a");
+
+  StrictMock<MockBufferedLogForwarder> runner("reload");
+  ASSERT_TRUE(runner.setUp());
+  runner.logString("c");
+
+  // A new forwarder loads the logs pending in the backing store.
+  StrictMock<MockBufferedLogForwarder> runner2("reload");
+  ASSERT_TRUE(runner2.setUp());
+  runner2.logString("d");
+
+  EXPECT_CALL(runner2, send(ElementsAre("a", "b", "c", "d"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner2.check();
+  runner2.check();
+
+  std::vector<std::string> indexes;
+  scanDatabaseKeys(kLogs, indexes, "reload_");
+  EXPECT_TRUE(indexes.empty());
+}
+
 TEST_F(BufferedLogForwarderTests, test_retry) {
   StrictMock<MockBufferedLogForwarder> runner;
   runner.logString("foo");
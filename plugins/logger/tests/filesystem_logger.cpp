@@ -33,6 +33,8 @@ namespace osquery {
 DECLARE_string(logger_path);
 DECLARE_bool(disable_logging);
 DECLARE_bool(logger_numerics);
+DECLARE_uint64(logger_filesystem_buffer_size);
+DECLARE_uint64(logger_filesystem_flush_interval);
 
 class FilesystemLoggerTests : public testing::Test {
  public:
@@ -85,6 +87,73 @@ TEST_F(FilesystemLoggerTests, test_log_string) {
   EXPECT_EQ(content, "{\"json\": true}\n");
 }
 
+TEST_F(FilesystemLoggerTests, test_buffered_log_string) {
+  auto plugin = std::dynamic_pointer_cast<FilesystemLoggerPlugin>(
+      Registry::get().plugin("logger", "filesystem"));
+  ASSERT_NE(plugin, nullptr);
+
+  auto buffer_size = FLAGS_logger_filesystem_buffer_size;
+  auto flush_interval = FLAGS_logger_filesystem_flush_interval;
+  FLAGS_logger_filesystem_buffer_size = 1024;
+  FLAGS_logger_filesystem_flush_interval = 60000;
+
+  EXPECT_TRUE(plugin->logString("{\"line\": 1}"));
+  EXPECT_TRUE(plugin->logString("{\"line\": 2}"));
+
+  // Lines are held until the buffer is full or flushed.
+  std::string content;
+  EXPECT_TRUE(readFile(results_path_, content));
+  EXPECT_EQ(content, "");
+  EXPECT_EQ(plugin->linesWritten(), 0U);
+
+  plugin->tearDown();
+  content.clear();
+  EXPECT_TRUE(readFile(results_path_, content));
+  EXPECT_EQ(content, "{\"line\": 1}\n{\"line\": 2}\n");
+  EXPECT_EQ(plugin->linesWritten(), 2U);
+  EXPECT_EQ(plugin->bytesWritten(), content.size());
+
+  FLAGS_logger_filesystem_buffer_size = buffer_size;
+  FLAGS_logger_filesystem_flush_interval = flush_interval;
+}
+
+TEST_F(FilesystemLoggerTests, test_log_string_batch) {
+  auto plugin = std::dynamic_pointer_cast<FilesystemLoggerPlugin>(
+      Registry::get().plugin("logger", "filesystem"));
+  ASSERT_NE(plugin, nullptr);
+
+  EXPECT_TRUE(logStringBatch(
+      {"{\"line\": 1}", "{\"line\": 2}"}, "event", "filesystem"));
+
+  std::string content;
+  EXPECT_TRUE(readFile(results_path_, content));
+  EXPECT_EQ(content, "{\"line\": 1}\n{\"line\": 2}\n");
+  EXPECT_EQ(plugin->linesWritten(), 2U);
+}
+
+TEST_F(FilesystemLoggerTests, test_log_string_rotation) {
+  if (isPlatform(PlatformType::TYPE_WINDOWS)) {
+    // An open file cannot be renamed on windows.
+    return;
+  }
+
+  EXPECT_TRUE(logString("{\"line\": 1}", "event"));
+
+  // Rotate the results log, the next line is written to a new file.
+  auto rotated_path = results_path_ + ".1";
+  fs::rename(results_path_, rotated_path);
+
+  EXPECT_TRUE(logString("{\"line\": 2}", "event"));
+
+  std::string content;
+  EXPECT_TRUE(readFile(rotated_path, content));
+  EXPECT_EQ(content, "{\"line\": 1}\n");
+
+  content.clear();
+  EXPECT_TRUE(readFile(results_path_, content));
+  EXPECT_EQ(content, "{\"line\": 2}\n");
+}
+
 class FilesystemTestLoggerPlugin : public LoggerPlugin {
  public:
   Status logString(const std::string& s) override {
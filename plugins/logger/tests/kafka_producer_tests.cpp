@@ -56,6 +56,16 @@ class MockKafkaProducerPlugin : public KafkaProducerPlugin {
     return Status(0, "OK");
   }
 
+  Status publishMsgBatch(
+      rd_kafka_topic_t* topic,
+      const std::vector<const std::string*>& payloads) override {
+    timesBatched_++;
+    for (const auto* payload : payloads) {
+      publishedMsgs_[topic].push_back(*payload);
+    }
+    return Status(0, "OK");
+  }
+
   void flushMessages() override {
     timesFlushed_++;
   }
@@ -70,6 +80,8 @@ class MockKafkaProducerPlugin : public KafkaProducerPlugin {
   std::atomic<int> timesFlushed_;
 
   std::atomic<int> timesPolled_;
+
+  std::atomic<int> timesBatched_{0};
 };
 
 class KafkaProducerPluginTest : public ::testing::Test {
@@ -355,6 +367,33 @@ TEST_F(KafkaProducerPluginTest, logString_multi_topic_happy_path) {
   EXPECT_TRUE(mkpp.timesPolled_.load() == 8);
 }
 
+TEST_F(KafkaProducerPluginTest, logStringBatch_multi_topic) {
+  MockKafkaProducerPlugin mkpp;
+
+  std::map<std::string, rd_kafka_topic_t*> qToT;
+  rd_kafka_topic_t* topicBase = reinterpret_cast<rd_kafka_topic_t*>(0x692870);
+  qToT[kKafkaBaseTopic] = topicBase;
+  rd_kafka_topic_t* topic1 = reinterpret_cast<rd_kafka_topic_t*>(0x692871);
+  qToT["topic1"] = topic1;
+  mkpp.setQueryToTopics(qToT);
+
+  std::vector<std::string> msgs = {
+      "{\"name\": \"topic1\", \"snapshot\": \"1\"}",
+      "{\"name\": \"topic10\", \"snapshot\": \"2\"}",
+      "{\"name\": \"topic1\", \"snapshot\": \"3\"}",
+  };
+  EXPECT_TRUE(mkpp.logStringBatch(msgs).ok());
+
+  std::vector<std::string> expected = {msgs[1]};
+  EXPECT_EQ(expected, mkpp.publishedMsgs_[topicBase]);
+  expected = {msgs[0], msgs[2]};
+  EXPECT_EQ(expected, mkpp.publishedMsgs_[topic1]);
+
+  // One produce call per topic and a single poll.
+  EXPECT_EQ(mkpp.timesBatched_.load(), 2);
+  EXPECT_EQ(mkpp.timesPolled_.load(), 1);
+}
+
 TEST_F(KafkaProducerPluginTest, flush_on_stop) {
   MockKafkaProducerPlugin mkpp;
 
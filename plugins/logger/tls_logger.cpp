@@ -65,6 +65,11 @@ Status TLSLoggerPlugin::logString(const std::string& s) {
   return forwarder_->logString(s);
 }
 
+Status TLSLoggerPlugin::logStringBatch(
+    const std::vector<std::string>& strings) {
+  return forwarder_->logStringBatch(strings);
+}
+
 Status TLSLoggerPlugin::logStatus(const std::vector<StatusLogLine>& log) {
   return forwarder_->logStatus(log);
 }
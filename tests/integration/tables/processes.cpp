@@ -12,6 +12,7 @@
 
 #include <osquery/tests/integration/tables/helper.h>
 
+#include <osquery/process/process.h>
 #include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/info/platform_type.h>
 #include <osquery/utils/system/uptime.h>
@@ -104,5 +105,25 @@ TEST_F(ProcessesTest, test_sanity) {
   validate_rows(data, row_map);
 }
 
+TEST_F(ProcessesTest, test_used_columns) {
+  // Tables may only generate the columns used by the query.
+  auto const data = execute_query("select pid, name from processes");
+  ASSERT_GE(data.size(), 2ul);
+
+  ValidationMap row_map = {
+      {"pid", IntType},
+      {"name", NormalType},
+  };
+  validate_rows(data, row_map);
+
+  auto const pid = std::to_string(platformGetPid());
+  auto const self =
+      execute_query("select pid, name, path from processes where pid = " + pid);
+  ASSERT_EQ(self.size(), 1ul);
+  EXPECT_EQ(self[0].at("pid"), pid);
+  EXPECT_FALSE(self[0].at("name").empty());
+  EXPECT_FALSE(self[0].at("path").empty());
+}
+
 } // namespace table_tests
 } // namespace osquery
@@ -82,6 +82,7 @@ TABLE_ATTRIBUTES = {
     "cacheable": "CACHEABLE",
     "utility": "UTILITY",
     "kernel_required": "KERNEL_REQUIRED", # Deprecated
+    "memoizable": "MEMOIZABLE",
 }
 
 
@@ -243,6 +244,11 @@ class TableState(Singleton):
                 print(lightred(
                     "Table cannot use a generator and be marked cacheable: %s" % (path)))
                 exit(1)
+        if "memoizable" in self.attributes:
+            if self.generator:
+                print(lightred(
+                    "Table cannot use a generator and be marked memoizable: %s" % (path)))
+                exit(1)
         if self.table_name == "" or self.function == "":
             print(lightred("Invalid table spec: %s" % (path)))
             exit(1)
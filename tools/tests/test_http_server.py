@@ -300,6 +300,12 @@ class RealSimpleHandler(BaseHTTPRequestHandler):
     # Endpoint where the blocks of the carve are received, and
     # susequently reassembled.
     def continue_carve(self, request):
+        # The agent waits for every block to be acknowledged, reply once the
+        # block is stored and the carve reassembled if it was the last one
+        self.store_carve_block(request)
+        self._reply({})
+
+    def store_carve_block(self, request):
         # First check if we have already received this block
         if request['block_id'] in FILE_CARVE_MAP[request['session_id']][
                 'blocks_received']: